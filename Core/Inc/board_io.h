@@ -0,0 +1,188 @@
+/**
+  ******************************************************************************
+  * @file           : board_io.h
+  * @brief          : Direct register access for the input interrupts and ADC
+  ******************************************************************************
+  * @attention
+  *
+  * Static inline accessors with the pins from main.h fixed at compile time,
+  * for the paths that run on every edge or sample. They replace
+  * HAL_GPIO_ReadPin(), HAL_GPIO_EXTI_IRQHandler() and the
+  * HAL_ADC_ConfigChannel() / Start / PollForConversion sequence. Each of
+  * those HAL calls checks parameters and state on every call; these
+  * accessors are a few register loads and stores.
+  *
+  * The stream accessors run the ADC continuously into DMA1 channel 1 for
+  * burst captures (circular) and spectrum frames (one shot), and put it
+  * back into single conversion mode afterwards.
+  *
+  * The encoder channels A and B must share one GPIO port, so both are read
+  * with a single IDR load. The header only needs the CMSIS register
+  * definitions and the LL ADC inlines, so a host stub providing those can
+  * compile it.
+  ******************************************************************************
+  */
+
+#ifndef __BOARD_IO_H
+#define __BOARD_IO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "stm32l0xx_ll_adc.h"
+
+/**
+  * @brief  Button level, 1 when the pin is high
+  */
+static inline uint8_t Board_Read_Button(void)
+{
+    return (USER_BUTTON_GPIO_Port->IDR & USER_BUTTON_Pin) ? 1U : 0U;
+}
+
+/**
+  * @brief  Encoder levels as (A << 1) | B, from one port read
+  */
+static inline uint8_t Board_Read_Encoder(void)
+{
+    uint32_t idr = ROT_CHA_GPIO_Port->IDR;
+
+    return (uint8_t)(((idr & ROT_CHA_Pin) ? 2U : 0U) | ((idr & ROT_CHB_Pin) ? 1U : 0U));
+}
+
+/**
+  * @brief  Switch LED_RED
+  * @param  on Nonzero to light it
+  */
+static inline void Board_Led_Red(uint8_t on)
+{
+    if (on) {
+        LED_RED_GPIO_Port->BSRR = LED_RED_Pin;
+    } else {
+        LED_RED_GPIO_Port->BRR = LED_RED_Pin;
+    }
+}
+
+/**
+  * @brief  Clear EXTI pending bits (write 1 to clear)
+  * @param  pins GPIO_PIN_x mask, equal to the EXTI line mask
+  * @note   Clear before reading the pins, so an edge during the handler
+  *         raises the interrupt again instead of being lost.
+  */
+static inline void Board_Clear_Exti(uint32_t pins)
+{
+    EXTI->PR = pins;
+}
+
+/**
+  * @brief  Enable the ADC and the VREFINT / temperature sensor paths once
+  * @note   The temperature sensor needs 10 us before its first conversion.
+  */
+static inline void Board_Adc_Enable(void)
+{
+    LL_ADC_SetCommonPathInternalCh(__LL_ADC_COMMON_INSTANCE(ADC1),
+                                   LL_ADC_PATH_INTERNAL_VREFINT | LL_ADC_PATH_INTERNAL_TEMPSENSOR);
+    LL_ADC_ClearFlag_ADRDY(ADC1);
+    LL_ADC_Enable(ADC1);
+    while (!LL_ADC_IsActiveFlag_ADRDY(ADC1)) {
+    }
+}
+
+/**
+  * @brief  Single polled conversion
+  * @param  channel HAL ADC_CHANNEL_x
+  * @retval 12-bit code
+  */
+static inline uint16_t Board_Adc_Read(uint32_t channel)
+{
+    ADC1->CHSELR = channel & ADC_CHANNEL_MASK;
+    LL_ADC_REG_StartConversion(ADC1);
+    while (!LL_ADC_IsActiveFlag_EOC(ADC1)) {
+    }
+    return LL_ADC_REG_ReadConversionData12(ADC1);   // Clears EOC
+}
+
+/**
+  * @brief  Convert continuously into a DMA buffer
+  * @param  channels HAL ADC_CHANNEL_x mask, converted in ascending order
+  * @param  sampling SMPR code, 0 (1.5 cycles) to 7 (160.5 cycles)
+  * @param  oversampling Log2 of the conversions averaged per sample, 0 to 8
+  * @param  buffer Samples
+  * @param  count Samples in the buffer
+  * @param  circular 1 to wrap around with half and full transfer interrupts,
+  *         0 to fill the buffer once; the DMA then stops by itself and
+  *         raises the full transfer interrupt
+  * @note   The ADC must be idle. The oversampler shifts the sum back to
+  *         12 bits, so the codes and the analog watchdog keep their scale.
+  */
+static inline void Board_Adc_Stream_Start(uint32_t channels, uint32_t sampling, uint32_t oversampling,
+                                          volatile uint16_t* buffer, uint16_t count, uint8_t circular)
+{
+    // The oversampler can only be configured with the ADC disabled
+    LL_ADC_Disable(ADC1);
+    while (LL_ADC_IsEnabled(ADC1)) {
+    }
+    ADC1->CFGR2 &= ~(ADC_CFGR2_OVSE | ADC_CFGR2_OVSR | ADC_CFGR2_OVSS);
+    if (oversampling > 0) {
+        ADC1->CFGR2 |= ADC_CFGR2_OVSE | ((oversampling - 1) << ADC_CFGR2_OVSR_Pos) |
+                       (oversampling << ADC_CFGR2_OVSS_Pos);
+    }
+    Board_Adc_Enable();
+
+    ADC1->SMPR = sampling;
+    ADC1->CHSELR = channels & ADC_CHANNEL_MASK;
+    // Overwrite on overrun, so a late DMA cycle never stops the stream
+    ADC1->CFGR1 |= ADC_CFGR1_CONT | ADC_CFGR1_DMAEN | ADC_CFGR1_DMACFG | ADC_CFGR1_OVRMOD;
+    ADC1->ISR = ADC_ISR_EOC | ADC_ISR_EOS | ADC_ISR_OVR;
+
+    DMA1_Channel1->CCR = 0;
+    DMA1_CSELR->CSELR &= ~DMA_CSELR_C1S;                // Request 0, ADC
+    DMA1->IFCR = DMA_IFCR_CGIF1;
+    DMA1_Channel1->CPAR = (uint32_t)&ADC1->DR;
+    DMA1_Channel1->CMAR = (uint32_t)buffer;
+    DMA1_Channel1->CNDTR = count;
+    DMA1_Channel1->CCR = DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 | DMA_CCR_MINC | DMA_CCR_TCIE |
+                         (circular ? (DMA_CCR_CIRC | DMA_CCR_HTIE) : 0U) | DMA_CCR_EN;
+
+    LL_ADC_REG_StartConversion(ADC1);
+}
+
+/**
+  * @brief  Stop the conversions and the DMA channel, from the DMA interrupt
+  * @note   Conversions already under way may still complete and be written.
+  */
+static inline void Board_Adc_Stream_Halt(void)
+{
+    if (LL_ADC_REG_IsConversionOngoing(ADC1)) {
+        LL_ADC_REG_StopConversion(ADC1);
+    }
+    DMA1_Channel1->CCR &= ~(DMA_CCR_EN | DMA_CCR_HTIE | DMA_CCR_TCIE);
+    DMA1->IFCR = DMA_IFCR_CGIF1;
+}
+
+/**
+  * @brief  Return to single software-started conversions after a stream
+  * @note   Restores the fastest sampling time and no oversampling.
+  */
+static inline void Board_Adc_Stream_Restore(void)
+{
+    Board_Adc_Stream_Halt();
+    while (LL_ADC_REG_IsStopConversionOngoing(ADC1)) {
+    }
+    ADC1->CFGR1 &= ~(ADC_CFGR1_CONT | ADC_CFGR1_DMAEN | ADC_CFGR1_DMACFG | ADC_CFGR1_OVRMOD);
+
+    LL_ADC_Disable(ADC1);
+    while (LL_ADC_IsEnabled(ADC1)) {
+    }
+    ADC1->CFGR2 &= ~(ADC_CFGR2_OVSE | ADC_CFGR2_OVSR | ADC_CFGR2_OVSS);
+    ADC1->SMPR = 0;
+    ADC1->ISR = ADC_ISR_EOC | ADC_ISR_EOS | ADC_ISR_OVR;
+    Board_Adc_Enable();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOARD_IO_H */
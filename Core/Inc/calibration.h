@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file           : calibration.h
+  * @brief          : Runtime ADC calibration with data EEPROM storage
+  ******************************************************************************
+  * @attention
+  *
+  * Each channel maps a raw ADC code to milli-units (mV, mA) with a straight
+  * line in fixed point:
+  *
+  *     value = ((raw * gain_q16) >> 16) + offset
+  *
+  * Calibration captures (raw, reference) pairs per channel, from the menu or
+  * the UART console. Calibration_Commit() fits every channel with at least
+  * two points by least squares and stores both lines in data EEPROM with a
+  * CRC-32. At boot a valid record replaces the compiled-in defaults.
+  *
+  * With three or more points a channel also gets a piecewise-linear table
+  * of CAL_LUT_POINTS breakpoints, one every 256 codes from 0 to 4096, built
+  * from the points sorted by code (end segments extrapolated). While a
+  * table is active it replaces the line: the top bits of the code index a
+  * segment and the low 8 bits interpolate inside it, so any code converts
+  * in constant time with integer math.
+  *
+  * Calibration_Set_Zero() learns the code a channel reads with no input
+  * (auto-zero) and stores a correction so that code converts to 0; results
+  * are signed, so currents flowing backwards read negative.
+  * Calibration_Auto_Zero() averages a sum of unloaded conversions into that
+  * code. At boot it leaves a loaded channel alone and keeps the stored
+  * correction while the new one is within CAL_ZERO_DEADBAND of it, so the
+  * record is not rewritten each power-up for a fraction of a code of noise.
+  ******************************************************************************
+  */
+
+#ifndef __CALIBRATION_H
+#define __CALIBRATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define CAL_MAX_POINTS          8        // Captured points per channel
+#define CAL_MAGIC               0x334C4143UL   // "CAL3"
+#define CAL_LUT_SHIFT           8        // Codes per table segment = 1 << shift
+#define CAL_LUT_POINTS          ((4096 >> CAL_LUT_SHIFT) + 1)
+#define CAL_ZERO_DEADBAND       4        // Milli-units, about one current code
+
+typedef enum {
+    CAL_VOLTAGE = 0,
+    CAL_CURRENT,
+    CAL_CHANNELS
+} Cal_Channel_t;
+
+typedef struct {
+    int32_t gain_q16;       // Milli-units per ADC code, Q16
+    int32_t offset;         // Milli-units
+} Cal_Line_t;
+
+typedef struct {
+    uint16_t raw;           // ADC code
+    int32_t reference;      // Reference value in milli-units
+} Cal_Point_t;
+
+typedef enum {
+    CAL_ZERO_STORED = 0,    // New correction in use and stored
+    CAL_ZERO_KEPT,          // Within the deadband, the stored one stays
+    CAL_ZERO_LOADED,        // Reading beyond the limit, nothing changed
+    CAL_ZERO_FAILED         // Storing failed
+} Cal_Zero_Result_t;
+
+void Calibration_Init(const Cal_Line_t defaults[CAL_CHANNELS]);
+int32_t Calibration_Apply(Cal_Channel_t channel, uint32_t raw);
+const Cal_Line_t* Calibration_Get(Cal_Channel_t channel);
+
+uint8_t Calibration_Capture(Cal_Channel_t channel, uint16_t raw, int32_t reference);
+uint8_t Calibration_Point_Count(Cal_Channel_t channel);
+void Calibration_Clear_Points(void);
+uint8_t Calibration_Commit(void);
+uint8_t Calibration_Restore_Defaults(void);
+
+uint8_t Calibration_Lut_Active(Cal_Channel_t channel);
+int32_t Calibration_Read_Q4(Cal_Channel_t channel, uint32_t raw_q4);
+uint8_t Calibration_Set_Zero(Cal_Channel_t channel, uint32_t raw_q4);
+int32_t Calibration_Get_Zero(Cal_Channel_t channel);
+Cal_Zero_Result_t Calibration_Auto_Zero(Cal_Channel_t channel, uint32_t sum, uint32_t samples, int32_t limit);
+
+uint8_t Calibration_Fit(const Cal_Point_t* points, uint8_t count, Cal_Line_t* line);
+uint8_t Calibration_Build_Lut(Cal_Point_t* points, uint8_t count, int32_t lut[CAL_LUT_POINTS]);
+int32_t Calibration_Lut_Apply(const int32_t lut[CAL_LUT_POINTS], uint32_t raw);
+uint32_t Calibration_Crc32(const void* data, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CALIBRATION_H */
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file           : compensation.h
+  * @brief          : VDDA and temperature compensation of raw ADC codes
+  ******************************************************************************
+  * @attention
+  *
+  * The ADC converts against VDDA, which is only nominally 3.3 V. About once
+  * a second the internal VREFINT and temperature sensor channels are
+  * sampled; with the factory values VREFINT_CAL and TS_CAL1/TS_CAL2 (taken
+  * at VDDA = 3.0 V) Compensation_Update() derives the real VDDA and the die
+  * temperature.
+  *
+  * Compensation_Apply() rescales a raw code to the code it would read at
+  * the nominal COMPENSATION_VDDA_NOMINAL_MV, and removes a linear gain drift
+  * of tempco_ppm per degree from COMPENSATION_TEMP_REF_DC, both as one Q16
+  * factor per channel. Calibration therefore works on compensated codes.
+  ******************************************************************************
+  */
+
+#ifndef __COMPENSATION_H
+#define __COMPENSATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "calibration.h"
+
+#define COMPENSATION_VDDA_NOMINAL_MV  3300     // VDDA the calibration refers to
+#define COMPENSATION_FACTORY_VDDA_MV  3000     // VDDA of the factory calibration
+#define COMPENSATION_TEMP_REF_DC      250      // Temperature without drift correction (0.1 C)
+
+typedef struct {
+    uint16_t vrefint_cal;               // VREFINT code at 3.0 V
+    uint16_t ts_cal1;                   // Temperature sensor code at 30 C, 3.0 V
+    uint16_t ts_cal2;                   // Temperature sensor code at 130 C, 3.0 V
+    int16_t tempco_ppm[CAL_CHANNELS];   // Gain drift of each input path (ppm/C)
+} Compensation_Config_t;
+
+void Compensation_Init(const Compensation_Config_t* config);
+void Compensation_Update(uint16_t vrefint_raw, uint16_t temperature_raw);
+uint32_t Compensation_Apply(Cal_Channel_t channel, uint32_t raw);
+uint16_t Compensation_Get_Vdda_mV(void);
+int16_t Compensation_Get_Temperature_dC(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COMPENSATION_H */
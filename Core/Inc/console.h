@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file           : console.h
+  * @brief          : Line based UART console on USART1 (PA9 TX, PA10 RX)
+  ******************************************************************************
+  * @attention
+  *
+  * Bytes are received one at a time by the RXNE interrupt into a line
+  * buffer. A line ends at CR or LF; until the main loop has taken it with
+  * Console_Get_Line(), further input is dropped. Replies are sent blocking
+  * from the main loop, so nothing is transmitted from interrupt context.
+  * Only the clock, pins and interrupt come from the HAL (HAL_UART_MspInit);
+  * the port itself is programmed by register, which keeps the HAL UART
+  * init, interrupt and transfer code out of the image.
+  ******************************************************************************
+  */
+
+#ifndef __CONSOLE_H
+#define __CONSOLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+#define CONSOLE_LINE_SIZE       32       // Longest command line, terminator included
+
+void Console_Init(USART_TypeDef* usart, uint32_t clock_hz);
+void Console_IRQHandler(void);
+uint8_t Console_Line_Ready(void);
+uint8_t Console_Get_Line(char* dst);
+void Console_Write(const char* str);
+const char* Console_Parse_Int(const char* str, int32_t* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONSOLE_H */
@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file           : demand.h
+  * @brief          : Sliding-window demand (average power) metering
+  ******************************************************************************
+  * @attention
+  *
+  * Energy is collected into fixed DEMAND_BUCKET_S buckets kept in a ring of
+  * DEMAND_BUCKETS, which is the longest window. Each window keeps a running
+  * sum of its most recent buckets: when a bucket closes it is added to every
+  * sum and the bucket falling out of each window is subtracted, so an update
+  * costs the same regardless of the window length and the RAM is fixed.
+  *
+  * The averages step once per closed bucket. Until a window has filled, its
+  * average covers the buckets seen so far. The peak of a window is the
+  * highest average over a complete window since the last reset, as on a
+  * utility demand register. Power is signed, negative when energy flows
+  * back.
+  ******************************************************************************
+  */
+
+#ifndef __DEMAND_H
+#define __DEMAND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define DEMAND_BUCKET_S         20U             // Bucket length, window step
+#define DEMAND_BUCKET_US        (DEMAND_BUCKET_S * 1000000UL)
+#define DEMAND_BUCKETS          45U             // 15 minutes of buckets
+#define DEMAND_WINDOWS          3U              // 1, 5 and 15 minutes
+
+typedef struct {
+    int32_t average_mw[DEMAND_WINDOWS];     // Average power over each window
+    int32_t peak_mw[DEMAND_WINDOWS];        // Highest complete window average
+} Demand_Values_t;
+
+typedef struct {
+    int32_t bucket_mj[DEMAND_BUCKETS];      // Closed buckets, mJ = mW * s
+    int32_t window_mj[DEMAND_WINDOWS];      // Running sum of each window
+    int64_t open_nj;                        // Bucket being filled
+    uint32_t open_us;                       // Time already in it
+    int32_t last_power_mw;                  // Previous sample
+    uint8_t head;                           // Slot the open bucket closes into
+    uint8_t filled;                         // Closed buckets, up to DEMAND_BUCKETS
+    uint8_t primed;                         // Previous sample valid
+    Demand_Values_t values;
+} Demand_t;
+
+void Demand_Reset(Demand_t* demand);
+void Demand_Reset_Peaks(Demand_t* demand);
+void Demand_Sample(Demand_t* demand, int32_t power_mw, uint32_t delta_us);
+uint8_t Demand_Window_Minutes(uint8_t window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DEMAND_H */
@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file           : encoder.h
+  * @brief          : Table-driven quadrature decoder for the rotary encoder
+  ******************************************************************************
+  * @attention
+  *
+  * Every A/B edge is fed to Encoder_Decode() with the new pin state
+  * (A << 1 | B). A 16-entry table indexed by (old << 2 | new) gives the
+  * quarter step. Contact bounce on one channel produces +1/-1 pairs that
+  * cancel, and a transition where both channels change at once is dropped
+  * with a resync, so no time lockout is needed.
+  *
+  * A detent step is reported when the encoder comes back to its rest state
+  * (the state seen at Encoder_Init()) having moved at least half a cycle.
+  * Steps closer together than the acceleration thresholds are multiplied
+  * by 10 or 100 so fast spins move value editors quickly.
+  *
+  * When the knob is wired to a timer in encoder mode the hardware does the
+  * quadrature counting. Encoder_Decode_Counter() is then called once per
+  * tick with the raw 16-bit counter and turns the count delta into detent
+  * steps with the same acceleration, keeping partial detents for the next
+  * call. The counter may wrap freely.
+  ******************************************************************************
+  */
+
+#ifndef __ENCODER_H
+#define __ENCODER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define ENCODER_ACCEL_X100_MS   15       // Detents closer than this count 100
+#define ENCODER_ACCEL_X10_MS    40       // Detents closer than this count 10
+#define ENCODER_COUNTS_PER_DETENT 4      // Quadrature counts per detent
+#define ENCODER_MAX_STEPS       100      // Largest step reported per call
+
+typedef struct {
+    uint8_t state;          // Last A/B state
+    uint8_t detent;         // Rest state between detents
+    int8_t accumulator;     // Quarter steps since the last detent
+    uint16_t count;         // Last timer count (counter mode)
+    uint32_t last_step_ms;  // Time of the last detent step
+} Encoder_t;
+
+void Encoder_Init(Encoder_t* encoder, uint8_t ab);
+int8_t Encoder_Decode(Encoder_t* encoder, uint8_t ab, uint32_t now_ms);
+void Encoder_Init_Counter(Encoder_t* encoder, uint16_t count);
+int8_t Encoder_Decode_Counter(Encoder_t* encoder, uint16_t count, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ENCODER_H */
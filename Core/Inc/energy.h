@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @file           : energy.h
+  * @brief          : Bidirectional energy and charge accumulators
+  ******************************************************************************
+  * @attention
+  *
+  * Power and current are integrated per sample pair with the trapezoidal
+  * rule in integer math: mW * us = nJ and mA * us = nC. When the two samples
+  * of a pair have opposite signs the pair is split at the interpolated zero
+  * crossing, so the import counters only collect the positive area (energy
+  * drawn) and the export counters the negative one (battery charging, solar
+  * feed-in), and the two never cancel. The 64-bit counters cover about
+  * 5000 kWh without wrapping; net values are import minus export.
+  *
+  * An interval longer than ENERGY_GAP_US (a late or missed tick) is counted
+  * as a gap and bridged by the same linear interpolation instead of being
+  * dropped.
+  ******************************************************************************
+  */
+
+#ifndef __ENERGY_H
+#define __ENERGY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define ENERGY_NJ_PER_MWH       3600000000ULL   // 1 mWh = 3.6 J
+#define ENERGY_NC_PER_MAH       3600000000ULL   // 1 mAh = 3.6 C
+
+#ifndef ENERGY_GAP_US
+#define ENERGY_GAP_US           250000UL        // Longer sample intervals are gaps
+#endif
+
+typedef struct {
+    uint64_t import_nj;     // Energy drawn from the source
+    uint64_t export_nj;     // Energy fed back
+    uint64_t charge_in_nc;  // Charge with positive current
+    uint64_t charge_out_nc; // Charge with negative current
+    uint32_t gaps;          // Bridged intervals longer than ENERGY_GAP_US
+    uint32_t gap_ms;        // Total time of the bridged gaps
+    int32_t last_power_mw;  // Previous sample, start of the next trapezoid
+    int32_t last_current_ma;
+    uint8_t primed;         // Previous sample valid
+} Energy_t;
+
+void Energy_Reset(Energy_t* energy);
+void Energy_Sample(Energy_t* energy, int32_t power_mw, int32_t current_ma, uint32_t delta_us);
+int32_t Energy_To_mWh(uint64_t energy_nj);
+int32_t Energy_Net_mWh(const Energy_t* energy);
+int32_t Energy_To_mAh(uint64_t charge_nc);
+int32_t Energy_Net_mAh(const Energy_t* energy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ENERGY_H */
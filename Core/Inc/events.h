@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file           : events.h
+  * @brief          : Load step (appliance on/off) detection with event log
+  ******************************************************************************
+  * @attention
+  *
+  * The power stream of the measurement tick is smoothed by a short moving
+  * average and compared with the steady level before it. A deviation of at
+  * least the step threshold starts a candidate; it becomes an event once the
+  * deviation has stayed above the release level, the threshold less the
+  * hysteresis, for the debounce time. Shorter excursions are dropped. The
+  * power after the step is the mean of the raw samples over a second
+  * debounce time, which leaves inrush peaks out of it; the step is recorded
+  * if that mean still clears the release level. While no step is pending the
+  * steady level follows slow drift, so ramps do not turn into events.
+  *
+  * Events go into a ring of EVENTS_LOG entries, overwriting the oldest. The
+  * tick is the only writer; Events_Get() copies an entry and retries if the
+  * tick recorded a new event meanwhile. The slot is written before the total
+  * moves, so a reader must never interrupt the tick; the main loop may read.
+  * Every sample costs the same.
+  ******************************************************************************
+  */
+
+#ifndef __EVENTS_H
+#define __EVENTS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define EVENTS_LOG              16U             // Logged events, power of two
+
+typedef struct {
+    uint16_t step_dw;           // Smallest step reported, 0.1 W
+    uint16_t hysteresis_pct;    // Candidate dropped below step * (100 - hysteresis) / 100
+    uint16_t debounce_ms;       // Time the new level must hold
+} Events_Config_t;
+
+typedef struct {
+    uint32_t time_ms;           // Timebase at the start of the step
+    int16_t before_dw;          // Steady power before the step, 0.1 W
+    int16_t after_dw;           // Mean power after the step
+} Load_Event_t;
+
+typedef struct {
+    Load_Event_t log[EVENTS_LOG];
+    volatile uint32_t total;    // Events recorded since the last reset
+    int32_t filtered_mw;        // Smoothed power
+    int32_t steady_mw;          // Level before a step
+    int32_t after_sum_mw;       // Raw samples after the settle time
+    uint16_t after_count;
+    uint32_t onset_ms;          // First sample beyond the release level
+    uint32_t pending_ms;        // Start of the current pending phase
+    int8_t pending;             // Direction of a pending step, 0 if none
+    uint8_t measuring;          // Pending step past its settle time
+    uint8_t onset;              // onset_ms valid
+    uint8_t primed;             // Levels valid
+} Events_t;
+
+void Events_Reset(Events_t* events);
+void Events_Sample(Events_t* events, const Events_Config_t* config, int32_t power_mw, uint32_t now_ms);
+uint32_t Events_Total(const Events_t* events);
+uint8_t Events_Count(const Events_t* events);
+uint8_t Events_Get(const Events_t* events, uint8_t age, Load_Event_t* dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENTS_H */
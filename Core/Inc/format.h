@@ -0,0 +1,41 @@
+/**
+  ******************************************************************************
+  * @file           : format.h
+  * @brief          : Integer-only number formatting for the OLED display paths
+  ******************************************************************************
+  * @attention
+  *
+  * Replaces sprintf() in the display code so that newlib-nano's vfprintf,
+  * _printf_i and the malloc family are not linked into the 32KB image.
+  * All functions write into a caller supplied buffer, terminate it and
+  * return a pointer to the terminating '\0' so calls can be chained:
+  *
+  *   char* p = line;
+  *   p = Format_String(p, "V:");
+  *   p = Format_Fixed(p, voltage_dV, 1, 0);
+  *   p = Format_String(p, "V");
+  *
+  * The caller is responsible for the buffer being large enough.
+  ******************************************************************************
+  */
+
+#ifndef __FORMAT_H
+#define __FORMAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+char* Format_String(char* dst, const char* str);
+char* Format_Uint(char* dst, uint32_t value, uint8_t min_width, char pad);
+char* Format_Fixed(char* dst, int32_t value, uint8_t decimals, uint8_t min_width);
+char* Format_Energy(char* dst, uint32_t energy_mwh);
+char* Format_Pad(char* start, char* end, uint8_t width);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FORMAT_H */
@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file           : histogram.h
+  * @brief          : Load profile, time spent in log-spaced power bins
+  ******************************************************************************
+  * @attention
+  *
+  * HISTOGRAM_BINS bins with lower edges base * 10^(k / per_decade) for
+  * k = 0 .. HISTOGRAM_BINS - 2 above bin 0, which takes everything below
+  * the first edge, including no load and power fed back. Each sample adds
+  * its interval to one 32-bit millisecond counter; the bin is found with a
+  * fixed number of integer compares against the edge table. Sub-millisecond
+  * remainders carry over to the next sample. Counters saturate after about
+  * 49 days in one bin and then set the saturated flag.
+  *
+  * The edges are rebuilt, and the counters cleared, when the sampling side
+  * sees a new configuration. Single writer; every counter is one word, so
+  * readers in the main loop see each one whole.
+  ******************************************************************************
+  */
+
+#ifndef __HISTOGRAM_H
+#define __HISTOGRAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define HISTOGRAM_BINS          16U             // Power of two, see Histogram_Bin()
+#define HISTOGRAM_MAX_PER_DECADE 6U
+
+typedef struct {
+    uint16_t base_mw;                       // Lower edge of bin 1
+    uint16_t per_decade;                    // Bins per power of ten, 1 to 6
+} Histogram_Config_t;
+
+typedef struct {
+    uint32_t bin_ms[HISTOGRAM_BINS];        // Time spent in each bin
+    uint32_t edge_mw[HISTOGRAM_BINS - 1];   // Lower edges of bins 1 and up
+    uint32_t remainder_us;                  // Time not yet counted
+    Histogram_Config_t applied;             // Configuration of the edges
+    uint8_t saturated;                      // A counter reached UINT32_MAX
+} Histogram_t;
+
+void Histogram_Configure(Histogram_t* histogram, const Histogram_Config_t* config);
+void Histogram_Reset(Histogram_t* histogram);
+uint8_t Histogram_Bin(const Histogram_t* histogram, int32_t power_mw);
+void Histogram_Sample(Histogram_t* histogram, const Histogram_Config_t* config,
+                      int32_t power_mw, uint32_t delta_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HISTOGRAM_H */
@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file           : input.h
+  * @brief          : Input event queue and button gesture recognizer
+  ******************************************************************************
+  * @attention
+  *
+  * Interrupt handlers only timestamp raw input (button down/up, encoder
+  * steps) and push it to an Input_Queue_t. Each queue is single producer /
+  * single consumer: exactly one ISR pushes, the main loop pops, and head /
+  * tail are each written by one side only, so no locking is needed. Sources
+  * that run in different interrupts get their own queue.
+  *
+  * The main loop feeds button events to a Gesture_Recognizer_t and calls
+  * Gesture_Update() every pass for the time based gestures:
+  * - click / double / triple: release within GESTURE_CLICK_GAP_MS of the
+  *   previous one, reported once the gap expires (triple at once)
+  * - hold:        pressed for GESTURE_HOLD_MS, the press is not a click
+  * - hold repeat: while still held, first after GESTURE_REPEAT_DELAY_MS,
+  *   then every interval, shrinking 3/4 per repeat down to
+  *   GESTURE_REPEAT_MIN_MS
+  ******************************************************************************
+  */
+
+#ifndef __INPUT_H
+#define __INPUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define INPUT_QUEUE_SIZE        8        // Events per queue, power of two
+
+#define GESTURE_CLICK_GAP_MS    300      // Max release to press gap inside a multi-click
+#define GESTURE_HOLD_MS         1000     // Press duration that makes a hold
+#define GESTURE_REPEAT_DELAY_MS 400      // Hold to first repeat
+#define GESTURE_REPEAT_MIN_MS   50       // Fastest repeat interval
+
+typedef enum {
+    INPUT_BUTTON_DOWN = 0,
+    INPUT_BUTTON_UP,
+    INPUT_ROTATE            // value = detent steps from the encoder decoder
+} Input_EventType_t;
+
+typedef struct {
+    uint32_t time_ms;
+    uint8_t type;           // Input_EventType_t
+    int8_t value;
+} Input_Event_t;
+
+typedef struct {
+    Input_Event_t events[INPUT_QUEUE_SIZE];
+    volatile uint8_t head;      // Written by the producer only
+    volatile uint8_t tail;      // Written by the consumer only
+    volatile uint8_t dropped;   // Events lost to a full queue, producer side
+} Input_Queue_t;
+
+typedef enum {
+    GESTURE_NONE = 0,
+    GESTURE_CLICK,
+    GESTURE_DOUBLE_CLICK,
+    GESTURE_TRIPLE_CLICK,
+    GESTURE_HOLD,
+    GESTURE_HOLD_REPEAT
+} Gesture_Type_t;
+
+typedef struct {
+    uint8_t pressed;
+    uint8_t held;               // Current press already reported as a hold
+    uint8_t clicks;             // Clicks waiting for the gap to expire
+    uint32_t press_ms;
+    uint32_t release_ms;
+    uint32_t repeat_ms;         // Time of the next hold repeat
+    uint16_t repeat_interval;
+} Gesture_Recognizer_t;
+
+uint8_t Input_Queue_Push(Input_Queue_t* queue, const Input_Event_t* event);
+uint8_t Input_Queue_Pop(Input_Queue_t* queue, Input_Event_t* event);
+uint8_t Input_Queue_Empty(const Input_Queue_t* queue);
+
+void Gesture_Init(Gesture_Recognizer_t* gesture);
+Gesture_Type_t Gesture_Event(Gesture_Recognizer_t* gesture, const Input_Event_t* event);
+Gesture_Type_t Gesture_Update(Gesture_Recognizer_t* gesture, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INPUT_H */
@@ -41,6 +41,40 @@ extern "C" {
 
 /* Exported constants --------------------------------------------------------*/
 /* USER CODE BEGIN EC */
+// Optional features, 1 = built in. They do not all fit the 32 KB of flash
+// at once; the flash budget in docs/development/build-environment.md gives
+// the cost of each. The defaults fit both configurations, the larger -Og
+// code of Debug leaves room for fewer. Override on the compiler line, e.g.
+// -DFEATURE_SCOPE=1 -DFEATURE_CONSOLE=0
+#ifdef DEBUG
+#define FEATURE_RELEASE_DEFAULT 0
+#else
+#define FEATURE_RELEASE_DEFAULT 1
+#endif
+#ifndef FEATURE_CALIBRATION
+#define FEATURE_CALIBRATION     1        // Calibration page and console CAL capture
+#endif
+#ifndef FEATURE_CONSOLE
+#define FEATURE_CONSOLE         FEATURE_RELEASE_DEFAULT  // UART console on USART1 (console.c)
+#endif
+#ifndef FEATURE_PROTECTION
+#define FEATURE_PROTECTION      FEATURE_RELEASE_DEFAULT  // Over-voltage/current trip (protection.c)
+#endif
+#ifndef FEATURE_DEMAND
+#define FEATURE_DEMAND          0        // 1/5/15 minute demand page (demand.c)
+#endif
+#ifndef FEATURE_HISTOGRAM
+#define FEATURE_HISTOGRAM       0        // Load profile page (histogram.c)
+#endif
+#ifndef FEATURE_EVENTS
+#define FEATURE_EVENTS          0        // Load step log and browser (events.c)
+#endif
+#ifndef FEATURE_SPECTRUM
+#define FEATURE_SPECTRUM        0        // FFT page and console command (spectrum.c)
+#endif
+#ifndef FEATURE_SCOPE
+#define FEATURE_SCOPE           0        // Burst scope page and console command (scope.c)
+#endif
 
 /* USER CODE END EC */
 
@@ -56,6 +90,7 @@ void Error_Handler(void);
 void Timer_Interrupt_Handler(void);
 void User_Button_Interrupt_Handler(void);
 void Rotary_Encoder_Interrupt_Handler(void);
+void Adc_Stream_Interrupt_Handler(void);
 uint32_t Get_ADC_Value(uint32_t adc_channel);
 
 /* USER CODE END EFP */
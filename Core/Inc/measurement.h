@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file           : measurement.h
+  * @brief          : Coherent measurement snapshots from the TIM6 tick
+  ******************************************************************************
+  * @attention
+  *
+  * The measurement tick publishes each result set as a whole through a
+  * two-slot sequence latch. The writer fills the slot readers are not
+  * directed to, then bumps the sequence, whose low bit selects the slot to
+  * read. A reader copies the selected slot and retries only if the sequence
+  * moved meanwhile, i.e. if the tick preempted it. The writer never waits.
+  * Readers running above the tick priority always find a complete slot and
+  * do not retry. Interrupts are never disabled.
+  *
+  * Single writer only. Readers that the writer can preempt twice in a row
+  * within one copy simply retry again.
+  ******************************************************************************
+  */
+
+#ifndef __MEASUREMENT_H
+#define __MEASUREMENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "energy.h"
+#include "demand.h"
+
+typedef struct {
+    uint32_t timestamp_us;  // Timebase at the sample
+    float voltage;          // V
+    float current;          // A, negative when flowing back
+    float power;            // W, negative when energy flows back
+    float peak_voltage;
+    float peak_current;
+    float peak_power;
+    Energy_t energy;        // Counters up to this sample
+    Demand_Values_t demand; // Window averages and peaks
+} Measurement_t;
+
+typedef struct {
+    volatile uint32_t sequence;
+    Measurement_t slots[2];
+} Measurement_Latch_t;
+
+void Measurement_Publish(Measurement_Latch_t* latch, const Measurement_t* measurement);
+void Measurement_Read(const Measurement_Latch_t* latch, Measurement_t* dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MEASUREMENT_H */
@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file           : power.h
+  * @brief          : Idle sleep and MCU duty cycle accounting
+  ******************************************************************************
+  * @attention
+  *
+  * The main loop calls Power_Idle() with interrupts disabled once it has no
+  * queued work. The core then sleeps (WFI) until the next interrupt: the
+  * TIM6 measurement tick, the TIM2 timebase overflow, a button / encoder
+  * edge or a console byte. Peripherals keep running, so sampling and the
+  * timebase are not disturbed.
+  *
+  * The 1 ms SysTick is suspended while asleep. Otherwise it would wake the
+  * core about 1000 times a second for a main loop pass with nothing to do;
+  * without it an idle second has about 30 wakeups (TIM6 and TIM2 every
+  * 65.5 ms each). At roughly 400 cycles per wakeup (interrupt, accounting
+  * and an empty main loop pass at 32 MHz, about 12 us) that is about 1.2 %
+  * of run time, or an estimated 40 uA with the figures below. This is
+  * worked out from the code, not measured on a board; the sleep share shown
+  * in Settings -> Power is the measurement.
+  *
+  * Stop mode is not used: it halts the APB timers, so TIM6 would stop
+  * sampling and TIM2 would stop the timebase.
+  *
+  * Nor does the core drop to MSI while the display is off. TIM2 (1 MHz
+  * timebase), TIM6 (measurement tick), the ADC (PCLK/2), the I2C timing and
+  * the UART baud rate all derive from the 32 MHz PLL. A prescaler change
+  * only takes effect at the next update event, up to 65.5 ms later for
+  * TIM2, so the timebase would run at the wrong rate across every switch,
+  * and measuring continues with the display off, so the core would switch
+  * about 30 times a second. A lower idle clock needs a clock independent
+  * timebase (LPTIM on LSE) first.
+  *
+  * The time spent asleep is measured in microseconds from the timebase and
+  * reduced once per POWER_WINDOW_MS to a sleep share, from which an MCU
+  * current estimate is derived with the typical datasheet figures below.
+  ******************************************************************************
+  */
+
+#ifndef __POWER_H
+#define __POWER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define POWER_WINDOW_MS         1000     // Duty cycle averaging window
+#define POWER_RUN_UA            4500     // Run mode, 32 MHz range 1, from flash
+#define POWER_SLEEP_UA          1100     // Sleep mode, 32 MHz, peripherals clocked
+
+void Power_Idle(void);
+uint16_t Power_Get_Sleep_Permille(void);
+uint32_t Power_Get_Estimated_uA(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __POWER_H */
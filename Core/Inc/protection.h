@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file           : protection.h
+  * @brief          : Over-voltage / over-current trip on the ADC analog watchdog
+  ******************************************************************************
+  * @attention
+  *
+  * The user limits are translated once per measurement tick into raw ADC
+  * code thresholds through the active compensation and calibration (binary
+  * search over the monotonic conversion, so tables and zero correction are
+  * included). Protection_Arm() loads the thresholds of the channel about to
+  * be converted into the analog watchdog. A conversion outside the window
+  * raises the watchdog interrupt at the end of that conversion, without any
+  * software comparison, and the handler latches the event with its
+  * timestamp, switches LED_RED on and masks the watchdog interrupt until the
+  * next Protection_Arm(), so a signal staying over the limit interrupts
+  * once, not on every conversion. The window itself cannot be changed while
+  * a stream is converting.
+  *
+  * A stream of two channels has one window, so Protection_Arm_Single()
+  * watches only one of them; the other channel's limit waits for the
+  * measurement tick after the stream.
+  *
+  * A tripped channel is disarmed until its reading falls below the limit
+  * by the hysteresis percentage, or until its limit is set to 0; LED_RED
+  * follows this active state. The latched event stays until
+  * Protection_Acknowledge(). The current limit applies in both directions.
+  ******************************************************************************
+  */
+
+#ifndef __PROTECTION_H
+#define __PROTECTION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "calibration.h"
+
+#define PROTECTION_OVER_VOLTAGE 0x01
+#define PROTECTION_OVER_CURRENT 0x02
+
+typedef struct {
+    uint16_t voltage_limit_dv;   // 0 disables
+    uint16_t current_limit_ca;   // Magnitude, 0 disables
+    uint16_t hysteresis_pct;     // Release below limit * (100 - hysteresis) / 100
+} Protection_Config_t;
+
+void Protection_Init(const Protection_Config_t* config);
+void Protection_Update(int32_t voltage_mv, int32_t current_ma);
+void Protection_Arm(Cal_Channel_t channel);
+void Protection_Arm_Single(Cal_Channel_t channel, uint32_t adc_channel);
+void Protection_IRQHandler(void);
+uint8_t Protection_Get_Active(void);
+uint8_t Protection_Get_Event(void);
+uint32_t Protection_Get_Event_Time_ms(void);
+void Protection_Acknowledge(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PROTECTION_H */
@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file           : scope.h
+  * @brief          : Triggered burst capture from a circular DMA buffer
+  ******************************************************************************
+  * @attention
+  *
+  * The ADC streams into a circular buffer of two halves; Scope_Feed() runs
+  * from the half and full transfer interrupts and looks at the half just
+  * written. With two channels the samples are interleaved, a step holds one
+  * sample of each, and the trigger looks at one lane.
+  *
+  * A trigger is a crossing of the level in the selected direction after the
+  * signal was at least SCOPE_HYSTERESIS codes on the other side, so noise
+  * around the level does not fire it. It is only looked for once the
+  * pre-trigger part of the record has been written. The capture is complete
+  * once the post-trigger part is in; the DMA then has to stop within
+  * SCOPE_MARGIN samples, which the half not holding the record leaves room
+  * for. Without a trigger for auto_halves halves the most recent record is
+  * taken as is (auto mode).
+  ******************************************************************************
+  */
+
+#ifndef __SCOPE_H
+#define __SCOPE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define SCOPE_RECORD            128U            // Samples kept around the trigger
+#define SCOPE_MARGIN            8U              // Samples the DMA may write after completion
+#define SCOPE_HALF              (SCOPE_RECORD + SCOPE_MARGIN)
+#define SCOPE_BUFFER            (2 * SCOPE_HALF)
+#define SCOPE_HYSTERESIS        16U             // Codes beyond the level that re-arm the trigger
+
+typedef enum {
+    SCOPE_RISING = 0,
+    SCOPE_FALLING
+} Scope_Edge_t;
+
+typedef enum {
+    SCOPE_IDLE = 0,
+    SCOPE_FILLING,          // Writing the pre-trigger part
+    SCOPE_ARMED,            // Looking for the trigger
+    SCOPE_TRIGGERED,        // Writing the post-trigger part
+    SCOPE_DONE
+} Scope_State_t;
+
+typedef struct {
+    uint16_t level;             // Trigger level, raw code
+    uint16_t edge;              // Scope_Edge_t
+    uint16_t pretrigger_pct;    // Share of the record before the trigger
+} Scope_Config_t;
+
+typedef struct {
+    const volatile uint16_t* buffer;    // SCOPE_BUFFER samples written by the DMA
+    volatile uint8_t state;             // Scope_State_t
+    uint8_t stride;                     // Samples per step, the number of channels
+    uint8_t lane;                       // Trigger channel within a step
+    uint8_t primed;                     // Signal seen beyond the hysteresis
+    uint8_t forced;                     // Completed by auto mode
+    uint16_t pre_steps;                 // Steps of the record before the trigger
+    uint16_t halves_left;               // Halves until auto mode
+    uint32_t written;                   // Samples the DMA has completed
+    uint32_t trigger_step;              // Step holding the trigger sample
+    Scope_Config_t config;              // Settings of this capture
+} Scope_t;
+
+void Scope_Arm(Scope_t* scope, const volatile uint16_t* buffer, const Scope_Config_t* config,
+               uint8_t stride, uint8_t lane, uint16_t auto_halves);
+uint8_t Scope_Feed(Scope_t* scope);
+uint16_t Scope_Steps(const Scope_t* scope);
+uint16_t Scope_Get(const Scope_t* scope, uint16_t step, uint8_t lane);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCOPE_H */
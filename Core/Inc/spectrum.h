@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum.h
+  * @brief          : Fixed-point FFT spectrum, fundamental, THD and harmonics
+  ******************************************************************************
+  * @attention
+  *
+  * A frame of SPECTRUM_N raw ADC codes has its mean removed, is scaled up to
+  * use the 16-bit range, Hann windowed and transformed by an in-place radix-2
+  * FFT in Q15 integer math. The twiddle factors and the window come from one
+  * quarter-wave sine table in flash. Before each stage the frame is halved if
+  * it could overflow, so small signals keep their resolution (block floating
+  * point); all results are relative, so the scale is not tracked.
+  *
+  * The fundamental is the strongest bin above DC, refined between bins with
+  * the Hann window interpolation. Each harmonic sums the power of the bin
+  * nearest its expected position and the bin on either side (SPECTRUM_LOBE,
+  * the Hann main lobe); THD is the root of all harmonics below Nyquist over
+  * the fundamental.
+  ******************************************************************************
+  */
+
+#ifndef __SPECTRUM_H
+#define __SPECTRUM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define SPECTRUM_N              128U            // Samples per frame, sine table is sized for it
+#define SPECTRUM_LOG2_N         7U
+#define SPECTRUM_BINS           (SPECTRUM_N / 2)
+#define SPECTRUM_HARMONICS      6U              // H2 to H7 are reported
+
+typedef struct {
+    uint8_t level_db[SPECTRUM_BINS];            // Power below the strongest bin, dB
+    uint32_t fundamental_mhz;                   // Interpolated fundamental frequency
+    uint16_t thd_pm;                            // Total harmonic distortion, 0.1 %
+    uint16_t harmonic_pm[SPECTRUM_HARMONICS];   // H2.. amplitude over the fundamental, 0.1 %
+    uint8_t fundamental_bin;
+    uint8_t valid;                              // 0 when the frame is flat
+} Spectrum_t;
+
+uint8_t Spectrum_FFT(int16_t re[SPECTRUM_N], int16_t im[SPECTRUM_N]);
+void Spectrum_Analyze(int16_t re[SPECTRUM_N], int16_t im[SPECTRUM_N], uint32_t duration_us,
+                      Spectrum_t* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SPECTRUM_H */
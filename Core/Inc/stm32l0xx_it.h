@@ -53,8 +53,12 @@ void PendSV_Handler(void);
 void SysTick_Handler(void);
 void EXTI2_3_IRQHandler(void);
 void EXTI4_15_IRQHandler(void);
+void DMA1_Channel1_IRQHandler(void);
+void ADC1_COMP_IRQHandler(void);
 void TIM6_DAC_IRQHandler(void);
+void USART1_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void TIM2_IRQHandler(void);
 
 /* USER CODE END EFP */
 
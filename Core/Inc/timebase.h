@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file           : timebase.h
+  * @brief          : Microsecond timebase from TIM2 and a software overflow count
+  ******************************************************************************
+  * @attention
+  *
+  * TIM2 counts at 1 MHz through its full 16-bit range. Its update interrupt
+  * extends the count in software, which gives a monotonic 64-bit microsecond
+  * clock (about 8.9 years at 48 bits). A read that races with an overflow
+  * whose interrupt has not run yet, because the reader masked interrupts or
+  * runs at a higher priority, sees the pending update flag and corrects for
+  * it. The readers are therefore safe from any ISR and the main loop.
+  *
+  * TIM2 keeps counting in Sleep mode, which is the only low-power mode this
+  * firmware uses (see power.h).
+  ******************************************************************************
+  */
+
+#ifndef __TIMEBASE_H
+#define __TIMEBASE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+void Timebase_Init(TIM_HandleTypeDef* htim);
+void Timebase_IRQHandler(void);
+uint64_t Timebase_Now_us64(void);
+uint32_t Timebase_Now_us(void);
+uint32_t Timebase_Now_ms(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TIMEBASE_H */
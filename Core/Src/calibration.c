@@ -0,0 +1,402 @@
+/**
+  ******************************************************************************
+  * @file           : calibration.c
+  * @brief          : Runtime ADC calibration with data EEPROM storage
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "calibration.h"
+
+// Record at the start of data EEPROM, word aligned
+typedef struct {
+    uint32_t magic;
+    Cal_Line_t lines[CAL_CHANNELS];
+    int32_t luts[CAL_CHANNELS][CAL_LUT_POINTS];
+    uint32_t lut_mask;      // Bit per channel with an active table
+    int32_t zero[CAL_CHANNELS];     // Auto-zero corrections (milli-units)
+    uint32_t crc;           // CRC-32 of everything above
+} Cal_Record_t;
+
+#define CAL_RECORD_ADDRESS      DATA_EEPROM_BASE
+#define CAL_RECORD_WORDS        (sizeof(Cal_Record_t) / sizeof(uint32_t))
+
+static Cal_Line_t cal_lines[CAL_CHANNELS];
+static int32_t cal_luts[CAL_CHANNELS][CAL_LUT_POINTS];
+static uint8_t cal_lut_mask = 0;
+static int32_t cal_zero[CAL_CHANNELS];
+static Cal_Line_t cal_defaults[CAL_CHANNELS];
+static Cal_Point_t cal_points[CAL_CHANNELS][CAL_MAX_POINTS];
+static uint8_t cal_point_count[CAL_CHANNELS];
+
+/**
+  * @brief  CRC-32 (IEEE 802.3, reflected), bitwise to keep flash use small
+  * @param  data Bytes to check
+  * @param  length Number of bytes
+  * @retval CRC value
+  */
+uint32_t Calibration_Crc32(const void* data, uint32_t length)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    while (length--) {
+        crc ^= *bytes++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+/**
+  * @brief  Write both lines to data EEPROM
+  * @retval 1 on success
+  */
+static uint8_t Calibration_Save(void)
+{
+    Cal_Record_t record;
+    const uint32_t* words = (const uint32_t*)&record;
+    uint8_t ok = 1;
+
+    record.magic = CAL_MAGIC;
+    for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+        record.lines[ch] = cal_lines[ch];
+        for (uint8_t i = 0; i < CAL_LUT_POINTS; i++) {
+            record.luts[ch][i] = cal_luts[ch][i];
+        }
+    }
+    record.lut_mask = cal_lut_mask;
+    for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+        record.zero[ch] = cal_zero[ch];
+    }
+    record.crc = Calibration_Crc32(&record, sizeof(record) - sizeof(record.crc));
+
+    if (HAL_FLASHEx_DATAEEPROM_Unlock() != HAL_OK) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < CAL_RECORD_WORDS; i++) {
+        if (HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD,
+                                           CAL_RECORD_ADDRESS + i * sizeof(uint32_t),
+                                           words[i]) != HAL_OK) {
+            ok = 0;
+            break;
+        }
+    }
+    HAL_FLASHEx_DATAEEPROM_Lock();
+    return ok;
+}
+
+/**
+  * @brief  Load the stored calibration, or the defaults if none is valid
+  * @param  defaults Compiled-in lines, also used by Calibration_Restore_Defaults()
+  */
+void Calibration_Init(const Cal_Line_t defaults[CAL_CHANNELS])
+{
+    const Cal_Record_t* record = (const Cal_Record_t*)CAL_RECORD_ADDRESS;
+    uint8_t valid = record->magic == CAL_MAGIC &&
+                    record->crc == Calibration_Crc32(record, sizeof(*record) - sizeof(record->crc));
+
+    for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+        cal_defaults[ch] = defaults[ch];
+        cal_lines[ch] = valid ? record->lines[ch] : defaults[ch];
+        for (uint8_t i = 0; i < CAL_LUT_POINTS; i++) {
+            cal_luts[ch][i] = valid ? record->luts[ch][i] : 0;
+        }
+        cal_zero[ch] = valid ? record->zero[ch] : 0;
+    }
+    cal_lut_mask = valid ? (uint8_t)record->lut_mask : 0;
+    Calibration_Clear_Points();
+}
+
+/**
+  * @brief  Convert a raw code with the active calibration
+  * @param  channel CAL_VOLTAGE or CAL_CURRENT
+  * @param  raw ADC code
+  * @retval Milli-units (mV or mA)
+  */
+int32_t Calibration_Apply(Cal_Channel_t channel, uint32_t raw)
+{
+    return Calibration_Read_Q4(channel, raw << 4) + cal_zero[channel];
+}
+
+/**
+  * @brief  Convert a code with 4 fractional bits, without the zero correction
+  * @param  channel CAL_VOLTAGE or CAL_CURRENT
+  * @param  raw_q4 ADC code * 16, e.g. an average
+  * @retval Milli-units
+  */
+int32_t Calibration_Read_Q4(Cal_Channel_t channel, uint32_t raw_q4)
+{
+    const Cal_Line_t* line = &cal_lines[channel];
+
+    if (cal_lut_mask & (1U << channel)) {
+        return Calibration_Lut_Apply(cal_luts[channel], (raw_q4 + 8) >> 4);
+    }
+
+    return (int32_t)(((int64_t)raw_q4 * line->gain_q16 + 0x80000) >> 20) + line->offset;
+}
+
+/**
+  * @brief  Make a code read zero and store the correction
+  * @param  channel CAL_VOLTAGE or CAL_CURRENT
+  * @param  raw_q4 Averaged code with no input applied, * 16
+  * @retval 1 on success, 0 if storing failed
+  */
+uint8_t Calibration_Set_Zero(Cal_Channel_t channel, uint32_t raw_q4)
+{
+    int32_t zero = -Calibration_Read_Q4(channel, raw_q4);
+
+    if (zero == cal_zero[channel]) {
+        return 1;
+    }
+    cal_zero[channel] = zero;
+    return Calibration_Save();
+}
+
+/**
+  * @brief  Active auto-zero correction of a channel (milli-units)
+  */
+int32_t Calibration_Get_Zero(Cal_Channel_t channel)
+{
+    return cal_zero[channel];
+}
+
+/**
+  * @brief  Learn the zero from a sum of conversions with no input applied
+  * @param  channel CAL_VOLTAGE or CAL_CURRENT
+  * @param  sum Sum of the ADC codes
+  * @param  samples Number of codes in the sum
+  * @param  limit Largest reading (milli-units, either sign) still taken as
+  *         no input, with the deadband applied; 0 to always store (on request)
+  * @retval CAL_ZERO_STORED, CAL_ZERO_KEPT, CAL_ZERO_LOADED or CAL_ZERO_FAILED
+  */
+Cal_Zero_Result_t Calibration_Auto_Zero(Cal_Channel_t channel, uint32_t sum, uint32_t samples, int32_t limit)
+{
+    uint32_t zero_q4 = (uint32_t)(((uint64_t)sum * 16 + samples / 2) / samples);
+    int32_t reading = Calibration_Read_Q4(channel, zero_q4) + cal_zero[channel];
+
+    if (limit) {
+        if (reading > limit || reading < -limit) {
+            return CAL_ZERO_LOADED;
+        }
+        if (reading <= CAL_ZERO_DEADBAND && reading >= -CAL_ZERO_DEADBAND) {
+            return CAL_ZERO_KEPT;
+        }
+    }
+    return Calibration_Set_Zero(channel, zero_q4) ? CAL_ZERO_STORED : CAL_ZERO_FAILED;
+}
+
+/**
+  * @brief  Interpolate a calibration table
+  * @param  lut Table of CAL_LUT_POINTS values at codes 0, 256, ..., 4096
+  * @param  raw ADC code, 0..4095 (larger codes are clamped)
+  * @retval Milli-units
+  */
+int32_t Calibration_Lut_Apply(const int32_t lut[CAL_LUT_POINTS], uint32_t raw)
+{
+    if (raw > 4095) {
+        raw = 4095;
+    }
+
+    uint32_t index = raw >> CAL_LUT_SHIFT;
+    int32_t fraction = (int32_t)(raw & ((1U << CAL_LUT_SHIFT) - 1));
+    int32_t span = lut[index + 1] - lut[index];
+
+    return lut[index] + ((span * fraction + (1 << (CAL_LUT_SHIFT - 1))) >> CAL_LUT_SHIFT);
+}
+
+/**
+  * @brief  Check if a channel converts through its table
+  */
+uint8_t Calibration_Lut_Active(Cal_Channel_t channel)
+{
+    return (cal_lut_mask >> channel) & 1U;
+}
+
+/**
+  * @brief  Active line of a channel
+  */
+const Cal_Line_t* Calibration_Get(Cal_Channel_t channel)
+{
+    return &cal_lines[channel];
+}
+
+/**
+  * @brief  Add a calibration point
+  * @param  channel CAL_VOLTAGE or CAL_CURRENT
+  * @param  raw ADC code measured at the reference
+  * @param  reference Applied reference in milli-units
+  * @retval Number of points of the channel, 0 if it is full
+  */
+uint8_t Calibration_Capture(Cal_Channel_t channel, uint16_t raw, int32_t reference)
+{
+    uint8_t count = cal_point_count[channel];
+
+    if (count >= CAL_MAX_POINTS) {
+        return 0;
+    }
+    cal_points[channel][count].raw = raw;
+    cal_points[channel][count].reference = reference;
+    cal_point_count[channel] = count + 1;
+    return count + 1;
+}
+
+/**
+  * @brief  Number of points captured for a channel
+  */
+uint8_t Calibration_Point_Count(Cal_Channel_t channel)
+{
+    return cal_point_count[channel];
+}
+
+/**
+  * @brief  Discard all captured points
+  */
+void Calibration_Clear_Points(void)
+{
+    for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+        cal_point_count[ch] = 0;
+    }
+}
+
+/**
+  * @brief  Least squares line through the points, in fixed point
+  * @param  points Captured points
+  * @param  count Number of points, at least 2
+  * @param  line Receives the fitted line
+  * @retval 1 on success, 0 if the points do not define a rising line
+  */
+uint8_t Calibration_Fit(const Cal_Point_t* points, uint8_t count, Cal_Line_t* line)
+{
+    int64_t sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+
+    if (count < 2) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        int64_t x = points[i].raw;
+        int64_t y = points[i].reference;
+
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+
+    int64_t denominator = count * sum_xx - sum_x * sum_x;
+    int64_t numerator = count * sum_xy - sum_x * sum_y;
+    if (denominator <= 0 || numerator <= 0) {
+        return 0;
+    }
+
+    // Round to nearest, both terms are positive here
+    int64_t gain_q16 = ((numerator << 16) + denominator / 2) / denominator;
+    if (gain_q16 > INT32_MAX) {
+        return 0;
+    }
+
+    // offset = mean(y) - gain * mean(x), rounded to nearest
+    int64_t offset_q16 = (sum_y << 16) - gain_q16 * sum_x;
+    int64_t divisor = (int64_t)count << 16;
+    offset_q16 += (offset_q16 >= 0) ? divisor / 2 : -divisor / 2;
+
+    line->gain_q16 = (int32_t)gain_q16;
+    line->offset = (int32_t)(offset_q16 / divisor);
+    return 1;
+}
+
+/**
+  * @brief  Build a piecewise-linear table through the points
+  * @param  points Captured points, sorted by code in place
+  * @param  count Number of points, at least 3
+  * @param  lut Receives CAL_LUT_POINTS values at codes 0, 256, ..., 4096
+  * @retval 1 on success, 0 if there are too few distinct codes
+  */
+uint8_t Calibration_Build_Lut(Cal_Point_t* points, uint8_t count, int32_t lut[CAL_LUT_POINTS])
+{
+    if (count < 3) {
+        return 0;
+    }
+
+    // Insertion sort by code, at most CAL_MAX_POINTS entries
+    for (uint8_t i = 1; i < count; i++) {
+        Cal_Point_t point = points[i];
+        uint8_t j = i;
+
+        while (j > 0 && points[j - 1].raw > point.raw) {
+            points[j] = points[j - 1];
+            j--;
+        }
+        points[j] = point;
+    }
+    for (uint8_t i = 1; i < count; i++) {
+        if (points[i].raw == points[i - 1].raw) {
+            return 0;
+        }
+    }
+
+    uint8_t segment = 0;
+    for (uint8_t i = 0; i < CAL_LUT_POINTS; i++) {
+        int32_t code = (int32_t)i << CAL_LUT_SHIFT;
+
+        // Segment containing the code, the first and last ones extrapolate
+        while (segment < count - 2 && code >= points[segment + 1].raw) {
+            segment++;
+        }
+
+        const Cal_Point_t* a = &points[segment];
+        const Cal_Point_t* b = &points[segment + 1];
+        int64_t numerator = (int64_t)(b->reference - a->reference) * (code - a->raw);
+        int64_t dx = b->raw - a->raw;
+
+        numerator += ((numerator >= 0) ? dx : -dx) / 2;
+        lut[i] = a->reference + (int32_t)(numerator / dx);
+    }
+    return 1;
+}
+
+/**
+  * @brief  Fit every channel with enough points and store the result
+  * @retval 1 if at least one channel was fitted and saved, 0 otherwise
+  * @note   Captured points are discarded either way.
+  */
+uint8_t Calibration_Commit(void)
+{
+    uint8_t fitted = 0;
+
+    for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+        Cal_Line_t line;
+
+        if (Calibration_Fit(cal_points[ch], cal_point_count[ch], &line)) {
+            cal_lines[ch] = line;
+            cal_zero[ch] = 0;       // The fit includes the offset
+            fitted = 1;
+
+            // Three or more points also describe the curvature
+            if (Calibration_Build_Lut(cal_points[ch], cal_point_count[ch], cal_luts[ch])) {
+                cal_lut_mask |= 1U << ch;
+            } else {
+                cal_lut_mask &= ~(1U << ch);
+            }
+        }
+    }
+    Calibration_Clear_Points();
+
+    return fitted && Calibration_Save();
+}
+
+/**
+  * @brief  Go back to the compiled-in calibration and store it
+  * @retval 1 on success
+  */
+uint8_t Calibration_Restore_Defaults(void)
+{
+    for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+        cal_lines[ch] = cal_defaults[ch];
+        cal_zero[ch] = 0;
+    }
+    cal_lut_mask = 0;
+    Calibration_Clear_Points();
+    return Calibration_Save();
+}
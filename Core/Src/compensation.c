@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file           : compensation.c
+  * @brief          : VDDA and temperature compensation of raw ADC codes
+  ******************************************************************************
+  */
+
+#include <stddef.h>
+#include "compensation.h"
+
+static const Compensation_Config_t* comp_config = NULL;
+static uint16_t comp_vdda_mv = COMPENSATION_VDDA_NOMINAL_MV;
+static int16_t comp_temperature_dc = COMPENSATION_TEMP_REF_DC;
+static uint32_t comp_factor_q16[CAL_CHANNELS];
+
+/**
+  * @brief  Start uncompensated (nominal VDDA, reference temperature)
+  * @param  config Factory values and drift coefficients
+  */
+void Compensation_Init(const Compensation_Config_t* config)
+{
+    comp_config = config;
+    comp_vdda_mv = COMPENSATION_VDDA_NOMINAL_MV;
+    comp_temperature_dc = COMPENSATION_TEMP_REF_DC;
+    for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+        comp_factor_q16[ch] = 1UL << 16;
+    }
+}
+
+/**
+  * @brief  Recompute VDDA, temperature and the channel factors
+  * @param  vrefint_raw VREFINT code
+  * @param  temperature_raw Temperature sensor code, same VDDA
+  */
+void Compensation_Update(uint16_t vrefint_raw, uint16_t temperature_raw)
+{
+    if (vrefint_raw == 0 || comp_config->ts_cal2 <= comp_config->ts_cal1) {
+        return;
+    }
+
+    // VDDA = 3.0 V * VREFINT_CAL / VREFINT
+    comp_vdda_mv = (uint16_t)(((uint32_t)COMPENSATION_FACTORY_VDDA_MV * comp_config->vrefint_cal +
+                               vrefint_raw / 2) / vrefint_raw);
+
+    // Sensor code as it would read at 3.0 V, interpolated between 30 C and 130 C
+    int32_t ts_code = (int32_t)(((uint32_t)temperature_raw * comp_vdda_mv) / COMPENSATION_FACTORY_VDDA_MV);
+    int32_t ts_span = comp_config->ts_cal2 - comp_config->ts_cal1;
+    comp_temperature_dc = (int16_t)(300 + ((ts_code - comp_config->ts_cal1) * 1000) / ts_span);
+
+    uint32_t supply_q16 = ((uint32_t)comp_vdda_mv << 16) / COMPENSATION_VDDA_NOMINAL_MV;
+    int32_t delta_dc = comp_temperature_dc - COMPENSATION_TEMP_REF_DC;
+
+    for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+        // 1 - tempco * dT, tempco in ppm/C and dT in 0.1 C
+        int32_t drift_q16 = (int32_t)(((int64_t)comp_config->tempco_ppm[ch] * delta_dc * 65536) / 10000000);
+
+        comp_factor_q16[ch] = (uint32_t)(((uint64_t)supply_q16 * (uint32_t)(65536 - drift_q16)) >> 16);
+    }
+}
+
+/**
+  * @brief  Compensate a raw code
+  * @param  channel CAL_VOLTAGE or CAL_CURRENT
+  * @param  raw ADC code
+  * @retval Code referred to the nominal VDDA and reference temperature
+  */
+uint32_t Compensation_Apply(Cal_Channel_t channel, uint32_t raw)
+{
+    return (raw * comp_factor_q16[channel] + 0x8000) >> 16;
+}
+
+/**
+  * @brief  Measured VDDA in millivolts
+  */
+uint16_t Compensation_Get_Vdda_mV(void)
+{
+    return comp_vdda_mv;
+}
+
+/**
+  * @brief  Die temperature in 0.1 C
+  */
+int16_t Compensation_Get_Temperature_dC(void)
+{
+    return comp_temperature_dc;
+}
@@ -0,0 +1,139 @@
+/**
+  ******************************************************************************
+  * @file           : console.c
+  * @brief          : Line based UART console on USART1 (PA9 TX, PA10 RX)
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "console.h"
+#include "timebase.h"
+
+#define CONSOLE_BAUD            115200
+#define CONSOLE_TX_TIMEOUT_MS   50
+#define CONSOLE_RX_ERRORS       (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE)
+
+static USART_TypeDef* console_usart = NULL;
+static char console_line[CONSOLE_LINE_SIZE];
+static uint8_t console_length = 0;
+static volatile uint8_t console_ready = 0;
+
+/**
+  * @brief  Set the port up for CONSOLE_BAUD 8N1 and start receiving
+  * @param  usart USART with its clock, pins and interrupt already enabled
+  * @param  clock_hz USART kernel clock
+  */
+void Console_Init(USART_TypeDef* usart, uint32_t clock_hz)
+{
+    console_usart = usart;
+    console_length = 0;
+    console_ready = 0;
+
+    // 16x oversampling: BRR is the rounded clock divider. BRR is only
+    // writable with the USART disabled.
+    console_usart->CR1 = 0;
+    console_usart->CR2 = 0;
+    console_usart->CR3 = 0;
+    console_usart->BRR = (clock_hz + CONSOLE_BAUD / 2) / CONSOLE_BAUD;
+    console_usart->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF;
+    console_usart->CR1 = USART_CR1_TE | USART_CR1_RE | USART_CR1_RXNEIE | USART_CR1_UE;
+}
+
+/**
+  * @brief  Collect a received byte, called from USART1_IRQHandler()
+  * @note   RXNEIE also raises the interrupt on an overrun. A byte received
+  *         with a framing or noise error is dropped.
+  */
+void Console_IRQHandler(void)
+{
+    uint32_t isr = console_usart->ISR;
+
+    if (isr & CONSOLE_RX_ERRORS) {
+        console_usart->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF;
+    }
+    if (!(isr & USART_ISR_RXNE)) {
+        return;
+    }
+
+    // Reading RDR clears RXNE
+    char c = (char)console_usart->RDR;
+    if ((isr & (USART_ISR_FE | USART_ISR_NE)) || console_ready) {
+        return;
+    }
+    if (c == '\r' || c == '\n') {
+        if (console_length > 0) {
+            console_line[console_length] = '\0';
+            console_ready = 1;
+        }
+    } else if (console_length < CONSOLE_LINE_SIZE - 1) {
+        console_line[console_length++] = c;
+    }
+}
+
+/**
+  * @brief  Check for a complete line without taking it
+  */
+uint8_t Console_Line_Ready(void)
+{
+    return console_ready;
+}
+
+/**
+  * @brief  Take the received line
+  * @param  dst Buffer of CONSOLE_LINE_SIZE bytes
+  * @retval 1 if a line was copied
+  */
+uint8_t Console_Get_Line(char* dst)
+{
+    if (!console_ready) {
+        return 0;
+    }
+    memcpy(dst, console_line, console_length + 1);
+    console_length = 0;
+    console_ready = 0;
+    return 1;
+}
+
+/**
+  * @brief  Send a string, blocking (main loop only)
+  * @note   Gives up after CONSOLE_TX_TIMEOUT_MS, like the HAL transmit did
+  */
+void Console_Write(const char* str)
+{
+    uint32_t start_ms = Timebase_Now_ms();
+
+    while (*str != '\0') {
+        while (!(console_usart->ISR & USART_ISR_TXE)) {
+            if (Timebase_Now_ms() - start_ms > CONSOLE_TX_TIMEOUT_MS) {
+                return;
+            }
+        }
+        console_usart->TDR = (uint8_t)*str++;
+    }
+}
+
+/**
+  * @brief  Parse a signed decimal integer after optional spaces
+  * @param  str Input text
+  * @param  value Receives the number
+  * @retval Pointer past the number, NULL if there is none
+  */
+const char* Console_Parse_Int(const char* str, int32_t* value)
+{
+    uint8_t negative = 0;
+    int32_t result = 0;
+
+    while (*str == ' ') str++;
+    if (*str == '-') {
+        negative = 1;
+        str++;
+    }
+    if (*str < '0' || *str > '9') {
+        return NULL;
+    }
+    while (*str >= '0' && *str <= '9') {
+        result = result * 10 + (*str++ - '0');
+    }
+    *value = negative ? -result : result;
+    return str;
+}
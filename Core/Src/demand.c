@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @file           : demand.c
+  * @brief          : Sliding-window demand (average power) metering
+  ******************************************************************************
+  */
+
+#include "demand.h"
+#include <string.h>
+
+// Window lengths in buckets, the last one spans the whole ring
+static const uint8_t demand_window_buckets[DEMAND_WINDOWS] = {
+    60 / DEMAND_BUCKET_S, 300 / DEMAND_BUCKET_S, DEMAND_BUCKETS
+};
+
+/**
+  * @brief  Clear the buckets, averages and peaks
+  * @note   The previous sample is kept, so the next interval still counts.
+  */
+void Demand_Reset(Demand_t* demand)
+{
+    memset(demand->bucket_mj, 0, sizeof(demand->bucket_mj));
+    memset(demand->window_mj, 0, sizeof(demand->window_mj));
+    memset(&demand->values, 0, sizeof(demand->values));
+    demand->open_nj = 0;
+    demand->open_us = 0;
+    demand->head = 0;
+    demand->filled = 0;
+}
+
+/**
+  * @brief  Clear the peak demand registers only
+  */
+void Demand_Reset_Peaks(Demand_t* demand)
+{
+    memset(demand->values.peak_mw, 0, sizeof(demand->values.peak_mw));
+}
+
+/**
+  * @brief  Length of a window
+  * @param  window Window index, 0 to DEMAND_WINDOWS - 1
+  * @retval Minutes
+  */
+uint8_t Demand_Window_Minutes(uint8_t window)
+{
+    return (uint8_t)(demand_window_buckets[window] * DEMAND_BUCKET_S / 60);
+}
+
+/**
+  * @brief  Divide rounding half away from zero
+  */
+static int64_t Demand_Divide(int64_t value, int64_t divisor)
+{
+    return (value < 0) ? -((-value + divisor / 2) / divisor)
+                       : (value + divisor / 2) / divisor;
+}
+
+/**
+  * @brief  Move the open bucket into the ring and step the windows
+  */
+static void Demand_Close_Bucket(Demand_t* demand)
+{
+    int32_t closed_mj = (int32_t)Demand_Divide(demand->open_nj, 1000000);
+    uint8_t present = demand->filled;
+
+    if (demand->filled < DEMAND_BUCKETS) {
+        demand->filled++;
+    }
+
+    for (uint8_t w = 0; w < DEMAND_WINDOWS; w++) {
+        uint8_t length = demand_window_buckets[w];
+
+        // The oldest bucket of a full window drops out; for the longest
+        // window that is the slot about to be overwritten
+        demand->window_mj[w] += closed_mj;
+        if (present >= length) {
+            uint8_t oldest = (uint8_t)((demand->head + DEMAND_BUCKETS - length) % DEMAND_BUCKETS);
+            demand->window_mj[w] -= demand->bucket_mj[oldest];
+        }
+
+        uint8_t span = (demand->filled < length) ? demand->filled : length;
+        int32_t average = (int32_t)Demand_Divide(demand->window_mj[w], span * DEMAND_BUCKET_S);
+        demand->values.average_mw[w] = average;
+        if (demand->filled >= length && average > demand->values.peak_mw[w]) {
+            demand->values.peak_mw[w] = average;
+        }
+    }
+
+    demand->bucket_mj[demand->head] = closed_mj;
+    demand->head = (uint8_t)((demand->head + 1) % DEMAND_BUCKETS);
+    // The rounding remainder carries over, so no energy is lost
+    demand->open_nj -= (int64_t)closed_mj * 1000000;
+    demand->open_us = 0;
+}
+
+/**
+  * @brief  Account the interval up to a new sample
+  * @param  demand Demand state
+  * @param  power_mw Signed power, negative when energy flows back
+  * @param  delta_us Time since the previous sample
+  * @note   The interval is taken at the mean of its two samples and split at
+  *         bucket boundaries, so a late tick or a gap fills every bucket it
+  *         spans.
+  */
+void Demand_Sample(Demand_t* demand, int32_t power_mw, uint32_t delta_us)
+{
+    if (demand->primed) {
+        int32_t mean_mw = (int32_t)(((int64_t)demand->last_power_mw + power_mw) / 2);
+
+        while (delta_us > 0) {
+            uint32_t room = DEMAND_BUCKET_US - demand->open_us;
+            uint32_t step = (delta_us < room) ? delta_us : room;
+
+            demand->open_nj += (int64_t)mean_mw * step;
+            demand->open_us += step;
+            delta_us -= step;
+            if (demand->open_us >= DEMAND_BUCKET_US) {
+                Demand_Close_Bucket(demand);
+            }
+        }
+    }
+
+    demand->last_power_mw = power_mw;
+    demand->primed = 1;
+}
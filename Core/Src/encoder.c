@@ -0,0 +1,131 @@
+/**
+  ******************************************************************************
+  * @file           : encoder.c
+  * @brief          : Table-driven quadrature decoder for the rotary encoder
+  ******************************************************************************
+  */
+
+#include "encoder.h"
+
+// Quarter step for (old_state << 2 | new_state), 0 = no move or invalid
+static const int8_t encoder_table[16] = {
+     0, -1, +1,  0,     // 00 -> 00 01 10 11
+    +1,  0,  0, -1,     // 01 -> 00 01 10 11
+    -1,  0,  0, +1,     // 10 -> 00 01 10 11
+     0, +1, -1,  0      // 11 -> 00 01 10 11
+};
+
+/**
+  * @brief  Acceleration factor for detents arriving at the given rate
+  * @param  encoder Decoder state
+  * @param  detents Detents moved since the last step
+  * @param  now_ms Current time in milliseconds
+  * @retval 1, 10 or 100
+  */
+static uint8_t Encoder_Acceleration(Encoder_t* encoder, uint8_t detents, uint32_t now_ms)
+{
+    uint32_t interval = (now_ms - encoder->last_step_ms) / detents;
+    encoder->last_step_ms = now_ms;
+
+    if (interval < ENCODER_ACCEL_X100_MS) {
+        return 100;
+    } else if (interval < ENCODER_ACCEL_X10_MS) {
+        return 10;
+    }
+    return 1;
+}
+
+/**
+  * @brief  Initialize the decoder at rest
+  * @param  encoder Decoder state
+  * @param  ab Current pin state (A << 1 | B), taken as the detent state
+  */
+void Encoder_Init(Encoder_t* encoder, uint8_t ab)
+{
+    encoder->state = ab & 0x03;
+    encoder->detent = ab & 0x03;
+    encoder->accumulator = 0;
+    encoder->count = 0;
+    encoder->last_step_ms = 0;
+}
+
+/**
+  * @brief  Decode one edge
+  * @param  encoder Decoder state
+  * @param  ab New pin state (A << 1 | B)
+  * @param  now_ms Timestamp of the edge in milliseconds
+  * @retval Detent steps with acceleration (0, +-1, +-10, +-100)
+  */
+int8_t Encoder_Decode(Encoder_t* encoder, uint8_t ab, uint32_t now_ms)
+{
+    ab &= 0x03;
+    if (ab == encoder->state) {
+        return 0;
+    }
+
+    encoder->accumulator += encoder_table[(encoder->state << 2) | ab];
+    encoder->state = ab;
+
+    if (ab != encoder->detent) {
+        return 0;
+    }
+
+    // Back at rest: a real detent moved ~4 quarter steps, bounce nets to ~0
+    int8_t direction = 0;
+    if (encoder->accumulator >= 2) {
+        direction = 1;
+    } else if (encoder->accumulator <= -2) {
+        direction = -1;
+    }
+    encoder->accumulator = 0;
+
+    if (direction == 0) {
+        return 0;
+    }
+
+    return direction * Encoder_Acceleration(encoder, 1, now_ms);
+}
+
+/**
+  * @brief  Initialize the decoder for a hardware quadrature counter
+  * @param  encoder Decoder state
+  * @param  count Current counter value, taken as the detent position
+  */
+void Encoder_Init_Counter(Encoder_t* encoder, uint16_t count)
+{
+    Encoder_Init(encoder, 0);
+    encoder->count = count;
+}
+
+/**
+  * @brief  Convert the counter movement since the last call to detent steps
+  * @param  encoder Decoder state
+  * @param  count Counter value, counting up in the positive direction
+  * @param  now_ms Timestamp of the sample in milliseconds
+  * @retval Detent steps with acceleration, limited to +-ENCODER_MAX_STEPS
+  */
+int8_t Encoder_Decode_Counter(Encoder_t* encoder, uint16_t count, uint32_t now_ms)
+{
+    // Signed 16-bit difference handles counter wrap in both directions
+    int16_t counts = (int16_t)(uint16_t)(count - encoder->count);
+    encoder->count = count;
+
+    int32_t total = counts + encoder->accumulator;
+    int32_t detents = total / ENCODER_COUNTS_PER_DETENT;
+    encoder->accumulator = total % ENCODER_COUNTS_PER_DETENT;
+
+    if (detents == 0) {
+        return 0;
+    }
+
+    uint32_t magnitude = (detents < 0) ? -detents : detents;
+    if (magnitude > ENCODER_MAX_STEPS) {
+        magnitude = ENCODER_MAX_STEPS;
+    }
+
+    uint32_t steps = magnitude * Encoder_Acceleration(encoder, magnitude, now_ms);
+    if (steps > ENCODER_MAX_STEPS) {
+        steps = ENCODER_MAX_STEPS;
+    }
+    return (detents < 0) ? -(int8_t)steps : (int8_t)steps;
+}
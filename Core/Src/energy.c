@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * @file           : energy.c
+  * @brief          : Bidirectional energy and charge accumulators
+  ******************************************************************************
+  */
+
+#include "energy.h"
+
+/**
+  * @brief  Clear the counters and gap statistics
+  * @note   The previous sample is kept, so the next pair still integrates.
+  */
+void Energy_Reset(Energy_t* energy)
+{
+    energy->import_nj = 0;
+    energy->export_nj = 0;
+    energy->charge_in_nc = 0;
+    energy->charge_out_nc = 0;
+    energy->gaps = 0;
+    energy->gap_ms = 0;
+}
+
+/**
+  * @brief  Add the trapezoid between two samples to the counter of its sign
+  * @param  positive Counter for the area above zero
+  * @param  negative Counter for the area below zero
+  * @param  v0 First sample
+  * @param  v1 Second sample
+  * @param  dt Time between the samples
+  */
+static void Energy_Trapezoid(uint64_t* positive, uint64_t* negative, int32_t v0, int32_t v1, uint32_t dt)
+{
+    uint32_t a0 = (v0 < 0) ? 0U - (uint32_t)v0 : (uint32_t)v0;
+    uint32_t a1 = (v1 < 0) ? 0U - (uint32_t)v1 : (uint32_t)v1;
+
+    if ((v0 < 0) == (v1 < 0) || a0 == 0 || a1 == 0) {
+        // One sign over the whole interval
+        uint64_t area = (((uint64_t)a0 + a1) * dt) >> 1;
+        if (v0 < 0 || v1 < 0) {
+            *negative += area;
+        } else {
+            *positive += area;
+        }
+        return;
+    }
+
+    // Sign change: split at the zero crossing of the interpolated line
+    uint32_t t0 = (uint32_t)(((uint64_t)a0 * dt) / ((uint64_t)a0 + a1));
+    uint64_t area0 = ((uint64_t)a0 * t0) >> 1;
+    uint64_t area1 = ((uint64_t)a1 * (dt - t0)) >> 1;
+
+    if (v0 < 0) {
+        *negative += area0;
+        *positive += area1;
+    } else {
+        *positive += area0;
+        *negative += area1;
+    }
+}
+
+/**
+  * @brief  Integrate up to a new sample
+  * @param  energy Counters
+  * @param  power_mw Signed power, negative when energy flows back
+  * @param  current_ma Signed current
+  * @param  delta_us Time since the previous sample
+  */
+void Energy_Sample(Energy_t* energy, int32_t power_mw, int32_t current_ma, uint32_t delta_us)
+{
+    if (energy->primed && delta_us > 0) {
+        if (delta_us > ENERGY_GAP_US) {
+            energy->gaps++;
+            energy->gap_ms += delta_us / 1000;
+        }
+
+        Energy_Trapezoid(&energy->import_nj, &energy->export_nj,
+                         energy->last_power_mw, power_mw, delta_us);
+        Energy_Trapezoid(&energy->charge_in_nc, &energy->charge_out_nc,
+                         energy->last_current_ma, current_ma, delta_us);
+    }
+
+    energy->last_power_mw = power_mw;
+    energy->last_current_ma = current_ma;
+    energy->primed = 1;
+}
+
+/**
+  * @brief  Round a signed nJ / nC amount to mWh / mAh, saturating to int32
+  */
+static int32_t Energy_Scale(int64_t amount, int64_t unit)
+{
+    // Round from the remainder, adding half a unit first overflows near INT64_MAX
+    int64_t scaled = amount / unit;
+    int64_t rest = amount % unit;
+
+    if (rest >= unit / 2) scaled++;
+    if (rest <= -unit / 2) scaled--;
+
+    if (scaled > INT32_MAX) return INT32_MAX;
+    if (scaled < -INT32_MAX) return -INT32_MAX;
+    return (int32_t)scaled;
+}
+
+/**
+  * @brief  Net of two unsigned counters, kept in range of int64
+  */
+static int64_t Energy_Difference(uint64_t positive, uint64_t negative)
+{
+    if (positive >= negative) {
+        uint64_t diff = positive - negative;
+        return (diff > INT64_MAX) ? INT64_MAX : (int64_t)diff;
+    }
+
+    uint64_t diff = negative - positive;
+    return (diff > INT64_MAX) ? -INT64_MAX : -(int64_t)diff;
+}
+
+/**
+  * @brief  Energy counter in mWh
+  */
+int32_t Energy_To_mWh(uint64_t energy_nj)
+{
+    return Energy_Scale(Energy_Difference(energy_nj, 0), ENERGY_NJ_PER_MWH);
+}
+
+/**
+  * @brief  Imported minus exported energy in mWh
+  */
+int32_t Energy_Net_mWh(const Energy_t* energy)
+{
+    return Energy_Scale(Energy_Difference(energy->import_nj, energy->export_nj), ENERGY_NJ_PER_MWH);
+}
+
+/**
+  * @brief  Charge counter in mAh
+  */
+int32_t Energy_To_mAh(uint64_t charge_nc)
+{
+    return Energy_Scale(Energy_Difference(charge_nc, 0), ENERGY_NC_PER_MAH);
+}
+
+/**
+  * @brief  Charge in minus charge out in mAh
+  */
+int32_t Energy_Net_mAh(const Energy_t* energy)
+{
+    return Energy_Scale(Energy_Difference(energy->charge_in_nc, energy->charge_out_nc), ENERGY_NC_PER_MAH);
+}
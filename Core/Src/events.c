@@ -0,0 +1,172 @@
+/**
+  ******************************************************************************
+  * @file           : events.c
+  * @brief          : Load step (appliance on/off) detection with event log
+  ******************************************************************************
+  */
+
+#include "events.h"
+#include <string.h>
+
+#define EVENTS_FILTER_DIV       4       // Smoothing, 1/4 of the error per sample
+#define EVENTS_DRIFT_DIV        16      // Steady level tracking, 1/16 per sample
+
+// Keeps the compiler from moving log writes across the total update
+#define EVENTS_BARRIER()        __asm volatile ("" ::: "memory")
+
+/**
+  * @brief  Clear the log and restart the levels from the next sample
+  */
+void Events_Reset(Events_t* events)
+{
+    memset(events->log, 0, sizeof(events->log));
+    events->pending = 0;
+    events->onset = 0;
+    events->primed = 0;
+    EVENTS_BARRIER();
+    events->total = 0;
+}
+
+/**
+  * @brief  mW to 0.1 W, rounded and saturated to int16
+  */
+static int16_t Events_To_dW(int32_t power_mw)
+{
+    int32_t dw = (power_mw < 0) ? -((-power_mw + 50) / 100) : (power_mw + 50) / 100;
+
+    if (dw > INT16_MAX) return INT16_MAX;
+    if (dw < -INT16_MAX) return -INT16_MAX;
+    return (int16_t)dw;
+}
+
+/**
+  * @brief  Append an event, overwriting the oldest
+  */
+static void Events_Record(Events_t* events, uint32_t time_ms, int32_t before_mw, int32_t after_mw)
+{
+    Load_Event_t* event = &events->log[events->total % EVENTS_LOG];
+
+    event->time_ms = time_ms;
+    event->before_dw = Events_To_dW(before_mw);
+    event->after_dw = Events_To_dW(after_mw);
+    EVENTS_BARRIER();
+    events->total++;
+}
+
+/**
+  * @brief  Run the detector on a new sample
+  * @param  events Detector state and log
+  * @param  config Step threshold, hysteresis and debounce time
+  * @param  power_mw Signed power of the sample
+  * @param  now_ms Timebase of the sample
+  */
+void Events_Sample(Events_t* events, const Events_Config_t* config, int32_t power_mw, uint32_t now_ms)
+{
+    int32_t step_mw = (int32_t)config->step_dw * 100;
+    int32_t release_mw = step_mw * (100 - (int32_t)config->hysteresis_pct) / 100;
+
+    if (!events->primed) {
+        events->filtered_mw = power_mw;
+        events->steady_mw = power_mw;
+        events->primed = 1;
+        return;
+    }
+
+    events->filtered_mw += (power_mw - events->filtered_mw) / EVENTS_FILTER_DIV;
+    int32_t deviation = events->filtered_mw - events->steady_mw;
+
+    if (events->pending) {
+        // A step that falls back below the release level was a transient
+        if (deviation * events->pending < release_mw) {
+            events->pending = 0;
+            events->onset = 0;
+            return;
+        }
+
+        if (events->measuring) {
+            events->after_sum_mw += power_mw;
+            events->after_count++;
+        }
+        if ((uint32_t)(now_ms - events->pending_ms) < config->debounce_ms) {
+            return;
+        }
+        if (!events->measuring || events->after_count == 0) {
+            // Settled, average the new level from the next sample on
+            events->measuring = 1;
+            events->pending_ms = now_ms;
+            events->after_sum_mw = 0;
+            events->after_count = 0;
+            return;
+        }
+
+        int32_t after_mw = events->after_sum_mw / events->after_count;
+        if ((after_mw - events->steady_mw) * events->pending >= release_mw) {
+            Events_Record(events, events->onset_ms, events->steady_mw, after_mw);
+            events->steady_mw = after_mw;
+            events->filtered_mw = after_mw;
+        }
+        events->pending = 0;
+        events->onset = 0;
+        return;
+    }
+
+    int32_t magnitude = (deviation < 0) ? -deviation : deviation;
+
+    if (magnitude < release_mw || step_mw == 0) {
+        // Quiet: follow slow drift of the steady level
+        events->steady_mw += deviation / EVENTS_DRIFT_DIV;
+        events->onset = 0;
+        return;
+    }
+    if (!events->onset) {
+        events->onset_ms = now_ms;
+        events->onset = 1;
+    }
+    if (magnitude >= step_mw) {
+        events->pending = (deviation > 0) ? 1 : -1;
+        events->pending_ms = now_ms;
+        events->measuring = 0;
+    }
+}
+
+/**
+  * @brief  Events recorded since the last reset, including overwritten ones
+  */
+uint32_t Events_Total(const Events_t* events)
+{
+    return events->total;
+}
+
+/**
+  * @brief  Events held in the log
+  */
+uint8_t Events_Count(const Events_t* events)
+{
+    uint32_t total = events->total;
+
+    return (total < EVENTS_LOG) ? (uint8_t)total : EVENTS_LOG;
+}
+
+/**
+  * @brief  Copy a logged event
+  * @param  events Detector state and log
+  * @param  age 0 for the newest event
+  * @param  dst Receives the event
+  * @retval 1 if the event is in the log
+  */
+uint8_t Events_Get(const Events_t* events, uint8_t age, Load_Event_t* dst)
+{
+    uint32_t total;
+
+    do {
+        total = events->total;
+        if (age >= total || age >= EVENTS_LOG) {
+            return 0;
+        }
+        EVENTS_BARRIER();
+        *dst = events->log[(total - 1 - age) % EVENTS_LOG];
+        EVENTS_BARRIER();
+    } while (events->total != total);
+
+    return 1;
+}
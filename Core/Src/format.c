@@ -0,0 +1,132 @@
+/**
+  ******************************************************************************
+  * @file           : format.c
+  * @brief          : Integer-only number formatting for the OLED display paths
+  ******************************************************************************
+  */
+
+#include "format.h"
+
+/**
+  * @brief  Copy a string
+  * @param  dst Output buffer
+  * @param  str String to copy
+  * @retval Pointer to the terminating '\0' in dst
+  */
+char* Format_String(char* dst, const char* str)
+{
+    while (*str) {
+        *dst++ = *str++;
+    }
+    *dst = '\0';
+    return dst;
+}
+
+/**
+  * @brief  Format an unsigned integer in decimal
+  * @param  dst Output buffer
+  * @param  value Value to format
+  * @param  min_width Minimum number of characters, left padded
+  * @param  pad Padding character ('0' or ' ')
+  * @retval Pointer to the terminating '\0' in dst
+  */
+char* Format_Uint(char* dst, uint32_t value, uint8_t min_width, char pad)
+{
+    char digits[10];
+    uint8_t count = 0;
+
+    do {
+        digits[count++] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    while (min_width > count) {
+        *dst++ = pad;
+        min_width--;
+    }
+    while (count > 0) {
+        *dst++ = digits[--count];
+    }
+    *dst = '\0';
+    return dst;
+}
+
+/**
+  * @brief  Format a fixed-point value with a given number of decimals
+  * @param  dst Output buffer
+  * @param  value Value scaled by 10^decimals (e.g. 1234 with 2 decimals = "12.34")
+  * @param  decimals Number of digits after the decimal point (0-9)
+  * @param  min_width Minimum total number of characters, left padded with spaces
+  * @retval Pointer to the terminating '\0' in dst
+  */
+char* Format_Fixed(char* dst, int32_t value, uint8_t decimals, uint8_t min_width)
+{
+    char* start = dst;
+    uint32_t magnitude;
+    uint32_t divisor = 1;
+
+    if (value < 0) {
+        *dst++ = '-';
+        magnitude = (uint32_t)(-(value + 1)) + 1;
+    } else {
+        magnitude = (uint32_t)value;
+    }
+
+    for (uint8_t i = 0; i < decimals; i++) {
+        divisor *= 10;
+    }
+
+    dst = Format_Uint(dst, magnitude / divisor, 1, '0');
+    if (decimals > 0) {
+        *dst++ = '.';
+        dst = Format_Uint(dst, magnitude % divisor, decimals, '0');
+    }
+
+    return Format_Pad(start, dst, min_width);
+}
+
+/**
+  * @brief  Format an energy value with automatic mWh -> Wh -> kWh scaling
+  * @param  dst Output buffer
+  * @param  energy_mwh Energy in milliwatt-hours
+  * @retval Pointer to the terminating '\0' in dst
+  * @note   Same scales as the original display: "123mWh", "12.34Wh", "1.234kWh"
+  */
+char* Format_Energy(char* dst, uint32_t energy_mwh)
+{
+    if (energy_mwh < 1000UL) {
+        dst = Format_Uint(dst, energy_mwh, 1, '0');
+        return Format_String(dst, "mWh");
+    } else if (energy_mwh < 1000000UL) {
+        dst = Format_Fixed(dst, (int32_t)(energy_mwh / 10), 2, 0);
+        return Format_String(dst, "Wh");
+    } else {
+        dst = Format_Fixed(dst, (int32_t)(energy_mwh / 1000), 3, 0);
+        return Format_String(dst, "kWh");
+    }
+}
+
+/**
+  * @brief  Right-align an already formatted field to a fixed width
+  * @param  start First character of the field
+  * @param  end Terminating '\0' of the field
+  * @param  width Minimum field width, shorter fields are left padded with spaces
+  * @retval Pointer to the terminating '\0' of the padded field
+  */
+char* Format_Pad(char* start, char* end, uint8_t width)
+{
+    uint8_t length = (uint8_t)(end - start);
+
+    if (length >= width) {
+        return end;
+    }
+
+    uint8_t shift = width - length;
+    for (int8_t i = (int8_t)length; i >= 0; i--) {
+        start[i + shift] = start[i];
+    }
+    for (uint8_t i = 0; i < shift; i++) {
+        start[i] = ' ';
+    }
+    return start + width;
+}
@@ -0,0 +1,109 @@
+/**
+  ******************************************************************************
+  * @file           : histogram.c
+  * @brief          : Load profile, time spent in log-spaced power bins
+  ******************************************************************************
+  */
+
+#include "histogram.h"
+#include <string.h>
+
+// 10^(1/n) in Q16 for n = 1 .. HISTOGRAM_MAX_PER_DECADE
+static const uint32_t histogram_step_q16[HISTOGRAM_MAX_PER_DECADE] = {
+    655360, 207243, 141193, 116541, 103868, 96194
+};
+
+/**
+  * @brief  Clear the counters, keeping the edges
+  */
+void Histogram_Reset(Histogram_t* histogram)
+{
+    memset(histogram->bin_ms, 0, sizeof(histogram->bin_ms));
+    histogram->remainder_us = 0;
+    histogram->saturated = 0;
+}
+
+/**
+  * @brief  Build the edge table and clear the counters
+  * @param  histogram Histogram
+  * @param  config Lower edge and bins per decade, clamped to the valid range
+  */
+void Histogram_Configure(Histogram_t* histogram, const Histogram_Config_t* config)
+{
+    uint16_t per_decade = config->per_decade;
+    uint64_t decade_mw = (config->base_mw > 0) ? config->base_mw : 1;
+
+    if (per_decade < 1) per_decade = 1;
+    if (per_decade > HISTOGRAM_MAX_PER_DECADE) per_decade = HISTOGRAM_MAX_PER_DECADE;
+
+    // Q8 edges, restarted at each decade so rounding does not build up;
+    // clamped to INT32_MAX, which keeps the products within 64 bits
+    uint64_t edge_q8 = decade_mw << 8;
+    for (uint8_t k = 0; k < HISTOGRAM_BINS - 1; k++) {
+        if (k > 0 && k % per_decade == 0) {
+            decade_mw = (decade_mw > INT32_MAX / 10) ? INT32_MAX : decade_mw * 10;
+            edge_q8 = decade_mw << 8;
+        } else if (k > 0) {
+            edge_q8 = (edge_q8 * histogram_step_q16[per_decade - 1]) >> 16;
+        }
+        if (edge_q8 > ((uint64_t)INT32_MAX << 8)) {
+            edge_q8 = (uint64_t)INT32_MAX << 8;
+        }
+        histogram->edge_mw[k] = (uint32_t)((edge_q8 + 0x80) >> 8);
+    }
+
+    histogram->applied = *config;
+    Histogram_Reset(histogram);
+}
+
+/**
+  * @brief  Bin of a power value
+  * @note   Binary search with a fixed number of steps, log2(HISTOGRAM_BINS)
+  */
+uint8_t Histogram_Bin(const Histogram_t* histogram, int32_t power_mw)
+{
+    uint8_t bin = 0;
+
+    if (power_mw <= 0) {
+        return 0;
+    }
+    for (uint8_t step = HISTOGRAM_BINS / 2; step > 0; step >>= 1) {
+        if ((uint32_t)power_mw >= histogram->edge_mw[bin + step - 1]) {
+            bin += step;
+        }
+    }
+    return bin;
+}
+
+/**
+  * @brief  Count a sample interval into the bin of its power
+  * @param  histogram Histogram
+  * @param  config Wanted configuration, applied here when it changed
+  * @param  power_mw Signed power of the sample
+  * @param  delta_us Time since the previous sample
+  */
+void Histogram_Sample(Histogram_t* histogram, const Histogram_Config_t* config,
+                      int32_t power_mw, uint32_t delta_us)
+{
+    if (config->base_mw != histogram->applied.base_mw ||
+        config->per_decade != histogram->applied.per_decade) {
+        Histogram_Configure(histogram, config);
+    }
+
+    // 32-bit split of remainder + delta, no 64-bit division in the tick
+    uint32_t add_ms = delta_us / 1000;
+    uint32_t remainder_us = histogram->remainder_us + delta_us % 1000;
+    uint32_t* counter = &histogram->bin_ms[Histogram_Bin(histogram, power_mw)];
+
+    if (remainder_us >= 1000) {
+        remainder_us -= 1000;
+        add_ms++;
+    }
+    histogram->remainder_us = remainder_us;
+    if (*counter > UINT32_MAX - add_ms) {
+        *counter = UINT32_MAX;
+        histogram->saturated = 1;
+    } else {
+        *counter += add_ms;
+    }
+}
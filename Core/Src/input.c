@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file           : input.c
+  * @brief          : Input event queue and button gesture recognizer
+  ******************************************************************************
+  */
+
+#include "input.h"
+
+#define INPUT_QUEUE_MASK        (INPUT_QUEUE_SIZE - 1)
+
+// Keeps the compiler from moving the slot access past the index update.
+// Cortex-M0+ has a single core and no write buffer reordering to worry about.
+#define INPUT_BARRIER()         __asm volatile ("" ::: "memory")
+
+/**
+  * @brief  Append an event, called from the producing interrupt only
+  * @param  queue Event queue
+  * @param  event Event to copy in
+  * @retval 1 if queued, 0 if the queue was full and the event was dropped
+  */
+uint8_t Input_Queue_Push(Input_Queue_t* queue, const Input_Event_t* event)
+{
+    uint8_t head = queue->head;
+    uint8_t next = (head + 1) & INPUT_QUEUE_MASK;
+
+    if (next == queue->tail) {
+        queue->dropped++;
+        return 0;
+    }
+
+    queue->events[head] = *event;
+    INPUT_BARRIER();
+    queue->head = next;
+    return 1;
+}
+
+/**
+  * @brief  Take the oldest event, called from the main loop only
+  * @param  queue Event queue
+  * @param  event Receives the event
+  * @retval 1 if an event was returned, 0 if the queue was empty
+  */
+uint8_t Input_Queue_Pop(Input_Queue_t* queue, Input_Event_t* event)
+{
+    uint8_t tail = queue->tail;
+
+    if (tail == queue->head) {
+        return 0;
+    }
+
+    INPUT_BARRIER();
+    *event = queue->events[tail];
+    INPUT_BARRIER();
+    queue->tail = (tail + 1) & INPUT_QUEUE_MASK;
+    return 1;
+}
+
+/**
+  * @brief  Check for queued events without taking one
+  * @param  queue Event queue
+  * @retval 1 if the queue is empty
+  */
+uint8_t Input_Queue_Empty(const Input_Queue_t* queue)
+{
+    return queue->tail == queue->head;
+}
+
+/**
+  * @brief  Reset the recognizer to released with nothing pending
+  */
+void Gesture_Init(Gesture_Recognizer_t* gesture)
+{
+    gesture->pressed = 0;
+    gesture->held = 0;
+    gesture->clicks = 0;
+    gesture->press_ms = 0;
+    gesture->release_ms = 0;
+    gesture->repeat_ms = 0;
+    gesture->repeat_interval = GESTURE_REPEAT_DELAY_MS;
+}
+
+/**
+  * @brief  Gesture for a finished click sequence
+  */
+static Gesture_Type_t Gesture_Flush_Clicks(Gesture_Recognizer_t* gesture)
+{
+    uint8_t clicks = gesture->clicks;
+
+    gesture->clicks = 0;
+    if (clicks == 1) {
+        return GESTURE_CLICK;
+    } else if (clicks == 2) {
+        return GESTURE_DOUBLE_CLICK;
+    } else if (clicks >= 3) {
+        return GESTURE_TRIPLE_CLICK;
+    }
+    return GESTURE_NONE;
+}
+
+/**
+  * @brief  Feed a button event
+  * @param  gesture Recognizer state
+  * @param  event INPUT_BUTTON_DOWN or INPUT_BUTTON_UP, other types are ignored
+  * @retval Gesture completed by this event, GESTURE_NONE if none
+  */
+Gesture_Type_t Gesture_Event(Gesture_Recognizer_t* gesture, const Input_Event_t* event)
+{
+    Gesture_Type_t result = GESTURE_NONE;
+
+    if (event->type == INPUT_BUTTON_DOWN && !gesture->pressed) {
+        // A press after the gap ends the previous sequence (late main loop)
+        if (gesture->clicks && event->time_ms - gesture->release_ms >= GESTURE_CLICK_GAP_MS) {
+            result = Gesture_Flush_Clicks(gesture);
+        }
+        gesture->pressed = 1;
+        gesture->held = 0;
+        gesture->press_ms = event->time_ms;
+    } else if (event->type == INPUT_BUTTON_UP && gesture->pressed) {
+        gesture->pressed = 0;
+        if (!gesture->held) {
+            gesture->release_ms = event->time_ms;
+            if (++gesture->clicks >= 3) {
+                result = Gesture_Flush_Clicks(gesture);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+  * @brief  Advance the time based gestures
+  * @param  gesture Recognizer state
+  * @param  now_ms Current time, after all queued events have been fed
+  * @retval Gesture due at this time, GESTURE_NONE if none
+  */
+Gesture_Type_t Gesture_Update(Gesture_Recognizer_t* gesture, uint32_t now_ms)
+{
+    if (!gesture->pressed) {
+        if (gesture->clicks && now_ms - gesture->release_ms >= GESTURE_CLICK_GAP_MS) {
+            return Gesture_Flush_Clicks(gesture);
+        }
+        return GESTURE_NONE;
+    }
+
+    if (!gesture->held) {
+        if (now_ms - gesture->press_ms >= GESTURE_HOLD_MS) {
+            // Clicks right before the hold belong to it
+            gesture->held = 1;
+            gesture->clicks = 0;
+            gesture->repeat_interval = GESTURE_REPEAT_DELAY_MS;
+            gesture->repeat_ms = now_ms + GESTURE_REPEAT_DELAY_MS;
+            return GESTURE_HOLD;
+        }
+        return GESTURE_NONE;
+    }
+
+    if ((int32_t)(now_ms - gesture->repeat_ms) >= 0) {
+        gesture->repeat_interval = (gesture->repeat_interval * 3) / 4;
+        if (gesture->repeat_interval < GESTURE_REPEAT_MIN_MS) {
+            gesture->repeat_interval = GESTURE_REPEAT_MIN_MS;
+        }
+        gesture->repeat_ms = now_ms + gesture->repeat_interval;
+        return GESTURE_HOLD_REPEAT;
+    }
+    return GESTURE_NONE;
+}
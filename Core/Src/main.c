@@ -34,34 +34,125 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-#include <stdio.h>
+#include <string.h>
 #include "ssd1306/ssd1306.h"
+#include "format.h"
+#include "encoder.h"
+#include "input.h"
+#include "power.h"
+#include "calibration.h"
+#include "compensation.h"
+#include "energy.h"
+#include "demand.h"
+#include "histogram.h"
+#include "events.h"
+#include "spectrum.h"
+#include "scope.h"
+#include "timebase.h"
+#include "measurement.h"
+#include "board_io.h"
+#include "protection.h"
+#include "stm32l0xx_ll_adc.h"
+#include "console.h"
+#include "ui/ui.h"
+#include "ui/menu.h"
+#include "ui/display_power.h"
 
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
 /* USER CODE BEGIN PTD */
+typedef struct {
+    uint8_t sampling;       // SMPR code
+    uint8_t oversampling;   // Log2 of the conversions averaged per sample
+} Scope_Timebase_t;
 
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-// Production calibration constants for real power measurement
+// Production calibration constants for real power measurement, used as the
+// default calibration until one is stored in data EEPROM (calibration.c)
 #define VOLTAGE_SCALE_FACTOR    7.32f    // 分压倍率 (硬件常数)
 #define VOLTAGE_GAIN            1.36f   // 斜率校正 m
 #define VOLTAGE_OFFSET         -0.962f   // 零点校正 b (单位 V)
 #define CURRENT_SCALE_FACTOR    1.22f    // Current sensor ratio (5A max → 3.3V ADC)
+#define CURRENT_ZERO_OFFSET     2.15f    // Sensor output at 0 A, after the ratio (A)
+#define CURRENT_GAIN            0.245f   // Scale correction (fine-tuned)
 #define ADC_VREF                3.3f     // ADC reference voltage
 #define ADC_RESOLUTION          4095.0f  // 12-bit ADC resolution
 
+// Defaults in calibration units: milli-units per ADC code (Q16) and milli-unit offset
+#define CAL_DEFAULT_VOLTAGE_GAIN   ((int32_t)(ADC_VREF / ADC_RESOLUTION * VOLTAGE_SCALE_FACTOR * \
+                                              VOLTAGE_GAIN * 1000.0f * 65536.0f))
+#define CAL_DEFAULT_VOLTAGE_OFFSET ((int32_t)(VOLTAGE_OFFSET * 1000.0f))
+#define CAL_DEFAULT_CURRENT_GAIN   ((int32_t)(ADC_VREF / ADC_RESOLUTION * CURRENT_SCALE_FACTOR / \
+                                              CURRENT_GAIN * 1000.0f * 65536.0f))
+#define CAL_DEFAULT_CURRENT_OFFSET ((int32_t)(-CURRENT_ZERO_OFFSET / CURRENT_GAIN * 1000.0f))
+
+// VDDA / temperature compensation (compensation.c)
+#define COMPENSATION_INTERVAL_TICKS 15   // Internal channels sampled about once a second
+#define VOLTAGE_TEMPCO_PPM      0        // Divider gain drift (ppm/C), 0 = not characterized
+#define CURRENT_TEMPCO_PPM      0        // Current sensor gain drift (ppm/C), 0 = not characterized
+
+// Current auto-zero: AUTOZERO_TICKS x AUTOZERO_SAMPLES_PER_TICK conversions averaged
+#define AUTOZERO_TICKS          16       // About one second of TIM6 ticks
+#define AUTOZERO_SAMPLES_PER_TICK 16
+#define AUTOZERO_AT_BOOT        1        // Re-zero at power up when the reading looks unloaded
+#define AUTOZERO_BOOT_LIMIT_MA  300      // Boot re-zero is skipped above this reading
+
 // Memory optimization: Reduce graph data points for 32KB Flash
 #define GRAPH_DATA_POINTS       32       // Reduced from 64 to save RAM
-#define MENU_TIMEOUT_MS         30000    // 30 second timeout for menu auto-return
+#define GRAPH_LABEL_COLUMNS     18       // Widest y axis label, "150" in Font_6x8
+#define GRAPH_X_START           (GRAPH_LABEL_COLUMNS + 1)   // First plot column, right of the y axis
+#define GRAPH_WIDTH             108      // Plot width in columns, the curve ends at column 127
+#define GRAPH_Y_OFFSET          10       // First plot row, below the title line
+#define GRAPH_HEIGHT            20       // Plot height in rows, x axis included
+#define BAR_CHART_Y             8        // First bar chart row, below the title line
+#define BAR_CHART_HEIGHT        24       // Tallest bar in rows
+#define HISTOGRAM_BAR_PITCH     (SSD1306_WIDTH / HISTOGRAM_BINS)
+#define SPECTRUM_RATE_HZ        1250     // Default FFT sample rate
+#define SPECTRUM_INTERVAL_MS    1000     // New spectrum frame while its page is shown
+#define SPECTRUM_WAIT_MARGIN_MS 20       // Console FFT wait beyond the frame time
+#define SPECTRUM_FLOOR_DB       48       // Bar chart range below the strongest bin
+#define SPECTRUM_BAR_PITCH      (SSD1306_WIDTH / SPECTRUM_BINS)
+#define SCOPE_INTERVAL_MS       200      // Pause between captures while the scope page is shown
+#define SCOPE_AUTO_MS           50       // Auto mode after this long without a trigger
+#define SCOPE_WAIT_MARGIN_MS    20       // Console SCOPE wait beyond auto mode
+#define SCOPE_LEVEL_STEP        32       // Trigger level per encoder step (ADC codes)
+#define SCOPE_PRETRIGGER_STEP   5        // Pre-trigger share per encoder step (%)
+#define ADC_STREAM              (FEATURE_SPECTRUM || FEATURE_SCOPE)  // DMA streams built in
+#define MENU_TIMEOUT_S          30       // Default timeout for menu auto-return (seconds)
+#define DISPLAY_BRIGHTNESS_PCT  100      // Default OLED brightness
+#define DISPLAY_DIM_AFTER_S     30       // Default idle time before dimming (seconds)
+#define DISPLAY_OFF_AFTER_S     120      // Default idle time before the OLED turns off (seconds)
+#define PROTECTION_VOLTAGE_DV   0        // Default over-voltage trip (0.1 V, 0 = off)
+#define PROTECTION_CURRENT_CA   0        // Default over-current trip (0.01 A, 0 = off)
+#define PROTECTION_HYSTERESIS   5        // Default release hysteresis (% of the limit)
+#define HISTOGRAM_BASE_MW       100      // Default lower edge of the first load bin (mW)
+#define HISTOGRAM_PER_DECADE    4        // Default load bins per decade of power
+#define EVENTS_STEP_DW          20       // Default smallest load step reported (0.1 W)
+#define EVENTS_HYSTERESIS       25       // Default step hysteresis (% of the step)
+#define EVENTS_DEBOUNCE_MS      250      // Default time a new load level must hold
+
+// Rotary encoder input: EXTI edge decoding, or TIM22 hardware encoder mode
+// (PB4 = TIM22_CH1, PB5 = TIM22_CH2) read once per TIM6 tick without edge IRQs
+#define ROTARY_INPUT_EXTI       0
+#define ROTARY_INPUT_TIM22      1
+#define ROTARY_INPUT_MODE       ROTARY_INPUT_EXTI
+
+// Glyphs pre-rendered at boot for the power meter screen
+#define METER_GLYPHS_7x10       " .:-0123456789VAIPWEmhk"
+#define METER_GLYPHS_6x8        " :-.0123456789ROTQAh"
 
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
 /* USER CODE BEGIN PM */
+#if !FEATURE_PROTECTION
+#define Protection_Arm(channel) ((void)0)
+#define Protection_Arm_Single(channel, adc_channel) ((void)0)
+#endif
 
 /* USER CODE END PM */
 
@@ -73,47 +164,114 @@ I2C_HandleTypeDef hi2c1;
 TIM_HandleTypeDef htim6;
 
 /* USER CODE BEGIN PV */
-static uint8_t rotary_state;
+// TIM2 is not part of the .ioc, see TIM2_Timebase_Init()
+TIM_HandleTypeDef htim2;
+#if ROTARY_INPUT_MODE == ROTARY_INPUT_TIM22
+// TIM22 is not part of the .ioc, see TIM22_Encoder_Init()
+TIM_HandleTypeDef htim22;
+#endif
+static Encoder_t rotary_encoder;
 static uint8_t rotary_counter;
 static uint8_t button_state;
 
-// Real power meter variables (production)
+// Input events from the interrupts, one SPSC queue per producing ISR
+static Input_Queue_t button_queue;
+static Input_Queue_t rotary_queue;
+static Gesture_Recognizer_t button_gesture;
+static int8_t last_rotate_direction = 1;  // Hold-repeat direction in value editors
+
+// Set by the TIM6 tick, the main loop redraws the display
+static volatile uint8_t display_update_pending = 0;
+
+#if ADC_STREAM
+// A scope or spectrum DMA stream owns the ADC, the TIM6 tick leaves it alone
+static volatile uint8_t adc_stream_active = 0;
+#endif
+
+#if FEATURE_CALIBRATION
+// Raw ADC codes averaged over ~8 ticks (Q3), captured by calibration
+static volatile uint16_t voltage_adc_avg_q3 = 0;
+static volatile uint16_t current_adc_avg_q3 = 0;
+
+// Calibration references entered in the menu (0.1 V and 0.01 A)
+static uint16_t cal_ref_voltage_dv = 120;
+static uint16_t cal_ref_current_ca = 100;
+#endif
+
+static Compensation_Config_t compensation_config = {
+    .tempco_ppm = { VOLTAGE_TEMPCO_PPM, CURRENT_TEMPCO_PPM }
+};
+static uint8_t compensation_ticks = 0;
+
+// Auto-zero: the TIM6 handler sums the samples, the main loop stores the result
+static volatile uint8_t autozero_ticks_left = 0;
+static volatile uint8_t autozero_done = 0;
+static uint8_t autozero_at_boot = 0;
+static uint32_t autozero_sum = 0;
+
+static const Cal_Line_t calibration_defaults[CAL_CHANNELS] = {
+    { CAL_DEFAULT_VOLTAGE_GAIN, CAL_DEFAULT_VOLTAGE_OFFSET },
+    { CAL_DEFAULT_CURRENT_GAIN, CAL_DEFAULT_CURRENT_OFFSET },
+};
+
+// Real power meter variables (production), owned by the TIM6 handler
 static float measured_voltage = 0.0f;     // Real measured voltage (V)
 static float measured_current = 0.0f;     // Real measured current (A)
 static float calculated_power = 0.0f;     // Calculated power (W)
-static float accumulated_energy = 0.0f;   // Accumulated energy (Wh)
-static uint32_t last_timestamp = 0;       // For energy integration
+static Energy_t energy;                   // Imported/exported energy and charge
+#if FEATURE_DEMAND
+static Demand_t demand;                   // 1/5/15 minute average power
+#endif
+#if FEATURE_HISTOGRAM
+static Histogram_t histogram;             // Time spent per power bin
+#endif
+#if FEATURE_EVENTS
+static Events_t load_events;              // Load steps and their log
+#endif
+static uint32_t last_timestamp = 0;       // For energy integration (us)
 
 // Peak value tracking
 static float peak_voltage = 0.0f;
 static float peak_current = 0.0f;
 static float peak_power = 0.0f;
 
-// Button handling for reset functions
-static uint32_t button_press_time = 0;
-static uint8_t button_long_press_handled = 0;
+// Resets requested by the main loop, carried out by the TIM6 handler
+static volatile uint8_t peaks_reset_pending = 0;
+static volatile uint8_t energy_reset_pending = 0;
+#if FEATURE_EVENTS
+static volatile uint8_t events_reset_pending = 0;
+#endif
+
+// Published result sets, and the one the current frame is drawn from
+static Measurement_Latch_t measurement_latch;
+static Measurement_t display_snapshot;
+
+// Button debouncing, press timing is done by the gesture recognizer
 static uint32_t button_last_interrupt_time = 0;
 static uint8_t button_stable_state = 0;
 
-// Menu system variables
-typedef enum {
-    MENU_POWER_METER = 0,    // Main power meter display
-    MENU_MAIN,               // Main menu
-    MENU_PEAKS,              // Peak values display
-    MENU_GRAPHICS,           // Graphics display menu
-    MENU_GRAPHICS_SELECT,    // Graphics parameter selection
-    MENU_SETTINGS,           // Settings menu
-    MENU_RESET,              // Reset menu
-    MENU_ABOUT               // About/Info
-} MenuState_t;
-
-static MenuState_t current_menu = MENU_POWER_METER;
-static uint8_t menu_selection = 0;
-static uint8_t menu_changed = 1;
+// Menu system variables (menu tree and its state live in ui/menu.c)
 static uint32_t last_activity_time = 0;
-
-// Rotary encoder debouncing variables
-static uint32_t rotary_last_interrupt_time = 0;
+static uint16_t menu_timeout_s = MENU_TIMEOUT_S;  // Editable in Settings
+static Display_Power_Config_t display_power = {   // Editable in Settings
+    DISPLAY_BRIGHTNESS_PCT, DISPLAY_DIM_AFTER_S, DISPLAY_OFF_AFTER_S
+};
+#if FEATURE_PROTECTION
+static Protection_Config_t protection_config = {  // Editable in Settings
+    PROTECTION_VOLTAGE_DV, PROTECTION_CURRENT_CA, PROTECTION_HYSTERESIS
+};
+#endif
+#if FEATURE_HISTOGRAM
+static Histogram_Config_t histogram_config = {    // Editable in Settings
+    HISTOGRAM_BASE_MW, HISTOGRAM_PER_DECADE
+};
+#endif
+#if FEATURE_EVENTS
+static Events_Config_t events_config = {          // Editable in Settings
+    EVENTS_STEP_DW, EVENTS_HYSTERESIS, EVENTS_DEBOUNCE_MS
+};
+static uint8_t event_cursor = 0;                  // Browsed event, 0 = newest
+#endif
 
 // Graphics functionality variables (memory optimized)
 static float voltage_history[GRAPH_DATA_POINTS];
@@ -122,6 +280,59 @@ static float power_history[GRAPH_DATA_POINTS];
 static uint8_t graph_data_index = 0;
 static uint8_t graphics_parameter = 0;  // 0 = Voltage, 1 = Current, 2 = Power
 static uint32_t last_graph_update = 0;
+static uint8_t graph_strip_segment = 0; // Next strip-chart segment (0..GRAPH_DATA_POINTS-2)
+static uint8_t graph_strip_index = 0;   // Next history sample the strip plots
+static uint8_t graph_strip_last_y = 0;  // Row of the previously plotted sample
+
+#if ADC_STREAM
+// Spectrum frame and scope stream share their RAM, only one runs at a time
+static union {
+    struct {
+        int16_t re[SPECTRUM_N];         // Spectrum mode: one frame, transformed in place
+        int16_t im[SPECTRUM_N];
+    } spectrum;
+    volatile uint16_t scope[SCOPE_BUFFER];  // Scope mode: circular DMA buffer
+} capture;
+// Conversion time per SMPR code in half ADC clocks (16 MHz, PCLK / 2),
+// sampling plus 12.5 clocks of successive approximation
+static const uint16_t adc_conversion_x2[8] = { 28, 32, 40, 50, 64, 104, 184, 346 };
+#endif
+#if FEATURE_SPECTRUM
+static Spectrum_t spectrum;
+static uint8_t spectrum_channel = 0;    // 0 = Voltage, 1 = Current
+static uint8_t spectrum_view = 0;       // 0 = bars, 1 = harmonics
+static uint16_t spectrum_frames = 0;    // Analysed frames, 0 = none yet
+static uint32_t spectrum_last_ms = 0;
+static uint16_t spectrum_rate_hz = SPECTRUM_RATE_HZ;  // Editable in Settings
+static uint8_t spectrum_running = 0;    // Frame streaming
+static volatile uint8_t spectrum_capture_done = 0;  // Set by the DMA interrupt
+static uint8_t spectrum_capture_channel = 0;
+static uint32_t spectrum_sample_ns = 0; // Period of the frame being streamed
+#endif
+
+#if FEATURE_SCOPE
+// Scope mode: bursts at the full ADC rate, slower timebases by longer
+// sampling and oversampling; 112 us to 177 ms per record
+static const Scope_Timebase_t scope_timebases[] = {
+    { 0, 0 }, { 3, 0 }, { 5, 0 }, { 6, 0 }, { 7, 0 }, { 7, 1 },
+    { 7, 2 }, { 7, 3 }, { 7, 4 }, { 7, 5 }, { 7, 6 }, { 7, 7 },
+};
+static Scope_t scope;
+static Scope_Config_t scope_config = { 2048, SCOPE_RISING, 25 };
+static uint8_t scope_channels = 0;      // 0 = Voltage, 1 = Current, 2 = both
+static uint8_t scope_timebase = 6;      // scope_timebases index
+static uint8_t scope_control = 0;       // Encoder target: timebase, level, edge, pre-trigger
+static uint8_t scope_running = 0;       // Stream active
+static uint8_t scope_auto = 0;          // Last capture completed without a trigger
+static uint16_t scope_frames = 0;       // Completed captures, 0 = none yet
+static uint32_t scope_last_ms = 0;
+#endif
+
+// Power meter glyph caches (column masks, see ssd1306_GlyphCacheInit)
+static SSD1306_GlyphCache meter_glyphs_7x10;
+static SSD1306_GlyphCache meter_glyphs_6x8;
+static uint16_t meter_glyph_columns_7x10[(sizeof(METER_GLYPHS_7x10) - 1) * 7];
+static uint16_t meter_glyph_columns_6x8[(sizeof(METER_GLYPHS_6x8) - 1) * 6];
 
 /* USER CODE END PV */
 
@@ -132,6 +343,15 @@ static void MX_ADC_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_TIM6_Init(void);
 /* USER CODE BEGIN PFP */
+static void TIM2_Timebase_Init(void);
+#if ROTARY_INPUT_MODE == ROTARY_INPUT_TIM22
+static void TIM22_Encoder_Init(void);
+#endif
+void Display_Graphics(void);
+void Display_Graphics_Strip(void);
+#if FEATURE_SPECTRUM
+static void Stop_Spectrum_Capture(void);
+#endif
 
 /* USER CODE END PFP */
 
@@ -145,39 +365,21 @@ static void MX_TIM6_Init(void);
   */
 float Convert_ADC_to_Voltage(uint32_t adc_value)
 {
-    // ADC 读数转换为 ADC 端电压
-    float adc_voltage = ((float)adc_value / ADC_RESOLUTION) * ADC_VREF;
-
-    // 经过分压倍率换算到输入侧（仍未校正）
-    float measured_voltage = adc_voltage * VOLTAGE_SCALE_FACTOR;
-
-    // 线性校正：y = m·x + b
-    return measured_voltage * VOLTAGE_GAIN + VOLTAGE_OFFSET;
+    // 线性校正 y = m·x + b，整数定点运算 (mV)
+    return (float)Calibration_Apply(CAL_VOLTAGE, adc_value) * 0.001f;
 }
 
 /**
   * @brief  Convert ADC value to real current measurement
   * @param  adc_value Raw ADC value (0-4095)
-  * @retval Real current in amperes (0-5A range)
+  * @retval Real current in amperes, negative when the current flows backwards
   */
 float Convert_ADC_to_Current(uint32_t adc_value)
 {
     // Production ADC_CHANNEL_3 (PA3): Real current measurement via current sensor
-    // ADC voltage = (adc_value / 4095) * 3.3V
-    // Apply offset and scale corrections
-    float adc_voltage = ((float)adc_value / ADC_RESOLUTION) * ADC_VREF;
-    float raw_current = adc_voltage * CURRENT_SCALE_FACTOR;
-    
-    // Remove 2.15A offset and apply scale correction (fine-tuned)
-    // Real current = (displayed_current - offset) / 0.23
-    float corrected_current = (raw_current - 2.15f) / 0.245f;
-    
-    // Ensure current doesn't go negative
-    if (corrected_current < 0.0f) {
-        corrected_current = 0.0f;
-    }
-    
-    return corrected_current;
+    // Sensor offset and scale are part of the calibration line, the auto-zero
+    // correction keeps the zero code at 0 mA (signed, mA)
+    return (float)Calibration_Apply(CAL_CURRENT, adc_value) * 0.001f;
 }
 
 /**
@@ -192,17 +394,37 @@ float Calculate_Power(float voltage, float current)
 }
 
 /**
-  * @brief  Update accumulated energy using trapezoidal integration
-  * @param  power Current power in watts
-  * @param  delta_time Time interval in milliseconds
+  * @brief  Update the energy and charge counters using trapezoidal integration
+  *         and the demand windows and load profile
+  * @param  power Current power in watts, negative when energy flows back
+  * @param  current Current in amperes, negative when flowing back
+  * @param  delta_time Time since the previous sample in microseconds
   */
-void Update_Energy(float power, uint32_t delta_time)
+void Update_Energy(float power, float current, uint32_t delta_time)
 {
-    // Convert delta_time from ms to hours for Wh calculation
-    float delta_hours = (float)delta_time / (1000.0f * 3600.0f);
+    int32_t power_mw = (int32_t)(power * 1000.0f);
+
+    // Integer mW/mA over us, summed into the 64-bit import/export counters
+    Energy_Sample(&energy, power_mw, (int32_t)(current * 1000.0f), delta_time);
+#if FEATURE_DEMAND
+    Demand_Sample(&demand, power_mw, delta_time);
+#endif
+#if FEATURE_HISTOGRAM
+    Histogram_Sample(&histogram, &histogram_config, power_mw, delta_time);
+#endif
+}
+
+/**
+  * @brief  Integer that orders like a float that is compared to one >= 0
+  * @note   The IEEE 754 bits of non-negative floats compare like the values
+  *         and every negative float has the sign bit set. The peaks start
+  *         at 0 and only grow, so this replaces the soft-float compare.
+  */
+static inline int32_t Float_Order(float value)
+{
+    union { float f; int32_t i; } bits = { .f = value };
 
-    // Integration: E += P * dt
-    accumulated_energy += power * delta_hours;
+    return bits.i;
 }
 
 /**
@@ -213,486 +435,1775 @@ void Update_Energy(float power, uint32_t delta_time)
   */
 void Update_Peaks(float voltage, float current, float power)
 {
-    if (voltage > peak_voltage) peak_voltage = voltage;
-    if (current > peak_current) peak_current = current;
-    if (power > peak_power) peak_power = power;
+    if (Float_Order(voltage) > Float_Order(peak_voltage)) peak_voltage = voltage;
+    if (Float_Order(current) > Float_Order(peak_current)) peak_current = current;
+    if (Float_Order(power) > Float_Order(peak_power)) peak_power = power;
 }
 
 /**
   * @brief  Reset all peak values to zero
+  * @note   Takes effect on the next measurement tick
   */
 void Reset_Peaks(void)
 {
-    peak_voltage = 0.0f;
-    peak_current = 0.0f;
-    peak_power = 0.0f;
+    peaks_reset_pending = 1;
+}
+
+/**
+  * @brief  Reset accumulated energy to zero
+  * @note   Takes effect on the next measurement tick
+  */
+void Reset_Energy(void)
+{
+    energy_reset_pending = 1;
+}
+
+#if FEATURE_EVENTS
+/**
+  * @brief  Clear the load event log
+  * @note   Takes effect on the next measurement tick
+  */
+void Clear_Events(void)
+{
+    events_reset_pending = 1;
+}
+#endif
+
+/**
+  * @brief  Carry out requested resets, from the measurement tick
+  */
+static void Apply_Pending_Resets(void)
+{
+    if (peaks_reset_pending) {
+        peak_voltage = 0.0f;
+        peak_current = 0.0f;
+        peak_power = 0.0f;
+#if FEATURE_DEMAND
+        Demand_Reset_Peaks(&demand);
+#endif
+        peaks_reset_pending = 0;
+    }
+    if (energy_reset_pending) {
+        Energy_Reset(&energy);
+#if FEATURE_DEMAND
+        Demand_Reset(&demand);
+#endif
+#if FEATURE_HISTOGRAM
+        Histogram_Reset(&histogram);
+#endif
+        energy_reset_pending = 0;
+    }
+#if FEATURE_EVENTS
+    if (events_reset_pending) {
+        Events_Reset(&load_events);
+        events_reset_pending = 0;
+    }
+#endif
+}
+
+/**
+  * @brief  Publish the current result set to the display and console
+  * @param  timestamp_us Timebase at the sample
+  */
+static void Publish_Measurement(uint32_t timestamp_us)
+{
+    Measurement_t measurement;
+
+    measurement.timestamp_us = timestamp_us;
+    measurement.voltage = measured_voltage;
+    measurement.current = measured_current;
+    measurement.power = calculated_power;
+    measurement.peak_voltage = peak_voltage;
+    measurement.peak_current = peak_current;
+    measurement.peak_power = peak_power;
+    measurement.energy = energy;
+#if FEATURE_DEMAND
+    measurement.demand = demand.values;
+#endif
+    Measurement_Publish(&measurement_latch, &measurement);
+}
+
+/**
+  * @brief  Handle rotary encoder input for menu navigation
+  * @param  direction: detent steps, positive for clockwise, +-10/+-100 when spun fast
+  */
+void Handle_Menu_Navigation(int8_t direction)
+{
+    last_activity_time = Timebase_Now_ms();
+
+#if FEATURE_PROTECTION
+    // The alarm overlay hides the menu, don't move it blindly
+    if (Protection_Get_Event()) {
+        return;
+    }
+#endif
+    Menu_Navigate(direction);
+}
+
+/**
+  * @brief  Handle button gestures for menu actions
+  * @param  gesture Recognized gesture
+  */
+void Handle_Menu_Action(Gesture_Type_t gesture)
+{
+    last_activity_time = Timebase_Now_ms();
+
+#if FEATURE_PROTECTION
+    // A click acknowledges the alarm overlay, other gestures are ignored
+    if (Protection_Get_Event()) {
+        if (gesture == GESTURE_CLICK) {
+            Protection_Acknowledge();
+        }
+        return;
+    }
+#endif
+
+    switch (gesture) {
+        case GESTURE_CLICK:         // Enter/confirm
+            Menu_Select();
+            break;
+        case GESTURE_DOUBLE_CLICK:  // One level up
+            Menu_Back();
+            break;
+        case GESTURE_TRIPLE_CLICK:  // Straight to the power meter
+            Menu_Go_Root();
+            break;
+        case GESTURE_HOLD:          // Root <-> main menu, kept while editing for repeats
+            if (!Menu_Is_Editing()) {
+                Menu_Home();
+            }
+            break;
+        case GESTURE_HOLD_REPEAT:   // Keep stepping the edited value
+            if (Menu_Is_Editing()) {
+                Menu_Navigate(last_rotate_direction);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+  * @brief  Note user input and bring the display back to full brightness
+  * @retval 1 if the display was off, the input then only wakes it
+  */
+static uint8_t Input_Wake(void)
+{
+    last_activity_time = Timebase_Now_ms();
+    return Display_Power_Wake();
+}
+
+/**
+  * @brief  Drain the input queues and run the gesture recognizer (main loop)
+  */
+static void Process_Input(void)
+{
+    Input_Event_t event;
+
+    while (Input_Queue_Pop(&rotary_queue, &event)) {
+        if (Input_Wake()) {
+            continue;
+        }
+        last_rotate_direction = (event.value > 0) ? 1 : -1;
+        Handle_Menu_Navigation(event.value);
+    }
+
+    while (Input_Queue_Pop(&button_queue, &event)) {
+        // A press that wakes the display is dropped, its release is ignored
+        if (Input_Wake()) {
+            continue;
+        }
+        Gesture_Type_t gesture = Gesture_Event(&button_gesture, &event);
+        if (gesture != GESTURE_NONE) {
+            Handle_Menu_Action(gesture);
+        }
+    }
+
+    Gesture_Type_t gesture = Gesture_Update(&button_gesture, Timebase_Now_ms());
+    if (gesture != GESTURE_NONE) {
+        Handle_Menu_Action(gesture);
+    }
+}
+
+#if FEATURE_CALIBRATION
+/**
+  * @brief  Averaged raw ADC code of a channel, for calibration capture
+  */
+static uint16_t Calibration_Raw(Cal_Channel_t channel)
+{
+    uint16_t avg_q3 = (channel == CAL_VOLTAGE) ? voltage_adc_avg_q3 : current_adc_avg_q3;
+
+    return (avg_q3 + 4) >> 3;
+}
+
+static void Calibration_Capture_Voltage(void)
+{
+    Calibration_Capture(CAL_VOLTAGE, Calibration_Raw(CAL_VOLTAGE), (int32_t)cal_ref_voltage_dv * 100);
+}
+
+static void Calibration_Capture_Current(void)
+{
+    Calibration_Capture(CAL_CURRENT, Calibration_Raw(CAL_CURRENT), (int32_t)cal_ref_current_ca * 10);
+}
+#endif
+
+/**
+  * @brief  Start learning the zero code of the current channel
+  * @param  at_boot 1 to skip the result when the channel looks loaded
+  * @note   Remove the load first. The TIM6 handler averages the samples.
+  */
+static void Start_Auto_Zero(uint8_t at_boot)
+{
+    autozero_at_boot = at_boot;
+    autozero_sum = 0;
+    autozero_done = 0;
+    autozero_ticks_left = AUTOZERO_TICKS;
+}
+
+#if FEATURE_CALIBRATION
+static void Calibration_Zero_Current(void)
+{
+    Start_Auto_Zero(0);
+}
+#endif
+
+/**
+  * @brief  Store the averaged zero code once the TIM6 handler is done (main loop)
+  */
+static void Finish_Auto_Zero(void)
+{
+    if (!autozero_done) {
+        return;
+    }
+    autozero_done = 0;
+
+    // At boot a load may already be connected, only correct small offsets,
+    // and leave the stored zero alone while it is within the noise
+    Calibration_Auto_Zero(CAL_CURRENT, autozero_sum, (uint32_t)AUTOZERO_TICKS * AUTOZERO_SAMPLES_PER_TICK,
+                          autozero_at_boot ? AUTOZERO_BOOT_LIMIT_MA : 0);
+}
+
+#if FEATURE_CALIBRATION
+static void Calibration_Fit_And_Save(void)
+{
+    Calibration_Commit();
+}
+
+static void Calibration_Defaults(void)
+{
+    Calibration_Restore_Defaults();
+}
+#endif
+
+#if ADC_STREAM
+/**
+  * @brief  Time between two streamed samples
+  * @param  sampling SMPR code
+  * @param  oversampling Log2 of the conversions averaged per sample
+  * @retval Nanoseconds
+  */
+static uint32_t Adc_Stream_Period_ns(uint8_t sampling, uint8_t oversampling)
+{
+    return (((uint32_t)adc_conversion_x2[sampling] * 125) << oversampling) / 4;
+}
+#endif
+
+#if FEATURE_SCOPE
+/**
+  * @brief  Time between two conversions at the selected scope timebase
+  * @retval Nanoseconds
+  */
+static uint32_t Scope_Sample_ns(void)
+{
+    const Scope_Timebase_t* timebase = &scope_timebases[scope_timebase];
+
+    return Adc_Stream_Period_ns(timebase->sampling, timebase->oversampling);
+}
+
+/**
+  * @brief  Start streaming a burst capture with the scope page settings
+  * @note   The TIM6 tick skips its conversions until Stop_Scope_Capture(),
+  *         as the stream owns the ADC; its next sample integrates across
+  *         the pause like any late tick. The analog watchdog keeps guarding
+  *         the captured channel. Its one window cannot fit both channels, so
+  *         with both it watches only the current conversions and the
+  *         over-voltage trip waits for the next tick after the burst.
+  */
+static void Start_Scope_Capture(void)
+{
+    const Scope_Timebase_t* timebase = &scope_timebases[scope_timebase];
+    uint32_t half_us = Scope_Sample_ns() * SCOPE_HALF / 1000;
+    uint32_t channels;
+    uint8_t stride = 1;
+
+    if (scope_running) {
+        return;
+    }
+#if FEATURE_SPECTRUM
+    Stop_Spectrum_Capture();
+#endif
+    adc_stream_active = 1;
+    if (scope_channels == 0) {
+        channels = ADC_CHANNEL_4;
+        Protection_Arm(CAL_VOLTAGE);
+    } else if (scope_channels == 1) {
+        channels = ADC_CHANNEL_3;
+        Protection_Arm(CAL_CURRENT);
+    } else {
+        // Converted in channel order, current then voltage; the voltage triggers
+        channels = ADC_CHANNEL_3 | ADC_CHANNEL_4;
+        stride = 2;
+        Protection_Arm_Single(CAL_CURRENT, ADC_CHANNEL_3);
+    }
+    Scope_Arm(&scope, capture.scope, &scope_config, stride, stride - 1,
+              (uint16_t)(1 + SCOPE_AUTO_MS * 1000UL / half_us));
+    scope_running = 1;
+    Board_Adc_Stream_Start(channels, timebase->sampling, timebase->oversampling,
+                           capture.scope, SCOPE_BUFFER, 1);
+}
+
+/**
+  * @brief  End the burst capture, complete or not, and give the ADC back
+  */
+static void Stop_Scope_Capture(void)
+{
+    if (!scope_running) {
+        return;
+    }
+    Board_Adc_Stream_Restore();
+    if (scope.state == SCOPE_DONE) {
+        scope_auto = scope.forced;
+        scope_frames++;
+        if (scope_frames == 0) {
+            scope_frames = 1;
+        }
+    } else {
+        scope.state = SCOPE_IDLE;
+    }
+    scope_running = 0;
+    scope_last_ms = Timebase_Now_ms();
+    adc_stream_active = 0;
+}
+#endif
+
+#if FEATURE_SPECTRUM
+/**
+  * @brief  Start streaming one spectrum frame
+  * @param  channel 0 for voltage, 1 for current
+  * @note   The frame is a one-shot DMA transfer of SPECTRUM_N samples at
+  *         the stream timebase closest to spectrum_rate_hz; oversampling
+  *         makes up the longer periods and averages like an anti-alias
+  *         filter. Stop_Spectrum_Capture() analyses it once complete.
+  *         Meanwhile the TIM6 tick skips its conversions as for the scope.
+  */
+static void Start_Spectrum_Capture(uint8_t channel)
+{
+    uint32_t period_ns = 1000000000UL / spectrum_rate_hz;
+    uint32_t best_error = UINT32_MAX;
+    uint8_t sampling = 0;
+    uint8_t oversampling = 0;
+
+    if (spectrum_running) {
+        return;
+    }
+#if FEATURE_SCOPE
+    // The frame overwrites the scope record
+    Stop_Scope_Capture();
+    scope.state = SCOPE_IDLE;
+#endif
+
+    for (uint8_t smp = 0; smp < 8; smp++) {
+        for (uint8_t ovs = 0; ovs <= 8; ovs++) {
+            uint32_t ns = Adc_Stream_Period_ns(smp, ovs);
+            uint32_t error = (ns > period_ns) ? ns - period_ns : period_ns - ns;
+            if (error < best_error) {
+                best_error = error;
+                sampling = smp;
+                oversampling = ovs;
+            }
+        }
+    }
+    spectrum_sample_ns = Adc_Stream_Period_ns(sampling, oversampling);
+    spectrum_capture_channel = channel;
+    spectrum_capture_done = 0;
+    spectrum_running = 1;
+    adc_stream_active = 1;
+    Protection_Arm((channel == 0) ? CAL_VOLTAGE : CAL_CURRENT);
+    // re[] overlays the start of the stream buffer
+    Board_Adc_Stream_Start((channel == 0) ? ADC_CHANNEL_4 : ADC_CHANNEL_3, sampling, oversampling,
+                           capture.scope, SPECTRUM_N, 0);
+}
+
+/**
+  * @brief  Give the ADC back, and analyse the frame if it is complete
+  */
+static void Stop_Spectrum_Capture(void)
+{
+    if (!spectrum_running) {
+        return;
+    }
+    Board_Adc_Stream_Restore();
+    spectrum_running = 0;
+    adc_stream_active = 0;
+    if (!spectrum_capture_done) {
+        return;
+    }
+
+    Spectrum_Analyze(capture.spectrum.re, capture.spectrum.im,
+                     SPECTRUM_N * spectrum_sample_ns / 1000, &spectrum);
+    spectrum_channel = spectrum_capture_channel;
+    spectrum_last_ms = Timebase_Now_ms();
+    spectrum_frames++;
+    if (spectrum_frames == 0) {
+        spectrum_frames = 1;
+    }
+}
+#endif
+
+#if FEATURE_CONSOLE
+/**
+  * @brief  Run a console command line
+  * @param  line Received line
+  * @note   CAL V <mV> / CAL I <mA> capture a point at the applied reference,
+  *         CAL FIT fits and stores, CAL CLEAR drops the points, CAL DEFAULT
+  *         restores the compiled-in lines, CAL ZERO learns the current zero
+  *         (no load), CAL prints the active lines, LUT marks channels
+  *         converting through a table and Z gives the zero correction.
+  *         ENERGY prints import, export and net energy (E, mWh), charge
+  *         (Q, mAh) and the bridged gaps (G, count and ms). DEMAND prints
+  *         one line per window: minutes, average and peak demand (mW).
+  *         HIST prints one line per load bin: lower edge (mW) and time (ms),
+  *         then SAT if a counter saturated. EVENTS prints the logged load
+  *         steps, oldest first: time (ms), power before, after and the step
+  *         (W), then the number of events since the last clear.
+  *         FFT V / FFT I capture a spectrum frame and print the fundamental
+  *         (F, mHz), THD and H2.. (0.1 %), then the bin levels (L, dB below
+  *         the strongest bin). SCOPE captures a burst with the scope page
+  *         settings and prints S with the time between steps (ns), the
+  *         channels, the trigger step and T (triggered) or A (auto), then
+  *         the record, 16 values a line in conversion order (mV, mA).
+  *         The CAL capture, fit, clear and default commands, DEMAND, HIST,
+  *         EVENTS, FFT and SCOPE exist when their feature is built in
+  *         (main.h).
+  */
+static void Handle_Console_Command(const char* line)
+{
+    char reply[128];
+    char* p = reply;
+#if FEATURE_CALIBRATION
+    int32_t reference;
+#endif
+    uint8_t ok = 1;
+
+    if (strcmp(line, "CAL ZERO") == 0) {
+        Start_Auto_Zero(0);
+#if FEATURE_CALIBRATION
+    } else if (strncmp(line, "CAL V", 5) == 0 && Console_Parse_Int(line + 5, &reference)) {
+        ok = Calibration_Capture(CAL_VOLTAGE, Calibration_Raw(CAL_VOLTAGE), reference);
+    } else if (strncmp(line, "CAL I", 5) == 0 && Console_Parse_Int(line + 5, &reference)) {
+        ok = Calibration_Capture(CAL_CURRENT, Calibration_Raw(CAL_CURRENT), reference);
+    } else if (strcmp(line, "CAL FIT") == 0) {
+        ok = Calibration_Commit();
+    } else if (strcmp(line, "CAL CLEAR") == 0) {
+        Calibration_Clear_Points();
+    } else if (strcmp(line, "CAL DEFAULT") == 0) {
+        ok = Calibration_Restore_Defaults();
+#endif
+    } else if (strcmp(line, "ENERGY") == 0) {
+        Measurement_t snapshot;
+        Measurement_Read(&measurement_latch, &snapshot);
+        p = Format_String(p, "E ");
+        p = Format_Fixed(p, Energy_To_mWh(snapshot.energy.import_nj), 0, 0);
+        p = Format_String(p, " ");
+        p = Format_Fixed(p, Energy_To_mWh(snapshot.energy.export_nj), 0, 0);
+        p = Format_String(p, " ");
+        p = Format_Fixed(p, Energy_Net_mWh(&snapshot.energy), 0, 0);
+        p = Format_String(p, "\r\nQ ");
+        p = Format_Fixed(p, Energy_To_mAh(snapshot.energy.charge_in_nc), 0, 0);
+        p = Format_String(p, " ");
+        p = Format_Fixed(p, Energy_To_mAh(snapshot.energy.charge_out_nc), 0, 0);
+        p = Format_String(p, " ");
+        p = Format_Fixed(p, Energy_Net_mAh(&snapshot.energy), 0, 0);
+        p = Format_String(p, "\r\nG ");
+        p = Format_Uint(p, snapshot.energy.gaps, 1, '0');
+        p = Format_String(p, " ");
+        p = Format_Uint(p, snapshot.energy.gap_ms, 1, '0');
+        p = Format_String(p, "\r\n");
+#if FEATURE_DEMAND
+    } else if (strcmp(line, "DEMAND") == 0) {
+        Measurement_t snapshot;
+        Measurement_Read(&measurement_latch, &snapshot);
+        for (uint8_t w = 0; w < DEMAND_WINDOWS; w++) {
+            p = Format_String(p, "D");
+            p = Format_Uint(p, Demand_Window_Minutes(w), 1, '0');
+            p = Format_String(p, " ");
+            p = Format_Fixed(p, snapshot.demand.average_mw[w], 0, 0);
+            p = Format_String(p, " ");
+            p = Format_Fixed(p, snapshot.demand.peak_mw[w], 0, 0);
+            p = Format_String(p, "\r\n");
+        }
+#endif
+#if FEATURE_HISTOGRAM
+    } else if (strcmp(line, "HIST") == 0) {
+        // Longer than one reply, sent a bin at a time
+        for (uint8_t k = 0; k < HISTOGRAM_BINS; k++) {
+            p = Format_Uint(reply, (k > 0) ? histogram.edge_mw[k - 1] : 0, 1, '0');
+            p = Format_String(p, " ");
+            p = Format_Uint(p, histogram.bin_ms[k], 1, '0');
+            Format_String(p, "\r\n");
+            Console_Write(reply);
+        }
+        p = Format_String(reply, histogram.saturated ? "SAT\r\n" : "");
+#endif
+#if FEATURE_EVENTS
+    } else if (strcmp(line, "EVENTS") == 0) {
+        Load_Event_t event;
+        for (uint8_t age = Events_Count(&load_events); age-- > 0; ) {
+            if (!Events_Get(&load_events, age, &event)) {
+                continue;
+            }
+            p = Format_Uint(reply, event.time_ms, 1, '0');
+            p = Format_String(p, " ");
+            p = Format_Fixed(p, event.before_dw, 1, 0);
+            p = Format_String(p, " ");
+            p = Format_Fixed(p, event.after_dw, 1, 0);
+            p = Format_String(p, " ");
+            p = Format_Fixed(p, event.after_dw - event.before_dw, 1, 0);
+            Format_String(p, "\r\n");
+            Console_Write(reply);
+        }
+        p = Format_String(reply, "N ");
+        p = Format_Uint(p, Events_Total(&load_events), 1, '0');
+        p = Format_String(p, "\r\n");
+#endif
+#if FEATURE_SPECTRUM
+    } else if (strcmp(line, "FFT V") == 0 || strcmp(line, "FFT I") == 0) {
+        uint32_t start_ms;
+        uint32_t limit_ms;
+
+        Stop_Spectrum_Capture();
+        Start_Spectrum_Capture((line[4] == 'V') ? 0 : 1);
+        limit_ms = SPECTRUM_N * spectrum_sample_ns / 1000000UL + SPECTRUM_WAIT_MARGIN_MS;
+        start_ms = Timebase_Now_ms();
+        while (!spectrum_capture_done && (uint32_t)(Timebase_Now_ms() - start_ms) < limit_ms) {
+        }
+        ok = spectrum_capture_done;
+        Stop_Spectrum_Capture();
+
+        if (ok) {
+            p = Format_String(p, "F ");
+            p = Format_Uint(p, spectrum.fundamental_mhz, 1, '0');
+            p = Format_String(p, "\r\nTHD ");
+            p = Format_Uint(p, spectrum.thd_pm, 1, '0');
+            p = Format_String(p, "\r\nH");
+            for (uint8_t h = 0; h < SPECTRUM_HARMONICS; h++) {
+                p = Format_String(p, " ");
+                p = Format_Uint(p, spectrum.harmonic_pm[h], 1, '0');
+            }
+            Format_String(p, "\r\n");
+            Console_Write(reply);
+            // Bin levels, 16 per line
+            for (uint8_t k = 0; k < SPECTRUM_BINS; k++) {
+                if (k % 16 == 0) {
+                    p = Format_String(reply, "L");
+                }
+                p = Format_String(p, " ");
+                p = Format_Uint(p, spectrum.level_db[k], 1, '0');
+                if (k % 16 == 15) {
+                    Format_String(p, "\r\n");
+                    Console_Write(reply);
+                }
+            }
+            p = reply;
+        }
+#endif
+#if FEATURE_SCOPE
+    } else if (strcmp(line, "SCOPE") == 0) {
+        // Auto mode completes within SCOPE_AUTO_MS and a few halves; give up
+        // beyond that rather than hang the console on a stalled stream
+        uint32_t limit_ms = SCOPE_AUTO_MS + SCOPE_WAIT_MARGIN_MS +
+                            3 * (Scope_Sample_ns() * SCOPE_HALF / 1000000UL);
+        uint32_t start_ms;
+
+        Stop_Scope_Capture();
+        Start_Scope_Capture();
+        start_ms = Timebase_Now_ms();
+        while (scope.state != SCOPE_DONE &&
+               (uint32_t)(Timebase_Now_ms() - start_ms) < limit_ms) {
+        }
+        ok = (scope.state == SCOPE_DONE);
+        Stop_Scope_Capture();
+
+        if (ok) {
+            p = Format_String(reply, "S ");
+            p = Format_Uint(p, Scope_Sample_ns() * scope.stride, 1, '0');
+            p = Format_String(p, (scope.stride == 2) ? " IV " : (scope_channels == 0) ? " V " : " I ");
+            p = Format_Uint(p, scope.pre_steps, 1, '0');
+            p = Format_String(p, scope.forced ? " A\r\n" : " T\r\n");
+            Console_Write(reply);
+            for (uint16_t k = 0; k < SCOPE_RECORD; k++) {
+                uint8_t lane = (uint8_t)(k % scope.stride);
+                Cal_Channel_t channel = (scope.stride == 2) ? ((lane == 0) ? CAL_CURRENT : CAL_VOLTAGE)
+                                      : ((scope_channels == 0) ? CAL_VOLTAGE : CAL_CURRENT);
+                if (k % 16 == 0) {
+                    p = Format_String(reply, "R");
+                }
+                p = Format_String(p, " ");
+                p = Format_Fixed(p, Calibration_Apply(channel, Scope_Get(&scope, k / scope.stride, lane)), 0, 0);
+                if (k % 16 == 15) {
+                    Format_String(p, "\r\n");
+                    Console_Write(reply);
+                }
+            }
+            p = reply;
+        }
+#endif
+    } else if (strcmp(line, "CAL") == 0) {
+        for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+            const Cal_Line_t* cal = Calibration_Get((Cal_Channel_t)ch);
+            p = Format_String(p, (ch == CAL_VOLTAGE) ? "V " : "I ");
+            p = Format_Fixed(p, cal->gain_q16, 0, 0);
+            p = Format_String(p, " ");
+            p = Format_Fixed(p, cal->offset, 0, 0);
+            p = Format_String(p, " ");
+            p = Format_Uint(p, Calibration_Point_Count((Cal_Channel_t)ch), 0, ' ');
+            p = Format_String(p, Calibration_Lut_Active((Cal_Channel_t)ch) ? " LUT" : "");
+            p = Format_String(p, " Z");
+            p = Format_Fixed(p, Calibration_Get_Zero((Cal_Channel_t)ch), 0, 0);
+            p = Format_String(p, "\r\n");
+        }
+    } else {
+        ok = 0;
+    }
+
+    Format_String(p, ok ? "OK\r\n" : "ERR\r\n");
+    Console_Write(reply);
+}
+#endif
+
+/**
+  * @brief  Update graphics data buffer with current values
+  */
+void Update_Graphics_Data(void)
+{
+    uint32_t current_time = Timebase_Now_ms();
+
+    if (current_time - last_graph_update > 200) {
+        voltage_history[graph_data_index] = measured_voltage;
+        current_history[graph_data_index] = measured_current;
+        power_history[graph_data_index] = calculated_power;
+
+        graph_data_index = (graph_data_index + 1) % GRAPH_DATA_POINTS;
+        last_graph_update = current_time;
+    }
+}
+
+/**
+  * @brief  History of the selected graphics parameter
+  */
+static float* Graphics_Get_History(void)
+{
+    if (graphics_parameter == 0) {
+        return voltage_history;
+    } else if (graphics_parameter == 1) {
+        return current_history;
+    }
+    return power_history;
+}
+
+/**
+  * @brief  Plot rows per unit of the selected graphics parameter
+  * @note   Full scale is 30 V, 5 A or 150 W. Folded to a constant so that
+  *         plotting needs no float division.
+  */
+static float Graphics_Get_Scale(void)
+{
+    if (graphics_parameter == 0) {
+        return (GRAPH_HEIGHT - 2) / 30.0f;
+    } else if (graphics_parameter == 1) {
+        return (GRAPH_HEIGHT - 2) / 5.0f;
+    }
+    return (GRAPH_HEIGHT - 2) / 150.0f;
+}
+
+/**
+  * @brief  Map a value to a plot row, clamped to the plot area
+  * @param  value Sample value
+  * @param  rows_per_unit Scale from Graphics_Get_Scale()
+  * @retval Row in screen coordinates
+  */
+static uint8_t Graphics_Value_To_Y(float value, float rows_per_unit)
+{
+    int32_t rows = (int32_t)(value * rows_per_unit);
+
+    if (rows < 0) rows = 0;
+    if (rows > GRAPH_HEIGHT - 2) rows = GRAPH_HEIGHT - 2;
+    return GRAPH_Y_OFFSET + GRAPH_HEIGHT - 1 - (uint8_t)rows;
+}
+
+/**
+  * @brief  Draw the y axis scale labels into the screen buffer
+  * @note   Left of the y axis, at most GRAPH_LABEL_COLUMNS wide
+  */
+static void Graphics_Draw_Scale_Labels(void)
+{
+    ssd1306_SetCursor(0, GRAPH_Y_OFFSET);
+    if (graphics_parameter == 0) {
+        ssd1306_WriteString("30", Font_6x8, White);
+    } else if (graphics_parameter == 1) {
+        ssd1306_WriteString("5", Font_6x8, White);
+    } else {
+        ssd1306_WriteString("150", Font_6x8, White);
+    }
+
+    ssd1306_SetCursor(0, GRAPH_Y_OFFSET + GRAPH_HEIGHT - 8);
+    ssd1306_WriteString("0", Font_6x8, White);
+}
+
+/**
+  * @brief  Draw the graphics curve into the screen buffer (optimized for 32KB Flash)
+  * @note   Full redraw, used when entering the page. Afterwards
+  *         Display_Graphics_Strip() appends each new history sample.
+  */
+void Display_Graphics(void)
+{
+    float* data_array = Graphics_Get_History();
+    float rows_per_unit = Graphics_Get_Scale();
+
+    // Draw axes
+    for (uint8_t y = 0; y < GRAPH_HEIGHT; y++) {
+        ssd1306_DrawPixel(GRAPH_X_START - 1, GRAPH_Y_OFFSET + y, White);
+    }
+    for (uint8_t x = 0; x < GRAPH_WIDTH; x++) {
+        ssd1306_DrawPixel(GRAPH_X_START - 1 + x, GRAPH_Y_OFFSET + GRAPH_HEIGHT - 1, White);
+    }
+
+    // Plot data points (optimized for reduced data points)
+    for (uint8_t i = 0; i < GRAPH_DATA_POINTS - 1; i++) {
+        uint8_t data_index = (graph_data_index + i) % GRAPH_DATA_POINTS;
+        uint8_t next_index = (graph_data_index + i + 1) % GRAPH_DATA_POINTS;
+
+        uint8_t y1 = Graphics_Value_To_Y(data_array[data_index], rows_per_unit);
+        uint8_t y2 = Graphics_Value_To_Y(data_array[next_index], rows_per_unit);
+
+        uint8_t x1 = GRAPH_X_START + (i * GRAPH_WIDTH) / (GRAPH_DATA_POINTS - 1);
+        uint8_t x2 = GRAPH_X_START + ((i + 1) * GRAPH_WIDTH) / (GRAPH_DATA_POINTS - 1);
+
+        ssd1306_Line(x1, y1, x2, y2, White);
+    }
+
+    Graphics_Draw_Scale_Labels();
+
+    // The strip chart sweeps over the history from the left edge
+    graph_strip_segment = 0;
+    graph_strip_index = graph_data_index;
+    graph_strip_last_y = Graphics_Value_To_Y(
+        data_array[(graph_data_index + GRAPH_DATA_POINTS - 1) % GRAPH_DATA_POINTS], rows_per_unit);
+}
+
+/**
+  * @brief  Append new history samples to the graph as a sweeping strip chart
+  * @note   Runs on the history cadence (a sample every 200 ms, rounded up
+  *         to a TIM6 tick) with the segment spacing of Display_Graphics(),
+  *         so the sweep and a full redraw show the same time span. Only the
+  *         new segment and the
+  *         blank cursor column in front of it are sent to the OLED, about
+  *         10 data bytes instead of the 512 byte full-frame I2C transfer.
+  */
+void Display_Graphics_Strip(void)
+{
+    float* data_array = Graphics_Get_History();
+    float rows_per_unit = Graphics_Get_Scale();
+    uint8_t plot_bottom = GRAPH_Y_OFFSET + GRAPH_HEIGHT - 2;   // Row above the x axis
+
+    while (graph_strip_index != graph_data_index) {
+        uint8_t x1 = GRAPH_X_START + (graph_strip_segment * GRAPH_WIDTH) / (GRAPH_DATA_POINTS - 1);
+        uint8_t x2 = GRAPH_X_START + ((graph_strip_segment + 1) * GRAPH_WIDTH) / (GRAPH_DATA_POINTS - 1);
+        uint8_t last = (x2 + 1 < SSD1306_WIDTH) ? x2 + 1 : x2;
+        uint8_t y = Graphics_Value_To_Y(data_array[graph_strip_index], rows_per_unit);
+
+        // Clear the segment plus the cursor gap, then draw the sample
+        ssd1306_FillRectangle(x1, GRAPH_Y_OFFSET, last, plot_bottom, Black);
+        ssd1306_Line(x1, graph_strip_last_y, x2, y, White);
+        ssd1306_UpdateArea(x1, last - x1 + 1, GRAPH_Y_OFFSET / 8, (GRAPH_Y_OFFSET + GRAPH_HEIGHT - 1) / 8);
+
+        graph_strip_last_y = y;
+        graph_strip_index = (graph_strip_index + 1) % GRAPH_DATA_POINTS;
+        graph_strip_segment = (graph_strip_segment + 1) % (GRAPH_DATA_POINTS - 1);
+    }
+}
+
+/**
+  * @brief  Graph widget renderer
+  * @param  full 1 to redraw the whole curve, 0 to append new strip segments
+  */
+static void Graphics_Draw(uint8_t full)
+{
+    if (full) {
+        Display_Graphics();
+    } else {
+        Display_Graphics_Strip();
+    }
+}
+
+#if FEATURE_HISTOGRAM
+/**
+  * @brief  Load profile bar chart renderer
+  * @param  full 1 to draw all bars, 0 to redraw them only when one changed
+  * @note   Bars scale to the fullest bin; a bin with any time gets at least
+  *         one row. The counters are single words written by the TIM6 tick.
+  */
+static void Histogram_Draw(uint8_t full)
+{
+    static uint8_t bar_height[HISTOGRAM_BINS];
+    uint32_t max_ms = 1;
+    uint8_t changed = full;
+
+    for (uint8_t k = 0; k < HISTOGRAM_BINS; k++) {
+        if (histogram.bin_ms[k] > max_ms) {
+            max_ms = histogram.bin_ms[k];
+        }
+    }
+    for (uint8_t k = 0; k < HISTOGRAM_BINS; k++) {
+        uint32_t ms = histogram.bin_ms[k];
+        uint8_t height = (ms == 0) ? 0
+            : (uint8_t)(1 + ((uint64_t)ms * (BAR_CHART_HEIGHT - 1)) / max_ms);
+        if (height != bar_height[k]) {
+            bar_height[k] = height;
+            changed = 1;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+
+    uint8_t bottom = BAR_CHART_Y + BAR_CHART_HEIGHT - 1;
+    ssd1306_FillRectangle(0, BAR_CHART_Y, SSD1306_WIDTH - 1, bottom, Black);
+    for (uint8_t k = 0; k < HISTOGRAM_BINS; k++) {
+        if (bar_height[k] > 0) {
+            uint8_t x = k * HISTOGRAM_BAR_PITCH;
+            ssd1306_FillRectangle(x, bottom + 1 - bar_height[k], x + HISTOGRAM_BAR_PITCH - 2, bottom, White);
+        }
+    }
+    if (!full) {
+        ssd1306_UpdateArea(0, SSD1306_WIDTH, BAR_CHART_Y / 8, bottom / 8);
+    }
+}
+#endif
+
+#if FEATURE_SPECTRUM
+/* Spectrum page -------------------------------------------------------------*/
+static void Spectrum_Toggle_View(int8_t direction)
+{
+    (void)direction;
+    spectrum_view ^= 1;
+}
+
+static int32_t Get_Spectrum_Frame(void)
+{
+    return spectrum_frames;
+}
+
+/**
+  * @brief  Header: channel, fundamental and THD
+  */
+static char* Format_Spectrum_Header(char* dst, int32_t frame)
+{
+    dst = Format_String(dst, (spectrum_channel == 0) ? "V " : "I ");
+    if (frame == 0) {
+        return Format_String(dst, "capturing");
+    }
+    if (!spectrum.valid) {
+        return Format_String(dst, "no signal");
+    }
+    if (spectrum.fundamental_mhz < 1000000) {
+        dst = Format_Fixed(dst, (int32_t)(spectrum.fundamental_mhz / 100), 1, 0);
+    } else {
+        dst = Format_Uint(dst, spectrum.fundamental_mhz / 1000, 1, '0');
+    }
+    dst = Format_String(dst, "Hz THD ");
+    dst = Format_Fixed(dst, spectrum.thd_pm, 1, 0);
+    return Format_String(dst, "%");
+}
+
+/**
+  * @brief  Spectrum renderer: bars in dB, or the harmonic table
+  * @param  full 1 to draw, 0 to redraw only on a new frame or view
+  */
+static void Spectrum_Draw(uint8_t full)
+{
+    static uint16_t drawn_frame;
+    static uint8_t drawn_view;
+    uint8_t bottom = SSD1306_HEIGHT - 1;
+
+    if (!full && drawn_frame == spectrum_frames && drawn_view == spectrum_view) {
+        return;
+    }
+    drawn_frame = spectrum_frames;
+    drawn_view = spectrum_view;
+
+    ssd1306_FillRectangle(0, BAR_CHART_Y, SSD1306_WIDTH - 1, bottom, Black);
+    if (spectrum_view == 0) {
+        for (uint8_t k = 1; k < SPECTRUM_BINS && spectrum_frames != 0; k++) {
+            uint8_t level = spectrum.level_db[k];
+            if (level < SPECTRUM_FLOOR_DB) {
+                uint8_t height = (uint8_t)(((SPECTRUM_FLOOR_DB - level) * BAR_CHART_HEIGHT) / SPECTRUM_FLOOR_DB);
+                uint8_t x = k * SPECTRUM_BAR_PITCH;
+                ssd1306_Line(x, bottom + 1 - (height ? height : 1), x, bottom, White);
+            }
+        }
+    } else {
+        // H2..H7 in two columns
+        for (uint8_t h = 0; h < SPECTRUM_HARMONICS; h++) {
+            char text[12];
+            char* p = Format_String(text, "H");
+            p = Format_Uint(p, h + 2, 1, '0');
+            p = Format_String(p, " ");
+            p = Format_Fixed(p, spectrum.harmonic_pm[h], 1, 0);
+            Format_String(p, "%");
+            ssd1306_SetCursor((h % 2) * 64, BAR_CHART_Y + (h / 2) * 8);
+            ssd1306_WriteString(text, Font_6x8, White);
+        }
+    }
+    if (!full) {
+        ssd1306_UpdateArea(0, SSD1306_WIDTH, BAR_CHART_Y / 8, bottom / 8);
+    }
+}
+#endif
+
+#if FEATURE_SCOPE
+/* Scope page ----------------------------------------------------------------*/
+static void Scope_Adjust(int8_t direction)
+{
+    int32_t value;
+
+    switch (scope_control) {
+        case 0:     // Timebase, one step per detent
+            value = (int32_t)scope_timebase + ((direction > 0) ? 1 : -1);
+            if (value >= 0 && value < (int32_t)(sizeof(scope_timebases) / sizeof(scope_timebases[0]))) {
+                scope_timebase = (uint8_t)value;
+            }
+            break;
+        case 1:     // Trigger level
+            value = (int32_t)scope_config.level + direction * SCOPE_LEVEL_STEP;
+            scope_config.level = (uint16_t)((value < 0) ? 0 : (value > 4095) ? 4095 : value);
+            break;
+        case 2:     // Edge
+            scope_config.edge = (scope_config.edge == SCOPE_RISING) ? SCOPE_FALLING : SCOPE_RISING;
+            break;
+        default:    // Pre-trigger share
+            value = (int32_t)scope_config.pretrigger_pct + direction * SCOPE_PRETRIGGER_STEP;
+            scope_config.pretrigger_pct = (uint16_t)((value < 0) ? 0 : (value > 100) ? 100 : value);
+            break;
+    }
+}
+
+static void Scope_Next_Control(void)
+{
+    scope_control = (scope_control + 1) % 4;
+}
+
+/**
+  * @brief  Everything the header shows, packed so that any change redraws it
+  */
+static int32_t Get_Scope_Header(void)
+{
+    return (int32_t)scope_config.level | ((int32_t)scope_config.pretrigger_pct << 12) |
+           ((int32_t)scope_config.edge << 19) | ((int32_t)scope_auto << 20) |
+           ((int32_t)scope_timebase << 21) | ((int32_t)scope_control << 25) |
+           ((int32_t)scope_channels << 27);
+}
+
+/**
+  * @brief  Header: record length, trigger level, edge and pre-trigger share
+  * @note   '>' marks what the encoder adjusts, a click moves it on. A '*'
+  *         flags a capture taken by auto mode.
+  */
+static char* Format_Scope_Header(char* dst, int32_t state)
+{
+    uint32_t record_us = Scope_Sample_ns() * SCOPE_RECORD / 1000;
+    Cal_Channel_t channel = (scope_channels == 1) ? CAL_CURRENT : CAL_VOLTAGE;
+    int32_t level = Calibration_Apply(channel, scope_config.level);
+
+    (void)state;
+    dst = Format_String(dst, (scope_control == 0) ? ">" : " ");
+    if (record_us < 1000) {
+        dst = Format_Uint(dst, record_us, 1, '0');
+        dst = Format_String(dst, "us");
+    } else if (record_us < 10000) {
+        dst = Format_Fixed(dst, (int32_t)(record_us / 100), 1, 0);
+        dst = Format_String(dst, "ms");
+    } else {
+        dst = Format_Uint(dst, record_us / 1000, 1, '0');
+        dst = Format_String(dst, "ms");
+    }
+    dst = Format_String(dst, (scope_control == 1) ? ">" : " ");
+    if (channel == CAL_VOLTAGE) {
+        dst = Format_Fixed(dst, level / 100, 1, 0);
+        dst = Format_String(dst, "V");
+    } else {
+        dst = Format_Fixed(dst, level / 10, 2, 0);
+        dst = Format_String(dst, "A");
+    }
+    dst = Format_String(dst, (scope_control == 2) ? ">" : " ");
+    dst = Format_String(dst, (scope_config.edge == SCOPE_RISING) ? "/" : "\\");
+    dst = Format_String(dst, (scope_control == 3) ? ">" : " ");
+    dst = Format_Uint(dst, scope_config.pretrigger_pct, 1, '0');
+    return Format_String(dst, scope_auto ? "%*" : "%");
 }
 
-/**
-  * @brief  Reset accumulated energy to zero
-  */
-void Reset_Energy(void)
+static uint8_t Scope_Row(uint16_t code)
 {
-    accumulated_energy = 0.0f;
+    return (uint8_t)(SSD1306_HEIGHT - 1 - ((uint32_t)code * (BAR_CHART_HEIGHT - 1)) / 4095);
 }
 
 /**
-  * @brief  Handle rotary encoder input for menu navigation
-  * @param  direction: 1 for clockwise, -1 for counter-clockwise
+  * @brief  Scope renderer: the record, the trigger level and position
+  * @param  full 1 to draw, 0 to redraw only on a new capture or level
+  * @note   Full ADC range over the chart. With both channels the voltage
+  *         is the line and the current the dots.
   */
-void Handle_Menu_Navigation(int8_t direction)
+static void Scope_Draw(uint8_t full)
 {
-    last_activity_time = HAL_GetTick();
-    menu_changed = 1;
+    static uint16_t drawn_frame;
+    static uint16_t drawn_level;
+    uint8_t bottom = SSD1306_HEIGHT - 1;
 
-    switch (current_menu) {
-        case MENU_MAIN:
-            if (direction > 0) {
-                menu_selection = (menu_selection + 1) % 5;
-            } else {
-                menu_selection = (menu_selection == 0) ? 4 : menu_selection - 1;
+    if (!full && drawn_frame == scope_frames && drawn_level == scope_config.level) {
+        return;
+    }
+    drawn_frame = scope_frames;
+    drawn_level = scope_config.level;
+
+    ssd1306_FillRectangle(0, BAR_CHART_Y, SSD1306_WIDTH - 1, bottom, Black);
+    uint8_t level_y = Scope_Row(scope_config.level);
+    ssd1306_Line(0, level_y, 3, level_y, White);
+
+    // The buffer only holds a record between captures
+    if (scope.state == SCOPE_DONE && !scope_running) {
+        uint16_t steps = Scope_Steps(&scope);
+        uint8_t trigger_x = (uint8_t)(scope.pre_steps * SSD1306_WIDTH / steps);
+        uint8_t last_x = 0;
+        uint8_t last_y = 0;
+
+        ssd1306_Line(trigger_x, BAR_CHART_Y, trigger_x, BAR_CHART_Y + 2, White);
+        for (uint16_t i = 0; i < steps; i++) {
+            uint8_t x = (uint8_t)(i * SSD1306_WIDTH / steps);
+            uint8_t y = Scope_Row(Scope_Get(&scope, i, scope.stride - 1));
+            ssd1306_Line((i > 0) ? last_x : x, (i > 0) ? last_y : y, x, y, White);
+            if (scope.stride == 2) {
+                ssd1306_DrawPixel(x, Scope_Row(Scope_Get(&scope, i, 0)), White);
             }
-            break;
+            last_x = x;
+            last_y = y;
+        }
+    }
+    if (!full) {
+        ssd1306_UpdateArea(0, SSD1306_WIDTH, BAR_CHART_Y / 8, bottom / 8);
+    }
+}
+#endif
 
-        case MENU_GRAPHICS_SELECT:
-            if (direction > 0) {
-                menu_selection = (menu_selection + 1) % 4;
-            } else {
-                menu_selection = (menu_selection == 0) ? 3 : menu_selection - 1;
-            }
-            break;
+#if FEATURE_EVENTS
+/* Load event browser --------------------------------------------------------*/
+static void Event_Browser_Start(void)
+{
+    event_cursor = 0;
+}
 
-        case MENU_SETTINGS:
-            if (direction > 0) {
-                menu_selection = (menu_selection + 1) % 2;
-            } else {
-                menu_selection = (menu_selection == 0) ? 1 : menu_selection - 1;
-            }
-            break;
+static void Event_Browser_Move(int8_t direction)
+{
+    uint8_t count = Events_Count(&load_events);
+    int16_t cursor = (int16_t)event_cursor + ((direction > 0) ? 1 : -1);
 
-        case MENU_RESET:
-            if (direction > 0) {
-                menu_selection = (menu_selection + 1) % 3;
-            } else {
-                menu_selection = (menu_selection == 0) ? 2 : menu_selection - 1;
-            }
-            break;
+    if (cursor < 0) cursor = 0;
+    if (cursor >= count) cursor = (count > 0) ? count - 1 : 0;
+    event_cursor = (uint8_t)cursor;
+}
 
-        default:
-            break;
-    }
+static uint8_t Event_Browser_Count(void)
+{
+    return Events_Count(&load_events);
+}
+
+static uint8_t Event_Browser_Selection(void)
+{
+    return event_cursor;
 }
 
 /**
-  * @brief  Handle button press for menu actions
-  * @param  press_type: 0 = short press, 1 = long press
+  * @brief  Event line: uptime of the step and its size
+  * @param  index Age of the event, 0 for the newest
+  * @param  dst Output buffer
   */
-void Handle_Menu_Action(uint8_t press_type)
+static void Event_Browser_Text(uint8_t index, char* dst)
 {
-    last_activity_time = HAL_GetTick();
-    menu_changed = 1;
+    Load_Event_t event;
+    uint32_t seconds;
 
-    if (press_type == 1) { // Long press - go back/up
-        switch (current_menu) {
-            case MENU_POWER_METER:
-                current_menu = MENU_MAIN;
-                menu_selection = 0;
-                break;
+    if (!Events_Get(&load_events, index, &event)) {
+        *dst = '\0';
+        return;
+    }
+    seconds = event.time_ms / 1000;
+    dst = Format_Uint(dst, seconds / 3600, 2, '0');
+    dst = Format_String(dst, ":");
+    dst = Format_Uint(dst, (seconds / 60) % 60, 2, '0');
+    dst = Format_String(dst, ":");
+    dst = Format_Uint(dst, seconds % 60, 2, '0');
+    dst = Format_String(dst, (event.after_dw >= event.before_dw) ? " +" : " ");
+    dst = Format_Fixed(dst, event.after_dw - event.before_dw, 1, 0);
+    Format_String(dst, "W");
+}
 
-            default:
-                current_menu = MENU_POWER_METER;
-                menu_selection = 0;
-                break;
-        }
-    } else { // Short press - enter/confirm
-        switch (current_menu) {
-            case MENU_POWER_METER:
-                // No action on short press in power meter mode
-                break;
-
-            case MENU_MAIN:
-                switch (menu_selection) {
-                    case 0: current_menu = MENU_POWER_METER; break;
-                    case 1: current_menu = MENU_PEAKS; break;
-                    case 2: current_menu = MENU_GRAPHICS_SELECT; menu_selection = 0; break;
-                    case 3: current_menu = MENU_SETTINGS; menu_selection = 0; break;
-                    case 4: current_menu = MENU_RESET; menu_selection = 0; break;
-                }
-                break;
-
-            case MENU_PEAKS:
-                current_menu = MENU_MAIN;
-                menu_selection = 1;
-                break;
-
-            case MENU_GRAPHICS_SELECT:
-                switch (menu_selection) {
-                    case 0:
-                        graphics_parameter = 0;
-                        current_menu = MENU_GRAPHICS;
-                        break;
-                    case 1:
-                        graphics_parameter = 1;
-                        current_menu = MENU_GRAPHICS;
-                        break;
-                    case 2:
-                        graphics_parameter = 2;
-                        current_menu = MENU_GRAPHICS;
-                        break;
-                    case 3:
-                        current_menu = MENU_MAIN;
-                        menu_selection = 2;
-                        break;
-                }
-                break;
+static const UI_ListSource_t event_browser_source = {
+    .count = Event_Browser_Count,
+    .text = Event_Browser_Text,
+    .selection = Event_Browser_Selection
+};
 
-            case MENU_GRAPHICS:
-                current_menu = MENU_GRAPHICS_SELECT;
-                menu_selection = graphics_parameter;
-                break;
+// Redraw on a new event or a cursor move
+static int32_t Get_Events_View(void)
+{
+    return (int32_t)((Events_Total(&load_events) << 4) | event_cursor);
+}
 
-            case MENU_SETTINGS:
-                switch (menu_selection) {
-                    case 0: current_menu = MENU_ABOUT; break;
-                    case 1: current_menu = MENU_MAIN; menu_selection = 3; break;
-                }
-                break;
+static int32_t Get_Events_Total(void)
+{
+    return (int32_t)Events_Total(&load_events);
+}
 
-            case MENU_RESET:
-                switch (menu_selection) {
-                    case 0: Reset_Peaks(); current_menu = MENU_MAIN; menu_selection = 4; break;
-                    case 1: Reset_Energy(); current_menu = MENU_MAIN; menu_selection = 4; break;
-                    case 2: current_menu = MENU_MAIN; menu_selection = 4; break;
-                }
-                break;
+static char* Format_Event_Detail(char* dst, int32_t view)
+{
+    Load_Event_t event;
 
-            case MENU_ABOUT:
-                current_menu = MENU_SETTINGS;
-                menu_selection = 0;
-                break;
-        }
+    (void)view;
+    if (!Events_Get(&load_events, event_cursor, &event)) {
+        return Format_String(dst, "No events");
     }
+    dst = Format_Fixed(dst, event.before_dw, 1, 0);
+    dst = Format_String(dst, "W > ");
+    dst = Format_Fixed(dst, event.after_dw, 1, 0);
+    return Format_String(dst, "W");
 }
+#endif
 
-/**
-  * @brief  Display current menu on OLED (memory optimized)
-  */
-void Display_Current_Menu(void)
+/* Number formatters for the widget tables ----------------------------------*/
+static char* Format_Energy_Field(char* dst, int32_t energy_mwh)
 {
-    char line1[21] = {0};
-    char line2[21] = {0};
-    char line3[21] = {0};
-
-    ssd1306_Fill(Black);
-
-    switch (current_menu) {
-        case MENU_POWER_METER:
-            Display_Power_Meter();
-            return;
-
-        case MENU_MAIN:
-            {
-                const char* menu_items[5] = {
-                    " Power Meter",
-                    " Peak Values",
-                    " Graphics",
-                    " Settings",
-                    " Reset Options"
-                };
-
-                ssd1306_SetCursor(0, 0);
-                ssd1306_WriteString("=== MAIN MENU ===", Font_6x8, White);
-
-                uint8_t start_item = 0;
-                if (menu_selection >= 2) {
-                    start_item = menu_selection - 1;
-                    if (start_item > 2) start_item = 2;
-                }
+    if (energy_mwh < 0) {
+        *dst++ = '-';
+        return Format_Energy(dst, (uint32_t)(-energy_mwh));
+    }
+    return Format_Energy(dst, (uint32_t)energy_mwh);
+}
 
-                for (uint8_t i = 0; i < 3 && (start_item + i) < 5; i++) {
-                    uint8_t item_index = start_item + i;
-                    char display_line[21];
+static char* Format_Charge_Field(char* dst, int32_t charge_mah)
+{
+    dst = Format_Fixed(dst, charge_mah, 3, 0);
+    return Format_String(dst, "Ah");
+}
 
-                    sprintf(display_line, "%s%s",
-                           (item_index == menu_selection) ? ">" : " ",
-                           menu_items[item_index]);
+static char* Format_Counter_Field(char* dst, int32_t value)
+{
+    return Format_Uint(dst, (uint32_t)value, 3, '0');
+}
 
-                    ssd1306_SetCursor(0, 8 + (i * 8));
-                    ssd1306_WriteString(display_line, Font_6x8, White);
-                }
+static int32_t Get_Awake_Permille(void)
+{
+    return 1000 - Power_Get_Sleep_Permille();
+}
 
-                if (start_item > 0) {
-                    ssd1306_SetCursor(120, 8);
-                    ssd1306_WriteString("^", Font_6x8, White);
-                }
-                if (start_item + 3 < 5) {
-                    ssd1306_SetCursor(120, 24);
-                    ssd1306_WriteString("v", Font_6x8, White);
-                }
-            }
-            break;
+static int32_t Get_Estimated_uA(void)
+{
+    return (int32_t)Power_Get_Estimated_uA();
+}
 
-        case MENU_PEAKS:
-            ssd1306_SetCursor(0, 0);
-            ssd1306_WriteString("=== PEAK VALUES ===", Font_6x8, White);
-
-            int pv_int = (int)peak_voltage;
-            int pv_frac = (int)((peak_voltage - pv_int) * 10.0f);
-            int pi_int = (int)peak_current;
-            int pi_frac = (int)((peak_current - pi_int) * 100.0f);
-            int pp_int = (int)peak_power;
-            int pp_frac = (int)((peak_power - pp_int) * 10.0f);
-
-            sprintf(line1, "V: %d.%dV", pv_int, pv_frac);
-            sprintf(line2, "I: %d.%02dA", pi_int, pi_frac);
-            sprintf(line3, "P: %d.%dW", pp_int, pp_frac);
-
-            ssd1306_SetCursor(0, 10);
-            ssd1306_WriteString(line1, Font_7x10, White);
-            ssd1306_SetCursor(0, 20);
-            ssd1306_WriteString(line2, Font_7x10, White);
-            ssd1306_SetCursor(70, 20);
-            ssd1306_WriteString(line3, Font_7x10, White);
-            break;
+static int32_t Get_Net_Energy_mWh(void)
+{
+    return Energy_Net_mWh(&display_snapshot.energy);
+}
 
-        case MENU_SETTINGS:
-            ssd1306_SetCursor(0, 0);
-            ssd1306_WriteString("=== SETTINGS ===", Font_6x8, White);
+static int32_t Get_Net_Charge_mAh(void)
+{
+    return Energy_Net_mAh(&display_snapshot.energy);
+}
 
-            sprintf(line1, "%s About", (menu_selection == 0) ? ">" : " ");
-            sprintf(line2, "%s Back", (menu_selection == 1) ? ">" : " ");
+static int32_t Get_Import_mWh(void)
+{
+    return Energy_To_mWh(display_snapshot.energy.import_nj);
+}
 
-            ssd1306_SetCursor(0, 12);
-            ssd1306_WriteString(line1, Font_7x10, White);
-            ssd1306_SetCursor(0, 22);
-            ssd1306_WriteString(line2, Font_7x10, White);
-            break;
+static int32_t Get_Export_mWh(void)
+{
+    return Energy_To_mWh(display_snapshot.energy.export_nj);
+}
 
-        case MENU_RESET:
-            ssd1306_SetCursor(0, 0);
-            ssd1306_WriteString("=== RESET ===", Font_6x8, White);
+static int32_t Get_Charge_In_mAh(void)
+{
+    return Energy_To_mAh(display_snapshot.energy.charge_in_nc);
+}
 
-            sprintf(line1, "%s Reset Peaks", (menu_selection == 0) ? ">" : " ");
-            sprintf(line2, "%s Reset Energy", (menu_selection == 1) ? ">" : " ");
-            sprintf(line3, "%s Cancel", (menu_selection == 2) ? ">" : " ");
+static int32_t Get_Charge_Out_mAh(void)
+{
+    return Energy_To_mAh(display_snapshot.energy.charge_out_nc);
+}
 
-            ssd1306_SetCursor(0, 8);
-            ssd1306_WriteString(line1, Font_6x8, White);
-            ssd1306_SetCursor(0, 16);
-            ssd1306_WriteString(line2, Font_6x8, White);
-            ssd1306_SetCursor(0, 24);
-            ssd1306_WriteString(line3, Font_6x8, White);
-            break;
+#if FEATURE_DEMAND
+// Demand in tenths of a watt for the widgets
+static int32_t Get_Demand_1m_dW(void)  { return display_snapshot.demand.average_mw[0] / 100; }
+static int32_t Get_Demand_5m_dW(void)  { return display_snapshot.demand.average_mw[1] / 100; }
+static int32_t Get_Demand_15m_dW(void) { return display_snapshot.demand.average_mw[2] / 100; }
+static int32_t Get_Peak_1m_dW(void)    { return display_snapshot.demand.peak_mw[0] / 100; }
+static int32_t Get_Peak_5m_dW(void)    { return display_snapshot.demand.peak_mw[1] / 100; }
+static int32_t Get_Peak_15m_dW(void)   { return display_snapshot.demand.peak_mw[2] / 100; }
+#endif
+
+#if FEATURE_PROTECTION
+static int32_t Get_Alarm_Flags(void)
+{
+    return Protection_Get_Event();
+}
 
-        case MENU_GRAPHICS_SELECT:
-            {
-                const char* graphics_items[4] = {
-                    " Voltage (V)",
-                    " Current (A)",
-                    " Power (W)",
-                    " Back"
-                };
-
-                ssd1306_SetCursor(0, 0);
-                ssd1306_WriteString("=== GRAPHICS ===", Font_6x8, White);
-
-                uint8_t start_item = 0;
-                if (menu_selection >= 2) {
-                    start_item = menu_selection - 1;
-                    if (start_item > 1) start_item = 1;
-                }
+static int32_t Get_Alarm_Time_ds(void)
+{
+    return (int32_t)(Protection_Get_Event_Time_ms() / 100);
+}
 
-                for (uint8_t i = 0; i < 3 && (start_item + i) < 4; i++) {
-                    uint8_t item_index = start_item + i;
-                    char display_line[21];
+static char* Format_Alarm_Field(char* dst, int32_t flags)
+{
+    if (flags == (PROTECTION_OVER_VOLTAGE | PROTECTION_OVER_CURRENT)) {
+        return Format_String(dst, "OVER V+I");
+    }
+    return Format_String(dst, (flags & PROTECTION_OVER_VOLTAGE) ? "OVER V" : "OVER I");
+}
+#endif
 
-                    sprintf(display_line, "%s%s",
-                           (item_index == menu_selection) ? ">" : " ",
-                           graphics_items[item_index]);
+static int32_t Get_Vdda_mV(void)
+{
+    return Compensation_Get_Vdda_mV();
+}
 
-                    ssd1306_SetCursor(0, 8 + (i * 8));
-                    ssd1306_WriteString(display_line, Font_6x8, White);
-                }
+static int32_t Get_Temperature_dC(void)
+{
+    return Compensation_Get_Temperature_dC();
+}
 
-                if (start_item > 0) {
-                    ssd1306_SetCursor(120, 8);
-                    ssd1306_WriteString("^", Font_6x8, White);
-                }
-                if (start_item + 3 < 4) {
-                    ssd1306_SetCursor(120, 24);
-                    ssd1306_WriteString("v", Font_6x8, White);
-                }
-            }
-            break;
+/* Screen tables -------------------------------------------------------------*/
+static const UI_Widget_t power_meter_widgets[] = {
+    { .type = UI_NUMBER, .x = 0,  .y = 0,  .width = 63, .font = &Font_7x10, .glyphs = &meter_glyphs_7x10,
+      .text = "V:", .unit = "V", .source = &display_snapshot.voltage, .scale = 10.0f, .decimals = 1 },
+    { .type = UI_NUMBER, .x = 63, .y = 0,  .width = 63, .font = &Font_7x10, .glyphs = &meter_glyphs_7x10,
+      .text = "I:", .unit = "A", .source = &display_snapshot.current, .scale = 100.0f, .decimals = 2 },
+    { .type = UI_NUMBER, .x = 0,  .y = 11, .width = 56, .font = &Font_7x10, .glyphs = &meter_glyphs_7x10,
+      .text = "P:", .unit = "W", .source = &display_snapshot.power, .scale = 10.0f, .decimals = 1 },
+    { .type = UI_NUMBER, .x = 56, .y = 11, .width = 70, .font = &Font_7x10, .glyphs = &meter_glyphs_7x10,
+      .text = "E:", .get = Get_Net_Energy_mWh, .format = Format_Energy_Field },
+    { .type = UI_NUMBER, .x = 0,  .y = 22, .width = 42, .font = &Font_6x8, .glyphs = &meter_glyphs_6x8,
+      .text = "ROT:", .source = &rotary_counter, .source_type = UI_SOURCE_U8, .format = Format_Counter_Field },
+    { .type = UI_NUMBER, .x = 48, .y = 22, .width = 78, .font = &Font_6x8, .glyphs = &meter_glyphs_6x8,
+      .text = "Q:", .get = Get_Net_Charge_mAh, .format = Format_Charge_Field },
+};
+
+static const UI_Widget_t energy_widgets[] = {
+    { .type = UI_NUMBER, .x = 0, .y = 0,  .width = 126, .font = &Font_6x8,
+      .text = "Import: ", .get = Get_Import_mWh, .format = Format_Energy_Field },
+    { .type = UI_NUMBER, .x = 0, .y = 8,  .width = 126, .font = &Font_6x8,
+      .text = "Export: ", .get = Get_Export_mWh, .format = Format_Energy_Field },
+    { .type = UI_NUMBER, .x = 0, .y = 16, .width = 126, .font = &Font_6x8,
+      .text = "Q in:   ", .get = Get_Charge_In_mAh, .format = Format_Charge_Field },
+    { .type = UI_NUMBER, .x = 0, .y = 24, .width = 126, .font = &Font_6x8,
+      .text = "Q out:  ", .get = Get_Charge_Out_mAh, .format = Format_Charge_Field },
+};
+
+#if FEATURE_DEMAND
+static const UI_Widget_t demand_widgets[] = {
+    { .type = UI_LABEL,  .x = 0,  .y = 0,  .width = 128, .font = &Font_6x8, .text = "=== DEMAND ===" },
+    { .type = UI_NUMBER, .x = 0,  .y = 8,  .width = 66, .font = &Font_6x8,
+      .text = "1m: ", .unit = "W", .get = Get_Demand_1m_dW, .decimals = 1 },
+    { .type = UI_NUMBER, .x = 66, .y = 8,  .width = 60, .font = &Font_6x8,
+      .text = "pk", .unit = "W", .get = Get_Peak_1m_dW, .decimals = 1 },
+    { .type = UI_NUMBER, .x = 0,  .y = 16, .width = 66, .font = &Font_6x8,
+      .text = "5m: ", .unit = "W", .get = Get_Demand_5m_dW, .decimals = 1 },
+    { .type = UI_NUMBER, .x = 66, .y = 16, .width = 60, .font = &Font_6x8,
+      .text = "pk", .unit = "W", .get = Get_Peak_5m_dW, .decimals = 1 },
+    { .type = UI_NUMBER, .x = 0,  .y = 24, .width = 66, .font = &Font_6x8,
+      .text = "15m:", .unit = "W", .get = Get_Demand_15m_dW, .decimals = 1 },
+    { .type = UI_NUMBER, .x = 66, .y = 24, .width = 60, .font = &Font_6x8,
+      .text = "pk", .unit = "W", .get = Get_Peak_15m_dW, .decimals = 1 },
+};
+#endif
+
+static const UI_Widget_t peaks_widgets[] = {
+    { .type = UI_LABEL,  .x = 0,  .y = 0,  .width = 128, .font = &Font_6x8, .text = "=== PEAK VALUES ===" },
+    { .type = UI_NUMBER, .x = 0,  .y = 10, .width = 126, .font = &Font_7x10,
+      .text = "V: ", .unit = "V", .source = &display_snapshot.peak_voltage, .scale = 10.0f, .decimals = 1 },
+    { .type = UI_NUMBER, .x = 0,  .y = 20, .width = 70, .font = &Font_7x10,
+      .text = "I: ", .unit = "A", .source = &display_snapshot.peak_current, .scale = 100.0f, .decimals = 2 },
+    { .type = UI_NUMBER, .x = 70, .y = 20, .width = 56, .font = &Font_7x10,
+      .text = "P: ", .unit = "W", .source = &display_snapshot.peak_power, .scale = 10.0f, .decimals = 1 },
+};
+
+static const UI_Widget_t graphics_voltage_widgets[] = {
+    { .type = UI_NUMBER, .x = 0, .y = 0, .width = 126, .font = &Font_6x8,
+      .text = "Voltage: ", .unit = "V", .source = &display_snapshot.voltage, .scale = 10.0f, .decimals = 1 },
+    { .type = UI_GRAPH, .draw = Graphics_Draw },
+};
+static const UI_Widget_t graphics_current_widgets[] = {
+    { .type = UI_NUMBER, .x = 0, .y = 0, .width = 126, .font = &Font_6x8,
+      .text = "Current: ", .unit = "A", .source = &display_snapshot.current, .scale = 100.0f, .decimals = 2 },
+    { .type = UI_GRAPH, .draw = Graphics_Draw },
+};
+static const UI_Widget_t graphics_power_widgets[] = {
+    { .type = UI_NUMBER, .x = 0, .y = 0, .width = 126, .font = &Font_6x8,
+      .text = "Power: ", .unit = "W", .source = &display_snapshot.power, .scale = 10.0f, .decimals = 1 },
+    { .type = UI_GRAPH, .draw = Graphics_Draw },
+};
+
+#if FEATURE_HISTOGRAM
+static const UI_Widget_t histogram_widgets[] = {
+    { .type = UI_LABEL, .x = 0, .y = 0, .width = 128, .font = &Font_6x8, .text = "=== LOAD PROFILE ===" },
+    { .type = UI_GRAPH, .draw = Histogram_Draw },
+};
+#endif
+
+#if FEATURE_SPECTRUM
+static const UI_Widget_t spectrum_widgets[] = {
+    { .type = UI_NUMBER, .x = 0, .y = 0, .width = 128, .font = &Font_6x8,
+      .get = Get_Spectrum_Frame, .format = Format_Spectrum_Header },
+    { .type = UI_GRAPH, .draw = Spectrum_Draw },
+};
+#endif
+
+#if FEATURE_SCOPE
+static const UI_Widget_t scope_widgets[] = {
+    { .type = UI_NUMBER, .x = 0, .y = 0, .width = 128, .font = &Font_6x8,
+      .get = Get_Scope_Header, .format = Format_Scope_Header },
+    { .type = UI_GRAPH, .draw = Scope_Draw },
+};
+#endif
+
+#if FEATURE_EVENTS
+static const UI_Widget_t events_widgets[] = {
+    { .type = UI_NUMBER, .x = 0, .y = 0,  .width = 128, .font = &Font_6x8,
+      .text = "=== EVENTS ", .unit = " ===", .get = Get_Events_Total },
+    { .type = UI_LIST,   .x = 0, .y = 8,  .width = 114, .font = &Font_6x8, .get = Get_Events_View,
+      .list = &event_browser_source, .rows = 2, .row_height = 8 },
+    { .type = UI_NUMBER, .x = 0, .y = 24, .width = 126, .font = &Font_6x8,
+      .get = Get_Events_View, .format = Format_Event_Detail },
+};
+#endif
+
+static const UI_Widget_t about_widgets[] = {
+    { .type = UI_LABEL, .x = 0, .y = 0,  .width = 126, .font = &Font_7x10, .text = "Power Meter v1.0" },
+    { .type = UI_LABEL, .x = 0, .y = 12, .width = 126, .font = &Font_6x8,  .text = "STM32L052K6" },
+    { .type = UI_LABEL, .x = 0, .y = 20, .width = 126, .font = &Font_6x8,  .text = "Production Board" },
+};
+
+static const UI_Widget_t power_status_widgets[] = {
+    { .type = UI_NUMBER, .x = 0, .y = 0,  .width = 126, .font = &Font_6x8,
+      .text = "Awake:  ", .unit = "%", .get = Get_Awake_Permille, .decimals = 1 },
+    { .type = UI_NUMBER, .x = 0, .y = 8,  .width = 126, .font = &Font_6x8,
+      .text = "Est. I: ", .unit = "mA", .get = Get_Estimated_uA, .decimals = 3 },
+    { .type = UI_NUMBER, .x = 0, .y = 16, .width = 126, .font = &Font_6x8,
+      .text = "VDDA:   ", .unit = "V", .get = Get_Vdda_mV, .decimals = 3 },
+    { .type = UI_NUMBER, .x = 0, .y = 24, .width = 126, .font = &Font_6x8,
+      .text = "Temp:   ", .unit = "C", .get = Get_Temperature_dC, .decimals = 1 },
+};
+
+static const UI_Screen_t power_meter_screen      = UI_SCREEN(power_meter_widgets);
+static const UI_Screen_t peaks_screen            = UI_SCREEN(peaks_widgets);
+static const UI_Screen_t energy_screen           = UI_SCREEN(energy_widgets);
+#if FEATURE_DEMAND
+static const UI_Screen_t demand_screen           = UI_SCREEN(demand_widgets);
+#endif
+#if FEATURE_HISTOGRAM
+static const UI_Screen_t histogram_screen        = UI_SCREEN(histogram_widgets);
+#endif
+#if FEATURE_EVENTS
+static const UI_Screen_t events_screen           = UI_SCREEN(events_widgets);
+#endif
+#if FEATURE_SPECTRUM
+static const UI_Screen_t spectrum_screen         = UI_SCREEN(spectrum_widgets);
+#endif
+#if FEATURE_SCOPE
+static const UI_Screen_t scope_screen            = UI_SCREEN(scope_widgets);
+#endif
+static const UI_Screen_t graphics_voltage_screen = UI_SCREEN(graphics_voltage_widgets);
+static const UI_Screen_t graphics_current_screen = UI_SCREEN(graphics_current_widgets);
+static const UI_Screen_t graphics_power_screen   = UI_SCREEN(graphics_power_widgets);
+static const UI_Screen_t about_screen            = UI_SCREEN(about_widgets);
+static const UI_Screen_t power_status_screen     = UI_SCREEN(power_status_widgets);
+#if FEATURE_PROTECTION
+static const UI_Widget_t alarm_widgets[] = {
+    { .type = UI_NUMBER, .x = 0, .y = 0,  .width = 126, .font = &Font_7x10,
+      .text = "ALARM ", .get = Get_Alarm_Flags, .format = Format_Alarm_Field },
+    { .type = UI_NUMBER, .x = 0, .y = 12, .width = 126, .font = &Font_6x8,
+      .text = "At: ", .unit = "s", .get = Get_Alarm_Time_ds, .decimals = 1 },
+    { .type = UI_LABEL,  .x = 0, .y = 22, .width = 126, .font = &Font_6x8, .text = "Click to clear" },
+};
+
+static const UI_Screen_t alarm_screen            = UI_SCREEN(alarm_widgets);
+#endif
+
+/* Menu tree -----------------------------------------------------------------*/
+static void Select_Graph_Voltage(void) { graphics_parameter = 0; }
+static void Select_Graph_Current(void) { graphics_parameter = 1; }
+static void Select_Graph_Power(void)   { graphics_parameter = 2; }
+#if FEATURE_SPECTRUM
+static void Select_Spectrum_Voltage(void) { spectrum_channel = 0; spectrum_frames = 0; }
+static void Select_Spectrum_Current(void) { spectrum_channel = 1; spectrum_frames = 0; }
+#endif
+#if FEATURE_SCOPE
+static void Select_Scope_Voltage(void) { scope_channels = 0; }
+static void Select_Scope_Current(void) { scope_channels = 1; }
+static void Select_Scope_Both(void)    { scope_channels = 2; }
+#endif
+
+static const Menu_Value_t menu_timeout_editor = {
+    .value = &menu_timeout_s, .min = 10, .max = 300, .step = 10, .unit = "s"
+};
+#if FEATURE_CALIBRATION
+static const Menu_Value_t cal_voltage_editor = {
+    .value = &cal_ref_voltage_dv, .min = 0, .max = 300, .step = 1, .decimals = 1, .unit = "V"
+};
+static const Menu_Value_t cal_current_editor = {
+    .value = &cal_ref_current_ca, .min = 0, .max = 500, .step = 1, .decimals = 2, .unit = "A"
+};
+#endif
+static const Menu_Value_t brightness_editor = {
+    .value = &display_power.brightness_pct, .min = 10, .max = 100, .step = 10, .unit = "%"
+};
+static const Menu_Value_t dim_after_editor = {
+    .value = &display_power.dim_after_s, .min = 0, .max = 300, .step = 10, .unit = "s"
+};
+static const Menu_Value_t off_after_editor = {
+    .value = &display_power.off_after_s, .min = 0, .max = 600, .step = 30, .unit = "s"
+};
+#if FEATURE_PROTECTION
+static const Menu_Value_t trip_voltage_editor = {
+    .value = &protection_config.voltage_limit_dv, .min = 0, .max = 300, .step = 5, .decimals = 1, .unit = "V"
+};
+static const Menu_Value_t trip_current_editor = {
+    .value = &protection_config.current_limit_ca, .min = 0, .max = 500, .step = 5, .decimals = 2, .unit = "A"
+};
+static const Menu_Value_t trip_hysteresis_editor = {
+    .value = &protection_config.hysteresis_pct, .min = 1, .max = 20, .step = 1, .unit = "%"
+};
+#endif
+#if FEATURE_HISTOGRAM
+static const Menu_Value_t histogram_base_editor = {
+    .value = &histogram_config.base_mw, .min = 10, .max = 10000, .step = 10, .decimals = 3, .unit = "W"
+};
+static const Menu_Value_t histogram_per_decade_editor = {
+    .value = &histogram_config.per_decade, .min = 1, .max = HISTOGRAM_MAX_PER_DECADE, .step = 1
+};
+#endif
+#if FEATURE_SPECTRUM
+static const Menu_Value_t spectrum_rate_editor = {
+    .value = &spectrum_rate_hz, .min = 1000, .max = 20000, .step = 250, .unit = "Hz"
+};
+#endif
+#if FEATURE_EVENTS
+static const Menu_Value_t event_step_editor = {
+    .value = &events_config.step_dw, .min = 5, .max = 1000, .step = 5, .decimals = 1, .unit = "W"
+};
+static const Menu_Value_t event_hysteresis_editor = {
+    .value = &events_config.hysteresis_pct, .min = 5, .max = 50, .step = 5, .unit = "%"
+};
+static const Menu_Value_t event_debounce_editor = {
+    .value = &events_config.debounce_ms, .min = 50, .max = 2000, .step = 50, .unit = "ms"
+};
+#endif
+
+static const Menu_Page_t power_meter_page;
+static const Menu_Page_t main_menu_page;
+static const Menu_Page_t peaks_page;
+static const Menu_Page_t energy_page;
+#if FEATURE_DEMAND
+static const Menu_Page_t demand_page;
+#endif
+#if FEATURE_HISTOGRAM
+static const Menu_Page_t histogram_page;
+static const Menu_Page_t histogram_settings_page;
+#endif
+#if FEATURE_EVENTS
+static const Menu_Page_t events_page;
+static const Menu_Page_t events_settings_page;
+#endif
+static const Menu_Page_t graphics_select_page;
+static const Menu_Page_t graphics_voltage_page;
+static const Menu_Page_t graphics_current_page;
+static const Menu_Page_t graphics_power_page;
+#if FEATURE_SPECTRUM
+static const Menu_Page_t spectrum_page;
+#endif
+#if FEATURE_SCOPE
+static const Menu_Page_t scope_page;
+#endif
+static const Menu_Page_t settings_page;
+static const Menu_Page_t about_page;
+static const Menu_Page_t power_status_page;
+#if FEATURE_CALIBRATION
+static const Menu_Page_t calibration_page;
+#endif
+#if FEATURE_PROTECTION
+static const Menu_Page_t protection_page;
+#endif
+static const Menu_Page_t reset_page;
+
+static const Menu_Item_t main_menu_items[] = {
+    { " Power Meter",   MENU_ITEM_PAGE, &power_meter_page },
+    { " Peak Values",   MENU_ITEM_PAGE, &peaks_page },
+    { " Energy",        MENU_ITEM_PAGE, &energy_page },
+#if FEATURE_DEMAND
+    { " Demand",        MENU_ITEM_PAGE, &demand_page },
+#endif
+#if FEATURE_HISTOGRAM
+    { " Load Profile",  MENU_ITEM_PAGE, &histogram_page },
+#endif
+#if FEATURE_EVENTS
+    { " Events",        MENU_ITEM_PAGE, &events_page, Event_Browser_Start },
+#endif
+    { " Graphics",      MENU_ITEM_PAGE, &graphics_select_page },
+    { " Settings",      MENU_ITEM_PAGE, &settings_page },
+    { " Reset Options", MENU_ITEM_PAGE, &reset_page },
+};
+
+static const Menu_Item_t graphics_select_items[] = {
+    { " Voltage (V)",   MENU_ITEM_PAGE, &graphics_voltage_page, Select_Graph_Voltage },
+    { " Current (A)",   MENU_ITEM_PAGE, &graphics_current_page, Select_Graph_Current },
+    { " Power (W)",     MENU_ITEM_PAGE, &graphics_power_page,   Select_Graph_Power },
+#if FEATURE_SPECTRUM
+    { " Spectrum V",    MENU_ITEM_PAGE, &spectrum_page,         Select_Spectrum_Voltage },
+    { " Spectrum I",    MENU_ITEM_PAGE, &spectrum_page,         Select_Spectrum_Current },
+#endif
+#if FEATURE_SCOPE
+    { " Scope V",       MENU_ITEM_PAGE, &scope_page,            Select_Scope_Voltage },
+    { " Scope I",       MENU_ITEM_PAGE, &scope_page,            Select_Scope_Current },
+    { " Scope V+I",     MENU_ITEM_PAGE, &scope_page,            Select_Scope_Both },
+#endif
+    { " Back",          MENU_ITEM_BACK },
+};
+
+static const Menu_Item_t settings_items[] = {
+    { " About",         MENU_ITEM_PAGE, &about_page },
+    { " Power",         MENU_ITEM_PAGE, &power_status_page },
+    { " Timeout",       MENU_ITEM_VALUE, NULL, NULL, &menu_timeout_editor },
+    { " Brightness",    MENU_ITEM_VALUE, NULL, NULL, &brightness_editor },
+    { " Dim after",     MENU_ITEM_VALUE, NULL, NULL, &dim_after_editor },
+    { " Auto-off",      MENU_ITEM_VALUE, NULL, NULL, &off_after_editor },
+#if FEATURE_CALIBRATION
+    { " Calibration",   MENU_ITEM_PAGE, &calibration_page },
+#endif
+#if FEATURE_PROTECTION
+    { " Protection",    MENU_ITEM_PAGE, &protection_page },
+#endif
+#if FEATURE_HISTOGRAM
+    { " Load Profile",  MENU_ITEM_PAGE, &histogram_settings_page },
+#endif
+#if FEATURE_EVENTS
+    { " Events",        MENU_ITEM_PAGE, &events_settings_page },
+#endif
+#if FEATURE_SPECTRUM
+    { " FFT rate",      MENU_ITEM_VALUE, NULL, NULL, &spectrum_rate_editor },
+#endif
+    { " Back",          MENU_ITEM_BACK },
+};
+
+#if FEATURE_EVENTS
+static const Menu_Item_t events_settings_items[] = {
+    { " Step",          MENU_ITEM_VALUE, NULL, NULL, &event_step_editor },
+    { " Hysteresis",    MENU_ITEM_VALUE, NULL, NULL, &event_hysteresis_editor },
+    { " Debounce",      MENU_ITEM_VALUE, NULL, NULL, &event_debounce_editor },
+    { " Back",          MENU_ITEM_BACK },
+};
+#endif
+
+#if FEATURE_HISTOGRAM
+// Changing either one clears the load profile
+static const Menu_Item_t histogram_settings_items[] = {
+    { " First bin",     MENU_ITEM_VALUE, NULL, NULL, &histogram_base_editor },
+    { " Per decade",    MENU_ITEM_VALUE, NULL, NULL, &histogram_per_decade_editor },
+    { " Back",          MENU_ITEM_BACK },
+};
+#endif
+
+#if FEATURE_PROTECTION
+static const Menu_Item_t protection_items[] = {
+    { " Trip V",        MENU_ITEM_VALUE, NULL, NULL, &trip_voltage_editor },
+    { " Trip I",        MENU_ITEM_VALUE, NULL, NULL, &trip_current_editor },
+    { " Hysteresis",    MENU_ITEM_VALUE, NULL, NULL, &trip_hysteresis_editor },
+    { " Back",          MENU_ITEM_BACK },
+};
+#endif
+
+#if FEATURE_CALIBRATION
+static const Menu_Item_t calibration_items[] = {
+    { " Ref V",         MENU_ITEM_VALUE, NULL, NULL, &cal_voltage_editor },
+    { " Capture V",     MENU_ITEM_ACTION, NULL, Calibration_Capture_Voltage },
+    { " Ref I",         MENU_ITEM_VALUE, NULL, NULL, &cal_current_editor },
+    { " Capture I",     MENU_ITEM_ACTION, NULL, Calibration_Capture_Current },
+    { " Zero I",        MENU_ITEM_ACTION, NULL, Calibration_Zero_Current },
+    { " Fit & Save",    MENU_ITEM_BACK, NULL, Calibration_Fit_And_Save },
+    { " Defaults",      MENU_ITEM_BACK, NULL, Calibration_Defaults },
+    { " Back",          MENU_ITEM_BACK },
+};
+#endif
+
+static const Menu_Item_t reset_items[] = {
+    { " Reset Peaks",   MENU_ITEM_BACK, NULL, Reset_Peaks },
+    { " Reset Energy",  MENU_ITEM_BACK, NULL, Reset_Energy },
+#if FEATURE_EVENTS
+    { " Clear Events",  MENU_ITEM_BACK, NULL, Clear_Events },
+#endif
+    { " Cancel",        MENU_ITEM_BACK },
+};
+
+static const Menu_Page_t power_meter_page      = { .screen = &power_meter_screen };
+static const Menu_Page_t main_menu_page        = { "=== MAIN MENU ===", MENU_ITEMS(main_menu_items), NULL };
+static const Menu_Page_t peaks_page            = { .parent = &main_menu_page, .screen = &peaks_screen };
+static const Menu_Page_t energy_page           = { .parent = &main_menu_page, .screen = &energy_screen };
+#if FEATURE_DEMAND
+static const Menu_Page_t demand_page           = { .parent = &main_menu_page, .screen = &demand_screen };
+#endif
+#if FEATURE_HISTOGRAM
+static const Menu_Page_t histogram_page        = { .parent = &main_menu_page, .screen = &histogram_screen };
+#endif
+#if FEATURE_EVENTS
+static const Menu_Page_t events_page           = { .parent = &main_menu_page, .screen = &events_screen,
+                                                   .navigate = Event_Browser_Move };
+#endif
+static const Menu_Page_t graphics_select_page  = { "=== GRAPHICS ===", MENU_ITEMS(graphics_select_items), &main_menu_page };
+static const Menu_Page_t graphics_voltage_page = { .parent = &graphics_select_page, .screen = &graphics_voltage_screen };
+static const Menu_Page_t graphics_current_page = { .parent = &graphics_select_page, .screen = &graphics_current_screen };
+static const Menu_Page_t graphics_power_page   = { .parent = &graphics_select_page, .screen = &graphics_power_screen };
+#if FEATURE_SPECTRUM
+static const Menu_Page_t spectrum_page         = { .parent = &graphics_select_page, .screen = &spectrum_screen,
+                                                   .navigate = Spectrum_Toggle_View };
+#endif
+#if FEATURE_SCOPE
+static const Menu_Page_t scope_page            = { .parent = &graphics_select_page, .screen = &scope_screen,
+                                                   .navigate = Scope_Adjust, .select = Scope_Next_Control };
+#endif
+static const Menu_Page_t settings_page         = { "=== SETTINGS ===", MENU_ITEMS(settings_items), &main_menu_page };
+static const Menu_Page_t about_page            = { .parent = &settings_page, .screen = &about_screen };
+static const Menu_Page_t power_status_page     = { .parent = &settings_page, .screen = &power_status_screen };
+#if FEATURE_CALIBRATION
+static const Menu_Page_t calibration_page      = { "=== CALIBRATE ===", MENU_ITEMS(calibration_items), &settings_page };
+#endif
+#if FEATURE_PROTECTION
+static const Menu_Page_t protection_page       = { "=== PROTECT ===", MENU_ITEMS(protection_items), &settings_page };
+#endif
+#if FEATURE_HISTOGRAM
+static const Menu_Page_t histogram_settings_page = { "=== PROFILE ===", MENU_ITEMS(histogram_settings_items), &settings_page };
+#endif
+#if FEATURE_EVENTS
+static const Menu_Page_t events_settings_page  = { "=== EVENTS ===", MENU_ITEMS(events_settings_items), &settings_page };
+#endif
+static const Menu_Page_t reset_page            = { "=== RESET ===", MENU_ITEMS(reset_items), &main_menu_page };
 
-        case MENU_GRAPHICS:
-            Display_Graphics();
-            return;
-
-        case MENU_ABOUT:
-            ssd1306_SetCursor(0, 0);
-            ssd1306_WriteString("Power Meter v1.0", Font_7x10, White);
-            ssd1306_SetCursor(0, 12);
-            ssd1306_WriteString("STM32L052K6", Font_6x8, White);
-            ssd1306_SetCursor(0, 20);
-            ssd1306_WriteString("Production Board", Font_6x8, White);
-            ssd1306_SetCursor(0, 28);
-            ssd1306_WriteString("Real Power Meter", Font_6x8, White);
-            break;
+/**
+  * @brief  Display current menu on OLED (memory optimized)
+  * @note   Widgets keep their last rendered value, so only what changed since
+  *         the previous call is redrawn and sent over I2C.
+  */
+void Display_Current_Menu(void)
+{
+#if FEATURE_PROTECTION
+    if (Protection_Get_Event()) {
+        UI_Render(&alarm_screen);
+        return;
     }
-
-    ssd1306_UpdateScreen();
+#endif
+    UI_Render(Menu_Get_Screen());
 }
 
+#if FEATURE_SPECTRUM
 /**
-  * @brief  Update graphics data buffer with current values
+  * @brief  Stream spectrum frames while the spectrum page is shown
   */
-void Update_Graphics_Data(void)
+static void Update_Spectrum(void)
 {
-    uint32_t current_time = HAL_GetTick();
-
-    if (current_time - last_graph_update > 200) {
-        voltage_history[graph_data_index] = measured_voltage;
-        current_history[graph_data_index] = measured_current;
-        power_history[graph_data_index] = calculated_power;
-
-        graph_data_index = (graph_data_index + 1) % GRAPH_DATA_POINTS;
-        last_graph_update = current_time;
+    if (spectrum_running) {
+        if (spectrum_capture_done || Menu_Get_Page() != &spectrum_page) {
+            Stop_Spectrum_Capture();
+        }
+    } else if (Menu_Get_Page() == &spectrum_page &&
+               (spectrum_frames == 0 || Timebase_Now_ms() - spectrum_last_ms >= SPECTRUM_INTERVAL_MS)) {
+        Start_Spectrum_Capture(spectrum_channel);
     }
 }
+#endif
 
+#if FEATURE_SCOPE
 /**
-  * @brief  Display graphics curve (optimized for 32KB Flash)
+  * @brief  Run burst captures while the scope page is shown
+  * @note   A new capture starts SCOPE_INTERVAL_MS after the last one, which
+  *         leaves TIM6 a few ticks to measure and refresh the display.
   */
-void Display_Graphics(void)
+static void Update_Scope(void)
 {
-    char title_str[21] = {0};
-    float max_value = 0.0f;
-    float* data_array;
-
-    ssd1306_Fill(Black);
-
-    if (graphics_parameter == 0) {
-        int v_int = (int)measured_voltage;
-        int v_frac = (int)((measured_voltage - v_int) * 10.0f);
-        sprintf(title_str, "Voltage: %d.%dV", v_int, v_frac);
-        data_array = voltage_history;
-        max_value = 30.0f;
-    } else if (graphics_parameter == 1) {
-        int i_int = (int)measured_current;
-        int i_frac = (int)((measured_current - i_int) * 100.0f);
-        sprintf(title_str, "Current: %d.%02dA", i_int, i_frac);
-        data_array = current_history;
-        max_value = 5.0f;
-    } else {
-        int p_int = (int)calculated_power;
-        int p_frac = (int)((calculated_power - p_int) * 10.0f);
-        sprintf(title_str, "Power: %d.%dW", p_int, p_frac);
-        data_array = power_history;
-        max_value = 150.0f;
-    }
-
-    ssd1306_SetCursor(0, 0);
-    ssd1306_WriteString(title_str, Font_6x8, White);
+    uint8_t shown = (Menu_Get_Page() == &scope_page);
 
-    uint8_t graph_height = 20;
-    uint8_t graph_y_offset = 10;
+#if FEATURE_PROTECTION
+    shown = shown && !Protection_Get_Event();
+#endif
 
-    // Draw axes
-    for (uint8_t y = 0; y < graph_height; y++) {
-        ssd1306_DrawPixel(10, graph_y_offset + y, White);
-    }
-    for (uint8_t x = 0; x < 110; x++) {
-        ssd1306_DrawPixel(10 + x, graph_y_offset + graph_height - 1, White);
+    if (scope_running) {
+        if (scope.state == SCOPE_DONE || !shown) {
+            Stop_Scope_Capture();
+        }
+    } else if (shown && (scope_frames == 0 || Timebase_Now_ms() - scope_last_ms >= SCOPE_INTERVAL_MS)) {
+        Start_Scope_Capture();
     }
+}
+#endif
 
-    // Plot data points (optimized for reduced data points)
-    for (uint8_t i = 0; i < GRAPH_DATA_POINTS - 1; i++) {
-        uint8_t data_index = (graph_data_index + i) % GRAPH_DATA_POINTS;
-        uint8_t next_index = (graph_data_index + i + 1) % GRAPH_DATA_POINTS;
-
-        uint8_t y1 = graph_y_offset + graph_height - 1 -
-                     (uint8_t)((data_array[data_index] / max_value) * (graph_height - 2));
-        uint8_t y2 = graph_y_offset + graph_height - 1 -
-                     (uint8_t)((data_array[next_index] / max_value) * (graph_height - 2));
-
-        uint8_t x1 = 11 + (i * 110) / (GRAPH_DATA_POINTS - 1);
-        uint8_t x2 = 11 + ((i + 1) * 110) / (GRAPH_DATA_POINTS - 1);
-
-        ssd1306_Line(x1, y1, x2, y2, White);
-    }
+/**
+  * @brief  Count a rotary encoder step and queue it for the menu
+  * @param  steps Detent steps from the decoder
+  * @param  now_ms Timestamp of the step
+  */
+static void Rotary_Encoder_Step(int8_t steps, uint32_t now_ms)
+{
+    if (steps != 0) {
+        Input_Event_t event = { now_ms, INPUT_ROTATE, steps };
 
-    // Add scale labels
-    ssd1306_SetCursor(0, graph_y_offset);
-    if (graphics_parameter == 0) {
-        ssd1306_WriteString("30", Font_6x8, White);
-    } else if (graphics_parameter == 1) {
-        ssd1306_WriteString("5", Font_6x8, White);
-    } else {
-        ssd1306_WriteString("150", Font_6x8, White);
+        rotary_counter += (steps > 0) ? 1 : -1;
+        Input_Queue_Push(&rotary_queue, &event);
     }
+}
 
-    ssd1306_SetCursor(0, graph_y_offset + graph_height - 8);
-    ssd1306_WriteString("0", Font_6x8, White);
-
-    ssd1306_UpdateScreen();
+#if ROTARY_INPUT_MODE == ROTARY_INPUT_TIM22
+/**
+  * @brief  Read the TIM22 quadrature counter and apply the detents moved
+  * @param  now_ms Current tick
+  * @note   TIM22 counts down when A leads B, which is the positive direction
+  *         of the EXTI decoder, so the count is negated.
+  */
+static void Rotary_Encoder_Poll(uint32_t now_ms)
+{
+    uint16_t count = (uint16_t)(0u - __HAL_TIM_GET_COUNTER(&htim22));
+    Rotary_Encoder_Step(Encoder_Decode_Counter(&rotary_encoder, count, now_ms), now_ms);
 }
+#endif
 
 /**
-  * @brief  Display power meter data (production version)
-  */
-void Display_Power_Meter(void)
-{
-    char line1_str[21] = {0};
-    char line2_str[21] = {0};
-    char line3_str[21] = {0};
-
-    // Convert float to integer parts for display
-    int v_int = (int)measured_voltage;
-    int v_frac = (int)((measured_voltage - v_int) * 10.0f);
-    if (v_frac < 0) v_frac = -v_frac;
-
-    int i_int = (int)measured_current;
-    int i_frac = (int)((measured_current - i_int) * 100.0f);
-    if (i_frac < 0) i_frac = -i_frac;
-
-    int p_int = (int)calculated_power;
-    int p_frac = (int)((calculated_power - p_int) * 10.0f);
-    if (p_frac < 0) p_frac = -p_frac;
-
-    // Energy handling with three scales: mWh -> Wh -> kWh
-    if (accumulated_energy < 1.0f) {
-        // Less than 1 Wh: display in mWh
-        int e_mwh = (int)(accumulated_energy * 1000.0f);
-        sprintf(line1_str, "V:%d.%dV  I:%d.%02dA", v_int, v_frac, i_int, i_frac);
-        sprintf(line2_str, "P:%d.%dW E:%dmWh", p_int, p_frac, e_mwh);
-    } else if (accumulated_energy < 1000.0f) {
-        // Between 1 Wh and 1000 Wh: display in Wh
-        int e_wh_int = (int)accumulated_energy;
-        int e_wh_frac = (int)((accumulated_energy - e_wh_int) * 100.0f);
-        if (e_wh_frac < 0) e_wh_frac = -e_wh_frac;
-        sprintf(line1_str, "V:%d.%dV  I:%d.%02dA", v_int, v_frac, i_int, i_frac);
-        sprintf(line2_str, "P:%d.%dW E:%d.%02dWh", p_int, p_frac, e_wh_int, e_wh_frac);
-    } else {
-        // 1000 Wh and above: display in kWh
-        float e_kwh = accumulated_energy / 1000.0f;
-        int e_kwh_int = (int)e_kwh;
-        int e_kwh_frac = (int)((e_kwh - e_kwh_int) * 1000.0f);
-        if (e_kwh_frac < 0) e_kwh_frac = -e_kwh_frac;
-        sprintf(line1_str, "V:%d.%dV  I:%d.%02dA", v_int, v_frac, i_int, i_frac);
-        sprintf(line2_str, "P:%d.%dW E:%d.%03dkWh", p_int, p_frac, e_kwh_int, e_kwh_frac);
-    }
+  * @brief  Sample VREFINT and the temperature sensor and update the compensation
+  * @note   Internal channels need >= 10 us sampling, so the common sampling
+  *         time is raised for these two conversions only.
+  */
+static void Update_Compensation(void)
+{
+    uint32_t sampling = hadc.Instance->SMPR;
 
-    sprintf(line3_str, "ROT:%03u BTN:%s", rotary_counter, button_state ? "ON " : "OFF");
+    hadc.Instance->SMPR = ADC_SAMPLETIME_160CYCLES_5;
+    uint16_t vrefint = (uint16_t)Get_ADC_Value(ADC_CHANNEL_VREFINT);
+    uint16_t temperature = (uint16_t)Get_ADC_Value(ADC_CHANNEL_TEMPSENSOR);
+    hadc.Instance->SMPR = sampling;
 
-    ssd1306_Fill(Black);
-    ssd1306_SetCursor(0, 0);
-    ssd1306_WriteString(line1_str, Font_7x10, White);
-    ssd1306_SetCursor(0, 11);
-    ssd1306_WriteString(line2_str, Font_7x10, White);
-    ssd1306_SetCursor(0, 22);
-    ssd1306_WriteString(line3_str, Font_6x8, White);
-    ssd1306_UpdateScreen();
+    Compensation_Update(vrefint, temperature);
 }
 
 /**
@@ -701,56 +2212,83 @@ void Display_Power_Meter(void)
   */
 void Timer_Interrupt_Handler(void)
 {
-    // Read ADC values from real sensors (production pins)
-    uint32_t voltage_adc = Get_ADC_Value(ADC_CHANNEL_4);  // PA4 - Real voltage input
-    uint32_t current_adc = Get_ADC_Value(ADC_CHANNEL_3);  // PA3 - Real current input
+    // Input and display keep going during a stream; the next measured tick
+    // integrates across the pause like any late tick
+#if ADC_STREAM
+    if (adc_stream_active) {
+#if ROTARY_INPUT_MODE == ROTARY_INPUT_TIM22
+        Rotary_Encoder_Poll(Timebase_Now_ms());
+#endif
+        display_update_pending = 1;
+        return;
+    }
+#endif
+
+    // Track VDDA and die temperature for the compensation factors
+    if (++compensation_ticks >= COMPENSATION_INTERVAL_TICKS) {
+        compensation_ticks = 0;
+        Update_Compensation();
+    }
+
+#if FEATURE_PROTECTION
+    // Trip thresholds for this tick's conversions, release after hysteresis
+    Protection_Update((int32_t)(measured_voltage * 1000.0f), (int32_t)(measured_current * 1000.0f));
+#endif
+
+    // Read ADC values from real sensors (production pins), referred to nominal VDDA
+    uint32_t voltage_adc = Compensation_Apply(CAL_VOLTAGE, Get_ADC_Value(ADC_CHANNEL_4));  // PA4
+    uint32_t current_adc = Compensation_Apply(CAL_CURRENT, Get_ADC_Value(ADC_CHANNEL_3));  // PA3
+
+    // Auto-zero: extra conversions of the unloaded current channel
+    if (autozero_ticks_left) {
+        for (uint8_t i = 0; i < AUTOZERO_SAMPLES_PER_TICK; i++) {
+            autozero_sum += Compensation_Apply(CAL_CURRENT, Get_ADC_Value(ADC_CHANNEL_3));
+        }
+        if (--autozero_ticks_left == 0) {
+            autozero_done = 1;
+        }
+    }
+
+#if FEATURE_CALIBRATION
+    // Running average for calibration capture
+    voltage_adc_avg_q3 += voltage_adc - (voltage_adc_avg_q3 >> 3);
+    current_adc_avg_q3 += current_adc - (current_adc_avg_q3 >> 3);
+#endif
 
     // Convert ADC values to real physical quantities
     measured_voltage = Convert_ADC_to_Voltage(voltage_adc);
     measured_current = Convert_ADC_to_Current(current_adc);
     calculated_power = Calculate_Power(measured_voltage, measured_current);
 
-    // Calculate time delta for energy integration
-    uint32_t current_timestamp = HAL_GetTick();
-    uint32_t delta_time = current_timestamp - last_timestamp;
+    // Resets requested from the menu are done here, the only writer
+    Apply_Pending_Resets();
+
+    // Integrate from the previous sample, late ticks are bridged as gaps
+    uint32_t current_timestamp = Timebase_Now_us();
+    Update_Energy(calculated_power, measured_current, current_timestamp - last_timestamp);
     last_timestamp = current_timestamp;
 
-    // Update accumulated energy
-    if (delta_time > 0 && delta_time < 1000) {
-        Update_Energy(calculated_power, delta_time);
-    }
+#if ROTARY_INPUT_MODE == ROTARY_INPUT_TIM22
+    // Consume the encoder movement counted by TIM22 since the last tick
+    Rotary_Encoder_Poll(Timebase_Now_ms());
+#endif
 
     // Update peak values
     Update_Peaks(measured_voltage, measured_current, calculated_power);
 
-    // Update graphics data buffer
-    Update_Graphics_Data();
+#if FEATURE_EVENTS
+    // Appliance switching shows as steps in the power stream
+    Events_Sample(&load_events, &events_config, (int32_t)(calculated_power * 1000.0f), Timebase_Now_ms());
+#endif
 
-    // Button long press detection
-    if (button_state && !button_long_press_handled) {
-        uint32_t press_duration = current_timestamp - button_press_time;
-        if (press_duration >= 2000) {
-            Handle_Menu_Action(1);
-            button_long_press_handled = 1;
-        }
-    }
+    // Hand the coherent result set to the main loop
+    Publish_Measurement(current_timestamp);
 
-    // Auto-return to power meter
-    if (current_menu != MENU_POWER_METER &&
-        (current_timestamp - last_activity_time) > MENU_TIMEOUT_MS) {
-        current_menu = MENU_POWER_METER;
-        menu_selection = 0;
-        menu_changed = 1;
-    }
+    // Update graphics data buffer
+    Update_Graphics_Data();
 
-    // Update display
-    if (menu_changed) {
-        Display_Current_Menu();
-        menu_changed = 0;
-    }
-    else if (current_menu == MENU_POWER_METER || current_menu == MENU_GRAPHICS) {
-        Display_Current_Menu();
-    }
+    // Display and menu run in the main loop, outside interrupt context
+    display_update_pending = 1;
 }
 
 /**
@@ -759,8 +2297,8 @@ void Timer_Interrupt_Handler(void)
   */
 void User_Button_Interrupt_Handler(void)
 {
-    uint32_t current_time = HAL_GetTick();
-    uint8_t raw_button_state = HAL_GPIO_ReadPin(USER_BUTTON_GPIO_Port, USER_BUTTON_Pin);
+    uint32_t current_time = Timebase_Now_ms();
+    uint8_t raw_button_state = Board_Read_Button();
 
     // Software debouncing
     if ((current_time - button_last_interrupt_time) < 20) {
@@ -774,75 +2312,56 @@ void User_Button_Interrupt_Handler(void)
 
     button_stable_state = raw_button_state;
 
-    if (button_stable_state && !button_state) {
-        // Button pressed
-        button_press_time = current_time;
-        button_long_press_handled = 0;
-        button_state = 1;
-    }
-    else if (!button_stable_state && button_state) {
-        // Button released
-        uint32_t press_duration = current_time - button_press_time;
+    if (button_stable_state != button_state) {
+        Input_Event_t event = { current_time, button_stable_state ? INPUT_BUTTON_DOWN : INPUT_BUTTON_UP, 0 };
 
-        if (!button_long_press_handled && press_duration < 2000) {
-            Handle_Menu_Action(0);
-        }
-        button_state = 0;
+        button_state = button_stable_state;
+        Input_Queue_Push(&button_queue, &event);
     }
 }
 
 /**
-  * @brief  Interrupt handler for Rotary Encoder (same as test version)
+  * @brief  Interrupt handler for Rotary Encoder, decodes every A/B edge
   */
 void Rotary_Encoder_Interrupt_Handler(void)
 {
-    static int8_t rotary_buffer = 0;
-    uint32_t current_time = HAL_GetTick();
+    uint8_t rotary_new = Board_Read_Encoder();
+    uint32_t now_ms = Timebase_Now_ms();
+    Rotary_Encoder_Step(Encoder_Decode(&rotary_encoder, rotary_new, now_ms), now_ms);
+}
 
-    if ((current_time - rotary_last_interrupt_time) < 5) {
+/**
+  * @brief  Interrupt handler for the ADC streams, DMA half and full transfer
+  * @note   A spectrum frame is complete at its full transfer. For the scope,
+  *         both flags set means the handler ran late; both halves are still
+  *         fed, in order, so the sample count stays right.
+  */
+void Adc_Stream_Interrupt_Handler(void)
+{
+#if ADC_STREAM
+    uint32_t flags = DMA1->ISR;
+
+    DMA1->IFCR = DMA_IFCR_CGIF1;
+#if FEATURE_SPECTRUM
+    if (spectrum_running) {
+        if (flags & DMA_ISR_TCIF1) {
+            Board_Adc_Stream_Halt();
+            spectrum_capture_done = 1;
+        }
         return;
     }
-    rotary_last_interrupt_time = current_time;
-
-    uint8_t rotary_new = HAL_GPIO_ReadPin(ROT_CHA_GPIO_Port, ROT_CHA_Pin) << 1;
-    rotary_new += HAL_GPIO_ReadPin(ROT_CHB_GPIO_Port, ROT_CHB_Pin);
-
-    if (rotary_new != rotary_state) {
-        int8_t direction = 0;
-
-        // Clockwise transitions
-        if (((rotary_state == 0b00) && (rotary_new == 0b10)) ||
-            ((rotary_state == 0b10) && (rotary_new == 0b11)) ||
-            ((rotary_state == 0b11) && (rotary_new == 0b01)) ||
-            ((rotary_state == 0b01) && (rotary_new == 0b00))) {
-            rotary_buffer++;
-        }
-
-        // Counter-clockwise transitions
-        if (((rotary_state == 0b00) && (rotary_new == 0b01)) ||
-            ((rotary_state == 0b01) && (rotary_new == 0b11)) ||
-            ((rotary_state == 0b11) && (rotary_new == 0b10)) ||
-            ((rotary_state == 0b10) && (rotary_new == 0b00))) {
-            rotary_buffer--;
-        }
-
-        rotary_state = rotary_new;
-
-        if (rotary_buffer > 3) {
-            rotary_counter++;
-            rotary_buffer = 0;
-            direction = 1;
-        }
-        if (rotary_buffer < -3) {
-            rotary_counter--;
-            rotary_buffer = 0;
-            direction = -1;
-        }
+#endif
+#if FEATURE_SCOPE
+    uint8_t halves = ((flags & DMA_ISR_HTIF1) ? 1 : 0) + ((flags & DMA_ISR_TCIF1) ? 1 : 0);
 
-        if (direction != 0) {
-            Handle_Menu_Navigation(direction);
+    while (halves-- > 0) {
+        if (Scope_Feed(&scope)) {
+            Board_Adc_Stream_Halt();
+            break;
         }
     }
+#endif
+#endif
 }
 
 /**
@@ -852,23 +2371,12 @@ void Rotary_Encoder_Interrupt_Handler(void)
   */
 uint32_t Get_ADC_Value(uint32_t adc_channel)
 {
-    hadc.Instance->CHSELR = 0;
-    ADC_ChannelConfTypeDef sConfig = {0};
-    sConfig.Channel = adc_channel;
-    sConfig.Rank = ADC_RANK_CHANNEL_NUMBER;
-    if (HAL_ADC_ConfigChannel(&hadc, &sConfig) != HAL_OK)
-    {
-        Error_Handler();
-    }
-    if (HAL_ADC_Start(&hadc) != HAL_OK)
-    {
-        Error_Handler();
-    }
-    if (HAL_ADC_PollForConversion(&hadc, 100) != HAL_OK)
-    {
-        Error_Handler();
-    }
-    return HAL_ADC_GetValue(&hadc);
+    // Analog watchdog window of the measured inputs, internal channels are not watched
+    Protection_Arm((adc_channel == ADC_CHANNEL_4) ? CAL_VOLTAGE :
+                   (adc_channel == ADC_CHANNEL_3) ? CAL_CURRENT : CAL_CHANNELS);
+
+    // Direct register conversion, the ADC stays enabled since Board_Adc_Enable()
+    return Board_Adc_Read(adc_channel);
 }
 /* USER CODE END 0 */
 
@@ -905,8 +2413,27 @@ int main(void)
   MX_I2C1_Init();
   MX_TIM6_Init();
   /* USER CODE BEGIN 2 */
+  TIM2_Timebase_Init();
+#if ROTARY_INPUT_MODE == ROTARY_INPUT_TIM22
+  TIM22_Encoder_Init();
+#endif
+  // Start the microsecond clock before anything takes timestamps
+  Timebase_Init(&htim2);
+
+  // Seed the decoder with the current position before the first EXTI edge
+  // or TIM6 tick decodes it, so neither reports a phantom step
+#if ROTARY_INPUT_MODE == ROTARY_INPUT_TIM22
+  Encoder_Init_Counter(&rotary_encoder, (uint16_t)(0u - __HAL_TIM_GET_COUNTER(&htim22)));
+#else
+  Encoder_Init(&rotary_encoder, Board_Read_Encoder());
+#endif
+
+  Board_Adc_Enable();
+
   // Initialize OLED display
   ssd1306_Init();
+  ssd1306_GlyphCacheInit(&meter_glyphs_7x10, &Font_7x10, METER_GLYPHS_7x10, meter_glyph_columns_7x10);
+  ssd1306_GlyphCacheInit(&meter_glyphs_6x8, &Font_6x8, METER_GLYPHS_6x8, meter_glyph_columns_6x8);
   ssd1306_Fill(Black);
   ssd1306_SetCursor(0, 0);
   ssd1306_WriteString("Power Meter v1.0", Font_7x10, White);
@@ -915,20 +2442,44 @@ int main(void)
   ssd1306_SetCursor(0, 22);
   ssd1306_WriteString("STM32L052K6", Font_6x8, White);
   ssd1306_UpdateScreen();
+  Display_Power_Init(&display_power);
+
+  // Load the stored calibration before the first sample is converted
+  Calibration_Init(calibration_defaults);
+  compensation_config.vrefint_cal = *VREFINT_CAL_ADDR;
+  compensation_config.ts_cal1 = *TEMPSENSOR_CAL1_ADDR;
+  compensation_config.ts_cal2 = *TEMPSENSOR_CAL2_ADDR;
+  Compensation_Init(&compensation_config);
+  Update_Compensation();
+#if FEATURE_PROTECTION
+  Protection_Init(&protection_config);
+#endif
+#if FEATURE_HISTOGRAM
+  Histogram_Configure(&histogram, &histogram_config);
+#endif
+#if FEATURE_CONSOLE
+  // USART1 has no generated init: the HAL enables its clock, pins and
+  // interrupt, the console programs the port
+  UART_HandleTypeDef console_uart = { .Instance = USART1 };
+  HAL_UART_MspInit(&console_uart);
+  Console_Init(USART1, HAL_RCC_GetPCLK2Freq());
+#endif
 
   // Initialize power meter variables
-  last_timestamp = HAL_GetTick();
-  last_activity_time = HAL_GetTick();
+  last_timestamp = Timebase_Now_us();
+  last_activity_time = Timebase_Now_ms();
   Reset_Energy();
   Reset_Peaks();
 
   // Initialize menu system
-  current_menu = MENU_POWER_METER;
-  menu_selection = 0;
-  menu_changed = 1;
+  Menu_Init(&power_meter_page, &main_menu_page);
+  Gesture_Init(&button_gesture);
 
   // Start timer for periodic measurements
   HAL_TIM_Base_Start_IT(&htim6);
+#if AUTOZERO_AT_BOOT
+  Start_Auto_Zero(1);
+#endif
 
   // Brief startup delay
   HAL_Delay(1000);
@@ -937,10 +2488,66 @@ int main(void)
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
-  rotary_state = HAL_GPIO_ReadPin(ROT_CHA_GPIO_Port, ROT_CHA_Pin) << 1;
-  rotary_state += HAL_GPIO_ReadPin(ROT_CHB_GPIO_Port, ROT_CHB_Pin);
   while (1)
   {
+    Process_Input();
+
+#if FEATURE_CONSOLE
+    char console_line[CONSOLE_LINE_SIZE];
+
+    if (Console_Get_Line(console_line)) {
+      Handle_Console_Command(console_line);
+    }
+#endif
+    Finish_Auto_Zero();
+#if FEATURE_SCOPE
+    Update_Scope();
+#endif
+#if FEATURE_SPECTRUM
+    Update_Spectrum();
+#endif
+
+    if (display_update_pending) {
+      display_update_pending = 0;
+      Measurement_Read(&measurement_latch, &display_snapshot);
+
+#if FEATURE_PROTECTION
+      // A latched alarm keeps the panel awake until it is acknowledged
+      if (Protection_Get_Event()) {
+        Input_Wake();
+      }
+#endif
+      uint32_t idle_ms = Timebase_Now_ms() - last_activity_time;
+
+      // Auto-return to power meter
+      if (!Menu_At_Root() && idle_ms > (uint32_t)menu_timeout_s * 1000) {
+        Menu_Go_Root();
+      }
+
+      // Update display, widgets only redraw what changed; nothing is
+      // flushed while the panel is off, measurements keep running
+      if (Display_Power_Update(idle_ms)) {
+        Display_Current_Menu();
+      }
+    }
+
+    // Sleep until the next interrupt unless one already queued work
+    __disable_irq();
+    uint8_t work_pending = display_update_pending ||
+        !Input_Queue_Empty(&button_queue) || !Input_Queue_Empty(&rotary_queue);
+#if FEATURE_SCOPE
+    work_pending = work_pending || (scope_running && scope.state == SCOPE_DONE);
+#endif
+#if FEATURE_SPECTRUM
+    work_pending = work_pending || (spectrum_running && spectrum_capture_done);
+#endif
+#if FEATURE_CONSOLE
+    work_pending = work_pending || Console_Line_Ready();
+#endif
+    if (!work_pending) {
+      Power_Idle();
+    }
+    __enable_irq();
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
@@ -1164,6 +2771,16 @@ static void MX_GPIO_Init(void)
   __HAL_RCC_GPIOA_CLK_ENABLE();
   __HAL_RCC_GPIOB_CLK_ENABLE();
 
+  /*Configure GPIO pin Output Level */
+  HAL_GPIO_WritePin(LED_RED_GPIO_Port, LED_RED_Pin, GPIO_PIN_RESET);
+
+  /*Configure GPIO pin : LED_RED_Pin (PA15) */
+  GPIO_InitStruct.Pin = LED_RED_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  HAL_GPIO_Init(LED_RED_GPIO_Port, &GPIO_InitStruct);
+
   /*Configure GPIO pin : USER_BUTTON_Pin (PB3) */
   GPIO_InitStruct.Pin = USER_BUTTON_Pin;
   GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
@@ -1178,7 +2795,7 @@ static void MX_GPIO_Init(void)
 
   /*Configure GPIO pin : ROT_CHB_Pin (PA1) */
   GPIO_InitStruct.Pin = ROT_CHB_Pin;
-  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   HAL_GPIO_Init(ROT_CHB_GPIO_Port, &GPIO_InitStruct);
 
@@ -1193,12 +2810,102 @@ static void MX_GPIO_Init(void)
   HAL_NVIC_EnableIRQ(EXTI4_15_IRQn);
 
   /* USER CODE BEGIN MX_GPIO_Init_2 */
+#if ROTARY_INPUT_MODE == ROTARY_INPUT_TIM22
+  // The encoder pins belong to TIM22 (HAL_TIM_Encoder_MspInit), release
+  // their EXTI lines so no edge interrupts fire
+  HAL_NVIC_DisableIRQ(EXTI4_15_IRQn);
+  HAL_GPIO_DeInit(ROT_CHA_GPIO_Port, ROT_CHA_Pin | ROT_CHB_Pin);
+#endif
 
   /* USER CODE END MX_GPIO_Init_2 */
 }
 
 /* USER CODE BEGIN 4 */
 
+/**
+  * @brief TIM2 Initialization Function (1 MHz free running timebase)
+  * @note  Not part of the .ioc, so the clock and interrupt setup live here
+  * @param None
+  * @retval None
+  */
+static void TIM2_Timebase_Init(void)
+{
+  TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+  __HAL_RCC_TIM2_CLK_ENABLE();
+
+  htim2.Instance = TIM2;
+  htim2.Init.Prescaler = 31;
+  htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim2.Init.Period = 0xFFFF;
+  htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim2) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+  if (HAL_TIM_ConfigClockSource(&htim2, &sClockSourceConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim2, &sMasterConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /* TIM2 interrupt Init, above every timestamping interrupt */
+  HAL_NVIC_SetPriority(TIM2_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+#if ROTARY_INPUT_MODE == ROTARY_INPUT_TIM22
+/**
+  * @brief TIM22 Initialization Function (rotary encoder, encoder mode TI1+TI2)
+  * @note  Not part of the .ioc; the pins are set up in HAL_TIM_Encoder_MspInit()
+  * @param None
+  * @retval None
+  */
+static void TIM22_Encoder_Init(void)
+{
+  TIM_Encoder_InitTypeDef sConfig = {0};
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+  htim22.Instance = TIM22;
+  htim22.Init.Prescaler = 0;
+  htim22.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim22.Init.Period = 0xFFFF;
+  htim22.Init.ClockDivision = TIM_CLOCKDIVISION_DIV4;
+  htim22.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  sConfig.EncoderMode = TIM_ENCODERMODE_TI12;
+  sConfig.IC1Polarity = TIM_ICPOLARITY_RISING;
+  sConfig.IC1Selection = TIM_ICSELECTION_DIRECTTI;
+  sConfig.IC1Prescaler = TIM_ICPSC_DIV1;
+  sConfig.IC1Filter = 15;   // Digital filter replaces the software debounce
+  sConfig.IC2Polarity = TIM_ICPOLARITY_RISING;
+  sConfig.IC2Selection = TIM_ICSELECTION_DIRECTTI;
+  sConfig.IC2Prescaler = TIM_ICPSC_DIV1;
+  sConfig.IC2Filter = 15;
+  if (HAL_TIM_Encoder_Init(&htim22, &sConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim22, &sMasterConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (HAL_TIM_Encoder_Start(&htim22, TIM_CHANNEL_ALL) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+#endif
+
 /* USER CODE END 4 */
 
 /**
@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file           : measurement.c
+  * @brief          : Coherent measurement snapshots from the TIM6 tick
+  ******************************************************************************
+  */
+
+#include "measurement.h"
+
+// Keeps the compiler from moving slot accesses across the sequence accesses,
+// the Cortex-M0+ itself does not reorder them
+#define MEASUREMENT_BARRIER()   __asm volatile ("" ::: "memory")
+
+/**
+  * @brief  Publish a new result set (single writer)
+  * @param  latch Latch
+  * @param  measurement Result set
+  */
+void Measurement_Publish(Measurement_Latch_t* latch, const Measurement_t* measurement)
+{
+    uint32_t sequence = latch->sequence;
+
+    latch->slots[(sequence + 1) & 1] = *measurement;
+    MEASUREMENT_BARRIER();
+    latch->sequence = sequence + 1;
+}
+
+/**
+  * @brief  Copy the latest published result set
+  * @param  latch Latch
+  * @param  dst Destination
+  */
+void Measurement_Read(const Measurement_Latch_t* latch, Measurement_t* dst)
+{
+    uint32_t sequence;
+
+    do {
+        sequence = latch->sequence;
+        MEASUREMENT_BARRIER();
+        *dst = latch->slots[sequence & 1];
+        MEASUREMENT_BARRIER();
+    } while (latch->sequence != sequence);
+}
@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file           : power.c
+  * @brief          : Idle sleep and MCU duty cycle accounting
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "power.h"
+#include "timebase.h"
+
+static uint32_t power_sleep_us = 0;         // Time asleep in the current window
+static uint32_t power_window_start = 0;     // Timebase at the window start (us)
+static uint16_t power_sleep_permille = 0;   // Sleep share of the last window
+
+/**
+  * @brief  Sleep until the next interrupt
+  * @note   Call with interrupts disabled after checking for pending work. The
+  *         WFI still wakes on a pending interrupt, which then runs as soon as
+  *         the caller re-enables interrupts, so no wakeup can be missed.
+  * @note   The SysTick interrupt is masked while asleep, so HAL_GetTick()
+  *         stands still meanwhile; HAL timeouts and HAL_Delay() only count
+  *         while the core runs, which is all they are used for.
+  */
+void Power_Idle(void)
+{
+    uint32_t before = Timebase_Now_us();
+
+    HAL_SuspendTick();
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+    HAL_ResumeTick();
+
+    // The waking interrupt is still pending, the timebase accounts for it
+    uint32_t now = Timebase_Now_us();
+    power_sleep_us += now - before;
+
+    uint32_t window = now - power_window_start;
+    if (window >= POWER_WINDOW_MS * 1000UL) {
+        uint32_t permille = power_sleep_us / (window / 1000);
+
+        power_sleep_permille = (permille > 1000) ? 1000 : (uint16_t)permille;
+        power_sleep_us = 0;
+        power_window_start = now;
+    }
+}
+
+/**
+  * @brief  Share of the last window spent asleep
+  * @retval 0..1000
+  */
+uint16_t Power_Get_Sleep_Permille(void)
+{
+    return power_sleep_permille;
+}
+
+/**
+  * @brief  Estimated MCU supply current over the last window
+  * @retval Microamps, display and analog front end not included
+  */
+uint32_t Power_Get_Estimated_uA(void)
+{
+    uint32_t sleep = power_sleep_permille;
+
+    return (POWER_RUN_UA * (1000 - sleep) + POWER_SLEEP_UA * sleep) / 1000;
+}
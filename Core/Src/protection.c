@@ -0,0 +1,232 @@
+/**
+  ******************************************************************************
+  * @file           : protection.c
+  * @brief          : Over-voltage / over-current trip on the ADC analog watchdog
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "protection.h"
+#include "compensation.h"
+#include "timebase.h"
+#include "board_io.h"
+
+#define PROTECTION_RAW_MAX      4095U
+#define PROTECTION_TR(low, high)  (((uint32_t)(high) << 16) | (uint32_t)(low))
+#define PROTECTION_TR_OFF       PROTECTION_TR(0, PROTECTION_RAW_MAX)
+
+static const Protection_Config_t* protection_config = NULL;
+static uint32_t protection_tr[CAL_CHANNELS] = { PROTECTION_TR_OFF, PROTECTION_TR_OFF };
+static volatile uint8_t protection_armed = 0;      // Flag of the channel in the watchdog
+static volatile uint8_t protection_active = 0;     // Tripped, waiting for release
+static volatile uint8_t protection_event = 0;      // Latched until acknowledged
+static volatile uint32_t protection_event_ms = 0;
+
+static const uint8_t protection_flags[CAL_CHANNELS] = {
+    PROTECTION_OVER_VOLTAGE, PROTECTION_OVER_CURRENT
+};
+
+/**
+  * @brief  Reading of a raw ADC code, as the measurement path computes it
+  */
+static int32_t Protection_Convert(Cal_Channel_t channel, uint32_t raw)
+{
+    return Calibration_Apply(channel, Compensation_Apply(channel, raw));
+}
+
+/**
+  * @brief  Largest raw code that reads at most limit
+  */
+static uint32_t Protection_Raw_At_Most(Cal_Channel_t channel, int32_t limit)
+{
+    uint32_t low = 0;
+    uint32_t high = PROTECTION_RAW_MAX;
+
+    while (low < high) {
+        uint32_t mid = (low + high + 1) / 2;
+        if (Protection_Convert(channel, mid) <= limit) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+/**
+  * @brief  Smallest raw code that reads at least limit
+  */
+static uint32_t Protection_Raw_At_Least(Cal_Channel_t channel, int32_t limit)
+{
+    uint32_t low = 0;
+    uint32_t high = PROTECTION_RAW_MAX;
+
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        if (Protection_Convert(channel, mid) >= limit) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+/**
+  * @brief  Release a tripped channel once its reading is back below the
+  *         limit by the hysteresis, or at once if the limit was disabled
+  */
+static void Protection_Release(uint8_t flag, int32_t magnitude, int32_t limit)
+{
+    if ((protection_active & flag) &&
+        (limit == 0 || magnitude * 100 < limit * (100 - (int32_t)protection_config->hysteresis_pct))) {
+        protection_active &= ~flag;
+    }
+}
+
+/**
+  * @brief  Start with the given limits, the ADC must be enabled
+  * @param  config Limits, read on every update so Settings edits apply
+  */
+void Protection_Init(const Protection_Config_t* config)
+{
+    protection_config = config;
+    protection_active = 0;
+    protection_event = 0;
+    Board_Led_Red(0);
+
+    ADC1->CFGR1 &= ~(ADC_CFGR1_AWDCH | ADC_CFGR1_AWDSGL);   // Watch every conversion
+    ADC1->TR = PROTECTION_TR_OFF;
+    ADC1->ISR = ADC_ISR_AWD;
+    ADC1->CFGR1 |= ADC_CFGR1_AWDEN;
+    ADC1->IER |= ADC_IER_AWDIE;
+}
+
+/**
+  * @brief  Release tripped channels and recompute the code thresholds
+  * @param  voltage_mv Latest voltage reading
+  * @param  current_ma Latest current reading, signed
+  * @note   Call from the measurement tick, before its conversions.
+  */
+void Protection_Update(int32_t voltage_mv, int32_t current_ma)
+{
+    int32_t voltage_limit = (int32_t)protection_config->voltage_limit_dv * 100;
+    int32_t current_limit = (int32_t)protection_config->current_limit_ca * 10;
+
+    Protection_Release(PROTECTION_OVER_VOLTAGE, voltage_mv, voltage_limit);
+    Protection_Release(PROTECTION_OVER_CURRENT, (current_ma < 0) ? -current_ma : current_ma, current_limit);
+    Board_Led_Red(protection_active != 0);
+
+    protection_tr[CAL_VOLTAGE] = (voltage_limit == 0) ? PROTECTION_TR_OFF :
+        PROTECTION_TR(0, Protection_Raw_At_Most(CAL_VOLTAGE, voltage_limit));
+    protection_tr[CAL_CURRENT] = (current_limit == 0) ? PROTECTION_TR_OFF :
+        PROTECTION_TR(Protection_Raw_At_Least(CAL_CURRENT, -current_limit),
+                      Protection_Raw_At_Most(CAL_CURRENT, current_limit));
+}
+
+/**
+  * @brief  Load the watchdog window and selection, and enable its interrupt
+  * @param  channel Channel whose limits apply
+  * @param  watch 0 to watch every conversion, or ADC_CFGR1_AWDSGL with the
+  *         AWDCH field of one channel
+  * @note   CFGR1 and TR may only be written with no conversion ongoing.
+  */
+static void Protection_Load(Cal_Channel_t channel, uint32_t watch)
+{
+    uint8_t flag = (channel < CAL_CHANNELS) ? protection_flags[channel] : 0;
+
+    ADC1->CFGR1 = (ADC1->CFGR1 & ~(ADC_CFGR1_AWDCH | ADC_CFGR1_AWDSGL)) | watch;
+    if (flag == 0 || (protection_active & flag)) {
+        protection_armed = 0;
+        ADC1->TR = PROTECTION_TR_OFF;
+    } else {
+        protection_armed = flag;
+        ADC1->TR = protection_tr[channel];
+    }
+    // A flag left from conversions after a trip must not blame this channel
+    ADC1->ISR = ADC_ISR_AWD;
+    ADC1->IER |= ADC_IER_AWDIE;
+}
+
+/**
+  * @brief  Load the watchdog window for the next conversions
+  * @param  channel Channel about to be converted, CAL_CHANNELS for others
+  *         (VREFINT, temperature), which are not watched
+  * @note   Call with no conversion ongoing, before starting one or a stream.
+  */
+void Protection_Arm(Cal_Channel_t channel)
+{
+    Protection_Load(channel, 0);
+}
+
+/**
+  * @brief  Watch one channel of a multi-channel stream
+  * @param  channel Channel whose limits apply
+  * @param  adc_channel HAL ADC_CHANNEL_x it is converted on; the others in
+  *         the sequence are not watched
+  * @note   Call with no conversion ongoing, before starting the stream.
+  */
+void Protection_Arm_Single(Cal_Channel_t channel, uint32_t adc_channel)
+{
+    Protection_Load(channel, ADC_CFGR1_AWDSGL | (adc_channel & ADC_CFGR1_AWDCH));
+}
+
+/**
+  * @brief  Analog watchdog interrupt, a conversion left the window
+  */
+void Protection_IRQHandler(void)
+{
+    if (!(ADC1->ISR & ADC_ISR_AWD)) {
+        return;
+    }
+    // TR cannot be rewritten while a stream converts, so mask the interrupt
+    // until the next Protection_Arm(); a signal staying out of the window
+    // would otherwise interrupt on every sample
+    ADC1->IER &= ~ADC_IER_AWDIE;
+    ADC1->ISR = ADC_ISR_AWD;
+
+    uint8_t flag = protection_armed;
+    protection_armed = 0;
+    if (flag == 0) {
+        return;
+    }
+
+    protection_active |= flag;
+    if (protection_event == 0) {
+        protection_event_ms = Timebase_Now_ms();
+    }
+    protection_event |= flag;
+    Board_Led_Red(1);
+}
+
+/**
+  * @brief  Channels currently tripped
+  */
+uint8_t Protection_Get_Active(void)
+{
+    return protection_active;
+}
+
+/**
+  * @brief  Latched breaches since the last acknowledge
+  */
+uint8_t Protection_Get_Event(void)
+{
+    return protection_event;
+}
+
+/**
+  * @brief  Time of the first latched breach
+  */
+uint32_t Protection_Get_Event_Time_ms(void)
+{
+    return protection_event_ms;
+}
+
+/**
+  * @brief  Clear the latched event, tripped channels stay tripped
+  */
+void Protection_Acknowledge(void)
+{
+    protection_event = 0;
+}
@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file           : scope.c
+  * @brief          : Triggered burst capture from a circular DMA buffer
+  ******************************************************************************
+  */
+
+#include "scope.h"
+
+/**
+  * @brief  Start looking at a new stream
+  * @param  scope Capture state
+  * @param  buffer Circular buffer the DMA starts writing at index 0
+  * @param  config Level, edge and pre-trigger share, copied
+  * @param  stride Channels in the stream, 1 or 2
+  * @param  lane Trigger channel, 0 to stride - 1
+  * @param  auto_halves Halves without a trigger before auto mode takes over
+  */
+void Scope_Arm(Scope_t* scope, const volatile uint16_t* buffer, const Scope_Config_t* config,
+               uint8_t stride, uint8_t lane, uint16_t auto_halves)
+{
+    uint16_t pct = (config->pretrigger_pct > 100) ? 100 : config->pretrigger_pct;
+
+    scope->buffer = buffer;
+    scope->config = *config;
+    scope->stride = stride;
+    scope->lane = lane;
+    scope->primed = 0;
+    scope->forced = 0;
+    scope->pre_steps = (uint16_t)(Scope_Steps(scope) * pct / 100);
+    scope->halves_left = auto_halves;
+    scope->written = 0;
+    scope->trigger_step = 0;
+    scope->state = SCOPE_FILLING;
+}
+
+/**
+  * @brief  Steps in the record
+  */
+uint16_t Scope_Steps(const Scope_t* scope)
+{
+    return (uint16_t)(SCOPE_RECORD / scope->stride);
+}
+
+/**
+  * @brief  Look for the trigger in the samples of one half
+  * @param  scope Capture state
+  * @param  first First absolute sample of the half
+  */
+static void Scope_Search(Scope_t* scope, uint32_t first)
+{
+    uint32_t level = scope->config.level;
+    uint8_t rising = (scope->config.edge == SCOPE_RISING);
+    // Re-arm threshold on the far side of the level
+    uint32_t rearm = rising ? ((level > SCOPE_HYSTERESIS) ? level - SCOPE_HYSTERESIS : 0)
+                            : level + SCOPE_HYSTERESIS;
+
+    for (uint32_t step = first / scope->stride; step < (first + SCOPE_HALF) / scope->stride; step++) {
+        if (scope->state == SCOPE_FILLING) {
+            if (step < scope->pre_steps) {
+                continue;
+            }
+            scope->state = SCOPE_ARMED;
+        }
+
+        uint32_t sample = scope->buffer[(step * scope->stride + scope->lane) % SCOPE_BUFFER];
+        if (!scope->primed) {
+            scope->primed = rising ? (sample <= rearm) : (sample >= rearm);
+        } else if (rising ? (sample >= level) : (sample <= level)) {
+            scope->trigger_step = step;
+            scope->state = SCOPE_TRIGGERED;
+            return;
+        }
+    }
+}
+
+/**
+  * @brief  Process the half the DMA just completed
+  * @param  scope Capture state
+  * @retval 1 when the record is complete and the stream must stop
+  * @note   Called from the DMA half and full transfer interrupts, in order.
+  */
+uint8_t Scope_Feed(Scope_t* scope)
+{
+    uint32_t first = scope->written;
+
+    if (scope->state == SCOPE_IDLE || scope->state == SCOPE_DONE) {
+        return scope->state == SCOPE_DONE;
+    }
+
+    scope->written += SCOPE_HALF;
+    if (scope->state != SCOPE_TRIGGERED) {
+        Scope_Search(scope, first);
+    }
+
+    if (scope->state != SCOPE_TRIGGERED) {
+        if (scope->halves_left > 0 && --scope->halves_left == 0 &&
+            scope->written >= SCOPE_RECORD + SCOPE_MARGIN) {
+            // Auto mode: the newest full record, as if triggered
+            scope->trigger_step = scope->written / scope->stride - Scope_Steps(scope) + scope->pre_steps;
+            scope->forced = 1;
+            scope->state = SCOPE_DONE;
+            return 1;
+        }
+        return 0;
+    }
+
+    uint32_t end_step = scope->trigger_step - scope->pre_steps + Scope_Steps(scope);
+    if (scope->written >= end_step * scope->stride) {
+        scope->state = SCOPE_DONE;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+  * @brief  Sample of a completed record
+  * @param  scope Capture state
+  * @param  step 0 to Scope_Steps() - 1, the trigger is at pre_steps
+  * @param  lane Channel within the step
+  */
+uint16_t Scope_Get(const Scope_t* scope, uint16_t step, uint8_t lane)
+{
+    uint32_t first = scope->trigger_step - scope->pre_steps;
+
+    return scope->buffer[((first + step) * scope->stride + lane) % SCOPE_BUFFER];
+}
@@ -0,0 +1,281 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum.c
+  * @brief          : Fixed-point FFT spectrum, fundamental, THD and harmonics
+  ******************************************************************************
+  */
+
+#include "spectrum.h"
+
+#define SPECTRUM_HEADROOM       13000   // Max component before a stage, 32767 / (1 + sqrt(2))
+#define SPECTRUM_LOBE           1       // Hann main lobe half width, bins
+#define SPECTRUM_FIRST_BIN      2       // Bins below hold the window's DC leakage
+
+// sin(2 pi k / SPECTRUM_N) in Q15 for the first quarter wave
+static const int16_t spectrum_sine_q15[SPECTRUM_N / 4 + 1] = {
+    0, 1608, 3212, 4808, 6393, 7962, 9512, 11039,
+    12539, 14010, 15446, 16846, 18204, 19519, 20787, 22005,
+    23170, 24279, 25329, 26319, 27245, 28105, 28898, 29621,
+    30273, 30852, 31356, 31785, 32137, 32412, 32609, 32728,
+    32767,
+};
+
+/**
+  * @brief  sin(2 pi k / SPECTRUM_N) in Q15 from the quarter-wave table
+  */
+static int16_t Spectrum_Sin(uint32_t k)
+{
+    k &= SPECTRUM_N - 1;
+    if (k <= SPECTRUM_N / 4) return spectrum_sine_q15[k];
+    if (k <= SPECTRUM_N / 2) return spectrum_sine_q15[SPECTRUM_N / 2 - k];
+    if (k <= SPECTRUM_N * 3 / 4) return (int16_t)-spectrum_sine_q15[k - SPECTRUM_N / 2];
+    return (int16_t)-spectrum_sine_q15[SPECTRUM_N - k];
+}
+
+static int16_t Spectrum_Cos(uint32_t k)
+{
+    return Spectrum_Sin(k + SPECTRUM_N / 4);
+}
+
+/**
+  * @brief  Largest magnitude of any component
+  */
+static int32_t Spectrum_Peak(const int16_t* re, const int16_t* im)
+{
+    int32_t peak = 0;
+
+    for (uint32_t i = 0; i < SPECTRUM_N; i++) {
+        int32_t r = (re[i] < 0) ? -re[i] : re[i];
+        int32_t j = (im[i] < 0) ? -im[i] : im[i];
+        if (r > peak) peak = r;
+        if (j > peak) peak = j;
+    }
+    return peak;
+}
+
+/**
+  * @brief  In-place radix-2 decimation in time FFT, Q15
+  * @param  re Real parts, input in natural order, output by bin
+  * @param  im Imaginary parts
+  * @retval Number of stages that halved the frame to stay in range
+  */
+uint8_t Spectrum_FFT(int16_t re[SPECTRUM_N], int16_t im[SPECTRUM_N])
+{
+    uint8_t shifts = 0;
+
+    // Bit-reversed reordering
+    for (uint32_t i = 1, j = 0; i < SPECTRUM_N; i++) {
+        uint32_t bit = SPECTRUM_N >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j |= bit;
+        if (i < j) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (uint32_t half = 1; half < SPECTRUM_N; half <<= 1) {
+        uint32_t stride = SPECTRUM_N / (half << 1);     // Twiddle index step
+
+        if (Spectrum_Peak(re, im) > SPECTRUM_HEADROOM) {
+            for (uint32_t i = 0; i < SPECTRUM_N; i++) {
+                re[i] >>= 1;
+                im[i] >>= 1;
+            }
+            shifts++;
+        }
+
+        for (uint32_t k = 0; k < half; k++) {
+            int32_t c = Spectrum_Cos(k * stride);
+            int32_t s = Spectrum_Sin(k * stride);
+
+            for (uint32_t a = k; a < SPECTRUM_N; a += half << 1) {
+                uint32_t b = a + half;
+                // b * e^(-j theta)
+                int32_t tr = (re[b] * c + im[b] * s + 0x4000) >> 15;
+                int32_t ti = (im[b] * c - re[b] * s + 0x4000) >> 15;
+
+                re[b] = (int16_t)(re[a] - tr);
+                im[b] = (int16_t)(im[a] - ti);
+                re[a] = (int16_t)(re[a] + tr);
+                im[a] = (int16_t)(im[a] + ti);
+            }
+        }
+    }
+    return shifts;
+}
+
+/**
+  * @brief  Integer square root
+  */
+static uint32_t Spectrum_Sqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/**
+  * @brief  log2 in Q3, from the leading bit and the three bits after it
+  */
+static int32_t Spectrum_Log2_Q3(uint32_t value)
+{
+    int32_t msb = 0;
+
+    if (value == 0) {
+        return 0;
+    }
+    while ((value >> msb) > 1) {
+        msb++;
+    }
+    uint32_t fraction = (msb >= 3) ? (value >> (msb - 3)) & 7 : (value << (3 - msb)) & 7;
+    return msb * 8 + (int32_t)fraction;
+}
+
+/**
+  * @brief  Power of a bin
+  */
+static uint32_t Spectrum_Power(const int16_t* re, const int16_t* im, uint32_t k)
+{
+    return (uint32_t)(re[k] * re[k]) + (uint32_t)(im[k] * im[k]);
+}
+
+/**
+  * @brief  Power within the main lobe around a bin
+  */
+static uint64_t Spectrum_Lobe(const int16_t* re, const int16_t* im, int32_t center)
+{
+    uint64_t sum = 0;
+
+    for (int32_t k = center - SPECTRUM_LOBE; k <= center + SPECTRUM_LOBE; k++) {
+        if (k >= 1 && k < (int32_t)SPECTRUM_BINS) {
+            sum += Spectrum_Power(re, im, (uint32_t)k);
+        }
+    }
+    return sum;
+}
+
+/**
+  * @brief  Amplitude ratio sqrt(power / reference) in 0.1 %, saturated
+  */
+static uint16_t Spectrum_Ratio_pm(uint64_t power, uint64_t reference)
+{
+    if (reference == 0) {
+        return 0;
+    }
+    uint64_t scaled = (power * 1000000ULL) / reference;
+    uint32_t ratio = Spectrum_Sqrt((scaled > UINT32_MAX) ? UINT32_MAX : (uint32_t)scaled);
+    return (ratio > UINT16_MAX) ? UINT16_MAX : (uint16_t)ratio;
+}
+
+/**
+  * @brief  Transform a frame of raw codes and extract the readouts
+  * @param  re Raw ADC codes on input, overwritten by the transform
+  * @param  im Scratch buffer
+  * @param  duration_us Time spanned by the frame, SPECTRUM_N sample periods
+  * @param  result Spectrum and readouts
+  */
+void Spectrum_Analyze(int16_t re[SPECTRUM_N], int16_t im[SPECTRUM_N], uint32_t duration_us,
+                      Spectrum_t* result)
+{
+    int32_t mean = 0;
+    int32_t peak = 0;
+    uint8_t shift = 0;
+
+    for (uint32_t i = 0; i < SPECTRUM_N; i++) {
+        mean += re[i];
+    }
+    mean /= (int32_t)SPECTRUM_N;
+    for (uint32_t i = 0; i < SPECTRUM_N; i++) {
+        re[i] = (int16_t)(re[i] - mean);
+        int32_t magnitude = (re[i] < 0) ? -re[i] : re[i];
+        if (magnitude > peak) peak = magnitude;
+    }
+
+    // Scale up into the 16-bit range, then apply the periodic Hann window
+    while (peak != 0 && (peak << (shift + 1)) <= 32767 && shift < 15) {
+        shift++;
+    }
+    for (uint32_t i = 0; i < SPECTRUM_N; i++) {
+        int32_t window = (32767 - Spectrum_Cos(i)) >> 1;
+        re[i] = (int16_t)((((int32_t)re[i] << shift) * window) >> 15);
+        im[i] = 0;
+    }
+
+    Spectrum_FFT(re, im);
+
+    // Strongest bin above the window's DC leakage
+    uint32_t strongest = 0;
+    uint8_t k0 = SPECTRUM_FIRST_BIN;
+    for (uint32_t k = SPECTRUM_FIRST_BIN; k < SPECTRUM_BINS - 1; k++) {
+        uint32_t power = Spectrum_Power(re, im, k);
+        if (power > strongest) {
+            strongest = power;
+            k0 = (uint8_t)k;
+        }
+    }
+
+    int32_t top = Spectrum_Log2_Q3(strongest);
+    for (uint32_t k = 0; k < SPECTRUM_BINS; k++) {
+        uint32_t power = Spectrum_Power(re, im, k);
+        // 10 log10(2) / 8 = 385 / 1024 dB per Q3 step
+        int32_t db = power ? ((top - Spectrum_Log2_Q3(power)) * 385) >> 10 : 255;
+        result->level_db[k] = (uint8_t)((db > 255) ? 255 : (db < 0) ? 0 : db);
+    }
+
+    result->valid = (strongest != 0);
+    result->fundamental_bin = k0;
+    if (!result->valid) {
+        result->fundamental_mhz = 0;
+        result->thd_pm = 0;
+        for (uint32_t h = 0; h < SPECTRUM_HARMONICS; h++) {
+            result->harmonic_pm[h] = 0;
+        }
+        return;
+    }
+
+    // Hann interpolation with the larger neighbour n: delta = (2n - p) / (n + p)
+    int32_t p = (int32_t)Spectrum_Sqrt(strongest);
+    int32_t left = (int32_t)Spectrum_Sqrt(Spectrum_Power(re, im, k0 - 1));
+    int32_t right = (int32_t)Spectrum_Sqrt(Spectrum_Power(re, im, k0 + 1));
+    int32_t n = (right >= left) ? right : left;
+    int32_t delta_q10 = ((2 * n - p) * 1024) / (n + p);
+    if (delta_q10 < 0) delta_q10 = 0;
+    if (right < left) delta_q10 = -delta_q10;
+    int32_t position_q10 = (int32_t)k0 * 1024 + delta_q10;
+
+    result->fundamental_mhz = (uint32_t)(((uint64_t)position_q10 * 1000000000ULL) /
+                                         ((uint64_t)duration_us * 1024));
+
+    uint64_t fundamental = Spectrum_Lobe(re, im, k0);
+    uint64_t harmonics = 0;
+    for (uint32_t h = 2; (int32_t)h * position_q10 < (int32_t)(SPECTRUM_BINS - 1) * 1024; h++) {
+        int32_t center = ((int32_t)h * position_q10 + 512) >> 10;
+        uint64_t lobe = Spectrum_Lobe(re, im, center);
+        harmonics += lobe;
+        if (h - 2 < SPECTRUM_HARMONICS) {
+            result->harmonic_pm[h - 2] = Spectrum_Ratio_pm(lobe, fundamental);
+        }
+    }
+    for (uint32_t h = 2; h < 2 + SPECTRUM_HARMONICS; h++) {
+        if ((int32_t)h * position_q10 >= (int32_t)(SPECTRUM_BINS - 1) * 1024) {
+            result->harmonic_pm[h - 2] = 0;
+        }
+    }
+    result->thd_pm = Spectrum_Ratio_pm(harmonics, fundamental);
+}
@@ -59,6 +59,19 @@ static uint8_t SSD1306_Buffer[SSD1306_BUFFER_SIZE];
 // Screen object
 static SSD1306_t SSD1306;
 
+// Set when ssd1306_UpdateArea() left a narrowed column/page window behind
+static uint8_t SSD1306_WindowNarrowed = 0;
+
+/* Set the horizontal addressing mode column and page window, resets the RAM pointer */
+static void ssd1306_SetWindow(uint8_t col_start, uint8_t col_end, uint8_t page_start, uint8_t page_end) {
+    ssd1306_WriteCommand(0x21); // Set Column Address
+    ssd1306_WriteCommand(col_start + SSD1306_X_OFFSET_LOWER + (SSD1306_X_OFFSET_UPPER << 4));
+    ssd1306_WriteCommand(col_end + SSD1306_X_OFFSET_LOWER + (SSD1306_X_OFFSET_UPPER << 4));
+    ssd1306_WriteCommand(0x22); // Set Page Address
+    ssd1306_WriteCommand(page_start);
+    ssd1306_WriteCommand(page_end);
+}
+
 /* Fills the Screenbuffer with values from a given buffer of a fixed length */
 SSD1306_Error_t ssd1306_FillBuffer(uint8_t* buf, uint32_t len) {
     SSD1306_Error_t ret = SSD1306_ERR;
@@ -173,11 +186,7 @@ void ssd1306_Init(void) {
 
 /* Fill the whole screen with the given color */
 void ssd1306_Fill(SSD1306_COLOR color) {
-    uint32_t i;
-
-    for(i = 0; i < sizeof(SSD1306_Buffer); i++) {
-        SSD1306_Buffer[i] = (color == Black) ? 0x00 : 0xFF;
-    }
+    memset(SSD1306_Buffer, (color == Black) ? 0x00 : 0xFF, sizeof(SSD1306_Buffer));
 }
 
 /* Write the screenbuffer with changed to the screen */
@@ -188,6 +197,11 @@ void ssd1306_UpdateScreen(void) {
     //  * 32px   ==  4 pages
     //  * 64px   ==  8 pages
     //  * 128px  ==  16 pages
+    if (SSD1306_WindowNarrowed) {
+        // A partial update moved the RAM pointer, start again from page 0 column 0
+        ssd1306_SetWindow(0, SSD1306_WIDTH - 1, 0, SSD1306_HEIGHT/8 - 1);
+        SSD1306_WindowNarrowed = 0;
+    }
     for(uint8_t i = 0; i < SSD1306_HEIGHT/8; i++) {
         ssd1306_WriteCommand(0xB0 + i); // Set the current RAM page address.
         ssd1306_WriteCommand(0x00 + SSD1306_X_OFFSET_LOWER);
@@ -196,6 +210,34 @@ void ssd1306_UpdateScreen(void) {
     }
 }
 
+/*
+ * Write a rectangular part of the screenbuffer to the screen
+ * x          => First column
+ * w          => Number of columns
+ * page_start => First RAM page (8 pixel rows)
+ * page_end   => Last RAM page, inclusive
+ *
+ * Uses the horizontal addressing mode window (0x21/0x22) so only w bytes per
+ * page go over the bus, e.g. a single strip-chart column on a 32px screen
+ * costs 4 data bytes instead of the 512 of ssd1306_UpdateScreen().
+ */
+void ssd1306_UpdateArea(uint8_t x, uint8_t w, uint8_t page_start, uint8_t page_end) {
+    if (w == 0 || x >= SSD1306_WIDTH || page_start > page_end || page_end >= SSD1306_HEIGHT/8) {
+        return;
+    }
+    if (x + w > SSD1306_WIDTH) {
+        w = SSD1306_WIDTH - x;
+    }
+
+    ssd1306_SetWindow(x, x + w - 1, page_start, page_end);
+    SSD1306_WindowNarrowed = 1;
+
+    // The window wraps to the next page after its last column
+    for(uint8_t i = page_start; i <= page_end; i++) {
+        ssd1306_WriteData(&SSD1306_Buffer[x + SSD1306_WIDTH*i], w);
+    }
+}
+
 /*
  * Draw one pixel in the screenbuffer
  * X => X Coordinate
@@ -256,6 +298,102 @@ char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color) {
     return ch;
 }
 
+/*
+ * Draw pre-rendered columns to the screen buffer, foreground and background
+ * x       => X Coordinate
+ * y       => Y Coordinate of the top row
+ * columns => w column masks, bit 0 is the top row
+ * h       => Column height in pixels (max 16)
+ * color   => Color of the set bits, clear bits get the opposite color
+ *
+ * Each column touches at most 3 buffer bytes instead of h ssd1306_DrawPixel()
+ * calls. The result is identical to drawing the same pixels one by one.
+ */
+void ssd1306_DrawColumns(uint8_t x, uint8_t y, const uint16_t* columns, uint8_t w, uint8_t h, SSD1306_COLOR color) {
+    uint8_t page = y / 8;
+    uint8_t shift = y % 8;
+    uint32_t mask = ((1UL << h) - 1) << shift;
+
+    for(uint8_t i = 0; i < w && (x + i) < SSD1306_WIDTH; i++) {
+        uint32_t bits = (uint32_t)columns[i] << shift;
+        if(color == Black) {
+            bits = ~bits & mask;
+        }
+
+        uint8_t* dst = &SSD1306_Buffer[x + i + page * SSD1306_WIDTH];
+        for(uint8_t p = page; p < SSD1306_HEIGHT/8 && (mask >> ((p - page) * 8)); p++) {
+            uint8_t m = (uint8_t)(mask >> ((p - page) * 8));
+            *dst = (*dst & ~m) | ((uint8_t)(bits >> ((p - page) * 8)) & m);
+            dst += SSD1306_WIDTH;
+        }
+    }
+}
+
+/*
+ * Pre-render the glyphs of a font subset into column masks
+ * cache   => Cache to initialize
+ * font    => Font to render, at most 16 pixels high
+ * charset => Characters to cache, must stay valid (e.g. a string literal)
+ * columns => Storage for strlen(charset) * font->FontWidth masks
+ */
+void ssd1306_GlyphCacheInit(SSD1306_GlyphCache* cache, const FontDef* font, const char* charset, uint16_t* columns) {
+    cache->font = font;
+    cache->charset = charset;
+    cache->columns = columns;
+    memset(cache->index, 0xFF, sizeof(cache->index));
+
+    for(uint8_t slot = 0; charset[slot] != '\0'; slot++) {
+        char ch = charset[slot];
+        if (ch < 32 || ch > 126) {
+            continue;
+        }
+        cache->index[ch - 32] = slot;
+
+        uint16_t* glyph = &columns[slot * font->FontWidth];
+        for(uint8_t j = 0; j < font->FontWidth; j++) {
+            uint16_t column = 0;
+            for(uint8_t i = 0; i < font->FontHeight; i++) {
+                if((font->data[(ch - 32) * font->FontHeight + i] << j) & 0x8000) {
+                    column |= 1 << i;
+                }
+            }
+            glyph[j] = column;
+        }
+    }
+}
+
+/*
+ * Write a string through a glyph cache, same result as ssd1306_WriteString()
+ * Characters that are not cached fall back to ssd1306_WriteChar().
+ */
+char ssd1306_WriteStringCached(const SSD1306_GlyphCache* cache, const char* str, SSD1306_COLOR color) {
+    const FontDef* font = cache->font;
+
+    while (*str) {
+        char ch = *str;
+        if (ch < 32 || ch > 126 ||
+            SSD1306_WIDTH < (SSD1306.CurrentX + font->FontWidth) ||
+            SSD1306_HEIGHT < (SSD1306.CurrentY + font->FontHeight)) {
+            // Char could not be written
+            return ch;
+        }
+
+        uint8_t slot = cache->index[ch - 32];
+        if (slot == 0xFF) {
+            ssd1306_WriteChar(ch, *font, color);
+        } else {
+            ssd1306_DrawColumns(SSD1306.CurrentX, SSD1306.CurrentY,
+                                &cache->columns[slot * font->FontWidth],
+                                font->FontWidth, font->FontHeight, color);
+            SSD1306.CurrentX += font->FontWidth;
+        }
+        str++;
+    }
+
+    // Everything ok
+    return *str;
+}
+
 /* Write full string to screenbuffer */
 char ssd1306_WriteString(char* str, FontDef Font, SSD1306_COLOR color) {
     while (*str) {
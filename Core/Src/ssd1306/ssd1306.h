@@ -139,10 +139,22 @@ typedef struct {
     uint8_t y;
 } SSD1306_VERTEX;
 
+// Number of printable characters a glyph cache can index (' ' to '~')
+#define SSD1306_GLYPH_RANGE     95
+
+// Pre-rendered column masks for a subset of a font, see ssd1306_GlyphCacheInit()
+typedef struct {
+    const FontDef* font;
+    const char* charset;                    // Cached characters
+    uint16_t* columns;                      // strlen(charset) * FontWidth column masks, bit 0 = top row
+    uint8_t index[SSD1306_GLYPH_RANGE];     // Character -> slot in charset, 0xFF if not cached
+} SSD1306_GlyphCache;
+
 // Procedure definitions
 void ssd1306_Init(void);
 void ssd1306_Fill(SSD1306_COLOR color);
 void ssd1306_UpdateScreen(void);
+void ssd1306_UpdateArea(uint8_t x, uint8_t w, uint8_t page_start, uint8_t page_end);
 void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color);
 char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color);
 char ssd1306_WriteString(char* str, FontDef Font, SSD1306_COLOR color);
@@ -155,6 +167,9 @@ void ssd1306_FillCircle(uint8_t par_x,uint8_t par_y,uint8_t par_r,SSD1306_COLOR
 void ssd1306_Polyline(const SSD1306_VERTEX *par_vertex, uint16_t par_size, SSD1306_COLOR color);
 void ssd1306_DrawRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color);
 void ssd1306_FillRectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, SSD1306_COLOR color);
+void ssd1306_DrawColumns(uint8_t x, uint8_t y, const uint16_t* columns, uint8_t w, uint8_t h, SSD1306_COLOR color);
+void ssd1306_GlyphCacheInit(SSD1306_GlyphCache* cache, const FontDef* font, const char* charset, uint16_t* columns);
+char ssd1306_WriteStringCached(const SSD1306_GlyphCache* cache, const char* str, SSD1306_COLOR color);
 void ssd1306_DrawBitmap(uint8_t x, uint8_t y, const unsigned char* bitmap, uint8_t w, uint8_t h, SSD1306_COLOR color);
 
 /**
@@ -105,6 +105,14 @@ void HAL_ADC_MspInit(ADC_HandleTypeDef* hadc)
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
     /* USER CODE BEGIN ADC1_MspInit 1 */
+    /* ADC1 interrupt Init, analog watchdog trip above the sampling tick */
+    HAL_NVIC_SetPriority(ADC1_COMP_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(ADC1_COMP_IRQn);
+
+    /* DMA1 channel 1, burst captures streamed from the ADC */
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 2, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
 
     /* USER CODE END ADC1_MspInit 1 */
 
@@ -135,6 +143,8 @@ void HAL_ADC_MspDeInit(ADC_HandleTypeDef* hadc)
     HAL_GPIO_DeInit(GPIOA, CURRENT_IN_Pin|VOLTAGE_IN_Pin);
 
     /* USER CODE BEGIN ADC1_MspDeInit 1 */
+    HAL_NVIC_DisableIRQ(ADC1_COMP_IRQn);
+    HAL_NVIC_DisableIRQ(DMA1_Channel1_IRQn);
 
     /* USER CODE END ADC1_MspDeInit 1 */
   }
@@ -290,6 +300,9 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
     /* USER CODE BEGIN USART1_MspInit 1 */
+    /* USART1 interrupt Init */
+    HAL_NVIC_SetPriority(USART1_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(USART1_IRQn);
 
     /* USER CODE END USART1_MspInit 1 */
 
@@ -320,6 +333,7 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* huart)
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_9|GPIO_PIN_10);
 
     /* USER CODE BEGIN USART1_MspDeInit 1 */
+    HAL_NVIC_DisableIRQ(USART1_IRQn);
 
     /* USER CODE END USART1_MspDeInit 1 */
   }
@@ -328,4 +342,51 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* huart)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief TIM_Encoder MSP Initialization
+  * This function configures the hardware resources used in this example
+  * @param htim_encoder: TIM_Encoder handle pointer
+  * @retval None
+  */
+void HAL_TIM_Encoder_MspInit(TIM_HandleTypeDef* htim_encoder)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+  if(htim_encoder->Instance==TIM22)
+  {
+    /* Peripheral clock enable */
+    __HAL_RCC_TIM22_CLK_ENABLE();
+
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    /**TIM22 GPIO Configuration
+    PB4     ------> TIM22_CH1 (ROT_CHB)
+    PB5     ------> TIM22_CH2 (ROT_CHA)
+    */
+    GPIO_InitStruct.Pin = ROT_CHB_Pin|ROT_CHA_Pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    GPIO_InitStruct.Alternate = GPIO_AF4_TIM22;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+  }
+
+}
+
+/**
+  * @brief TIM_Encoder MSP De-Initialization
+  * This function freeze the hardware resources used in this example
+  * @param htim_encoder: TIM_Encoder handle pointer
+  * @retval None
+  */
+void HAL_TIM_Encoder_MspDeInit(TIM_HandleTypeDef* htim_encoder)
+{
+  if(htim_encoder->Instance==TIM22)
+  {
+    /* Peripheral clock disable */
+    __HAL_RCC_TIM22_CLK_DISABLE();
+
+    HAL_GPIO_DeInit(GPIOB, ROT_CHB_Pin|ROT_CHA_Pin);
+  }
+
+}
+
 /* USER CODE END 1 */
@@ -0,0 +1,109 @@
+/**
+  ******************************************************************************
+  * @file           : timebase.c
+  * @brief          : Microsecond timebase from TIM2 and a software overflow count
+  ******************************************************************************
+  */
+
+#include "timebase.h"
+
+#define TIMEBASE_WRAP_MS        65U      // One 16-bit wrap is 65 ms ...
+#define TIMEBASE_WRAP_REM_US    536U     // ... and 536 us
+
+static TIM_TypeDef* timebase_timer = NULL;
+static volatile uint32_t timebase_overflows = 0;
+// The overflow count in ms plus the us remainder, so that the millisecond
+// clock needs no 64-bit division in the input interrupts
+static volatile uint32_t timebase_ms = 0;
+static volatile uint16_t timebase_rem_us = 0;
+
+/**
+  * @brief  Start counting
+  * @param  htim Initialized 1 MHz, 16-bit full range timer
+  */
+void Timebase_Init(TIM_HandleTypeDef* htim)
+{
+    timebase_timer = htim->Instance;
+    timebase_overflows = 0;
+    timebase_ms = 0;
+    timebase_rem_us = 0;
+    HAL_TIM_Base_Start_IT(htim);
+}
+
+/**
+  * @brief  Count an overflow, call from the timer interrupt
+  */
+void Timebase_IRQHandler(void)
+{
+    if (timebase_timer->SR & TIM_SR_UIF) {
+        timebase_timer->SR = (uint32_t)~TIM_SR_UIF;
+        timebase_overflows++;
+
+        uint16_t rem = timebase_rem_us + TIMEBASE_WRAP_REM_US;
+        uint32_t ms = timebase_ms + TIMEBASE_WRAP_MS;
+        if (rem >= 1000U) {
+            rem -= 1000U;
+            ms++;
+        }
+        timebase_rem_us = rem;
+        timebase_ms = ms;
+    }
+}
+
+/**
+  * @brief  Microseconds since Timebase_Init()
+  */
+uint64_t Timebase_Now_us64(void)
+{
+    if (timebase_timer == NULL) {
+        return 0;   // Edge interrupts may fire before Timebase_Init()
+    }
+
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    uint32_t high = timebase_overflows;
+    uint32_t count = timebase_timer->CNT;
+    // Overflow not counted by the interrupt yet, re-read after the wrap
+    if (timebase_timer->SR & TIM_SR_UIF) {
+        high++;
+        count = timebase_timer->CNT;
+    }
+    __set_PRIMASK(primask);
+
+    return ((uint64_t)high << 16) | (count & 0xFFFFU);
+}
+
+/**
+  * @brief  Microseconds, wraps after about 71 minutes (use differences)
+  */
+uint32_t Timebase_Now_us(void)
+{
+    return (uint32_t)Timebase_Now_us64();
+}
+
+/**
+  * @brief  Milliseconds, wraps after about 49 days (use differences)
+  */
+uint32_t Timebase_Now_ms(void)
+{
+    if (timebase_timer == NULL) {
+        return 0;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    uint32_t ms = timebase_ms;
+    uint32_t us = timebase_rem_us;
+    uint32_t count = timebase_timer->CNT;
+    if (timebase_timer->SR & TIM_SR_UIF) {
+        ms += TIMEBASE_WRAP_MS;
+        us += TIMEBASE_WRAP_REM_US;
+        count = timebase_timer->CNT;
+    }
+    __set_PRIMASK(primask);
+
+    // Same value as Timebase_Now_us64() / 1000, with a 32-bit division
+    return ms + (us + (count & 0xFFFFU)) / 1000U;
+}
@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file           : display_power.c
+  * @brief          : OLED auto-dim and auto-off scheduler
+  ******************************************************************************
+  */
+
+#include "display_power.h"
+#include "../ssd1306/ssd1306.h"
+
+static const Display_Power_Config_t* display_config = NULL;
+static uint8_t display_on = 1;
+static uint8_t display_contrast = 0xFF;     // Contrast last sent to the panel
+
+/**
+  * @brief  Full contrast for the configured brightness
+  */
+static uint8_t Display_Power_Full_Contrast(void)
+{
+    uint16_t pct = display_config->brightness_pct;
+
+    if (pct > 100) pct = 100;
+    return (uint8_t)((pct * 255U) / 100U);
+}
+
+/**
+  * @brief  Send a contrast value if it differs from the panel's
+  */
+static void Display_Power_Set_Contrast(uint8_t contrast)
+{
+    if (contrast != display_contrast) {
+        ssd1306_SetContrast(contrast);
+        display_contrast = contrast;
+    }
+}
+
+/**
+  * @brief  Start with the panel on at the configured brightness
+  * @param  config Settings, read every frame so edits apply at once
+  */
+void Display_Power_Init(const Display_Power_Config_t* config)
+{
+    display_config = config;
+    display_on = 1;
+    display_contrast = 0xFF;    // Set by ssd1306_Init()
+    Display_Power_Set_Contrast(Display_Power_Full_Contrast());
+}
+
+/**
+  * @brief  Advance the dim / off schedule by one frame
+  * @param  idle_ms Time since the last user input
+  * @retval 1 if the panel is on and the frame should be rendered
+  */
+uint8_t Display_Power_Update(uint32_t idle_ms)
+{
+    uint32_t dim_ms = (uint32_t)display_config->dim_after_s * 1000;
+    uint32_t off_ms = (uint32_t)display_config->off_after_s * 1000;
+    uint8_t full = Display_Power_Full_Contrast();
+
+    if (!display_on) {
+        return 0;
+    }
+
+    if (off_ms != 0 && idle_ms >= off_ms) {
+        ssd1306_SetDisplayOn(0);
+        display_on = 0;
+        return 0;
+    }
+
+    if (dim_ms != 0 && idle_ms >= dim_ms) {
+        uint8_t dimmed = full / DISPLAY_DIM_DIVISOR;
+
+        if (display_contrast > dimmed + DISPLAY_FADE_STEP) {
+            Display_Power_Set_Contrast(display_contrast - DISPLAY_FADE_STEP);
+        } else {
+            Display_Power_Set_Contrast(dimmed);
+        }
+    } else {
+        Display_Power_Set_Contrast(full);
+    }
+    return 1;
+}
+
+/**
+  * @brief  Restore full brightness after user input
+  * @retval 1 if the panel was off, so the input only woke it up
+  */
+uint8_t Display_Power_Wake(void)
+{
+    Display_Power_Set_Contrast(Display_Power_Full_Contrast());
+
+    if (display_on) {
+        return 0;
+    }
+    ssd1306_SetDisplayOn(1);
+    display_on = 1;
+    return 1;
+}
@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file           : display_power.h
+  * @brief          : OLED auto-dim and auto-off scheduler
+  ******************************************************************************
+  * @attention
+  *
+  * Display_Power_Update() runs once per frame with the time since the last
+  * user input. After dim_after_s the contrast fades in steps of
+  * DISPLAY_FADE_STEP per frame down to a quarter of the set brightness;
+  * after off_after_s the panel is switched off and the caller stops
+  * rendering, so the framebuffer is no longer flushed over I2C. The panel
+  * keeps its RAM while off, so Display_Power_Wake() only has to switch it
+  * back on at full brightness, and the next frame redraws what changed.
+  *
+  * A timeout of 0 disables that stage.
+  ******************************************************************************
+  */
+
+#ifndef __DISPLAY_POWER_H
+#define __DISPLAY_POWER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define DISPLAY_FADE_STEP       16       // Contrast change per frame while dimming
+#define DISPLAY_DIM_DIVISOR     4        // Dimmed contrast = brightness / divisor
+
+// User settings, edited in place by the settings menu
+typedef struct {
+    uint16_t brightness_pct;    // 10..100
+    uint16_t dim_after_s;       // Idle time before dimming, 0 = never
+    uint16_t off_after_s;       // Idle time before switching off, 0 = never
+} Display_Power_Config_t;
+
+void Display_Power_Init(const Display_Power_Config_t* config);
+uint8_t Display_Power_Update(uint32_t idle_ms);
+uint8_t Display_Power_Wake(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DISPLAY_POWER_H */
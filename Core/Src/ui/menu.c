@@ -0,0 +1,266 @@
+/**
+  ******************************************************************************
+  * @file           : menu.c
+  * @brief          : Table-driven hierarchical menu engine
+  ******************************************************************************
+  */
+
+#include "menu.h"
+#include "format.h"
+
+// Engine state, independent of the size of the menu tree
+static const Menu_Page_t* menu_root = NULL;
+static const Menu_Page_t* menu_main = NULL;
+static const Menu_Page_t* menu_page = NULL;
+static uint8_t menu_selection = 0;
+static uint8_t menu_editing = 0;
+
+/* Generic list screen -------------------------------------------------------*/
+static const char* Menu_Title(void)
+{
+    return menu_page->title;
+}
+
+static uint8_t Menu_Item_Count(void)
+{
+    return menu_page->count;
+}
+
+static uint8_t Menu_Selection(void)
+{
+    return menu_selection;
+}
+
+/**
+  * @brief  Item text of the current page, value items show their value
+  * @param  index Item index
+  * @param  dst Output buffer (21 chars)
+  */
+static void Menu_Item_Text(uint8_t index, char* dst)
+{
+    const Menu_Item_t* item = &menu_page->items[index];
+
+    dst = Format_String(dst, item->label);
+    if (item->type == MENU_ITEM_VALUE) {
+        uint8_t editing = menu_editing && index == menu_selection;
+        dst = Format_String(dst, editing ? " [" : " ");
+        dst = Format_Fixed(dst, *item->editor->value, item->editor->decimals, 0);
+        dst = Format_String(dst, (item->editor->unit != NULL) ? item->editor->unit : "");
+        Format_String(dst, editing ? "]" : "");
+    }
+}
+
+/**
+  * @brief  Retained value of the list, changes with selection, edit mode and value
+  */
+static int32_t Menu_List_State(void)
+{
+    int32_t state = menu_selection | (menu_editing << 7);
+    const Menu_Item_t* item = &menu_page->items[menu_selection];
+
+    if (item->type == MENU_ITEM_VALUE) {
+        state |= (int32_t)*item->editor->value << 8;
+    }
+    return state;
+}
+
+static const UI_ListSource_t menu_list_source = {
+    .count = Menu_Item_Count,
+    .text = Menu_Item_Text,
+    .selection = Menu_Selection
+};
+
+static const UI_Widget_t menu_list_widgets[] = {
+    { .type = UI_LABEL, .x = 0, .y = 0, .width = 128, .font = &Font_6x8, .text_fn = Menu_Title },
+    { .type = UI_LIST,  .x = 0, .y = 8, .width = 114, .font = &Font_6x8, .get = Menu_List_State,
+      .list = &menu_list_source, .rows = 3, .row_height = 8 },
+};
+
+static const UI_Screen_t menu_list_screen = UI_SCREEN(menu_list_widgets);
+
+/* Navigation ----------------------------------------------------------------*/
+/**
+  * @brief  Open a page
+  * @param  page Page to show
+  * @param  selection Initial selection
+  */
+static void Menu_Open(const Menu_Page_t* page, uint8_t selection)
+{
+    menu_page = page;
+    menu_selection = (selection < page->count) ? selection : 0;
+    menu_editing = 0;
+    UI_Invalidate();
+}
+
+/**
+  * @brief  Return to the parent page, selecting the item that leads here
+  */
+static void Menu_Open_Parent(void)
+{
+    const Menu_Page_t* child = menu_page;
+    const Menu_Page_t* parent = child->parent;
+    uint8_t selection = 0;
+
+    if (parent == NULL) {
+        return;
+    }
+    for (uint8_t i = 0; i < parent->count; i++) {
+        if (parent->items[i].type == MENU_ITEM_PAGE && parent->items[i].target == child) {
+            selection = i;
+            break;
+        }
+    }
+    Menu_Open(parent, selection);
+}
+
+/**
+  * @brief  Initialize the engine on the root view
+  * @param  root Page shown at boot and after timeouts
+  * @param  main_menu Page opened by a long press on the root
+  */
+void Menu_Init(const Menu_Page_t* root, const Menu_Page_t* main_menu)
+{
+    menu_root = root;
+    menu_main = main_menu;
+    Menu_Open(root, 0);
+}
+
+/**
+  * @brief  Handle an encoder step
+  * @param  direction Steps, positive for clockwise, accelerated by the decoder
+  */
+void Menu_Navigate(int8_t direction)
+{
+    if (menu_page->count == 0) {
+        if (menu_page->navigate != NULL) {
+            menu_page->navigate(direction);
+        }
+        return;
+    }
+
+    if (menu_editing) {
+        const Menu_Value_t* editor = menu_page->items[menu_selection].editor;
+        int32_t value = (int32_t)*editor->value + (int32_t)direction * editor->step;
+
+        if (value < editor->min) value = editor->min;
+        if (value > editor->max) value = editor->max;
+        *editor->value = (uint16_t)value;
+        return;
+    }
+
+    // Lists move one item per detent, acceleration only applies to values
+    int16_t selection = (int16_t)menu_selection + ((direction > 0) ? 1 : -1);
+    while (selection < 0) {
+        selection += menu_page->count;
+    }
+    menu_selection = (uint8_t)(selection % menu_page->count);
+}
+
+/**
+  * @brief  Handle a short press
+  */
+void Menu_Select(void)
+{
+    if (menu_page->count == 0) {
+        if (menu_page->select != NULL) {
+            menu_page->select();
+        } else {
+            Menu_Open_Parent();
+        }
+        return;
+    }
+
+    const Menu_Item_t* item = &menu_page->items[menu_selection];
+
+    switch (item->type) {
+        case MENU_ITEM_PAGE:
+            if (item->action != NULL) item->action();
+            Menu_Open(item->target, 0);
+            break;
+
+        case MENU_ITEM_BACK:
+            if (item->action != NULL) item->action();
+            Menu_Open_Parent();
+            break;
+
+        case MENU_ITEM_ACTION:
+            if (item->action != NULL) item->action();
+            break;
+
+        case MENU_ITEM_VALUE:
+            menu_editing = !menu_editing;
+            if (!menu_editing && item->action != NULL) {
+                item->action();
+            }
+            break;
+    }
+}
+
+/**
+  * @brief  Handle a long press: root view opens the main menu, anything else goes home
+  */
+void Menu_Home(void)
+{
+    if (menu_page == menu_root) {
+        Menu_Open(menu_main, 0);
+    } else {
+        Menu_Go_Root();
+    }
+}
+
+/**
+  * @brief  Go up one level, or end value editing when a value is being edited
+  */
+void Menu_Back(void)
+{
+    if (menu_editing) {
+        const Menu_Item_t* item = &menu_page->items[menu_selection];
+
+        menu_editing = 0;
+        if (item->action != NULL) {
+            item->action();
+        }
+        return;
+    }
+    Menu_Open_Parent();
+}
+
+/**
+  * @brief  Return to the root view
+  */
+void Menu_Go_Root(void)
+{
+    Menu_Open(menu_root, 0);
+}
+
+/**
+  * @brief  Check if the root view is shown
+  */
+uint8_t Menu_At_Root(void)
+{
+    return menu_page == menu_root;
+}
+
+/**
+  * @brief  Check if a value editor is active
+  */
+uint8_t Menu_Is_Editing(void)
+{
+    return menu_editing;
+}
+
+/**
+  * @brief  Current page
+  */
+const Menu_Page_t* Menu_Get_Page(void)
+{
+    return menu_page;
+}
+
+/**
+  * @brief  Widget screen of the current page
+  */
+const UI_Screen_t* Menu_Get_Screen(void)
+{
+    return (menu_page->screen != NULL) ? menu_page->screen : &menu_list_screen;
+}
@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file           : menu.h
+  * @brief          : Table-driven hierarchical menu engine
+  ******************************************************************************
+  * @attention
+  *
+  * The menu tree is made of const Menu_Page_t / Menu_Item_t tables that
+  * live in flash. A page either lists items (rendered by the generic list
+  * screen of the engine) or shows its own widget screen (a "view" page such
+  * as the power meter). The engine state is a page pointer, a selection and
+  * an edit flag, so adding pages costs flash only.
+  *
+  * Input mapping:
+  * - Menu_Navigate(): encoder steps, moves the selection or edits a value,
+  *                    on a view page goes to its navigate handler if any
+  * - Menu_Select():   short press, opens / runs / toggles editing, or
+  *                    on a view page goes to its select handler if any,
+  *                    else leaves it to its parent
+  * - Menu_Home():     long press, root view <-> main menu
+  * - Menu_Back():     one level up, or ends value editing
+  ******************************************************************************
+  */
+
+#ifndef __MENU_H
+#define __MENU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "ui.h"
+
+typedef enum {
+    MENU_ITEM_PAGE = 0,     // Run action, then open target
+    MENU_ITEM_BACK,         // Run action, then return to the parent page
+    MENU_ITEM_ACTION,       // Run action, stay on the page
+    MENU_ITEM_VALUE         // Short press toggles editing of a value
+} Menu_ItemType_t;
+
+// Integer value editor, value shown with decimals as fixed point
+typedef struct {
+    uint16_t* value;
+    uint16_t min;
+    uint16_t max;
+    uint16_t step;
+    uint8_t decimals;
+    const char* unit;
+} Menu_Value_t;
+
+typedef struct Menu_Page Menu_Page_t;
+
+typedef struct {
+    const char* label;
+    Menu_ItemType_t type;
+    const Menu_Page_t* target;      // MENU_ITEM_PAGE destination
+    void (*action)(void);           // Optional, for MENU_ITEM_VALUE run when editing ends
+    const Menu_Value_t* editor;     // MENU_ITEM_VALUE
+} Menu_Item_t;
+
+struct Menu_Page {
+    const char* title;
+    const Menu_Item_t* items;
+    uint8_t count;
+    const Menu_Page_t* parent;
+    const UI_Screen_t* screen;      // View page widgets, NULL for a list page
+    void (*navigate)(int8_t direction); // Optional encoder handler of a view page
+    void (*select)(void);           // Optional short press handler of a view page
+};
+
+// Build the items/count pair of a Menu_Page_t from an item array
+#define MENU_ITEMS(items)       (items), sizeof(items) / sizeof((items)[0])
+
+void Menu_Init(const Menu_Page_t* root, const Menu_Page_t* main_menu);
+void Menu_Navigate(int8_t direction);
+void Menu_Select(void);
+void Menu_Home(void);
+void Menu_Back(void);
+void Menu_Go_Root(void);
+uint8_t Menu_At_Root(void);
+uint8_t Menu_Is_Editing(void);
+const Menu_Page_t* Menu_Get_Page(void);
+const UI_Screen_t* Menu_Get_Screen(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MENU_H */
@@ -0,0 +1,212 @@
+/**
+  ******************************************************************************
+  * @file           : ui.c
+  * @brief          : Retained-mode widget layer for the SSD1306 menu screens
+  ******************************************************************************
+  */
+
+#include "ui.h"
+#include "format.h"
+
+// Retained state of the screen currently shown
+static const UI_Screen_t* ui_screen = NULL;
+static uint8_t ui_invalid = 1;
+static int32_t ui_last_value[UI_MAX_WIDGETS];
+
+/**
+  * @brief  Read the value bound to a widget as fixed point
+  * @param  widget Widget to read
+  * @retval Bound value, scaled for number widgets
+  */
+static int32_t UI_Read_Value(const UI_Widget_t* widget)
+{
+    if (widget->get != NULL) {
+        return widget->get();
+    }
+    if (widget->source == NULL) {
+        return 0;
+    }
+    if (widget->source_type == UI_SOURCE_U8) {
+        return *(const volatile uint8_t*)widget->source;
+    }
+    return (int32_t)(*(const volatile float*)widget->source * widget->scale);
+}
+
+/**
+  * @brief  Write a string, padded with spaces to the widget width
+  * @param  widget Widget providing font and region
+  * @param  str Text to write, must have room for the padding
+  */
+static void UI_Write_Text(const UI_Widget_t* widget, char* str)
+{
+    char* end = str;
+    uint8_t chars = widget->width / widget->font->FontWidth;
+
+    while (*end) {
+        end++;
+    }
+    while ((uint8_t)(end - str) < chars) {
+        *end++ = ' ';
+    }
+    *end = '\0';
+
+    if (widget->glyphs != NULL) {
+        ssd1306_WriteStringCached(widget->glyphs, str, White);
+    } else {
+        ssd1306_WriteString(str, *widget->font, White);
+    }
+}
+
+/**
+  * @brief  Draw a list widget with its scroll window and arrows
+  * @param  widget List widget
+  */
+static void UI_Draw_List(const UI_Widget_t* widget)
+{
+    uint8_t count = widget->list->count();
+    uint8_t selection = widget->list->selection();
+    uint8_t start_item = 0;
+
+    if (count > widget->rows && selection >= 2) {
+        start_item = selection - 1;
+        if (start_item > count - widget->rows) {
+            start_item = count - widget->rows;
+        }
+    }
+
+    for (uint8_t i = 0; i < widget->rows && (start_item + i) < count; i++) {
+        uint8_t item_index = start_item + i;
+        char display_line[23];
+
+        display_line[0] = (item_index == selection) ? '>' : ' ';
+        widget->list->text(item_index, &display_line[1]);
+
+        ssd1306_SetCursor(widget->x, widget->y + (i * widget->row_height));
+        UI_Write_Text(widget, display_line);
+    }
+
+    if (start_item > 0) {
+        ssd1306_SetCursor(120, widget->y);
+        ssd1306_WriteString("^", Font_6x8, White);
+    }
+    if (start_item + widget->rows < count) {
+        ssd1306_SetCursor(120, widget->y + (widget->rows - 1) * widget->row_height);
+        ssd1306_WriteString("v", Font_6x8, White);
+    }
+}
+
+/**
+  * @brief  Draw one widget into the screen buffer
+  * @param  widget Widget to draw
+  * @param  value Current bound value
+  */
+static void UI_Draw_Widget(const UI_Widget_t* widget, int32_t value)
+{
+    char text[23];
+    char* p;
+
+    switch (widget->type) {
+        case UI_LABEL:
+            ssd1306_SetCursor(widget->x, widget->y);
+            Format_String(text, (widget->text_fn != NULL) ? widget->text_fn() : widget->text);
+            UI_Write_Text(widget, text);
+            break;
+
+        case UI_NUMBER:
+            p = Format_String(text, (widget->text != NULL) ? widget->text : "");
+            if (widget->format != NULL) {
+                p = widget->format(p, value);
+            } else {
+                p = Format_Fixed(p, value, widget->decimals, 0);
+            }
+            Format_String(p, (widget->unit != NULL) ? widget->unit : "");
+            ssd1306_SetCursor(widget->x, widget->y);
+            UI_Write_Text(widget, text);
+            break;
+
+        case UI_LIST:
+            UI_Draw_List(widget);
+            break;
+
+        case UI_GRAPH:
+            break;
+    }
+}
+
+/**
+  * @brief  Send the region of a widget to the OLED
+  * @param  widget Widget whose region changed
+  */
+static void UI_Flush_Widget(const UI_Widget_t* widget)
+{
+    uint8_t height = widget->font->FontHeight;
+
+    if (widget->type == UI_LIST) {
+        height = widget->rows * widget->row_height;
+        // Scroll arrows live at the right edge
+        ssd1306_UpdateArea(widget->x, SSD1306_WIDTH - widget->x,
+                           widget->y / 8, (widget->y + height - 1) / 8);
+        return;
+    }
+
+    ssd1306_UpdateArea(widget->x, widget->width, widget->y / 8, (widget->y + height - 1) / 8);
+}
+
+/**
+  * @brief  Force a full repaint on the next UI_Render()
+  */
+void UI_Invalidate(void)
+{
+    ui_invalid = 1;
+}
+
+/**
+  * @brief  Render a screen, redrawing only widgets whose value changed
+  * @param  screen Screen table to show
+  */
+void UI_Render(const UI_Screen_t* screen)
+{
+    uint8_t count = (screen->count < UI_MAX_WIDGETS) ? screen->count : UI_MAX_WIDGETS;
+
+    if (screen != ui_screen || ui_invalid) {
+        ui_screen = screen;
+        ui_invalid = 0;
+
+        ssd1306_Fill(Black);
+        for (uint8_t i = 0; i < count; i++) {
+            const UI_Widget_t* widget = &screen->widgets[i];
+            ui_last_value[i] = UI_Read_Value(widget);
+            if (widget->type == UI_GRAPH) {
+                widget->draw(1);
+            } else {
+                UI_Draw_Widget(widget, ui_last_value[i]);
+            }
+        }
+        ssd1306_UpdateScreen();
+        return;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        const UI_Widget_t* widget = &screen->widgets[i];
+
+        if (widget->type == UI_GRAPH) {
+            widget->draw(0);
+            continue;
+        }
+        if (widget->type == UI_LABEL) {
+            continue;
+        }
+
+        int32_t value = UI_Read_Value(widget);
+        if (value != ui_last_value[i]) {
+            ui_last_value[i] = value;
+            if (widget->type == UI_LIST) {
+                // Rows shift when scrolling, clear the whole list area
+                ssd1306_FillRectangle(widget->x, widget->y, SSD1306_WIDTH - 1,
+                                      widget->y + widget->rows * widget->row_height - 1, Black);
+            }
+            UI_Draw_Widget(widget, value);
+            UI_Flush_Widget(widget);
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @file           : ui.h
+  * @brief          : Retained-mode widget layer for the SSD1306 menu screens
+  ******************************************************************************
+  * @attention
+  *
+  * A screen is a const table of widgets placed in flash. UI_Render() keeps
+  * the last rendered value of every widget and only redraws, and sends to
+  * the OLED, the widgets whose bound value changed. Switching to another
+  * screen or calling UI_Invalidate() repaints the whole frame once.
+  *
+  * Widgets:
+  * - UI_LABEL  : text, drawn once per invalidation
+  * - UI_NUMBER : prefix + bound value as fixed point + unit
+  * - UI_LIST   : scrolling selection list, items come from a UI_ListSource_t
+  * - UI_GRAPH  : custom renderer called every frame, flushes its own area
+  ******************************************************************************
+  */
+
+#ifndef __UI_H
+#define __UI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "../ssd1306/ssd1306.h"
+
+// Widgets per screen, sizes the retained state
+#define UI_MAX_WIDGETS          8
+
+typedef enum {
+    UI_LABEL = 0,
+    UI_NUMBER,
+    UI_LIST,
+    UI_GRAPH
+} UI_WidgetType_t;
+
+typedef enum {
+    UI_SOURCE_FLOAT = 0,     // source points to a float
+    UI_SOURCE_U8             // source points to a uint8_t
+} UI_Source_t;
+
+// Items of a list widget
+typedef struct {
+    uint8_t (*count)(void);                         // Number of items
+    void (*text)(uint8_t index, char* dst);         // Item text, max 20 chars
+    uint8_t (*selection)(void);                     // Selected item
+} UI_ListSource_t;
+
+// Word sized members first, byte sized last: the flash tables carry no
+// padding between the fields
+typedef struct {
+    const FontDef* font;
+    const SSD1306_GlyphCache* glyphs;       // Optional pre-rendered glyphs of font
+    const char* text;                       // Label text or number prefix
+    const char* (*text_fn)(void);           // Label text provider, instead of text
+    const char* unit;                       // Number suffix
+    const volatile void* source;            // Bound value
+    int32_t (*get)(void);                   // Value getter, instead of source
+    float scale;                            // Float source multiplier to fixed point
+    char* (*format)(char* dst, int32_t value);  // Optional custom number formatter
+    const UI_ListSource_t* list;            // List items, change tracked through get
+    void (*draw)(uint8_t full);             // Graph renderer, full = 1 on invalidation
+    UI_WidgetType_t type;
+    UI_Source_t source_type;
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;                          // Region width in pixels, cleared on redraw
+    uint8_t decimals;                       // Fixed point decimals
+    uint8_t rows;                           // List visible rows
+    uint8_t row_height;                     // List row spacing in pixels
+} UI_Widget_t;
+
+typedef struct {
+    const UI_Widget_t* widgets;
+    uint8_t count;
+} UI_Screen_t;
+
+// Build a UI_Screen_t from a widget array
+#define UI_SCREEN(widgets)      { (widgets), sizeof(widgets) / sizeof((widgets)[0]) }
+
+void UI_Invalidate(void);
+void UI_Render(const UI_Screen_t* screen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UI_H */
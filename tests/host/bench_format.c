@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file           : bench_format.c
+  * @brief          : Time the integer formatter against snprintf on the host
+  ******************************************************************************
+  * @attention
+  *
+  * Formats the status lines of the power screen both ways with the same
+  * integer inputs. Host timings only rank the two, they are not
+  * Cortex-M0+ cycle counts.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "format.h"
+
+#define BENCH_LINES     1000000
+
+static volatile uint32_t bench_sink;
+
+static double Bench_Now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void Line_Format(char* line, int32_t voltage_dv, int32_t current_ca, uint32_t energy_mwh)
+{
+    char* p = line;
+
+    p = Format_String(p, "V:");
+    p = Format_Fixed(p, voltage_dv, 1, 0);
+    p = Format_String(p, "V  I:");
+    p = Format_Fixed(p, current_ca, 2, 0);
+    p = Format_String(p, "A E:");
+    Format_Energy(p, energy_mwh);
+}
+
+static void Line_Snprintf(char* line, int32_t voltage_dv, int32_t current_ca, uint32_t energy_mwh)
+{
+    int n = snprintf(line, 32, "V:%ld.%ldV  I:%ld.%02ldA E:", (long)(voltage_dv / 10),
+                     (long)(voltage_dv % 10), (long)(current_ca / 100), (long)(current_ca % 100));
+
+    if (energy_mwh < 1000UL) {
+        snprintf(line + n, 32 - n, "%lumWh", (unsigned long)energy_mwh);
+    } else if (energy_mwh < 1000000UL) {
+        snprintf(line + n, 32 - n, "%lu.%02luWh", (unsigned long)(energy_mwh / 1000),
+                 (unsigned long)(energy_mwh / 10 % 100));
+    } else {
+        snprintf(line + n, 32 - n, "%lu.%03lukWh", (unsigned long)(energy_mwh / 1000000),
+                 (unsigned long)(energy_mwh / 1000 % 1000));
+    }
+}
+
+static double Bench_Run(void (*format)(char*, int32_t, int32_t, uint32_t))
+{
+    char line[32];
+    double start = Bench_Now_ns();
+
+    for (uint32_t i = 0; i < BENCH_LINES; i++) {
+        format(line, 120 + (int32_t)(i & 127), (int32_t)(i & 511), i * 37U);
+        bench_sink += (uint8_t)line[9];
+    }
+    return (Bench_Now_ns() - start) / BENCH_LINES;
+}
+
+int main(void)
+{
+    char a[32], b[32];
+
+    // Both produce the same text for the positive values the old code handled
+    Line_Format(a, 123, 105, 1234567);
+    Line_Snprintf(b, 123, 105, 1234567);
+    if (strcmp(a, b) != 0) {
+        printf("mismatch: \"%s\" vs \"%s\"\n", a, b);
+        return 1;
+    }
+
+    double format_ns = Bench_Run(Line_Format);
+    double snprintf_ns = Bench_Run(Line_Snprintf);
+    printf("status line \"%s\"\n", a);
+    printf("Format_*  %6.1f ns/line\n", format_ns);
+    printf("snprintf  %6.1f ns/line  (%.1fx)\n", snprintf_ns, snprintf_ns / format_ns);
+    return 0;
+}
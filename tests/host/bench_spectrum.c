@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file           : bench_spectrum.c
+  * @brief          : Time the Q15 FFT and the spectrum analysis on the host
+  ******************************************************************************
+  * @attention
+  *
+  * Runs the transform alone and the whole analysis on a frame of ADC codes
+  * with harmonics. Host timings only compare versions of spectrum.c, they
+  * are not Cortex-M0+ cycle counts.
+  ******************************************************************************
+  */
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include "spectrum.h"
+
+#define BENCH_FRAMES    200000
+#define BUTTERFLIES     (SPECTRUM_N / 2 * SPECTRUM_LOG2_N)
+
+static volatile uint32_t bench_sink;
+static int16_t frame[SPECTRUM_N];
+
+static double Bench_Now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static double Bench_FFT(void)
+{
+    int16_t re[SPECTRUM_N], im[SPECTRUM_N];
+    double start = Bench_Now_ns();
+
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        for (uint32_t n = 0; n < SPECTRUM_N; n++) {
+            re[n] = (int16_t)((frame[n] - 2048) * 16);
+            im[n] = 0;
+        }
+        bench_sink += Spectrum_FFT(re, im);
+        bench_sink += (uint16_t)re[i & (SPECTRUM_N - 1)];
+    }
+    return (Bench_Now_ns() - start) / BENCH_FRAMES;
+}
+
+static double Bench_Analyze(Spectrum_t* result)
+{
+    int16_t re[SPECTRUM_N], im[SPECTRUM_N];
+    double start = Bench_Now_ns();
+
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        for (uint32_t n = 0; n < SPECTRUM_N; n++) {
+            re[n] = frame[n];
+        }
+        Spectrum_Analyze(re, im, 100000, result);
+        bench_sink += result->thd_pm;
+    }
+    return (Bench_Now_ns() - start) / BENCH_FRAMES;
+}
+
+int main(void)
+{
+    Spectrum_t result;
+
+    // 50 Hz over a 100 ms frame with 10 % H3 and 5 % H5
+    for (uint32_t n = 0; n < SPECTRUM_N; n++) {
+        double phase = 2 * 3.14159265358979323846 * 5 * n / SPECTRUM_N;
+        frame[n] = (int16_t)lrint(2048 + 1500 * (sin(phase) + 0.1 * sin(3 * phase) + 0.05 * sin(5 * phase)));
+    }
+
+    double fft_ns = Bench_FFT();
+    double analyze_ns = Bench_Analyze(&result);
+    printf("frame %u samples, %u butterflies, THD %u.%u %%\n", SPECTRUM_N, BUTTERFLIES,
+           result.thd_pm / 10, result.thd_pm % 10);
+    printf("Spectrum_FFT      %8.1f ns/frame  %5.2f ns/butterfly\n", fft_ns, fft_ns / BUTTERFLIES);
+    printf("Spectrum_Analyze  %8.1f ns/frame\n", analyze_ns);
+    return 0;
+}
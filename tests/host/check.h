@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file           : check.h
+  * @brief          : Minimal assertions for the host unit tests
+  ******************************************************************************
+  * @attention
+  *
+  * A failed CHECK prints its location and lets the test go on, so one run
+  * reports every broken case. CHECK_DONE() prints the summary line and is
+  * the exit status of main().
+  ******************************************************************************
+  */
+
+#ifndef __CHECK_H
+#define __CHECK_H
+
+#include <stdio.h>
+
+static int check_count = 0;
+static int check_failures = 0;
+
+#define CHECK(condition) do { \
+        check_count++; \
+        if (!(condition)) { \
+            check_failures++; \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+        long long check_a = (long long)(actual), check_e = (long long)(expected); \
+        check_count++; \
+        if (check_a != check_e) { \
+            check_failures++; \
+            printf("%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__, #actual, check_a, check_e); \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) do { \
+        long long check_a = (long long)(actual), check_e = (long long)(expected); \
+        long long check_d = check_a > check_e ? check_a - check_e : check_e - check_a; \
+        check_count++; \
+        if (check_d > (long long)(tolerance)) { \
+            check_failures++; \
+            printf("%s:%d: %s == %lld, expected %lld +- %lld\n", __FILE__, __LINE__, #actual, \
+                   check_a, check_e, (long long)(tolerance)); \
+        } \
+    } while (0)
+
+#define CHECK_DONE() \
+    (printf("%-24s %d checks, %d failed\n", __FILE__, check_count, check_failures), check_failures != 0)
+
+#endif /* __CHECK_H */
@@ -0,0 +1,19 @@
+/**
+  ******************************************************************************
+  * @file           : _ansi.h (host stub)
+  * @brief          : The newlib C linkage macros ssd1306.h uses
+  ******************************************************************************
+  */
+
+#ifndef _ANSIDECL_H_
+#define _ANSIDECL_H_
+
+#ifdef __cplusplus
+#define _BEGIN_STD_C            extern "C" {
+#define _END_STD_C              }
+#else
+#define _BEGIN_STD_C
+#define _END_STD_C
+#endif
+
+#endif /* _ANSIDECL_H_ */
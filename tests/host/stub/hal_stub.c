@@ -0,0 +1,322 @@
+/**
+  ******************************************************************************
+  * @file           : hal_stub.c
+  * @brief          : Host implementations behind stub/stm32l0xx_hal.h
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "stm32l0xx_ll_adc.h"
+
+uint32_t host_primask = 0;
+uint32_t host_eeprom[HOST_EEPROM_WORDS];
+uint32_t host_eeprom_writes = 0;
+uint8_t host_eeprom_fail = 0;
+uint16_t host_vrefint_cal = 1671;       // 1.224 V at 3.0 V
+uint16_t host_ts_cal1 = 670;
+uint16_t host_ts_cal2 = 870;
+
+uint8_t host_tick_suspended = 0;
+uint32_t host_sleeps = 0;
+void (*host_sleep)(void) = NULL;
+
+static uint8_t host_eeprom_locked = 1;
+
+void HAL_Delay(uint32_t delay_ms)
+{
+    (void)delay_ms;
+}
+
+void HAL_SuspendTick(void)
+{
+    host_tick_suspended = 1;
+}
+
+void HAL_ResumeTick(void)
+{
+    host_tick_suspended = 0;
+}
+
+void HAL_PWR_EnterSLEEPMode(uint32_t regulator, uint8_t entry)
+{
+    (void)regulator;
+    (void)entry;
+    host_sleeps++;
+    if (host_sleep) {
+        host_sleep();
+    }
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Unlock(void)
+{
+    host_eeprom_locked = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Lock(void)
+{
+    host_eeprom_locked = 1;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Program(uint32_t type, uintptr_t address, uint32_t data)
+{
+    uintptr_t offset = address - DATA_EEPROM_BASE;
+
+    if (host_eeprom_locked || host_eeprom_fail || type != FLASH_TYPEPROGRAMDATA_WORD ||
+        offset % 4 != 0 || offset / 4 >= HOST_EEPROM_WORDS) {
+        return HAL_ERROR;
+    }
+    host_eeprom[offset / 4] = data;
+    host_eeprom_writes++;
+    return HAL_OK;
+}
+
+/* Register model ----------------------------------------------------------- */
+
+GPIO_TypeDef host_gpioa, host_gpiob;
+EXTI_TypeDef host_exti;
+ADC_TypeDef host_adc1;
+ADC_Common_TypeDef host_adc1_common;
+DMA_Channel_TypeDef host_dma1_channel1;
+DMA_TypeDef host_dma1;
+DMA_Request_TypeDef host_dma1_cselr;
+
+uint16_t (*host_adc_source)(uint8_t channel) = NULL;
+void (*host_adc_irq)(void) = NULL;
+void (*host_dma_irq)(void) = NULL;
+uint32_t host_adc_ignored_writes = 0;
+
+static uint32_t host_adc_flags;         // ADC ISR as the hardware holds it
+static uint32_t host_exti_pending;
+static uint32_t host_adc_cfgr1;         // Configuration the conversion started with
+static uint32_t host_adc_tr;
+static uint8_t host_adc_next;           // Next channel of the sequence
+static uint32_t host_dma_length;        // CNDTR at the stream start
+
+void Host_Registers_Reset(void)
+{
+    host_gpioa = (GPIO_TypeDef){ 0 };
+    host_gpiob = (GPIO_TypeDef){ 0 };
+    host_exti = (EXTI_TypeDef){ 0 };
+    host_adc1 = (ADC_TypeDef){ 0 };
+    host_adc1_common = (ADC_Common_TypeDef){ 0 };
+    host_dma1_channel1 = (DMA_Channel_TypeDef){ 0 };
+    host_dma1 = (DMA_TypeDef){ 0 };
+    host_dma1_cselr = (DMA_Request_TypeDef){ 0 };
+    host_adc1.TR = 0x0FFF0000;
+    host_adc_flags = 0;
+    host_exti_pending = 0;
+    host_adc_ignored_writes = 0;
+    Host_Sync();
+}
+
+// A flag register without the mark was written by the firmware: clear
+// the bits written, then publish the state again
+static uint32_t Host_Sync_W1C(volatile uint32_t* reg, uint32_t flags)
+{
+    if (!(*reg & HOST_W1C_MARK)) {
+        flags &= ~*reg;
+    }
+    *reg = flags | HOST_W1C_MARK;
+    return flags;
+}
+
+static void Host_Sync_Gpio(GPIO_TypeDef* gpio)
+{
+    gpio->ODR = (gpio->ODR | (gpio->BSRR & 0xFFFF)) & ~(gpio->BSRR >> 16) & ~gpio->BRR;
+    gpio->BSRR = 0;
+    gpio->BRR = 0;
+}
+
+void Host_Sync(void)
+{
+    Host_Sync_Gpio(&host_gpioa);
+    Host_Sync_Gpio(&host_gpiob);
+    host_exti_pending = Host_Sync_W1C(&host_exti.PR, host_exti_pending);
+    host_adc_flags = Host_Sync_W1C(&host_adc1.ISR, host_adc_flags);
+    if (host_dma1.IFCR & DMA_IFCR_CGIF1) {
+        host_dma1.ISR &= ~(DMA_ISR_GIF1 | DMA_ISR_TCIF1 | DMA_ISR_HTIF1);
+    }
+    host_dma1.IFCR = 0;
+
+    // Configuration writes during a conversion do not take
+    if (host_adc1.CR & ADC_CR_ADSTART) {
+        if (host_adc1.TR != host_adc_tr || host_adc1.CFGR1 != host_adc_cfgr1) {
+            host_adc_ignored_writes++;
+            host_adc1.TR = host_adc_tr;
+            host_adc1.CFGR1 = host_adc_cfgr1;
+        }
+    }
+}
+
+void Host_Exti_Raise(uint32_t lines)
+{
+    Host_Sync();
+    host_exti_pending |= lines;
+    host_exti.PR = host_exti_pending | HOST_W1C_MARK;
+}
+
+// Interrupts the model has raised and the firmware has enabled
+static void Host_Interrupts(void)
+{
+    Host_Sync();
+    if ((host_adc_flags & ADC_ISR_AWD) && (host_adc1.IER & ADC_IER_AWDIE) && host_adc_irq) {
+        host_adc_irq();
+        Host_Sync();
+    }
+}
+
+static void Host_Dma_Transfer(uint16_t sample)
+{
+    DMA_Channel_TypeDef* dma = &host_dma1_channel1;
+    uint32_t raised = 0;
+
+    if (!(host_adc1.CFGR1 & ADC_CFGR1_DMAEN) || !(dma->CCR & DMA_CCR_EN) || dma->CNDTR == 0) {
+        return;
+    }
+    ((volatile uint16_t*)(uintptr_t)dma->CMAR)[host_dma_length - dma->CNDTR] = sample;
+    dma->CNDTR--;
+    if (dma->CNDTR == host_dma_length / 2) {
+        host_dma1.ISR |= DMA_ISR_GIF1 | DMA_ISR_HTIF1;
+        raised = dma->CCR & DMA_CCR_HTIE;
+    }
+    if (dma->CNDTR == 0) {
+        host_dma1.ISR |= DMA_ISR_GIF1 | DMA_ISR_TCIF1;
+        raised = dma->CCR & DMA_CCR_TCIE;
+        if (dma->CCR & DMA_CCR_CIRC) {
+            dma->CNDTR = host_dma_length;
+        }
+    }
+    if (raised && host_dma_irq) {
+        host_dma_irq();
+        Host_Sync();
+    }
+}
+
+// One conversion of the next channel in the sequence
+static void Host_Adc_Sample(void)
+{
+    uint32_t selected = host_adc1.CHSELR & ADC_CHANNEL_MASK;
+    uint8_t channel = host_adc_next;
+
+    while (!(selected & (1UL << channel))) {
+        channel = (uint8_t)((channel + 1) % 19);
+    }
+    host_adc_next = (uint8_t)((channel + 1) % 19);
+
+    uint16_t sample = host_adc_source ? (host_adc_source(channel) & 0x0FFF) : 0;
+    host_adc1.DR = sample;
+    host_adc_flags |= ADC_ISR_EOC;
+    if ((selected >> (channel + 1)) == 0) {
+        host_adc_flags |= ADC_ISR_EOS;
+        host_adc_next = 0;
+    }
+    if ((host_adc_cfgr1 & ADC_CFGR1_AWDEN) &&
+        (!(host_adc_cfgr1 & ADC_CFGR1_AWDSGL) ||
+         ((host_adc_cfgr1 & ADC_CFGR1_AWDCH) >> ADC_CFGR1_AWDCH_Pos) == channel) &&
+        (sample < (host_adc_tr & 0x0FFF) || sample > ((host_adc_tr >> 16) & 0x0FFF))) {
+        host_adc_flags |= ADC_ISR_AWD;
+    }
+    host_adc1.ISR = host_adc_flags | HOST_W1C_MARK;
+    Host_Dma_Transfer(sample);
+    Host_Interrupts();
+}
+
+uint8_t Host_Adc_Convert(void)
+{
+    Host_Sync();
+    if (!(host_adc1.CR & ADC_CR_ADSTART) || !(host_adc1.CHSELR & ADC_CHANNEL_MASK)) {
+        return 0;
+    }
+    Host_Adc_Sample();
+    return 1;
+}
+
+void LL_ADC_SetCommonPathInternalCh(ADC_Common_TypeDef* common, uint32_t paths)
+{
+    Host_Sync();
+    common->CCR = (common->CCR & ~(ADC_CCR_VREFEN | ADC_CCR_TSEN)) | paths;
+}
+
+void LL_ADC_ClearFlag_ADRDY(ADC_TypeDef* adc)
+{
+    adc->ISR = ADC_ISR_ADRDY;
+    Host_Sync();
+}
+
+uint32_t LL_ADC_IsActiveFlag_ADRDY(ADC_TypeDef* adc)
+{
+    (void)adc;
+    Host_Sync();
+    return (host_adc_flags & ADC_ISR_ADRDY) ? 1U : 0U;
+}
+
+uint32_t LL_ADC_IsActiveFlag_EOC(ADC_TypeDef* adc)
+{
+    (void)adc;
+    Host_Sync();
+    return (host_adc_flags & ADC_ISR_EOC) ? 1U : 0U;
+}
+
+void LL_ADC_Enable(ADC_TypeDef* adc)
+{
+    Host_Sync();
+    adc->CR |= ADC_CR_ADEN;
+    host_adc_flags |= ADC_ISR_ADRDY;
+    Host_Sync_W1C(&adc->ISR, host_adc_flags);
+}
+
+void LL_ADC_Disable(ADC_TypeDef* adc)
+{
+    Host_Sync();
+    adc->CR &= ~(ADC_CR_ADEN | ADC_CR_ADSTART);
+}
+
+uint32_t LL_ADC_IsEnabled(ADC_TypeDef* adc)
+{
+    return (adc->CR & ADC_CR_ADEN) ? 1U : 0U;
+}
+
+void LL_ADC_REG_StartConversion(ADC_TypeDef* adc)
+{
+    Host_Sync();
+    host_adc_cfgr1 = adc->CFGR1;
+    host_adc_tr = adc->TR;
+    host_adc_next = 0;
+    host_dma_length = host_dma1_channel1.CNDTR;
+    adc->CR |= ADC_CR_ADSTART;
+    // An interrupt enabled with its flag already set is taken at once
+    Host_Interrupts();
+    if (!(adc->CFGR1 & ADC_CFGR1_CONT) && (adc->CHSELR & ADC_CHANNEL_MASK)) {
+        do {
+            Host_Adc_Sample();
+        } while (host_adc_next != 0);
+        adc->CR &= ~ADC_CR_ADSTART;
+    }
+}
+
+void LL_ADC_REG_StopConversion(ADC_TypeDef* adc)
+{
+    Host_Sync();
+    adc->CR &= ~ADC_CR_ADSTART;
+}
+
+uint32_t LL_ADC_REG_IsConversionOngoing(ADC_TypeDef* adc)
+{
+    return (adc->CR & ADC_CR_ADSTART) ? 1U : 0U;
+}
+
+uint32_t LL_ADC_REG_IsStopConversionOngoing(ADC_TypeDef* adc)
+{
+    (void)adc;
+    return 0;
+}
+
+uint16_t LL_ADC_REG_ReadConversionData12(ADC_TypeDef* adc)
+{
+    Host_Sync();
+    host_adc_flags &= ~ADC_ISR_EOC;
+    adc->ISR = host_adc_flags | HOST_W1C_MARK;
+    return (uint16_t)(adc->DR & 0x0FFF);
+}
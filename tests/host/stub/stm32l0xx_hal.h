@@ -0,0 +1,266 @@
+/**
+  ******************************************************************************
+  * @file           : stm32l0xx_hal.h (host stub)
+  * @brief          : Host stand-in for the HAL included by Core/Inc/main.h
+  ******************************************************************************
+  * @attention
+  *
+  * Provides only the CMSIS and HAL pieces the tested modules touch: PRIMASK,
+  * a TIM register block the tests can drive by hand, the data EEPROM
+  * programming calls writing to host_eeprom[], the factory VREFINT and
+  * temperature sensor calibration words, SysTick suspension and a Sleep
+  * mode entry that runs host_sleep() for the time asleep, an I2C memory
+  * write that
+  * the test using it implements, and a register model of the GPIO, EXTI,
+  * ADC and DMA blocks board_io.h drives.
+  *
+  * The register blocks are plain memory with the CMSIS layout and bit
+  * positions. Host_Sync() applies what the firmware wrote since the last
+  * model step: write-1-to-clear flags (ADC ISR, EXTI PR, DMA IFCR), the
+  * GPIO set/reset registers, and ADC configuration writes made while a
+  * conversion is ongoing, which the hardware ignores and the model undoes
+  * and counts in host_adc_ignored_writes. The flag registers carry
+  * HOST_W1C_MARK while they hold the model's state; a firmware write
+  * replaces it. Conversions run in stm32l0xx_ll_adc.h: a single conversion
+  * at its start, a continuous stream one sample per Host_Adc_Convert().
+  * Each sample is host_adc_source() of its channel, is checked against the
+  * watchdog window, moved by DMA channel 1 if enabled, and raises
+  * host_adc_irq() / host_dma_irq() as the NVIC would.
+  ******************************************************************************
+  */
+
+#ifndef __STM32L0xx_HAL_H
+#define __STM32L0xx_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR
+} HAL_StatusTypeDef;
+
+/* CMSIS core */
+extern uint32_t host_primask;
+
+static inline uint32_t __get_PRIMASK(void) { return host_primask; }
+static inline void __set_PRIMASK(uint32_t primask) { host_primask = primask; }
+static inline void __disable_irq(void) { host_primask = 1; }
+static inline void __enable_irq(void) { host_primask = 0; }
+
+/* Timers */
+typedef struct {
+    volatile uint32_t SR;
+    volatile uint32_t CNT;
+} TIM_TypeDef;
+
+#define TIM_SR_UIF              (1UL << 0)
+
+typedef struct {
+    TIM_TypeDef* Instance;
+} TIM_HandleTypeDef;
+
+static inline HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef* htim)
+{
+    (void)htim;
+    return HAL_OK;
+}
+
+/* SysTick and Sleep mode: host_sleep(), if set, lets the time pass that
+   the core spends in WFI */
+#define PWR_MAINREGULATOR_ON    0x00U
+#define PWR_SLEEPENTRY_WFI      0x01U
+
+extern uint8_t host_tick_suspended;
+extern uint32_t host_sleeps;
+extern void (*host_sleep)(void);
+
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+void HAL_PWR_EnterSLEEPMode(uint32_t regulator, uint8_t entry);
+
+/* I2C, HAL_I2C_Mem_Write() is up to the test that links the driver */
+#define HAL_MAX_DELAY           0xFFFFFFFFU
+
+typedef struct {
+    uint32_t Instance;
+} I2C_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef* hi2c, uint16_t address, uint16_t mem_address,
+                                    uint16_t mem_size, uint8_t* data, uint16_t size, uint32_t timeout);
+void HAL_Delay(uint32_t delay_ms);
+
+/* GPIO and EXTI */
+typedef enum {
+    EXTI2_3_IRQn = 6,
+    EXTI4_15_IRQn = 7
+} IRQn_Type;
+
+typedef struct {
+    volatile uint32_t MODER;
+    volatile uint32_t OTYPER;
+    volatile uint32_t OSPEEDR;
+    volatile uint32_t PUPDR;
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+    volatile uint32_t BSRR;
+    volatile uint32_t LCKR;
+    volatile uint32_t AFR[2];
+    volatile uint32_t BRR;
+} GPIO_TypeDef;
+
+typedef struct {
+    volatile uint32_t IMR;
+    volatile uint32_t EMR;
+    volatile uint32_t RTSR;
+    volatile uint32_t FTSR;
+    volatile uint32_t SWIER;
+    volatile uint32_t PR;
+} EXTI_TypeDef;
+
+extern GPIO_TypeDef host_gpioa, host_gpiob;
+extern EXTI_TypeDef host_exti;
+
+#define GPIOA                   (&host_gpioa)
+#define GPIOB                   (&host_gpiob)
+#define EXTI                    (&host_exti)
+
+#define GPIO_PIN_3              ((uint16_t)0x0008)
+#define GPIO_PIN_4              ((uint16_t)0x0010)
+#define GPIO_PIN_5              ((uint16_t)0x0020)
+#define GPIO_PIN_15             ((uint16_t)0x8000)
+
+/* ADC */
+typedef struct {
+    volatile uint32_t ISR;
+    volatile uint32_t IER;
+    volatile uint32_t CR;
+    volatile uint32_t CFGR1;
+    volatile uint32_t CFGR2;
+    volatile uint32_t SMPR;
+    uint32_t RESERVED1;
+    uint32_t RESERVED2;
+    volatile uint32_t TR;
+    uint32_t RESERVED3;
+    volatile uint32_t CHSELR;
+    uint32_t RESERVED4[5];
+    volatile uint32_t DR;
+    uint32_t RESERVED5[28];
+    volatile uint32_t CALFACT;
+} ADC_TypeDef;
+
+typedef struct {
+    volatile uint32_t CCR;
+} ADC_Common_TypeDef;
+
+extern ADC_TypeDef host_adc1;
+extern ADC_Common_TypeDef host_adc1_common;
+
+#define ADC1                    (&host_adc1)
+#define ADC1_COMMON             (&host_adc1_common)
+
+#define ADC_ISR_ADRDY           (1UL << 0)
+#define ADC_ISR_EOC             (1UL << 2)
+#define ADC_ISR_EOS             (1UL << 3)
+#define ADC_ISR_OVR             (1UL << 4)
+#define ADC_ISR_AWD             (1UL << 7)
+#define ADC_IER_AWDIE           (1UL << 7)
+#define ADC_CR_ADEN             (1UL << 0)
+#define ADC_CR_ADDIS            (1UL << 1)
+#define ADC_CR_ADSTART          (1UL << 2)
+#define ADC_CR_ADSTP            (1UL << 4)
+#define ADC_CFGR1_DMAEN         (1UL << 0)
+#define ADC_CFGR1_DMACFG        (1UL << 1)
+#define ADC_CFGR1_OVRMOD        (1UL << 12)
+#define ADC_CFGR1_CONT          (1UL << 13)
+#define ADC_CFGR1_AWDSGL        (1UL << 22)
+#define ADC_CFGR1_AWDEN         (1UL << 23)
+#define ADC_CFGR1_AWDCH_Pos     26U
+#define ADC_CFGR1_AWDCH         (0x1FUL << ADC_CFGR1_AWDCH_Pos)
+#define ADC_CFGR2_OVSE          (1UL << 0)
+#define ADC_CFGR2_OVSR_Pos      2U
+#define ADC_CFGR2_OVSR          (0x7UL << ADC_CFGR2_OVSR_Pos)
+#define ADC_CFGR2_OVSS_Pos      5U
+#define ADC_CFGR2_OVSS          (0xFUL << ADC_CFGR2_OVSS_Pos)
+#define ADC_CCR_VREFEN          (1UL << 22)
+#define ADC_CCR_TSEN            (1UL << 23)
+
+// HAL channel codes: the CHSELR bit and the AWDCH number
+#define ADC_CHANNEL_3           ((1UL << 3) | (3UL << ADC_CFGR1_AWDCH_Pos))
+#define ADC_CHANNEL_4           ((1UL << 4) | (4UL << ADC_CFGR1_AWDCH_Pos))
+#define ADC_CHANNEL_VREFINT     ((1UL << 17) | (17UL << ADC_CFGR1_AWDCH_Pos))
+#define ADC_CHANNEL_TEMPSENSOR  ((1UL << 18) | (18UL << ADC_CFGR1_AWDCH_Pos))
+#define ADC_CHANNEL_MASK        (0x0007FFFFU)
+
+/* DMA */
+typedef struct {
+    volatile uint32_t CCR;
+    volatile uint32_t CNDTR;
+    volatile uint32_t CPAR;
+    volatile uint32_t CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct {
+    volatile uint32_t ISR;
+    volatile uint32_t IFCR;
+} DMA_TypeDef;
+
+typedef struct {
+    volatile uint32_t CSELR;
+} DMA_Request_TypeDef;
+
+extern DMA_Channel_TypeDef host_dma1_channel1;
+extern DMA_TypeDef host_dma1;
+extern DMA_Request_TypeDef host_dma1_cselr;
+
+#define DMA1                    (&host_dma1)
+#define DMA1_Channel1           (&host_dma1_channel1)
+#define DMA1_CSELR              (&host_dma1_cselr)
+
+#define DMA_ISR_GIF1            (1UL << 0)
+#define DMA_ISR_TCIF1           (1UL << 1)
+#define DMA_ISR_HTIF1           (1UL << 2)
+#define DMA_IFCR_CGIF1          (1UL << 0)
+#define DMA_CCR_EN              (1UL << 0)
+#define DMA_CCR_TCIE            (1UL << 1)
+#define DMA_CCR_HTIE            (1UL << 2)
+#define DMA_CCR_CIRC            (1UL << 5)
+#define DMA_CCR_MINC            (1UL << 7)
+#define DMA_CCR_PSIZE_0         (1UL << 8)
+#define DMA_CCR_MSIZE_0         (1UL << 10)
+#define DMA_CSELR_C1S           (0xFUL << 0)
+
+/* Register model */
+#define HOST_W1C_MARK           (1UL << 31)     // Flag register holds the model state
+
+extern uint16_t (*host_adc_source)(uint8_t channel);
+extern void (*host_adc_irq)(void);
+extern void (*host_dma_irq)(void);
+extern uint32_t host_adc_ignored_writes;
+
+void Host_Registers_Reset(void);
+void Host_Sync(void);
+void Host_Exti_Raise(uint32_t lines);
+uint8_t Host_Adc_Convert(void);
+
+/* Factory calibration values in system memory, set by the test */
+extern uint16_t host_vrefint_cal, host_ts_cal1, host_ts_cal2;
+
+#define VREFINT_CAL_ADDR        (&host_vrefint_cal)
+#define TEMPSENSOR_CAL1_ADDR    (&host_ts_cal1)
+#define TEMPSENSOR_CAL2_ADDR    (&host_ts_cal2)
+
+/* Data EEPROM, addresses are host pointers */
+#define HOST_EEPROM_WORDS       256
+extern uint32_t host_eeprom[HOST_EEPROM_WORDS];
+extern uint32_t host_eeprom_writes;
+extern uint8_t host_eeprom_fail;        // Programming fails while set
+
+#define DATA_EEPROM_BASE        ((uintptr_t)host_eeprom)
+#define FLASH_TYPEPROGRAMDATA_WORD  0x02U
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Unlock(void);
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Lock(void);
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Program(uint32_t type, uintptr_t address, uint32_t data);
+
+#endif /* __STM32L0xx_HAL_H */
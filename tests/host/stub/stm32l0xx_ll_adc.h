@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file           : stm32l0xx_ll_adc.h (host stub)
+  * @brief          : The LL ADC calls board_io.h uses, on the host register model
+  ******************************************************************************
+  * @attention
+  *
+  * Same names and register effects as the LL inlines, but enabling sets
+  * ADRDY at once, a started single conversion completes before the call
+  * returns, and a stop takes effect at once. Continuous conversions wait
+  * for Host_Adc_Convert().
+  ******************************************************************************
+  */
+
+#ifndef __STM32L0xx_LL_ADC_H
+#define __STM32L0xx_LL_ADC_H
+
+#include "stm32l0xx_hal.h"
+
+#define LL_ADC_PATH_INTERNAL_VREFINT    ADC_CCR_VREFEN
+#define LL_ADC_PATH_INTERNAL_TEMPSENSOR ADC_CCR_TSEN
+#define __LL_ADC_COMMON_INSTANCE(adc)   (ADC1_COMMON)
+
+void LL_ADC_SetCommonPathInternalCh(ADC_Common_TypeDef* common, uint32_t paths);
+void LL_ADC_ClearFlag_ADRDY(ADC_TypeDef* adc);
+uint32_t LL_ADC_IsActiveFlag_ADRDY(ADC_TypeDef* adc);
+uint32_t LL_ADC_IsActiveFlag_EOC(ADC_TypeDef* adc);
+void LL_ADC_Enable(ADC_TypeDef* adc);
+void LL_ADC_Disable(ADC_TypeDef* adc);
+uint32_t LL_ADC_IsEnabled(ADC_TypeDef* adc);
+void LL_ADC_REG_StartConversion(ADC_TypeDef* adc);
+void LL_ADC_REG_StopConversion(ADC_TypeDef* adc);
+uint32_t LL_ADC_REG_IsConversionOngoing(ADC_TypeDef* adc);
+uint32_t LL_ADC_REG_IsStopConversionOngoing(ADC_TypeDef* adc);
+uint16_t LL_ADC_REG_ReadConversionData12(ADC_TypeDef* adc);
+
+#endif /* __STM32L0xx_LL_ADC_H */
@@ -0,0 +1,188 @@
+/**
+  ******************************************************************************
+  * @file           : test_board_io.c
+  * @brief          : Pin, EXTI, ADC and DMA stream accessors on the register model
+  ******************************************************************************
+  * @attention
+  *
+  * board_io.h compiles against the GPIO, EXTI, ADC and DMA blocks in stub/.
+  * The DMA interrupt below acknowledges like the firmware's: it clears the
+  * channel flags and halts a one-shot stream at its full transfer.
+  ******************************************************************************
+  */
+
+#include "check.h"
+#include "board_io.h"
+
+static uint16_t codes[19];              // Input of each ADC channel
+static uint32_t interrupts, half_transfers, full_transfers;
+static uint8_t halt_at_full;
+
+static uint16_t Source(uint8_t channel)
+{
+    return codes[channel]++;
+}
+
+static void Dma_Irq(void)
+{
+    uint32_t flags = DMA1->ISR;
+
+    DMA1->IFCR = DMA_IFCR_CGIF1;
+    interrupts++;
+    half_transfers += (flags & DMA_ISR_HTIF1) ? 1 : 0;
+    full_transfers += (flags & DMA_ISR_TCIF1) ? 1 : 0;
+    if ((flags & DMA_ISR_TCIF1) && halt_at_full) {
+        Board_Adc_Stream_Halt();
+    }
+}
+
+static void Start(void)
+{
+    Host_Registers_Reset();
+    host_adc_source = Source;
+    host_dma_irq = Dma_Irq;
+    interrupts = 0;
+    half_transfers = 0;
+    full_transfers = 0;
+    halt_at_full = 0;
+    for (uint8_t i = 0; i < 19; i++) {
+        codes[i] = (uint16_t)(i * 100);
+    }
+}
+
+static void Test_Pins(void)
+{
+    Start();
+
+    // Button and encoder read the input data register
+    GPIOB->IDR = USER_BUTTON_Pin;
+    CHECK_EQ(Board_Read_Button(), 1);
+    GPIOB->IDR = ~(uint32_t)USER_BUTTON_Pin;
+    CHECK_EQ(Board_Read_Button(), 0);
+    GPIOB->IDR = 0;
+    CHECK_EQ(Board_Read_Encoder(), 0);
+    GPIOB->IDR = ROT_CHB_Pin;
+    CHECK_EQ(Board_Read_Encoder(), 1);
+    GPIOB->IDR = ROT_CHA_Pin;
+    CHECK_EQ(Board_Read_Encoder(), 2);
+    GPIOB->IDR = 0xFFFF;
+    CHECK_EQ(Board_Read_Encoder(), 3);
+
+    // The LED sets and resets its pin only
+    GPIOA->ODR = 0x0101;
+    Board_Led_Red(1);
+    Host_Sync();
+    CHECK_EQ(GPIOA->ODR, 0x0101 | LED_RED_Pin);
+    Board_Led_Red(0);
+    Host_Sync();
+    CHECK_EQ(GPIOA->ODR, 0x0101);
+
+    // Only the lines written are cleared, an edge raised later stays
+    Host_Exti_Raise(USER_BUTTON_Pin | ROT_CHA_Pin | ROT_CHB_Pin);
+    Board_Clear_Exti(ROT_CHA_Pin | ROT_CHB_Pin);
+    Host_Sync();
+    CHECK_EQ(EXTI->PR & ~HOST_W1C_MARK, USER_BUTTON_Pin);
+    Host_Exti_Raise(ROT_CHA_Pin);
+    Board_Clear_Exti(USER_BUTTON_Pin);
+    Host_Sync();
+    CHECK_EQ(EXTI->PR & ~HOST_W1C_MARK, ROT_CHA_Pin);
+}
+
+static void Test_Read(void)
+{
+    Start();
+
+    // Enabled with both internal paths
+    Board_Adc_Enable();
+    CHECK(ADC1->CR & ADC_CR_ADEN);
+    CHECK_EQ(ADC1_COMMON->CCR & (ADC_CCR_VREFEN | ADC_CCR_TSEN), ADC_CCR_VREFEN | ADC_CCR_TSEN);
+
+    // One channel per read, the AWDCH bits stay out of CHSELR
+    CHECK_EQ(Board_Adc_Read(ADC_CHANNEL_4), 400);
+    CHECK_EQ(ADC1->CHSELR, 1UL << 4);
+    CHECK_EQ(Board_Adc_Read(ADC_CHANNEL_3), 300);
+    CHECK_EQ(Board_Adc_Read(ADC_CHANNEL_VREFINT), 1700);
+    CHECK_EQ(Board_Adc_Read(ADC_CHANNEL_4), 401);
+
+    // The read leaves no conversion running and no EOC behind
+    Host_Sync();
+    CHECK_EQ(ADC1->CR & ADC_CR_ADSTART, 0);
+    CHECK_EQ(ADC1->ISR & ADC_ISR_EOC, 0);
+}
+
+static void Test_Stream(void)
+{
+    static volatile uint16_t buffer[9];
+
+    // Circular over two channels: ascending order, half and full transfer
+    // interrupts, then around again
+    Start();
+    Board_Adc_Enable();
+    ADC1->CFGR1 = ADC_CFGR1_AWDEN;
+    Board_Adc_Stream_Start(ADC_CHANNEL_4 | ADC_CHANNEL_3, 5, 0, buffer, 8, 1);
+    CHECK_EQ(ADC1->CHSELR, (1UL << 3) | (1UL << 4));
+    CHECK_EQ(ADC1->SMPR, 5);
+    CHECK_EQ(ADC1->CFGR2, 0);
+    CHECK_EQ(ADC1->CFGR1 & (ADC_CFGR1_CONT | ADC_CFGR1_DMAEN | ADC_CFGR1_DMACFG | ADC_CFGR1_OVRMOD),
+             ADC_CFGR1_CONT | ADC_CFGR1_DMAEN | ADC_CFGR1_DMACFG | ADC_CFGR1_OVRMOD);
+    CHECK_EQ(DMA1_Channel1->CPAR, (uint32_t)&ADC1->DR);
+    for (uint8_t i = 0; i < 4; i++) {
+        Host_Adc_Convert();
+    }
+    CHECK_EQ(interrupts, 1);
+    CHECK_EQ(half_transfers, 1);
+    CHECK_EQ(full_transfers, 0);
+    for (uint8_t i = 0; i < 4; i++) {
+        Host_Adc_Convert();
+    }
+    CHECK_EQ(full_transfers, 1);
+    CHECK_EQ(buffer[0], 300);
+    CHECK_EQ(buffer[1], 400);
+    CHECK_EQ(buffer[6], 303);
+    CHECK_EQ(buffer[7], 403);
+    Host_Adc_Convert();
+    CHECK_EQ(buffer[0], 304);
+    CHECK_EQ(half_transfers, 1);
+
+    // Back to single conversions: the watchdog setting survives
+    Board_Adc_Stream_Restore();
+    CHECK_EQ(ADC1->CFGR1, ADC_CFGR1_AWDEN);
+    CHECK_EQ(ADC1->SMPR, 0);
+    CHECK_EQ(DMA1_Channel1->CCR & DMA_CCR_EN, 0);
+    CHECK(ADC1->CR & ADC_CR_ADEN);
+    CHECK_EQ(Host_Adc_Convert(), 0);
+    CHECK_EQ(Board_Adc_Read(ADC_CHANNEL_4), 404);
+    CHECK_EQ(buffer[1], 400);
+
+    // One shot with oversampling: no half transfer interrupt, halted at
+    // the full one, nothing written past the buffer
+    Start();
+    Board_Adc_Enable();
+    buffer[8] = 0xBEEF;
+    halt_at_full = 1;
+    Board_Adc_Stream_Start(ADC_CHANNEL_4, 7, 4, buffer, 8, 0);
+    CHECK_EQ(ADC1->CFGR2, ADC_CFGR2_OVSE | (3UL << ADC_CFGR2_OVSR_Pos) | (4UL << ADC_CFGR2_OVSS_Pos));
+    CHECK_EQ(DMA1_Channel1->CCR & (DMA_CCR_CIRC | DMA_CCR_HTIE), 0);
+    for (uint8_t i = 0; i < 20; i++) {
+        Host_Adc_Convert();
+    }
+    CHECK_EQ(interrupts, 1);
+    CHECK_EQ(full_transfers, 1);
+    CHECK_EQ(buffer[7], 407);
+    CHECK_EQ(buffer[8], 0xBEEF);
+    CHECK_EQ(codes[4], 408);
+    Host_Sync();
+    CHECK_EQ(DMA1->ISR & DMA_ISR_TCIF1, 0);
+
+    Board_Adc_Stream_Restore();
+    CHECK_EQ(ADC1->CFGR2, 0);
+    CHECK_EQ(Board_Adc_Read(ADC_CHANNEL_4), 408);
+}
+
+int main(void)
+{
+    Test_Pins();
+    Test_Read();
+    Test_Stream();
+    return CHECK_DONE();
+}
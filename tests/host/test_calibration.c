@@ -0,0 +1,307 @@
+/**
+  ******************************************************************************
+  * @file           : test_calibration.c
+  * @brief          : Least-squares fit, table interpolation, auto-zero and the stored record
+  ******************************************************************************
+  * @attention
+  *
+  * The auto-zero cases model the current sensor of the default line, whose
+  * zero code drifts by a few codes between boots, and count the data EEPROM
+  * words written to see when the record is stored.
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "check.h"
+#include "main.h"
+#include "calibration.h"
+
+static const Cal_Line_t defaults[CAL_CHANNELS] = {
+    { 525770, -962 },       // 8.0226 mV/code
+    { 262984, -8776 },      // 4.0128 mA/code
+};
+
+static void Test_Crc(void)
+{
+    CHECK_EQ(Calibration_Crc32("123456789", 9), 0xCBF43926UL);
+    CHECK_EQ(Calibration_Crc32("", 0), 0);
+}
+
+static void Test_Fit(void)
+{
+    Cal_Line_t line;
+
+    // Two points on y = 8.02 x + 40
+    Cal_Point_t two[] = { { 500, 4050 }, { 3500, 28110 } };
+    CHECK(Calibration_Fit(two, 2, &line));
+    CHECK_NEAR(line.gain_q16, (int32_t)(8.02 * 65536), 1);
+    CHECK_EQ(line.offset, 40);
+
+    // Least squares through scattered points: y = 10 x - 12 +- 10
+    Cal_Point_t four[] = { { 100, 998 }, { 1000, 9978 }, { 2000, 19998 }, { 3000, 29978 } };
+    CHECK(Calibration_Fit(four, 4, &line));
+    CHECK_NEAR(line.gain_q16, 10 * 65536, 65536 / 100);
+    CHECK_NEAR(line.offset, -12, 10);
+
+    // Negative offsets round to nearest, not towards zero
+    Cal_Point_t negative[] = { { 1000, 1000 - 3 }, { 2000, 2000 - 3 } };
+    CHECK(Calibration_Fit(negative, 2, &line));
+    CHECK_EQ(line.gain_q16, 65536);
+    CHECK_EQ(line.offset, -3);
+
+    // Not a rising line
+    Cal_Point_t same_code[] = { { 1000, 5 }, { 1000, 9 } };
+    Cal_Point_t falling[] = { { 1000, 9000 }, { 2000, 8000 } };
+    CHECK(!Calibration_Fit(same_code, 2, &line));
+    CHECK(!Calibration_Fit(falling, 2, &line));
+    CHECK(!Calibration_Fit(four, 1, &line));
+}
+
+static void Test_Lut(void)
+{
+    int32_t lut[CAL_LUT_POINTS];
+
+    // Exact line y = 10 x, given unsorted: every code reproduces within rounding
+    Cal_Point_t linear[] = { { 1000, 10000 }, { 0, 0 }, { 3000, 30000 } };
+    CHECK(Calibration_Build_Lut(linear, 3, lut));
+    CHECK_EQ(linear[0].raw, 0);
+    CHECK_EQ(linear[2].raw, 3000);
+    uint32_t worst = 0;
+    for (uint32_t raw = 0; raw < 4096; raw++) {
+        int32_t error = Calibration_Lut_Apply(lut, raw) - (int32_t)(10 * raw);
+        uint32_t magnitude = (uint32_t)(error < 0 ? -error : error);
+        worst = magnitude > worst ? magnitude : worst;
+    }
+    CHECK(worst <= 1);
+
+    // Codes past the ADC range clamp to the last one
+    CHECK_EQ(Calibration_Lut_Apply(lut, 9999), Calibration_Lut_Apply(lut, 4095));
+
+    // A knee at 2048: breakpoints hold the points, segments interpolate
+    Cal_Point_t knee[] = { { 0, 0 }, { 2048, 2048 }, { 4096, 6144 } };
+    CHECK(Calibration_Build_Lut(knee, 3, lut));
+    CHECK_EQ(lut[0], 0);
+    CHECK_EQ(lut[8], 2048);
+    CHECK_EQ(lut[CAL_LUT_POINTS - 1], 6144);
+    CHECK_EQ(Calibration_Lut_Apply(lut, 1024), 1024);
+    CHECK_EQ(Calibration_Lut_Apply(lut, 3072), 4096);
+    CHECK_EQ(Calibration_Lut_Apply(lut, 2048 + 128), 2048 + 256);
+
+    // End segments extrapolate the outer points
+    Cal_Point_t inner[] = { { 1024, 1000 }, { 2048, 2000 }, { 3072, 3000 } };
+    CHECK(Calibration_Build_Lut(inner, 3, lut));
+    CHECK_NEAR(lut[0], 0, 1);
+    CHECK_NEAR(lut[CAL_LUT_POINTS - 1], 4000, 1);
+
+    Cal_Point_t duplicate[] = { { 5, 1 }, { 5, 2 }, { 9, 3 } };
+    CHECK(!Calibration_Build_Lut(duplicate, 3, lut));
+    CHECK(!Calibration_Build_Lut(knee, 2, lut));
+}
+
+static void Test_Record(void)
+{
+    const Cal_Line_t other[CAL_CHANNELS] = { { 65536, 0 }, { 65536, 0 } };
+
+    // Blank EEPROM: the defaults apply
+    memset(host_eeprom, 0, sizeof(host_eeprom));
+    Calibration_Init(defaults);
+    CHECK_EQ(Calibration_Get(CAL_VOLTAGE)->gain_q16, defaults[CAL_VOLTAGE].gain_q16);
+    CHECK(!Calibration_Lut_Active(CAL_VOLTAGE));
+
+    // Four voltage points (line + table), two current points (line only)
+    Calibration_Capture(CAL_VOLTAGE, 100, 998);
+    Calibration_Capture(CAL_VOLTAGE, 1000, 9978);
+    Calibration_Capture(CAL_VOLTAGE, 2000, 19998);
+    Calibration_Capture(CAL_VOLTAGE, 3000, 29978);
+    Calibration_Capture(CAL_CURRENT, 500, 2000);
+    Calibration_Capture(CAL_CURRENT, 3500, 14000);
+    CHECK(Calibration_Commit());
+    CHECK_EQ(Calibration_Point_Count(CAL_VOLTAGE), 0);
+    CHECK(Calibration_Lut_Active(CAL_VOLTAGE));
+    CHECK(!Calibration_Lut_Active(CAL_CURRENT));
+    CHECK(Calibration_Set_Zero(CAL_CURRENT, 500 << 4));
+    CHECK_EQ(Calibration_Apply(CAL_CURRENT, 500), 0);
+
+    Cal_Line_t voltage = *Calibration_Get(CAL_VOLTAGE);
+    Cal_Line_t current = *Calibration_Get(CAL_CURRENT);
+    int32_t zero = Calibration_Get_Zero(CAL_CURRENT);
+    int32_t readings[4];
+    for (uint32_t i = 0; i < 4; i++) {
+        readings[i] = Calibration_Apply(i & 1 ? CAL_CURRENT : CAL_VOLTAGE, 300 + 1000 * i);
+    }
+
+    // Reboot with other defaults: the stored record wins
+    Calibration_Init(other);
+    CHECK_EQ(Calibration_Get(CAL_VOLTAGE)->gain_q16, voltage.gain_q16);
+    CHECK_EQ(Calibration_Get(CAL_VOLTAGE)->offset, voltage.offset);
+    CHECK_EQ(Calibration_Get(CAL_CURRENT)->gain_q16, current.gain_q16);
+    CHECK_EQ(Calibration_Get_Zero(CAL_CURRENT), zero);
+    CHECK(Calibration_Lut_Active(CAL_VOLTAGE));
+    for (uint32_t i = 0; i < 4; i++) {
+        CHECK_EQ(Calibration_Apply(i & 1 ? CAL_CURRENT : CAL_VOLTAGE, 300 + 1000 * i), readings[i]);
+    }
+
+    // A single flipped bit fails the CRC and falls back to the defaults
+    host_eeprom[3] ^= 1U << 7;
+    Calibration_Init(other);
+    CHECK_EQ(Calibration_Get(CAL_VOLTAGE)->gain_q16, 65536);
+    CHECK(!Calibration_Lut_Active(CAL_VOLTAGE));
+    CHECK_EQ(Calibration_Get_Zero(CAL_CURRENT), 0);
+    host_eeprom[3] ^= 1U << 7;
+
+    CHECK(Calibration_Restore_Defaults());
+    Calibration_Init(defaults);
+    CHECK_EQ(Calibration_Get(CAL_VOLTAGE)->gain_q16, 65536);
+    CHECK(!Calibration_Lut_Active(CAL_VOLTAGE));
+}
+
+// Current sensor of the default line: 4.0128 mA per code around a zero
+// code, plus an offset drift in codes
+#define SENSOR_ZERO_CODE        2187.0
+#define SENSOR_MA_PER_CODE      4.0128
+
+static uint16_t Current_Code(double ma, double drift)
+{
+    return (uint16_t)(SENSOR_ZERO_CODE + drift + ma / SENSOR_MA_PER_CODE + 0.5);
+}
+
+// Sum of conversions at no current: the drift plus a noise of +-noise codes
+static uint32_t Zero_Sum(double drift, uint32_t samples, int32_t noise)
+{
+    uint32_t sum = 0;
+
+    for (uint32_t i = 0; i < samples; i++) {
+        int32_t n = (noise == 0) ? 0 : (int32_t)(i % (2 * noise + 1)) - noise;
+        sum += (uint32_t)((int32_t)Current_Code(0, drift) + n);
+    }
+    return sum;
+}
+
+static void Test_Zero(void)
+{
+    memset(host_eeprom, 0, sizeof(host_eeprom));
+    Calibration_Init(defaults);
+    CHECK_EQ(Calibration_Get_Zero(CAL_CURRENT), 0);
+
+    // Set: the code reads 0, codes below it read negative, and it is stored
+    uint32_t writes = host_eeprom_writes;
+    CHECK(Calibration_Set_Zero(CAL_CURRENT, 2190 << 4));
+    CHECK(host_eeprom_writes > writes);
+    CHECK_EQ(Calibration_Apply(CAL_CURRENT, 2190), 0);
+    CHECK_NEAR(Calibration_Apply(CAL_CURRENT, 2189), -4, 1);
+    CHECK_NEAR(Calibration_Apply(CAL_CURRENT, 2190 - 250), -1003, 2);
+    Calibration_Init(defaults);
+    CHECK_EQ(Calibration_Apply(CAL_CURRENT, 2190), 0);
+
+    // The same zero again does not write
+    writes = host_eeprom_writes;
+    CHECK(Calibration_Set_Zero(CAL_CURRENT, 2190 << 4));
+    CHECK_EQ(host_eeprom_writes, writes);
+
+    // Averaging: the mean to 1/16 code, rounded to nearest. A line of 16
+    // milli-units per code reads it back in steps of 1
+    const Cal_Line_t sixteen[CAL_CHANNELS] = { { 16 * 65536, 0 }, { 16 * 65536, 0 } };
+    memset(host_eeprom, 0, sizeof(host_eeprom));
+    Calibration_Init(sixteen);
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, 2186 * 128 + 2187 * 128, 256, 0), CAL_ZERO_STORED);
+    CHECK_EQ(Calibration_Get_Zero(CAL_CURRENT), -(2186 * 16 + 8));
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, 2186 * 2 + 2187, 3, 0), CAL_ZERO_STORED);
+    CHECK_EQ(Calibration_Get_Zero(CAL_CURRENT), -(2186 * 16 + 5));
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, 2186 + 2187 * 2, 3, 0), CAL_ZERO_STORED);
+    CHECK_EQ(Calibration_Get_Zero(CAL_CURRENT), -(2186 * 16 + 11));
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, 4095 * 70000U, 70000, 0), CAL_ZERO_STORED);
+    CHECK_EQ(Calibration_Get_Zero(CAL_CURRENT), -4095 * 16);
+    CHECK_EQ(Calibration_Apply(CAL_VOLTAGE, 100), 1600);
+
+    // On request a loaded channel is zeroed anyway
+    Calibration_Init(defaults);
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(100, 256, 0), 256, 0), CAL_ZERO_STORED);
+    CHECK_EQ(Calibration_Apply(CAL_CURRENT, Current_Code(0, 100)), 0);
+}
+
+static void Test_Boot_Zero(void)
+{
+    const int32_t limit = 300;
+    uint32_t writes;
+
+    memset(host_eeprom, 0, sizeof(host_eeprom));
+    Calibration_Init(defaults);
+
+    // First boot: a 3 code offset is learned and stored
+    CHECK_NEAR(Calibration_Apply(CAL_CURRENT, Current_Code(0, 3)), 12, 4);
+    writes = host_eeprom_writes;
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(3, 256, 2), 256, limit), CAL_ZERO_STORED);
+    CHECK(host_eeprom_writes > writes);
+    CHECK_NEAR(Calibration_Apply(CAL_CURRENT, Current_Code(0, 3)), 0, 1);
+    int32_t zero = Calibration_Get_Zero(CAL_CURRENT);
+
+    // Later boots with the same offset and other noise keep the record
+    for (int32_t noise = 0; noise <= 3; noise++) {
+        Calibration_Init(defaults);
+        writes = host_eeprom_writes;
+        CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(3, 256, noise), 256, limit), CAL_ZERO_KEPT);
+        CHECK_EQ(host_eeprom_writes, writes);
+        CHECK_EQ(Calibration_Get_Zero(CAL_CURRENT), zero);
+    }
+
+    // A drift of one code is just inside the deadband, two are stored
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(4, 256, 0), 256, limit), CAL_ZERO_KEPT);
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(5, 256, 0), 256, limit), CAL_ZERO_STORED);
+    CHECK_NEAR(Calibration_Apply(CAL_CURRENT, Current_Code(0, 5)), 0, 1);
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(3, 256, 0), 256, limit), CAL_ZERO_STORED);
+
+    // A load at power up is not taken for an offset, in either direction
+    writes = host_eeprom_writes;
+    zero = Calibration_Get_Zero(CAL_CURRENT);
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(3 + 80, 256, 0), 256, limit), CAL_ZERO_LOADED);
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(3 - 80, 256, 0), 256, limit), CAL_ZERO_LOADED);
+    CHECK_EQ(host_eeprom_writes, writes);
+    CHECK_EQ(Calibration_Get_Zero(CAL_CURRENT), zero);
+
+    // A failing EEPROM leaves the correction in use but reports it
+    host_eeprom_fail = 1;
+    CHECK_EQ(Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(-3, 256, 0), 256, limit), CAL_ZERO_FAILED);
+    host_eeprom_fail = 0;
+    CHECK_NEAR(Calibration_Apply(CAL_CURRENT, Current_Code(0, -3)), 0, 1);
+}
+
+static void Test_Signed(void)
+{
+    // Offset drifts of a few codes either way, each zeroed at boot: current
+    // reads signed around zero, and so does power at a positive voltage
+    static const double drifts[] = { -6, -2.5, 0, 1.75, 6 };
+    int32_t worst = 0;
+
+    for (uint8_t d = 0; d < sizeof(drifts) / sizeof(drifts[0]); d++) {
+        memset(host_eeprom, 0, sizeof(host_eeprom));
+        Calibration_Init(defaults);
+        Calibration_Auto_Zero(CAL_CURRENT, Zero_Sum(drifts[d], 256, 1), 256, 300);
+
+        int32_t mv = Calibration_Apply(CAL_VOLTAGE, 1500);
+        CHECK(mv > 0);
+        for (int32_t ma = -2000; ma <= 2000; ma += 250) {
+            int32_t reading = Calibration_Apply(CAL_CURRENT, Current_Code(ma, drifts[d]));
+            int32_t error = reading - ma;
+            int64_t mw = (int64_t)mv * reading / 1000;
+
+            worst = (error < 0 ? -error : error) > worst ? (error < 0 ? -error : error) : worst;
+            CHECK(ma == 0 || (reading < 0) == (ma < 0));
+            CHECK(ma == 0 || (mw < 0) == (ma < 0));
+        }
+    }
+    // Half a code of input rounding, half of drift rounding, and the 1/16
+    // code of the averaged zero
+    CHECK(worst <= (int32_t)(SENSOR_MA_PER_CODE + 1));
+}
+
+int main(void)
+{
+    Test_Crc();
+    Test_Fit();
+    Test_Lut();
+    Test_Record();
+    Test_Zero();
+    Test_Boot_Zero();
+    Test_Signed();
+    return CHECK_DONE();
+}
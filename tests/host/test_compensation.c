@@ -0,0 +1,145 @@
+/**
+  ******************************************************************************
+  * @file           : test_compensation.c
+  * @brief          : VDDA and temperature from VREFINT / TS_CAL, Q16 factors and corrected codes
+  ******************************************************************************
+  * @attention
+  *
+  * The factory words are read through VREFINT_CAL_ADDR and
+  * TEMPSENSOR_CAL1/2_ADDR as main.c does, here pointing at host values. A
+  * model of the ADC turns a supply, a die temperature and an input voltage
+  * into the codes the firmware would read, with a gain drift of the input
+  * paths; the sweep covers VDDA 1.8 to 3.6 V and -40 to 125 C.
+  ******************************************************************************
+  */
+
+#include <math.h>
+#include "check.h"
+#include "main.h"
+#include "compensation.h"
+
+static Compensation_Config_t config = { .tempco_ppm = { 50, -120 } };
+
+// Load the factory words and start like main()
+static void Start(uint16_t vrefint_cal, uint16_t ts_cal1, uint16_t ts_cal2)
+{
+    host_vrefint_cal = vrefint_cal;
+    host_ts_cal1 = ts_cal1;
+    host_ts_cal2 = ts_cal2;
+    config.vrefint_cal = *VREFINT_CAL_ADDR;
+    config.ts_cal1 = *TEMPSENSOR_CAL1_ADDR;
+    config.ts_cal2 = *TEMPSENSOR_CAL2_ADDR;
+    Compensation_Init(&config);
+}
+
+// Code of a voltage at the given supply
+static uint16_t Code(double volts, double vdda)
+{
+    double code = floor(volts * 4095.0 / vdda + 0.5);
+
+    return (uint16_t)((code > 4095) ? 4095 : code);
+}
+
+// Convert VREFINT and the sensor at the given supply and temperature
+static void Convert(double vdda, double celsius)
+{
+    double vref = host_vrefint_cal * 3.0 / 4095.0;
+    double ts30 = host_ts_cal1 * 3.0 / 4095.0;
+    double ts130 = host_ts_cal2 * 3.0 / 4095.0;
+
+    Compensation_Update(Code(vref, vdda), Code(ts30 + (ts130 - ts30) * (celsius - 30) / 100, vdda));
+}
+
+// Factor of a channel to 1/2 LSB of Q16, read back through Compensation_Apply()
+static double Factor_Q16(Cal_Channel_t channel)
+{
+    return 2.0 * Compensation_Apply(channel, 1UL << 15);
+}
+
+static void Test_Init(void)
+{
+    // Before the first update the codes pass unchanged
+    Start(1671, 670, 870);
+    CHECK_EQ(Compensation_Get_Vdda_mV(), COMPENSATION_VDDA_NOMINAL_MV);
+    CHECK_EQ(Compensation_Get_Temperature_dC(), COMPENSATION_TEMP_REF_DC);
+    for (uint32_t raw = 0; raw < 4096; raw += 13) {
+        CHECK_EQ(Compensation_Apply(CAL_VOLTAGE, raw), raw);
+    }
+
+    // Factory values: 3.0 V reads the calibration codes
+    Convert(3.0, 30);
+    CHECK_EQ(Compensation_Get_Vdda_mV(), 3000);
+    CHECK_EQ(Compensation_Get_Temperature_dC(), 300);
+    Convert(3.0, 130);
+    CHECK_EQ(Compensation_Get_Temperature_dC(), 1300);
+
+    // Unusable readings keep the last values
+    Compensation_Update(0, 700);
+    CHECK_EQ(Compensation_Get_Vdda_mV(), 3000);
+    Start(1671, 870, 870);
+    Convert(2.5, 60);
+    CHECK_EQ(Compensation_Get_Vdda_mV(), COMPENSATION_VDDA_NOMINAL_MV);
+    CHECK_EQ(Compensation_Apply(CAL_CURRENT, 2000), 2000);
+
+    // Init starts over
+    Start(1671, 670, 870);
+    Convert(1.8, -40);
+    Start(1671, 670, 870);
+    CHECK_EQ(Compensation_Apply(CAL_CURRENT, 2000), 2000);
+}
+
+static void Test_Sweep(void)
+{
+    // Factory words of three parts, the middle one typical
+    static const uint16_t parts[][3] = { { 1640, 650, 845 }, { 1671, 670, 870 }, { 1700, 690, 900 } };
+    double vdda_error = 0, temperature_error = 0, factor_error = 0, code_error = 0;
+
+    for (uint8_t p = 0; p < 3; p++) {
+        Start(parts[p][0], parts[p][1], parts[p][2]);
+        for (double vdda = 1.8; vdda < 3.6001; vdda += 0.05) {
+            for (double celsius = -40; celsius <= 125; celsius += 5) {
+                Convert(vdda, celsius);
+                double vdda_mv = Compensation_Get_Vdda_mV();
+                double measured_c = Compensation_Get_Temperature_dC() / 10.0;
+                vdda_error = fmax(vdda_error, fabs(vdda_mv - vdda * 1000));
+                temperature_error = fmax(temperature_error, fabs(measured_c - celsius));
+
+                for (uint8_t ch = 0; ch < CAL_CHANNELS; ch++) {
+                    double tempco = config.tempco_ppm[ch] * 1e-6;
+
+                    // Q16 factor from the module's own VDDA and temperature
+                    double expected = 65536.0 * vdda_mv / COMPENSATION_VDDA_NOMINAL_MV *
+                                      (1 - tempco * (measured_c - COMPENSATION_TEMP_REF_DC / 10.0));
+                    factor_error = fmax(factor_error, fabs(Factor_Q16(ch) - expected));
+
+                    // Inputs whose path gain drifts with the die: the code
+                    // reads as at 3.3 V and 25 C
+                    for (double volts = 0.1; volts < fmin(vdda, 3.0); volts += 0.3) {
+                        double gain = 1 + tempco * (celsius - COMPENSATION_TEMP_REF_DC / 10.0);
+                        double wanted = volts * 4095.0 / 3.3;
+                        double error = Compensation_Apply(ch, Code(volts * gain, vdda)) - wanted;
+                        code_error = fmax(code_error, fabs(error));
+                    }
+                }
+            }
+        }
+    }
+    // VDDA: half a VREFINT code at 3.6 V is 1.1 mV. Measured: 1 mV
+    CHECK(vdda_error <= 2);
+    // Temperature: half a sensor code is 0.26 C, the sensor code truncated
+    // to 3.0 V adds up to 0.5 C. Measured: 0.8 C
+    CHECK(temperature_error <= 1);
+    // Factors: read back to 1 LSB, truncation of the supply and drift
+    // terms. Measured: 3.0
+    CHECK(factor_error <= 3.5);
+    // Codes: the input rounding at 1.8 V scaled by 3.3 / 1.8, and the VDDA
+    // error on a near full-scale input, 0.07 % of full scale. Measured: 2.5
+    CHECK(code_error <= 3);
+}
+
+int main(void)
+{
+    Test_Init();
+    Test_Sweep();
+    return CHECK_DONE();
+}
@@ -0,0 +1,198 @@
+/**
+  ******************************************************************************
+  * @file           : test_demand.c
+  * @brief          : Demand windows, ring rollover, peaks against a brute-force sum
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include "check.h"
+#include "demand.h"
+
+static Demand_t demand;
+
+// Fresh state primed with a first sample
+static void Start(int32_t power_mw)
+{
+    demand = (Demand_t){ 0 };
+    Demand_Sample(&demand, power_mw, 0);
+}
+
+static void Run(int32_t power_mw, uint32_t step_us, uint64_t total_us)
+{
+    for (uint64_t t = 0; t < total_us; t += step_us) {
+        Demand_Sample(&demand, power_mw, step_us);
+    }
+}
+
+// Sum of the newest buckets of the ring
+static int64_t Ring_Sum(uint8_t length)
+{
+    int64_t sum = 0;
+
+    for (uint8_t k = 1; k <= length; k++) {
+        sum += demand.bucket_mj[(demand.head + DEMAND_BUCKETS - k) % DEMAND_BUCKETS];
+    }
+    return sum;
+}
+
+static void Test_Windows(void)
+{
+    CHECK_EQ(Demand_Window_Minutes(0), 1);
+    CHECK_EQ(Demand_Window_Minutes(1), 5);
+    CHECK_EQ(Demand_Window_Minutes(2), 15);
+
+    // Before a bucket closes there is nothing to average
+    Start(10000);
+    Run(10000, 65536, DEMAND_BUCKET_US - 65536);
+    CHECK_EQ(demand.filled, 0);
+    CHECK_EQ(demand.values.average_mw[0], 0);
+
+    // Partly filled windows average the buckets seen, peaks wait for a full one
+    Run(10000, 65536, 2 * 65536);
+    CHECK_EQ(demand.filled, 1);
+    for (uint8_t w = 0; w < DEMAND_WINDOWS; w++) {
+        CHECK_NEAR(demand.values.average_mw[w], 10000, 1);
+        CHECK_EQ(demand.values.peak_mw[w], 0);
+    }
+
+    // 10 W for 20 minutes: every window full and at 10 W
+    Run(10000, 65536, 1200000000ULL);
+    CHECK_EQ(demand.filled, DEMAND_BUCKETS);
+    for (uint8_t w = 0; w < DEMAND_WINDOWS; w++) {
+        CHECK_NEAR(demand.values.average_mw[w], 10000, 1);
+        CHECK_NEAR(demand.values.peak_mw[w], 10000, 1);
+    }
+
+    // Then 40 W for 2 minutes: 1 m = 40 W, 5 m = 22 W, 15 m = 14 W
+    Run(40000, 65536, 120000000ULL);
+    CHECK_NEAR(demand.values.average_mw[0], 40000, 700);
+    CHECK_NEAR(demand.values.average_mw[1], 22000, 200);
+    CHECK_NEAR(demand.values.average_mw[2], 14000, 100);
+    CHECK_NEAR(demand.values.peak_mw[0], 40000, 700);
+    CHECK_NEAR(demand.values.peak_mw[2], 14000, 100);
+}
+
+static void Test_Peaks(void)
+{
+    // 1 minute at 60 W, 2 minutes off, for 30 minutes
+    Start(0);
+    for (uint32_t minute = 0; minute < 30; minute++) {
+        Run((minute % 3 == 0) ? 60000 : 0, 50000, 60000000ULL);
+    }
+    CHECK_NEAR(demand.values.average_mw[2], 20000, 300);
+    CHECK_NEAR(demand.values.peak_mw[0], 60000, 1000);
+    CHECK_NEAR(demand.values.peak_mw[1], 24000, 500);
+
+    // Peaks survive lower load and clear on their own
+    Run(1000, 50000, 900000000ULL);
+    CHECK_NEAR(demand.values.average_mw[2], 1000, 1);
+    CHECK_NEAR(demand.values.peak_mw[0], 60000, 1000);
+    Demand_Reset_Peaks(&demand);
+    CHECK_EQ(demand.values.peak_mw[0], 0);
+    CHECK_NEAR(demand.values.average_mw[2], 1000, 1);
+    CHECK_EQ(demand.filled, DEMAND_BUCKETS);
+
+    // Power fed back averages negative and never sets a peak
+    Start(-3000);
+    Run(-3000, 65536, 600000000ULL);
+    CHECK_NEAR(demand.values.average_mw[1], -3000, 1);
+    CHECK_EQ(demand.values.peak_mw[1], 0);
+}
+
+static void Test_Gap(void)
+{
+    // One 3 minute interval fills all nine buckets it spans
+    Start(5000);
+    Demand_Sample(&demand, 5000, 1000);
+    Demand_Sample(&demand, 5000, 180000000UL);
+    CHECK_EQ(demand.filled, 9);
+    CHECK_NEAR(demand.values.average_mw[1], 5000, 1);
+
+    // The longest interval (71 minutes) rolls the ring over
+    Demand_Sample(&demand, 7000, UINT32_MAX);
+    CHECK_EQ(demand.filled, DEMAND_BUCKETS);
+    CHECK_NEAR(demand.values.average_mw[2], 6000, 1);
+    CHECK_NEAR(demand.values.peak_mw[2], 6000, 1);
+
+    // Reset keeps the last sample, the next interval still counts
+    Demand_Reset(&demand);
+    CHECK_EQ(demand.filled, 0);
+    Demand_Sample(&demand, 7000, DEMAND_BUCKET_US);
+    CHECK_EQ(demand.filled, 1);
+    CHECK_NEAR(demand.values.average_mw[0], 7000, 1);
+}
+
+static void Test_Reference(void)
+{
+    static double bucket_mj[40000];
+    uint32_t buckets = 0;
+    double open_mj = 0;
+    uint64_t open_us = 0;
+    int32_t last_mw = 0;
+    double peak_mw[DEMAND_WINDOWS] = { 0 };
+    uint32_t drift = 0, wrong = 0;
+
+    // Random load and jittered ticks for about 10 hours, many ring rollovers
+    Start(0);
+    srand(1);
+    for (uint32_t i = 0; i < 500000; i++) {
+        uint32_t delta_us = 60000 + (uint32_t)rand() % 20000;
+        int32_t power_mw = (int32_t)(rand() % 150000) - 20000;
+        double mean_mw = (int32_t)(((int64_t)last_mw + power_mw) / 2);
+
+        for (uint32_t rest = delta_us; rest > 0;) {
+            uint32_t step = (rest < DEMAND_BUCKET_US - open_us) ? rest : (uint32_t)(DEMAND_BUCKET_US - open_us);
+            open_mj += mean_mw * step / 1e6;
+            open_us += step;
+            rest -= step;
+            if (open_us == DEMAND_BUCKET_US) {
+                bucket_mj[buckets++] = open_mj;
+                open_mj = 0;
+                open_us = 0;
+                for (uint8_t w = 0; w < DEMAND_WINDOWS; w++) {
+                    uint8_t length = (w == 0) ? 3 : (w == 1) ? 15 : DEMAND_BUCKETS;
+                    if (buckets >= length) {
+                        double sum = 0;
+                        for (uint8_t k = 1; k <= length; k++) {
+                            sum += bucket_mj[buckets - k];
+                        }
+                        peak_mw[w] = (sum / (length * DEMAND_BUCKET_S) > peak_mw[w]) ?
+                                     sum / (length * DEMAND_BUCKET_S) : peak_mw[w];
+                    }
+                }
+            }
+        }
+        last_mw = power_mw;
+        Demand_Sample(&demand, power_mw, delta_us);
+
+        // The running sums stay equal to the ring, nothing drifts
+        if (i % 97 == 0) {
+            drift += demand.window_mj[0] != Ring_Sum(3);
+            drift += demand.window_mj[1] != Ring_Sum(15);
+            drift += demand.window_mj[2] != Ring_Sum(DEMAND_BUCKETS);
+        }
+    }
+    CHECK_EQ(drift, 0);
+    CHECK(buckets > 10 * DEMAND_BUCKETS);
+
+    for (uint8_t w = 0; w < DEMAND_WINDOWS; w++) {
+        uint8_t length = (w == 0) ? 3 : (w == 1) ? 15 : DEMAND_BUCKETS;
+        double sum = 0;
+        for (uint8_t k = 1; k <= length; k++) {
+            sum += bucket_mj[buckets - k];
+        }
+        wrong += abs(demand.values.average_mw[w] - (int32_t)(sum / (length * DEMAND_BUCKET_S))) > 2;
+        wrong += abs(demand.values.peak_mw[w] - (int32_t)peak_mw[w]) > 2;
+    }
+    CHECK_EQ(wrong, 0);
+}
+
+int main(void)
+{
+    Test_Windows();
+    Test_Peaks();
+    Test_Gap();
+    Test_Reference();
+    return CHECK_DONE();
+}
@@ -0,0 +1,159 @@
+/**
+  ******************************************************************************
+  * @file           : test_encoder.c
+  * @brief          : Quadrature replay with bounce, acceleration and counter mode
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include "check.h"
+#include "encoder.h"
+
+#define REST                    0x03    // A and B high between detents
+
+// Gray code cycle in the positive direction, starting after the rest state
+static const uint8_t forward[4] = { 0x01, 0x00, 0x02, 0x03 };
+
+static Encoder_t encoder;
+static uint32_t now_ms;
+
+// Turn by whole detents, one edge every edge_ms, bouncing each edge if asked
+static int32_t Turn(int32_t detents, uint32_t edge_ms, uint8_t bounce)
+{
+    int32_t steps = 0;
+    uint8_t state = REST;
+
+    for (int32_t d = 0; d < abs(detents); d++) {
+        for (uint8_t q = 0; q < 4; q++) {
+            uint8_t next = (detents > 0) ? forward[q] : forward[(6 - q) % 4];
+            now_ms += edge_ms;
+            for (uint8_t b = 0; b < bounce; b++) {
+                steps += Encoder_Decode(&encoder, next, now_ms);
+                steps += Encoder_Decode(&encoder, state, now_ms);
+            }
+            steps += Encoder_Decode(&encoder, next, now_ms);
+            state = next;
+        }
+    }
+    return steps;
+}
+
+static void Test_Detents(void)
+{
+    Encoder_Init(&encoder, REST);
+    now_ms = 0;
+
+    // Slow turns: one step per detent, both ways
+    CHECK_EQ(Turn(1, 100, 0), 1);
+    CHECK_EQ(Turn(5, 100, 0), 5);
+    CHECK_EQ(Turn(-3, 100, 0), -3);
+
+    // Three bounces on every edge do not add or lose a detent
+    CHECK_EQ(Turn(4, 100, 3), 4);
+    CHECK_EQ(Turn(-4, 100, 3), -4);
+
+    // Half a detent and back is no step
+    int32_t steps = 0;
+    steps += Encoder_Decode(&encoder, 0x01, now_ms += 100);
+    steps += Encoder_Decode(&encoder, 0x00, now_ms += 100);
+    steps += Encoder_Decode(&encoder, 0x01, now_ms += 100);
+    steps += Encoder_Decode(&encoder, REST, now_ms += 100);
+    CHECK_EQ(steps, 0);
+
+    // Repeated states are not edges
+    CHECK_EQ(Encoder_Decode(&encoder, REST, now_ms += 100), 0);
+
+    // Both channels at once is dropped, the cycle goes on from there
+    steps = Encoder_Decode(&encoder, 0x01, now_ms += 100);
+    steps += Encoder_Decode(&encoder, 0x02, now_ms += 100);
+    steps += Encoder_Decode(&encoder, REST, now_ms += 100);
+    CHECK_EQ(steps, 1);
+}
+
+static void Test_Acceleration(void)
+{
+    // Detent intervals: 4 edges apart
+    Encoder_Init(&encoder, REST);
+    now_ms = 1000;
+    CHECK_EQ(Turn(1, 250, 0), 1);
+    CHECK_EQ(Turn(1, 12, 0), 1);        // 48 ms
+    CHECK_EQ(Turn(1, 9, 0), 10);        // 36 ms
+    CHECK_EQ(Turn(1, 3, 0), 100);       // 12 ms
+    CHECK_EQ(Turn(-1, 3, 0), -100);
+    CHECK_EQ(Turn(-1, 50, 0), -1);
+
+    // Timestamps keep working across the 32-bit wrap
+    now_ms = UINT32_MAX - 13;
+    CHECK_EQ(Turn(1, 3, 0), 1);
+    CHECK_EQ(Turn(1, 3, 0), 100);
+}
+
+static void Test_Replay(void)
+{
+    int32_t position = 0, steps = 0;
+    uint8_t state = REST, phase = 3;
+
+    // A random walk of valid edges with bounce, slow enough for no
+    // acceleration: the steps add up to the detents between the end points
+    Encoder_Init(&encoder, REST);
+    now_ms = 0;
+    srand(5);
+    for (uint32_t i = 0; i < 200000; i++) {
+        int8_t move = (rand() % 3 == 0) ? -1 : 1;
+        uint8_t next;
+
+        phase = (uint8_t)((phase + 4 + move) % 4);
+        next = forward[phase];
+        position += move;
+        now_ms += 50;
+        if (rand() % 4 == 0) {
+            steps += Encoder_Decode(&encoder, next, now_ms);
+            steps += Encoder_Decode(&encoder, state, now_ms);
+        }
+        steps += Encoder_Decode(&encoder, next, now_ms);
+        state = next;
+    }
+    // Come back to rest on the nearer side
+    while (state != REST) {
+        phase = (uint8_t)((phase + 1) % 4);
+        state = forward[phase];
+        position++;
+        steps += Encoder_Decode(&encoder, state, now_ms += 50);
+    }
+    CHECK_EQ(position % 4, 0);
+    CHECK_EQ(steps, position / 4);
+    CHECK(abs(position) > 400);
+}
+
+static void Test_Counter(void)
+{
+    // Partial detents carry over, the counter wraps both ways
+    Encoder_Init_Counter(&encoder, 65534);
+    now_ms = 0;
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 65535, now_ms += 100), 0);
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 1, now_ms += 100), 0);
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 2, now_ms += 100), 1);
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 65535, now_ms += 100), 0);
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 65532, now_ms += 100), -1);
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 65534, now_ms += 100), 0);
+
+    // Several detents in one tick: the interval per detent sets the factor
+    Encoder_Init_Counter(&encoder, 100);
+    now_ms = 1000;
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 112, now_ms += 300), 3);
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 120, now_ms += 60), 20);
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 100, now_ms += 50), -ENCODER_MAX_STEPS);
+
+    // Large jumps are limited
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 100 + 4 * 500, now_ms += 10000), ENCODER_MAX_STEPS);
+    CHECK_EQ(Encoder_Decode_Counter(&encoder, 100, now_ms += 10000), -ENCODER_MAX_STEPS);
+}
+
+int main(void)
+{
+    Test_Detents();
+    Test_Acceleration();
+    Test_Replay();
+    Test_Counter();
+    return CHECK_DONE();
+}
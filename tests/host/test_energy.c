@@ -0,0 +1,164 @@
+/**
+  ******************************************************************************
+  * @file           : test_energy.c
+  * @brief          : Trapezoid split at zero crossings, gaps and 64-bit counters
+  ******************************************************************************
+  */
+
+#include "check.h"
+#include "energy.h"
+
+static Energy_t energy;
+
+// Fresh counters primed with a first sample
+static void Start(int32_t power_mw, int32_t current_ma)
+{
+    energy = (Energy_t){ 0 };
+    Energy_Sample(&energy, power_mw, current_ma, 0);
+}
+
+static void Test_Trapezoid(void)
+{
+    // The first sample only primes, there is no interval yet
+    energy = (Energy_t){ 0 };
+    Energy_Sample(&energy, 5000, 1000, 65536);
+    CHECK_EQ(energy.import_nj, 0);
+    CHECK(energy.primed);
+
+    // 1 W to 3 W over 1 ms: 2 mJ
+    Start(1000, 200);
+    Energy_Sample(&energy, 3000, 600, 1000);
+    CHECK_EQ(energy.import_nj, 2000000);
+    CHECK_EQ(energy.charge_in_nc, 400000);
+    CHECK_EQ(energy.export_nj, 0);
+
+    // All negative goes to export, a zero end does not change the sign
+    Start(-1000, -100);
+    Energy_Sample(&energy, 0, 0, 1000);
+    CHECK_EQ(energy.export_nj, 500000);
+    CHECK_EQ(energy.charge_out_nc, 50000);
+    CHECK_EQ(energy.import_nj, 0);
+    Energy_Sample(&energy, 2000, 200, 1000);
+    CHECK_EQ(energy.import_nj, 1000000);
+    CHECK_EQ(energy.export_nj, 500000);
+}
+
+static void Test_Zero_Crossing(void)
+{
+    // +3 W to -1 W over 4 ms crosses at 3 ms: 4.5 mJ in, 0.5 mJ out
+    Start(3000, 300);
+    Energy_Sample(&energy, -1000, -100, 4000);
+    CHECK_EQ(energy.import_nj, 4500000);
+    CHECK_EQ(energy.export_nj, 500000);
+    CHECK_EQ(energy.charge_in_nc, 450000);
+    CHECK_EQ(energy.charge_out_nc, 50000);
+
+    // The other direction mirrors it
+    Start(-1000, -100);
+    Energy_Sample(&energy, 3000, 300, 4000);
+    CHECK_EQ(energy.export_nj, 500000);
+    CHECK_EQ(energy.import_nj, 4500000);
+
+    // A +-10 W square wave neither cancels nor leaks into the other counter
+    Start(10000, 1500);
+    for (uint32_t i = 1; i <= 20000; i++) {
+        int32_t sign = (i & 1) ? -1 : 1;
+        Energy_Sample(&energy, sign * 10000, sign * 1500, 66000);
+    }
+    CHECK_EQ(energy.import_nj, energy.export_nj);
+    CHECK_EQ(energy.import_nj, 20000ULL * 10000 * 33000 / 2);
+    CHECK_EQ(Energy_Net_mWh(&energy), 0);
+    CHECK_EQ(Energy_Net_mAh(&energy), 0);
+    CHECK_EQ(Energy_To_mWh(energy.import_nj), 917);
+
+    // Crossing times truncate, the two halves never exceed the interval
+    Start(1, 1);
+    Energy_Sample(&energy, -2, -2, 1000);
+    CHECK_EQ(energy.import_nj, 1 * 333 / 2);
+    CHECK_EQ(energy.export_nj, 2 * 667 / 2);
+}
+
+static void Test_Gap(void)
+{
+    // Exactly ENERGY_GAP_US is still a normal tick
+    Start(1000, 100);
+    Energy_Sample(&energy, 1000, 100, ENERGY_GAP_US);
+    CHECK_EQ(energy.gaps, 0);
+    CHECK_EQ(energy.import_nj, 1000ULL * ENERGY_GAP_US);
+
+    // Longer intervals are counted and still bridged
+    Energy_Sample(&energy, 3000, 100, ENERGY_GAP_US + 1);
+    CHECK_EQ(energy.gaps, 1);
+    CHECK_EQ(energy.gap_ms, ENERGY_GAP_US / 1000);
+    CHECK_EQ(energy.import_nj, 1000ULL * ENERGY_GAP_US + 2000ULL * (ENERGY_GAP_US + 1));
+
+    Energy_Sample(&energy, 3000, 100, 1500000);
+    CHECK_EQ(energy.gaps, 2);
+    CHECK_EQ(energy.gap_ms, ENERGY_GAP_US / 1000 + 1500);
+
+    // Reset clears the gap statistics, keeps the last sample
+    Energy_Reset(&energy);
+    CHECK_EQ(energy.gaps, 0);
+    CHECK_EQ(energy.gap_ms, 0);
+    Energy_Sample(&energy, 3000, 100, 1000);
+    CHECK_EQ(energy.import_nj, 3000000);
+
+    // A zero interval adds nothing
+    Energy_Sample(&energy, -3000, -100, 0);
+    CHECK_EQ(energy.import_nj, 3000000);
+    CHECK_EQ(energy.export_nj, 0);
+}
+
+static void Test_Range(void)
+{
+    // Full scale samples over the longest interval stay exact in 64 bits
+    Start(INT32_MAX, INT32_MAX);
+    Energy_Sample(&energy, INT32_MAX, INT32_MAX, UINT32_MAX);
+    CHECK(energy.import_nj == (uint64_t)INT32_MAX * UINT32_MAX);
+    CHECK(energy.charge_in_nc == (uint64_t)INT32_MAX * UINT32_MAX);
+
+    // INT32_MIN has a magnitude, not a wrapped one
+    Start(INT32_MIN, 0);
+    Energy_Sample(&energy, INT32_MIN, 0, 1000);
+    CHECK(energy.export_nj == 2147483648ULL * 1000);
+    CHECK_EQ(energy.import_nj, 0);
+
+    // Crossing between the extremes: 2^63 product in the split, t0 = INT32_MAX
+    Start(INT32_MAX, 0);
+    Energy_Sample(&energy, INT32_MIN, 0, UINT32_MAX);
+    CHECK(energy.import_nj == ((uint64_t)INT32_MAX * INT32_MAX) >> 1);
+    CHECK(energy.export_nj == 1ULL << 61);
+
+    // 1 W for an hour at 65.536 ms ticks, past 2^32 nJ
+    Start(1000, 1000);
+    for (uint32_t i = 0; i < 54932; i++) {
+        Energy_Sample(&energy, 1000, 1000, 65536);
+    }
+    CHECK(energy.import_nj == 1000ULL * 65536 * 54932);
+    CHECK_EQ(Energy_To_mWh(energy.import_nj), 1000);
+    CHECK_EQ(Energy_To_mAh(energy.charge_in_nc), 1000);
+}
+
+static void Test_Scale(void)
+{
+    // Rounds half away from zero
+    CHECK_EQ(Energy_To_mWh(ENERGY_NJ_PER_MWH / 2 - 1), 0);
+    CHECK_EQ(Energy_To_mWh(ENERGY_NJ_PER_MWH / 2), 1);
+    energy = (Energy_t){ .export_nj = ENERGY_NJ_PER_MWH * 3 / 2 };
+    CHECK_EQ(Energy_Net_mWh(&energy), -2);
+
+    // Saturates instead of wrapping
+    CHECK_EQ(Energy_To_mWh(UINT64_MAX), INT32_MAX);
+    energy = (Energy_t){ .charge_out_nc = UINT64_MAX };
+    CHECK_EQ(Energy_Net_mAh(&energy), -INT32_MAX);
+}
+
+int main(void)
+{
+    Test_Trapezoid();
+    Test_Zero_Crossing();
+    Test_Gap();
+    Test_Range();
+    Test_Scale();
+    return CHECK_DONE();
+}
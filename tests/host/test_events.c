@@ -0,0 +1,210 @@
+/**
+  ******************************************************************************
+  * @file           : test_events.c
+  * @brief          : Load step debounce, hysteresis, log ring and retried reads
+  ******************************************************************************
+  */
+
+#include <signal.h>
+#include <sys/time.h>
+#include "check.h"
+#include "events.h"
+
+#define TICK_MS                 66U
+#define BLOCK_MS                2048U           // Stress: one level, one event per block
+#define STRESS_EVENTS           20000UL
+
+static const Events_Config_t config = { 20, 25, 250 };     // 2 W, 25 %, 250 ms
+static Events_t events;
+static uint32_t now_ms;
+
+static void Start(int32_t power_mw)
+{
+    Events_Reset(&events);
+    now_ms = 1000;
+    Events_Sample(&events, &config, power_mw, now_ms);
+}
+
+static void Run(int32_t power_mw, uint32_t duration_ms)
+{
+    for (uint32_t t = 0; t < duration_ms; t += TICK_MS) {
+        now_ms += TICK_MS;
+        Events_Sample(&events, &config, power_mw, now_ms);
+    }
+}
+
+static void Test_Debounce(void)
+{
+    Load_Event_t event;
+
+    // 10 W for 200 ms is shorter than the debounce time
+    Start(5000);
+    Run(5000, 2000);
+    Run(15000, 200);
+    Run(5000, 3000);
+    CHECK_EQ(Events_Total(&events), 0);
+
+    // Held: one event, timed at the first sample of the step
+    uint32_t onset_ms = now_ms + TICK_MS;
+    Run(15000, 2000);
+    CHECK_EQ(Events_Total(&events), 1);
+    CHECK(Events_Get(&events, 0, &event));
+    CHECK_EQ(event.time_ms, onset_ms);
+    CHECK_EQ(event.before_dw, 50);
+    CHECK_EQ(event.after_dw, 150);
+
+    // Down again, a second event and no repeats while the level holds
+    Run(5000, 5000);
+    CHECK_EQ(Events_Total(&events), 2);
+    CHECK(Events_Get(&events, 0, &event));
+    CHECK_EQ(event.before_dw, 150);
+    CHECK_EQ(event.after_dw, 50);
+
+    // The inrush peak falls in the settle time, not in the mean
+    Run(40000, 2 * TICK_MS);
+    Run(15000, 2000);
+    CHECK_EQ(Events_Total(&events), 3);
+    CHECK(Events_Get(&events, 0, &event));
+    CHECK_EQ(event.after_dw, 150);
+}
+
+static void Test_Hysteresis(void)
+{
+    Load_Event_t event;
+
+    // 1.8 W: past the release level (1.5 W) but never the 2 W step
+    Start(10000);
+    Run(11800, 3000);
+    CHECK_EQ(Events_Total(&events), 0);
+
+    // 3 W that sags to 1.7 W once pending holds between the two levels
+    Start(10000);
+    Run(10000, 1000);
+    Run(13000, 5 * TICK_MS);
+    Run(11700, 2000);
+    CHECK_EQ(Events_Total(&events), 1);
+    CHECK(Events_Get(&events, 0, &event));
+    CHECK_EQ(event.after_dw, 117);
+
+    // Sagging below the release level drops the candidate
+    Start(10000);
+    Run(10000, 1000);
+    Run(13000, 5 * TICK_MS);
+    Run(11200, 2000);
+    CHECK_EQ(Events_Total(&events), 0);
+
+    // A slow ramp (0.3 W per minute) only moves the steady level
+    Start(10000);
+    for (uint32_t t = 0; t < 600000; t += TICK_MS) {
+        now_ms += TICK_MS;
+        Events_Sample(&events, &config, 10000 + (int32_t)(t / 200), now_ms);
+    }
+    CHECK_EQ(Events_Total(&events), 0);
+
+    // Power fed back steps as well, a zero threshold reports nothing
+    Start(-5000);
+    Run(-5000, 1000);
+    Run(-15000, 2000);
+    CHECK_EQ(Events_Total(&events), 1);
+    CHECK(Events_Get(&events, 0, &event));
+    CHECK_EQ(event.before_dw, -50);
+    CHECK_EQ(event.after_dw, -150);
+
+    Events_Config_t off = { 0, 25, 250 };
+    Start(0);
+    for (uint32_t i = 0; i < 100; i++) {
+        now_ms += TICK_MS;
+        Events_Sample(&events, &off, (i / 20 % 2) ? 50000 : 0, now_ms);
+    }
+    CHECK_EQ(Events_Total(&events), 0);
+}
+
+static void Test_Ring(void)
+{
+    Load_Event_t event;
+    uint32_t times[20];
+
+    // 20 steps: the log keeps the last EVENTS_LOG, newest first
+    Start(0);
+    for (uint32_t i = 0; i < 20; i++) {
+        times[i] = now_ms + TICK_MS;
+        Run((i % 2) ? 0 : 10000, 2000);
+    }
+    CHECK_EQ(Events_Total(&events), 20);
+    CHECK_EQ(Events_Count(&events), EVENTS_LOG);
+    for (uint8_t age = 0; age < EVENTS_LOG; age++) {
+        CHECK(Events_Get(&events, age, &event));
+        CHECK_EQ(event.time_ms, times[19 - age]);
+        CHECK_EQ(event.after_dw, (age % 2) ? 100 : 0);
+    }
+    CHECK(!Events_Get(&events, EVENTS_LOG, &event));
+
+    // Reset empties the log
+    Events_Reset(&events);
+    CHECK_EQ(Events_Count(&events), 0);
+    CHECK(!Events_Get(&events, 0, &event));
+}
+
+// Stress level of a block: alternating, with a size that identifies it
+static int32_t Block_Power_mw(uint32_t block)
+{
+    return (block % 2) ? 500 : 10000 + 100 * (int32_t)(block % 64);
+}
+
+static volatile uint32_t stress_block;
+
+// The tick: a timer signal interrupts the reader anywhere, like TIM6
+// preempting the main loop, and one block of samples logs one event
+static void Tick_Handler(int signal)
+{
+    uint32_t block = ++stress_block;
+
+    (void)signal;
+    for (uint32_t t = 0; t < 2000; t += TICK_MS) {
+        Events_Sample(&events, &config, Block_Power_mw(block), block * BLOCK_MS + t);
+    }
+}
+
+static void Test_Retry(void)
+{
+    struct itimerval period = { { 0, 20 }, { 0, 20 } };
+    struct itimerval stop = { { 0, 0 }, { 0, 0 } };
+    Load_Event_t event;
+    uint32_t reads = 0, torn = 0, stale = 0;
+
+    Events_Reset(&events);
+    Events_Sample(&events, &config, Block_Power_mw(0), 0);
+    stress_block = 0;
+    signal(SIGALRM, Tick_Handler);
+    setitimer(ITIMER_REAL, &period, NULL);
+
+    // Block b logs event b - 1. The oldest entry is the next one
+    // overwritten: the copy must be it at some point during the call, not
+    // the newer event that replaced it meanwhile, and must be whole
+    while (Events_Total(&events) < STRESS_EVENTS) {
+        uint32_t before = Events_Total(&events);
+        if (Events_Get(&events, EVENTS_LOG - 1, &event)) {
+            uint32_t after = Events_Total(&events);
+            uint32_t block = event.time_ms / BLOCK_MS;
+            reads++;
+            torn += event.after_dw * 100 != Block_Power_mw(block) ||
+                    event.before_dw * 100 != Block_Power_mw(block - 1);
+            stale += block - 1 + EVENTS_LOG < before || block - 1 + EVENTS_LOG > after;
+        }
+    }
+    setitimer(ITIMER_REAL, &stop, NULL);
+    signal(SIGALRM, SIG_DFL);
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(stale, 0);
+    CHECK(reads > STRESS_EVENTS);
+}
+
+int main(void)
+{
+    Test_Debounce();
+    Test_Hysteresis();
+    Test_Ring();
+    Test_Retry();
+    return CHECK_DONE();
+}
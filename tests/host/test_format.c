@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file           : test_format.c
+  * @brief          : Integer formatter output against the sprintf it replaced
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "check.h"
+#include "format.h"
+
+#define CHECK_STR(call, expected) do { \
+        char check_buf[32]; \
+        char* check_end; \
+        memset(check_buf, 'x', sizeof(check_buf)); \
+        check_end = call; \
+        check_count++; \
+        if (strcmp(check_buf, expected) != 0 || check_end != check_buf + strlen(expected)) { \
+            check_failures++; \
+            printf("%s:%d: %s gave \"%s\", expected \"%s\"\n", __FILE__, __LINE__, \
+                   #call, check_buf, expected); \
+        } \
+    } while (0)
+
+static void Test_Uint(void)
+{
+    CHECK_STR(Format_Uint(check_buf, 0, 0, '0'), "0");
+    CHECK_STR(Format_Uint(check_buf, 7, 3, '0'), "007");
+    CHECK_STR(Format_Uint(check_buf, 42, 5, ' '), "   42");
+    CHECK_STR(Format_Uint(check_buf, 12345, 2, '0'), "12345");
+    CHECK_STR(Format_Uint(check_buf, 4294967295UL, 0, '0'), "4294967295");
+}
+
+static void Test_Fixed(void)
+{
+    CHECK_STR(Format_Fixed(check_buf, 123, 1, 0), "12.3");
+    CHECK_STR(Format_Fixed(check_buf, 5, 2, 0), "0.05");
+    CHECK_STR(Format_Fixed(check_buf, 100, 2, 0), "1.00");
+    CHECK_STR(Format_Fixed(check_buf, 42, 0, 0), "42");
+    CHECK_STR(Format_Fixed(check_buf, 0, 3, 0), "0.000");
+
+    // Negatives keep the sign also between -1 and 0
+    CHECK_STR(Format_Fixed(check_buf, -5, 1, 0), "-0.5");
+    CHECK_STR(Format_Fixed(check_buf, -1234, 2, 0), "-12.34");
+    CHECK_STR(Format_Fixed(check_buf, -7, 0, 0), "-7");
+
+    // Range limits: no overflow in the magnitude or the divisor
+    CHECK_STR(Format_Fixed(check_buf, INT32_MAX, 0, 0), "2147483647");
+    CHECK_STR(Format_Fixed(check_buf, INT32_MIN, 0, 0), "-2147483648");
+    CHECK_STR(Format_Fixed(check_buf, INT32_MIN, 3, 0), "-2147483.648");
+    CHECK_STR(Format_Fixed(check_buf, INT32_MAX, 9, 0), "2.147483647");
+    CHECK_STR(Format_Fixed(check_buf, -1, 9, 0), "-0.000000001");
+
+    // Right alignment, the sign moves with the number
+    CHECK_STR(Format_Fixed(check_buf, 123, 1, 6), "  12.3");
+    CHECK_STR(Format_Fixed(check_buf, -123, 1, 6), " -12.3");
+    CHECK_STR(Format_Fixed(check_buf, 12345, 1, 4), "1234.5");
+}
+
+static void Test_Energy(void)
+{
+    CHECK_STR(Format_Energy(check_buf, 0), "0mWh");
+    CHECK_STR(Format_Energy(check_buf, 999), "999mWh");
+    CHECK_STR(Format_Energy(check_buf, 1000), "1.00Wh");
+
+    // Truncates like the "%d.%02d" displays it replaced, never rounds up a scale
+    CHECK_STR(Format_Energy(check_buf, 1999), "1.99Wh");
+    CHECK_STR(Format_Energy(check_buf, 999999), "999.99Wh");
+    CHECK_STR(Format_Energy(check_buf, 1000000), "1.000kWh");
+    CHECK_STR(Format_Energy(check_buf, 1234567), "1.234kWh");
+    CHECK_STR(Format_Energy(check_buf, 4294967295UL), "4294.967kWh");
+}
+
+static void Test_Chain(void)
+{
+    char line[32];
+    char* p = line;
+
+    p = Format_String(p, "V:");
+    p = Format_Fixed(p, 123, 1, 0);
+    p = Format_String(p, "V I:");
+    p = Format_Fixed(p, -45, 2, 6);
+    CHECK(strcmp(line, "V:12.3V I: -0.45") == 0);
+    CHECK(p == line + strlen(line));
+
+    // A field already wider than requested is left alone
+    p = Format_String(line, "12345");
+    CHECK(Format_Pad(line, p, 3) == p);
+    CHECK(strcmp(line, "12345") == 0);
+}
+
+int main(void)
+{
+    Test_Uint();
+    Test_Fixed();
+    Test_Energy();
+    Test_Chain();
+    return CHECK_DONE();
+}
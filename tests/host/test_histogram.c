@@ -0,0 +1,181 @@
+/**
+  ******************************************************************************
+  * @file           : test_histogram.c
+  * @brief          : Load profile edges, bin search, time accounting and saturation
+  ******************************************************************************
+  */
+
+#include <math.h>
+#include "check.h"
+#include "histogram.h"
+
+static Histogram_t histogram;
+
+// Linear search over the edges, the reference for Histogram_Bin()
+static uint8_t Reference_Bin(int32_t power_mw)
+{
+    uint8_t bin = 0;
+
+    for (uint8_t k = 0; k < HISTOGRAM_BINS - 1; k++) {
+        if (power_mw > 0 && (uint32_t)power_mw >= histogram.edge_mw[k]) {
+            bin = k + 1;
+        }
+    }
+    return bin;
+}
+
+static uint64_t Total_ms(void)
+{
+    uint64_t total = 0;
+
+    for (uint8_t k = 0; k < HISTOGRAM_BINS; k++) {
+        total += histogram.bin_ms[k];
+    }
+    return total;
+}
+
+static void Test_Edges(void)
+{
+    // Q16 steps within 1 mW + 20 ppm of base * 10^(k / n), clamped to INT32_MAX
+    for (uint16_t per_decade = 1; per_decade <= HISTOGRAM_MAX_PER_DECADE; per_decade++) {
+        for (uint16_t base = 10; base <= 10000; base *= 10) {
+            Histogram_Config_t config = { base, per_decade };
+            Histogram_Configure(&histogram, &config);
+            for (uint8_t k = 0; k < HISTOGRAM_BINS - 1; k++) {
+                double exact = fmin(base * pow(10.0, (double)k / per_decade), INT32_MAX);
+                CHECK_NEAR(histogram.edge_mw[k], llround(exact), exact * 2e-5 + 1);
+                if (k > 0) {
+                    CHECK(histogram.edge_mw[k] >= histogram.edge_mw[k - 1]);
+                }
+            }
+        }
+    }
+
+    // Decades restart exactly, rounding does not build up
+    Histogram_Config_t config = { 100, 4 };
+    Histogram_Configure(&histogram, &config);
+    CHECK_EQ(histogram.edge_mw[0], 100);
+    CHECK_EQ(histogram.edge_mw[1], 178);
+    CHECK_EQ(histogram.edge_mw[4], 1000);
+    CHECK_EQ(histogram.edge_mw[8], 10000);
+    CHECK_EQ(histogram.edge_mw[12], 100000);
+    CHECK_EQ(histogram.edge_mw[14], 316226);
+
+    // Out of range settings are clamped
+    Histogram_Config_t clamped = { 0, 9 };
+    Histogram_Configure(&histogram, &clamped);
+    CHECK_EQ(histogram.edge_mw[0], 1);
+    CHECK_EQ(histogram.edge_mw[HISTOGRAM_MAX_PER_DECADE], 10);
+}
+
+static void Test_Bin(void)
+{
+    Histogram_Config_t config = { 100, 4 };
+    Histogram_Configure(&histogram, &config);
+
+    // No load and power fed back land in bin 0
+    CHECK_EQ(Histogram_Bin(&histogram, 0), 0);
+    CHECK_EQ(Histogram_Bin(&histogram, -5000), 0);
+    CHECK_EQ(Histogram_Bin(&histogram, 99), 0);
+
+    // An edge belongs to the bin above it
+    CHECK_EQ(Histogram_Bin(&histogram, 100), 1);
+    CHECK_EQ(Histogram_Bin(&histogram, 177), 1);
+    CHECK_EQ(Histogram_Bin(&histogram, 178), 2);
+    CHECK_EQ(Histogram_Bin(&histogram, INT32_MAX), HISTOGRAM_BINS - 1);
+
+    uint32_t mismatches = 0;
+    for (int32_t power_mw = -10; power_mw < 4000000; power_mw += 7) {
+        mismatches += Histogram_Bin(&histogram, power_mw) != Reference_Bin(power_mw);
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+static void Test_Time(void)
+{
+    Histogram_Config_t config = { 100, 4 };
+    Histogram_Configure(&histogram, &config);
+
+    // 1000 ticks of 65.536 ms: the sub-millisecond parts carry over
+    for (uint32_t i = 0; i < 1000; i++) {
+        Histogram_Sample(&histogram, &config, 5000, 65536);
+    }
+    CHECK_EQ(histogram.bin_ms[Histogram_Bin(&histogram, 5000)], 65536);
+    CHECK_EQ(Total_ms(), 65536);
+    CHECK_EQ(histogram.remainder_us, 0);
+
+    // Remainders add across bins, the bin closing the millisecond gets it
+    Histogram_Reset(&histogram);
+    Histogram_Sample(&histogram, &config, 150, 600);
+    Histogram_Sample(&histogram, &config, 5000, 600);
+    CHECK_EQ(histogram.bin_ms[1], 0);
+    CHECK_EQ(histogram.bin_ms[Histogram_Bin(&histogram, 5000)], 1);
+    CHECK_EQ(histogram.remainder_us, 200);
+
+    // The longest interval does not overflow the split
+    Histogram_Reset(&histogram);
+    Histogram_Sample(&histogram, &config, 5000, 999);
+    Histogram_Sample(&histogram, &config, 5000, UINT32_MAX);
+    CHECK_EQ(Total_ms(), (999ULL + UINT32_MAX) / 1000);
+    CHECK_EQ(histogram.remainder_us, (999ULL + UINT32_MAX) % 1000);
+}
+
+static void Test_Saturation(void)
+{
+    Histogram_Config_t config = { 100, 4 };
+    Histogram_Configure(&histogram, &config);
+    int32_t power_mw = (int32_t)histogram.edge_mw[2];
+
+    histogram.bin_ms[3] = UINT32_MAX - 100;
+    Histogram_Sample(&histogram, &config, power_mw, 50000);
+    CHECK_EQ(histogram.bin_ms[3], UINT32_MAX - 50);
+    CHECK(!histogram.saturated);
+
+    Histogram_Sample(&histogram, &config, power_mw, 4000000000UL);
+    CHECK_EQ(histogram.bin_ms[3], UINT32_MAX);
+    CHECK(histogram.saturated);
+
+    // Stays at the limit, the other bins go on counting
+    Histogram_Sample(&histogram, &config, power_mw, 65536);
+    Histogram_Sample(&histogram, &config, 0, 2000);
+    CHECK_EQ(histogram.bin_ms[3], UINT32_MAX);
+    CHECK_EQ(histogram.bin_ms[0], 2);
+
+    // Reset clears the flag and keeps the edges
+    Histogram_Reset(&histogram);
+    CHECK(!histogram.saturated);
+    CHECK_EQ(Total_ms(), 0);
+    CHECK_EQ(histogram.edge_mw[0], 100);
+}
+
+static void Test_Reconfigure(void)
+{
+    Histogram_Config_t config = { 100, 4 };
+    Histogram_Configure(&histogram, &config);
+    Histogram_Sample(&histogram, &config, 5000, 10000);
+    CHECK_EQ(Total_ms(), 10);
+
+    // The sampling side applies a changed configuration and starts over
+    Histogram_Config_t changed = { 50, 3 };
+    Histogram_Sample(&histogram, &changed, 1000, 1000);
+    CHECK_EQ(histogram.applied.base_mw, 50);
+    CHECK_EQ(histogram.applied.per_decade, 3);
+    CHECK_EQ(histogram.edge_mw[0], 50);
+    CHECK_EQ(histogram.edge_mw[3], 500);
+    CHECK_EQ(Total_ms(), 1);
+    CHECK_EQ(histogram.bin_ms[Histogram_Bin(&histogram, 1000)], 1);
+
+    // An unchanged configuration keeps the counters
+    Histogram_Sample(&histogram, &changed, 1000, 1000);
+    CHECK_EQ(Total_ms(), 2);
+}
+
+int main(void)
+{
+    Test_Edges();
+    Test_Bin();
+    Test_Time();
+    Test_Saturation();
+    Test_Reconfigure();
+    return CHECK_DONE();
+}
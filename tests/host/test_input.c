@@ -0,0 +1,256 @@
+/**
+  ******************************************************************************
+  * @file           : test_input.c
+  * @brief          : Click, double click, hold and repeat timing, event queue
+  ******************************************************************************
+  */
+
+#include <signal.h>
+#include <sys/time.h>
+#include "check.h"
+#include "input.h"
+
+#define STRESS_EVENTS           200000UL
+
+static Gesture_Recognizer_t gesture;
+static uint32_t now_ms;
+
+// Gestures seen while polling, with the time they were reported
+static Gesture_Type_t seen[64];
+static uint32_t seen_ms[64];
+static uint8_t seen_count;
+
+static void Start(uint32_t start_ms)
+{
+    Gesture_Init(&gesture);
+    now_ms = start_ms;
+    seen_count = 0;
+}
+
+static void Record(Gesture_Type_t type)
+{
+    if (type != GESTURE_NONE && seen_count < 64) {
+        seen_ms[seen_count] = now_ms;
+        seen[seen_count++] = type;
+    }
+}
+
+// Main loop passes every millisecond for the given time
+static void Poll(uint32_t duration_ms)
+{
+    for (uint32_t t = 0; t < duration_ms; t++) {
+        now_ms++;
+        Record(Gesture_Update(&gesture, now_ms));
+    }
+}
+
+static void Button(uint8_t type)
+{
+    Input_Event_t event = { now_ms, type, 0 };
+    Record(Gesture_Event(&gesture, &event));
+}
+
+// Press for down_ms, then stay released for up_ms
+static void Click(uint32_t down_ms, uint32_t up_ms)
+{
+    Button(INPUT_BUTTON_DOWN);
+    Poll(down_ms);
+    Button(INPUT_BUTTON_UP);
+    Poll(up_ms);
+}
+
+static void Test_Clicks(void)
+{
+    // A click is reported once the gap expires, not at the release
+    Start(1000);
+    Click(80, GESTURE_CLICK_GAP_MS - 1);
+    CHECK_EQ(seen_count, 0);
+    Poll(1);
+    CHECK_EQ(seen_count, 1);
+    CHECK_EQ(seen[0], GESTURE_CLICK);
+    CHECK_EQ(seen_ms[0], 1000 + 80 + GESTURE_CLICK_GAP_MS);
+
+    // Second press just inside the gap: a double click
+    Start(1000);
+    Click(80, GESTURE_CLICK_GAP_MS - 1);
+    Click(80, 1000);
+    CHECK_EQ(seen_count, 1);
+    CHECK_EQ(seen[0], GESTURE_DOUBLE_CLICK);
+
+    // Just outside: two clicks
+    Start(1000);
+    Click(80, GESTURE_CLICK_GAP_MS);
+    Click(80, 1000);
+    CHECK_EQ(seen_count, 2);
+    CHECK_EQ(seen[0], GESTURE_CLICK);
+    CHECK_EQ(seen[1], GESTURE_CLICK);
+
+    // Triple is reported at the third release, a fourth starts over
+    Start(1000);
+    Click(60, 100);
+    Click(60, 100);
+    Button(INPUT_BUTTON_DOWN);
+    Poll(60);
+    Button(INPUT_BUTTON_UP);
+    CHECK_EQ(seen_count, 1);
+    CHECK_EQ(seen[0], GESTURE_TRIPLE_CLICK);
+    CHECK_EQ(seen_ms[0], 1000 + 380);
+    Poll(100);
+    Click(60, 1000);
+    CHECK_EQ(seen_count, 2);
+    CHECK_EQ(seen[1], GESTURE_CLICK);
+
+    // A late main loop: the next press closes the sequence, even without
+    // an update in between
+    Start(1000);
+    Click(80, 0);
+    now_ms += GESTURE_CLICK_GAP_MS + 500;
+    Button(INPUT_BUTTON_DOWN);
+    CHECK_EQ(seen_count, 1);
+    CHECK_EQ(seen[0], GESTURE_CLICK);
+
+    // Repeated edges of the same kind are ignored
+    Start(1000);
+    Button(INPUT_BUTTON_UP);
+    Button(INPUT_BUTTON_DOWN);
+    Poll(50);
+    Button(INPUT_BUTTON_DOWN);
+    Poll(50);
+    Button(INPUT_BUTTON_UP);
+    Button(INPUT_BUTTON_UP);
+    Poll(1000);
+    CHECK_EQ(seen_count, 1);
+    CHECK_EQ(seen[0], GESTURE_CLICK);
+}
+
+static void Test_Hold(void)
+{
+    // Offsets from the hold: 400, then each interval 3/4 of the last,
+    // no shorter than 50 ms
+    static const uint32_t repeat_ms[] = {
+        400, 700, 925, 1093, 1219, 1313, 1383, 1435, 1485, 1535, 1585
+    };
+    const uint8_t repeats = sizeof(repeat_ms) / sizeof(repeat_ms[0]);
+
+    // Just short of a hold is a click
+    Start(1000);
+    Click(GESTURE_HOLD_MS - 1, 1000);
+    CHECK_EQ(seen_count, 1);
+    CHECK_EQ(seen[0], GESTURE_CLICK);
+
+    // Held: hold at 1 s, the repeats speed up, the release is not a click
+    Start(1000);
+    Click(GESTURE_HOLD_MS + repeat_ms[repeats - 1], 1000);
+    CHECK_EQ(seen_count, 1 + repeats);
+    CHECK_EQ(seen[0], GESTURE_HOLD);
+    CHECK_EQ(seen_ms[0], 1000 + GESTURE_HOLD_MS);
+    for (uint8_t i = 0; i < repeats; i++) {
+        CHECK_EQ(seen[1 + i], GESTURE_HOLD_REPEAT);
+        CHECK_EQ(seen_ms[1 + i] - seen_ms[0], repeat_ms[i]);
+    }
+
+    // A click right before a hold belongs to it; the next hold starts slow
+    Start(1000);
+    Click(80, 100);
+    Click(GESTURE_HOLD_MS + 450, 1000);
+    CHECK_EQ(seen_count, 2);
+    CHECK_EQ(seen[0], GESTURE_HOLD);
+    CHECK_EQ(seen[1], GESTURE_HOLD_REPEAT);
+    Click(GESTURE_HOLD_MS + 450, 1000);
+    CHECK_EQ(seen_count, 4);
+    CHECK_EQ(seen_ms[3] - seen_ms[2], 400);
+
+    // A slow main loop gets one repeat per pass, not a burst
+    Start(1000);
+    Button(INPUT_BUTTON_DOWN);
+    Poll(GESTURE_HOLD_MS);
+    now_ms += 5000;
+    Record(Gesture_Update(&gesture, now_ms));
+    Record(Gesture_Update(&gesture, now_ms));
+    CHECK_EQ(seen_count, 2);
+    CHECK_EQ(seen[1], GESTURE_HOLD_REPEAT);
+
+    // Timing holds across the 32-bit millisecond wrap
+    Start(UINT32_MAX - 1200);
+    Click(GESTURE_HOLD_MS + 1000, 0);
+    CHECK_EQ(seen_count, 4);
+    CHECK_EQ(seen_ms[0], UINT32_MAX - 200);
+    CHECK_EQ(seen_ms[3] - seen_ms[0], 925);
+    Start(UINT32_MAX - 100);
+    Click(80, 1000);
+    Click(80, 1000);
+    CHECK_EQ(seen_count, 2);
+    CHECK_EQ(seen[1], GESTURE_CLICK);
+}
+
+static Input_Queue_t queue;
+static volatile uint32_t pushed;
+
+// The producing interrupt: a timer signal interrupts the consumer anywhere
+static void Push_Handler(int signal)
+{
+    uint32_t n = ++pushed;
+    Input_Event_t event = { n, (uint8_t)(n % 3), (int8_t)n };
+
+    (void)signal;
+    Input_Queue_Push(&queue, &event);
+}
+
+static void Test_Queue(void)
+{
+    struct itimerval period = { { 0, 20 }, { 0, 20 } };
+    struct itimerval stop = { { 0, 0 }, { 0, 0 } };
+    Input_Event_t event = { 0, INPUT_ROTATE, 0 };
+    uint32_t received = 0, last = 0, torn = 0, backwards = 0;
+
+    // Holds INPUT_QUEUE_SIZE - 1, then drops and counts
+    for (uint8_t i = 0; i < INPUT_QUEUE_SIZE + 2; i++) {
+        event.value = (int8_t)i;
+        CHECK_EQ(Input_Queue_Push(&queue, &event), i < INPUT_QUEUE_SIZE - 1);
+    }
+    CHECK_EQ(queue.dropped, 3);
+    for (uint8_t i = 0; i < INPUT_QUEUE_SIZE - 1; i++) {
+        CHECK(Input_Queue_Pop(&queue, &event));
+        CHECK_EQ(event.value, i);
+    }
+    CHECK(Input_Queue_Empty(&queue));
+    CHECK(!Input_Queue_Pop(&queue, &event));
+
+    queue.dropped = 0;
+    pushed = 0;
+    signal(SIGALRM, Push_Handler);
+    setitimer(ITIMER_REAL, &period, NULL);
+
+    // Every event arrives whole and in order, or is counted as dropped.
+    // Popping only from a full queue puts the producer's next slot right
+    // at the one being copied
+    while (pushed < STRESS_EVENTS) {
+        if (((queue.head - queue.tail) & (INPUT_QUEUE_SIZE - 1)) == INPUT_QUEUE_SIZE - 1 &&
+            Input_Queue_Pop(&queue, &event)) {
+            received++;
+            torn += event.type != event.time_ms % 3 || event.value != (int8_t)event.time_ms;
+            backwards += event.time_ms <= last;
+            last = event.time_ms;
+        }
+    }
+    setitimer(ITIMER_REAL, &stop, NULL);
+    signal(SIGALRM, SIG_DFL);
+    while (Input_Queue_Pop(&queue, &event)) {
+        received++;
+        backwards += event.time_ms <= last;
+        last = event.time_ms;
+    }
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(backwards, 0);
+    CHECK_EQ((uint8_t)(received + queue.dropped), (uint8_t)pushed);
+    CHECK(received > STRESS_EVENTS / 2);
+}
+
+int main(void)
+{
+    Test_Clicks();
+    Test_Hold();
+    Test_Queue();
+    return CHECK_DONE();
+}
@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file           : test_measurement.c
+  * @brief          : Sequence latch: latest set, slot alternation, torn-read stress
+  ******************************************************************************
+  * @attention
+  *
+  * The stress test runs the writer and a reader as two threads. Every field
+  * of a published set derives from one counter, so a copy mixing two sets
+  * shows up as fields that disagree. On one core the scheduler preempts the
+  * reader mid-copy, like the TIM6 tick preempting the main loop.
+  ******************************************************************************
+  */
+
+#include <pthread.h>
+#include <string.h>
+#include "check.h"
+#include "measurement.h"
+
+#define STRESS_SETS             4000000UL
+
+static Measurement_Latch_t latch;
+static volatile uint32_t writer_done;
+
+static void Fill(Measurement_t* measurement, uint32_t n)
+{
+    memset(measurement, 0, sizeof(*measurement));
+    measurement->timestamp_us = n;
+    measurement->voltage = (float)(n & 0xFFFF);
+    measurement->current = -(float)(n & 0xFFFF);
+    measurement->peak_power = (float)(n & 0xFFFF);
+    measurement->energy.import_nj = (uint64_t)n << 20;
+    measurement->energy.gaps = n;
+    for (uint8_t k = 0; k < DEMAND_WINDOWS; k++) {
+        measurement->demand.average_mw[k] = (int32_t)n + k;
+        measurement->demand.peak_mw[k] = -(int32_t)n - k;
+    }
+}
+
+// A set that is entirely the one published for its timestamp
+static uint8_t Whole(const Measurement_t* measurement)
+{
+    Measurement_t expected;
+    uint8_t whole;
+
+    Fill(&expected, measurement->timestamp_us);
+    whole = measurement->voltage == expected.voltage &&
+            measurement->current == expected.current &&
+            measurement->peak_power == expected.peak_power &&
+            measurement->energy.import_nj == expected.energy.import_nj &&
+            measurement->energy.gaps == expected.energy.gaps;
+    for (uint8_t k = 0; k < DEMAND_WINDOWS; k++) {
+        whole &= measurement->demand.average_mw[k] == expected.demand.average_mw[k] &&
+                 measurement->demand.peak_mw[k] == expected.demand.peak_mw[k];
+    }
+    return whole;
+}
+
+static void Test_Latch(void)
+{
+    Measurement_t set, read;
+
+    memset(&latch, 0, sizeof(latch));
+    for (uint32_t n = 1; n <= 5; n++) {
+        Fill(&set, n);
+        Measurement_Publish(&latch, &set);
+        CHECK_EQ(latch.sequence, n);
+        // The new set went to the slot the low bit now selects
+        CHECK_EQ(latch.slots[n & 1].timestamp_us, n);
+        CHECK_EQ(latch.slots[(n + 1) & 1].timestamp_us, n - 1);
+        Measurement_Read(&latch, &read);
+        CHECK_EQ(read.timestamp_us, n);
+        CHECK(Whole(&read));
+    }
+
+    // Sequence wraps through UINT32_MAX without changing the slot rule
+    latch.sequence = UINT32_MAX;
+    Fill(&set, 77);
+    Measurement_Publish(&latch, &set);
+    CHECK_EQ(latch.sequence, 0);
+    Measurement_Read(&latch, &read);
+    CHECK_EQ(read.timestamp_us, 77);
+}
+
+static void* Writer(void* arg)
+{
+    Measurement_t set;
+
+    (void)arg;
+    for (uint32_t n = 1; n <= STRESS_SETS; n++) {
+        Fill(&set, n);
+        Measurement_Publish(&latch, &set);
+    }
+    writer_done = 1;
+    return NULL;
+}
+
+static void Test_Stress(void)
+{
+    pthread_t writer;
+    Measurement_t read;
+    uint32_t last = 0, reads = 0, torn = 0, backwards = 0, skipped = 0;
+
+    // Set 0 first, the reader may start before the writer
+    memset(&latch, 0, sizeof(latch));
+    Fill(&read, 0);
+    Measurement_Publish(&latch, &read);
+    writer_done = 0;
+    CHECK_EQ(pthread_create(&writer, NULL, Writer, NULL), 0);
+
+    while (!writer_done) {
+        Measurement_Read(&latch, &read);
+        reads++;
+        torn += !Whole(&read);
+        backwards += read.timestamp_us < last;
+        skipped += read.timestamp_us > last + 1;
+        last = read.timestamp_us;
+    }
+    pthread_join(writer, NULL);
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(backwards, 0);
+    // The writer did run while the reader was copying
+    CHECK(reads > 0 && skipped > 0);
+
+    Measurement_Read(&latch, &read);
+    CHECK_EQ(read.timestamp_us, STRESS_SETS);
+}
+
+int main(void)
+{
+    Test_Latch();
+    Test_Stress();
+    return CHECK_DONE();
+}
@@ -0,0 +1,417 @@
+/**
+  ******************************************************************************
+  * @file           : test_menu.c
+  * @brief          : Menu tree walk, value editors and actions from encoder and button input
+  ******************************************************************************
+  * @attention
+  *
+  * main.c's tree needs the whole firmware, so the tree below has the same
+  * shapes: a root view, list pages, a view with its own handlers, a plain
+  * view, value editors, actions and back items. Turns go through the
+  * quadrature decoder and presses through the gesture recognizer, then to
+  * the engine as Handle_Menu_Navigation() / Handle_Menu_Action() do.
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "check.h"
+#include "ui/menu.h"
+#include "encoder.h"
+#include "input.h"
+
+static const UI_Screen_t view_screen = { NULL, 0 };
+
+static uint16_t timeout_s = 60;
+static uint16_t trip_dv = 200;
+static uint32_t trip_saved, peaks_reset, captured, scope_selected, scope_steps, scope_controls;
+
+static void Save_Trip(void)     { trip_saved++; }
+static void Reset_Peaks(void)   { peaks_reset++; }
+static void Capture(void)       { captured++; }
+static void Select_Scope(void)  { scope_selected++; }
+static void Scope_Adjust(int8_t direction) { scope_steps += (uint32_t)direction; }
+static void Scope_Next_Control(void) { scope_controls++; }
+
+static const Menu_Value_t timeout_editor = {
+    .value = &timeout_s, .min = 10, .max = 300, .step = 10, .unit = "s"
+};
+static const Menu_Value_t trip_editor = {
+    .value = &trip_dv, .min = 0, .max = 300, .step = 5, .decimals = 1, .unit = "V"
+};
+
+static const Menu_Page_t meter_page, main_page, peaks_page, graphics_page, scope_page,
+                         settings_page, reset_page;
+
+static const Menu_Item_t main_items[] = {
+    { " Power Meter",   MENU_ITEM_PAGE, &meter_page },
+    { " Peak Values",   MENU_ITEM_PAGE, &peaks_page },
+    { " Graphics",      MENU_ITEM_PAGE, &graphics_page },
+    { " Settings",      MENU_ITEM_PAGE, &settings_page },
+    { " Reset Options", MENU_ITEM_PAGE, &reset_page },
+};
+static const Menu_Item_t graphics_items[] = {
+    { " Scope V",       MENU_ITEM_PAGE, &scope_page, Select_Scope },
+    { " Scope I",       MENU_ITEM_PAGE, &scope_page, Select_Scope },
+    { " Back",          MENU_ITEM_BACK },
+};
+static const Menu_Item_t settings_items[] = {
+    { " Timeout",       MENU_ITEM_VALUE, NULL, NULL, &timeout_editor },
+    { " Trip V",        MENU_ITEM_VALUE, NULL, Save_Trip, &trip_editor },
+    { " Capture",       MENU_ITEM_ACTION, NULL, Capture },
+    { " Back",          MENU_ITEM_BACK },
+};
+static const Menu_Item_t reset_items[] = {
+    { " Reset Peaks",   MENU_ITEM_BACK, NULL, Reset_Peaks },
+    { " Cancel",        MENU_ITEM_BACK },
+};
+
+static const Menu_Page_t meter_page    = { .screen = &view_screen };
+static const Menu_Page_t main_page     = { "=== MAIN MENU ===", MENU_ITEMS(main_items), NULL };
+static const Menu_Page_t peaks_page    = { .parent = &main_page, .screen = &view_screen };
+static const Menu_Page_t graphics_page = { "=== GRAPHICS ===", MENU_ITEMS(graphics_items), &main_page };
+static const Menu_Page_t scope_page    = { .parent = &graphics_page, .screen = &view_screen,
+                                           .navigate = Scope_Adjust, .select = Scope_Next_Control };
+static const Menu_Page_t settings_page = { "=== SETTINGS ===", MENU_ITEMS(settings_items), &main_page };
+static const Menu_Page_t reset_page    = { "=== RESET ===", MENU_ITEMS(reset_items), &main_page };
+
+// Full repaints requested by the engine, ui.c is not linked
+static uint32_t invalidations;
+
+void UI_Invalidate(void)
+{
+    invalidations++;
+}
+
+/* Simulated input ---------------------------------------------------------- */
+
+// Gray code cycle in the positive direction, starting after the rest state
+static const uint8_t forward[4] = { 0x01, 0x00, 0x02, 0x03 };
+
+static Encoder_t encoder;
+static Gesture_Recognizer_t gesture;
+static uint32_t now_ms;
+static int8_t last_rotate_direction = 1;
+
+static void Dispatch(Gesture_Type_t type)
+{
+    switch (type) {
+        case GESTURE_CLICK:         Menu_Select(); break;
+        case GESTURE_DOUBLE_CLICK:  Menu_Back(); break;
+        case GESTURE_TRIPLE_CLICK:  Menu_Go_Root(); break;
+        case GESTURE_HOLD:
+            if (!Menu_Is_Editing()) {
+                Menu_Home();
+            }
+            break;
+        case GESTURE_HOLD_REPEAT:
+            if (Menu_Is_Editing()) {
+                Menu_Navigate(last_rotate_direction);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void Start(void)
+{
+    Encoder_Init(&encoder, 0x03);
+    Gesture_Init(&gesture);
+    Menu_Init(&meter_page, &main_page);
+    now_ms = 1000;
+}
+
+// Main loop passes every millisecond for the given time
+static void Poll(uint32_t duration_ms)
+{
+    for (uint32_t t = 0; t < duration_ms; t++) {
+        Dispatch(Gesture_Update(&gesture, ++now_ms));
+    }
+}
+
+// Turn by whole detents, one edge every edge_ms
+static void Turn(int32_t detents, uint32_t edge_ms)
+{
+    for (int32_t d = 0; d < ((detents < 0) ? -detents : detents); d++) {
+        for (uint8_t q = 0; q < 4; q++) {
+            int8_t steps = Encoder_Decode(&encoder, (detents > 0) ? forward[q] : forward[(6 - q) % 4],
+                                          now_ms += edge_ms);
+            if (steps != 0) {
+                last_rotate_direction = (steps > 0) ? 1 : -1;
+                Menu_Navigate(steps);
+            }
+        }
+    }
+}
+
+static void Button(uint8_t type)
+{
+    Input_Event_t event = { now_ms, type, 0 };
+
+    Dispatch(Gesture_Event(&gesture, &event));
+}
+
+// Press for down_ms, release and let the gesture close
+static void Press(uint32_t down_ms)
+{
+    Button(INPUT_BUTTON_DOWN);
+    Poll(down_ms);
+    Button(INPUT_BUTTON_UP);
+    Poll(GESTURE_CLICK_GAP_MS + 1);
+}
+
+static void Click(void)         { Press(80); }
+static void Hold(void)          { Press(GESTURE_HOLD_MS + 10); }
+
+static void Double_Click(void)
+{
+    Button(INPUT_BUTTON_DOWN);
+    Poll(80);
+    Button(INPUT_BUTTON_UP);
+    Poll(100);
+    Press(80);
+}
+
+static void Item_Text(uint8_t index, char* dst)
+{
+    Menu_Get_Screen()->widgets[1].list->text(index, dst);
+}
+
+static uint8_t Selection(void)
+{
+    return Menu_Get_Screen()->widgets[1].list->selection();
+}
+
+/* Tests -------------------------------------------------------------------- */
+
+// First item of a page linking to the target
+static uint8_t First_Link(const Menu_Page_t* page, const Menu_Page_t* target)
+{
+    uint8_t i = 0;
+
+    while (page->items[i].type != MENU_ITEM_PAGE || page->items[i].target != target) {
+        i++;
+    }
+    return i;
+}
+
+// Open every page under a list page and come back: each link reaches its
+// target, the target's parent points back, and back selects its first link
+static uint8_t Walk(const Menu_Page_t* page)
+{
+    uint8_t pages = 1;
+
+    for (uint8_t i = 0; i < page->count; i++) {
+        const Menu_Page_t* target = page->items[i].target;
+
+        CHECK(Menu_Get_Page() == page);
+        if (page->items[i].type != MENU_ITEM_PAGE) {
+            continue;
+        }
+        while (Selection() != i) {
+            Turn(1, 100);
+        }
+        Click();
+        CHECK(Menu_Get_Page() == target);
+        if (target == &meter_page) {
+            // The way home: no parent, a hold opens the menu again
+            CHECK(Menu_At_Root());
+            CHECK(target->parent == NULL);
+            Hold();
+            CHECK(Menu_Get_Page() == page);
+            continue;
+        }
+        CHECK(target->parent == page);
+        if (target->count > 0) {
+            pages += Walk(target);
+        }
+        Double_Click();
+        CHECK(Menu_Get_Page() == page);
+        CHECK_EQ(Selection(), First_Link(page, target));
+    }
+    return pages;
+}
+
+static void Test_Tree(void)
+{
+    Start();
+
+    // Root view, a hold opens the main menu on its first item
+    CHECK(Menu_At_Root());
+    CHECK(Menu_Get_Screen() == &view_screen);
+    Hold();
+    CHECK(Menu_Get_Page() == &main_page);
+    CHECK_EQ(Selection(), 0);
+
+    CHECK_EQ(Walk(&main_page), 4);
+    CHECK_EQ(scope_selected, 2);
+
+    // Back from a page shared by two links selects the first of them
+    Menu_Go_Root();
+    Hold();
+    Turn(2, 100);
+    Click();
+    Turn(1, 100);
+    Click();
+    CHECK(Menu_Get_Page() == &scope_page);
+    Double_Click();
+    CHECK_EQ(Selection(), 0);
+
+    // Lists wrap both ways
+    Turn(-1, 100);
+    CHECK_EQ(Selection(), 2);
+    Turn(1, 100);
+    CHECK_EQ(Selection(), 0);
+
+    // A back item returns to the parent on the link that led here
+    Turn(-1, 100);
+    Click();
+    CHECK(Menu_Get_Page() == &main_page);
+    CHECK_EQ(Selection(), 2);
+
+    // One item per detent, however fast the turn
+    Turn(2, 3);
+    CHECK_EQ(Selection(), 4);
+    Turn(-3, 3);
+    CHECK_EQ(Selection(), 1);
+
+    // Triple click goes home from a view, holds toggle root and main menu
+    Click();
+    Button(INPUT_BUTTON_DOWN);
+    Poll(60);
+    Button(INPUT_BUTTON_UP);
+    Poll(60);
+    Button(INPUT_BUTTON_DOWN);
+    Poll(60);
+    Button(INPUT_BUTTON_UP);
+    Poll(60);
+    Button(INPUT_BUTTON_DOWN);
+    Poll(60);
+    Button(INPUT_BUTTON_UP);
+    Poll(GESTURE_CLICK_GAP_MS + 1);
+    CHECK(Menu_At_Root());
+    Hold();
+    Hold();
+    CHECK(Menu_At_Root());
+
+    // Every page change asks for a full repaint
+    invalidations = 0;
+    Hold();
+    Click();
+    CHECK_EQ(invalidations, 2);
+}
+
+static void Test_Views(void)
+{
+    // A view with handlers takes the encoder and the click itself
+    Start();
+    Hold();
+    Turn(2, 100);
+    Click();
+    Click();
+    CHECK(Menu_Get_Page() == &scope_page);
+    scope_steps = 0;
+    Turn(3, 100);
+    Turn(-1, 100);
+    CHECK_EQ((int32_t)scope_steps, 2);
+    Click();
+    CHECK_EQ(scope_controls, 1);
+    CHECK(Menu_Get_Page() == &scope_page);
+    Double_Click();
+    CHECK(Menu_Get_Page() == &graphics_page);
+
+    // A plain view ignores the encoder, a click returns to its link
+    Double_Click();
+    Turn(-1, 100);
+    Click();
+    CHECK(Menu_Get_Page() == &peaks_page);
+    Turn(5, 100);
+    CHECK(Menu_Get_Page() == &peaks_page);
+    Click();
+    CHECK(Menu_Get_Page() == &main_page);
+    CHECK_EQ(Selection(), 1);
+}
+
+static void Test_Values(void)
+{
+    char text[24];
+
+    Start();
+    Hold();
+    Turn(3, 100);
+    Click();
+    CHECK(Menu_Get_Page() == &settings_page);
+
+    // Editing shows brackets, a detent steps by the editor step
+    Item_Text(0, text);
+    CHECK(strcmp(text, " Timeout 60s") == 0);
+    Click();
+    CHECK(Menu_Is_Editing());
+    Item_Text(0, text);
+    CHECK(strcmp(text, " Timeout [60s]") == 0);
+    Turn(2, 100);
+    CHECK_EQ(timeout_s, 80);
+
+    // Accelerated turns stop at the limits
+    Turn(3, 3);
+    CHECK_EQ(timeout_s, 300);
+    Turn(-3, 3);
+    CHECK_EQ(timeout_s, 10);
+    Turn(-1, 100);
+    CHECK_EQ(timeout_s, 10);
+
+    // The selection does not move while editing, a click ends it
+    Click();
+    CHECK(!Menu_Is_Editing());
+    CHECK_EQ(Selection(), 0);
+
+    // Hold repeats step the edited value in the last direction, a hold
+    // does not leave the page while editing
+    Turn(1, 100);
+    Click();
+    Turn(-1, 100);
+    CHECK_EQ(trip_dv, 195);
+    Button(INPUT_BUTTON_DOWN);
+    Poll(GESTURE_HOLD_MS + 925);        // Hold and three repeats
+    Button(INPUT_BUTTON_UP);
+    Poll(GESTURE_CLICK_GAP_MS + 1);
+    CHECK(Menu_Get_Page() == &settings_page);
+    CHECK_EQ(trip_dv, 180);
+    Item_Text(1, text);
+    CHECK(strcmp(text, " Trip V [18.0V]") == 0);
+
+    // The editor action runs once, when editing ends by click or by back
+    CHECK_EQ(trip_saved, 0);
+    Double_Click();
+    CHECK_EQ(trip_saved, 1);
+    CHECK(!Menu_Is_Editing());
+    CHECK(Menu_Get_Page() == &settings_page);
+    Click();
+    Click();
+    CHECK_EQ(trip_saved, 2);
+
+    // An action item runs and stays, a back item with an action runs it
+    // and returns
+    Turn(1, 100);
+    Click();
+    Click();
+    CHECK_EQ(captured, 2);
+    CHECK(Menu_Get_Page() == &settings_page);
+    Turn(1, 100);
+    Click();
+    CHECK(Menu_Get_Page() == &main_page);
+    Turn(1, 100);
+    Click();
+    Click();
+    CHECK_EQ(peaks_reset, 1);
+    CHECK(Menu_Get_Page() == &main_page);
+    CHECK_EQ(Selection(), 4);
+}
+
+int main(void)
+{
+    Test_Tree();
+    Test_Views();
+    Test_Values();
+    return CHECK_DONE();
+}
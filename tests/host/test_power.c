@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * @file           : test_power.c
+  * @brief          : Sleep time accounting, the per-window sleep share and the current estimate
+  ******************************************************************************
+  * @attention
+  *
+  * The timebase runs on a hand-driven TIM2 as in test_timebase.c. Cycle()
+  * plays one main loop pass: awake for a while, then Power_Idle() with
+  * interrupts masked, during which host_sleep() lets the sleep time pass.
+  * Sleeps stay below one TIM2 period, whose overflow would wake the core;
+  * one that crosses a wrap leaves that interrupt pending while the
+  * accounting reads the timebase, as on the target.
+  ******************************************************************************
+  */
+
+#include "check.h"
+#include "power.h"
+#include "timebase.h"
+
+static TIM_TypeDef tim;
+static TIM_HandleTypeDef htim = { &tim };
+static uint32_t sleep_for_us;
+static uint32_t sleep_errors;
+
+// Count like TIM2 at 1 MHz, the overflow interrupt runs unless masked
+static void Advance(uint32_t us)
+{
+    while (us--) {
+        tim.CNT = (tim.CNT + 1) & 0xFFFFU;
+        if (tim.CNT == 0) {
+            tim.SR |= TIM_SR_UIF;
+            if (!host_primask) {
+                Timebase_IRQHandler();
+            }
+        }
+    }
+}
+
+static void Sleep(void)
+{
+    sleep_errors += !host_tick_suspended || !host_primask;
+    Advance(sleep_for_us);
+}
+
+// One main loop pass: awake, then asleep until the next interrupt
+static void Cycle(uint32_t awake_us, uint32_t asleep_us)
+{
+    Advance(awake_us);
+    sleep_for_us = asleep_us;
+    host_primask = 1;
+    Power_Idle();
+    sleep_errors += host_tick_suspended || !host_primask;
+    host_primask = 0;
+    if (tim.SR & TIM_SR_UIF) {
+        Timebase_IRQHandler();
+    }
+}
+
+// Repeat a pass long enough that the last window holds only this one
+static void Run(uint32_t awake_us, uint32_t asleep_us)
+{
+    uint32_t start = Timebase_Now_us();
+
+    while (Timebase_Now_us() - start < 2 * POWER_WINDOW_MS * 1000UL + 2 * (awake_us + asleep_us)) {
+        Cycle(awake_us, asleep_us);
+    }
+}
+
+static uint32_t Expected_uA(uint32_t permille)
+{
+    return (POWER_RUN_UA * (1000 - permille) + POWER_SLEEP_UA * permille) / 1000;
+}
+
+static void Test_First_Window(void)
+{
+    // Nothing measured yet: awake all the time
+    CHECK_EQ(Power_Get_Sleep_Permille(), 0);
+    CHECK_EQ(Power_Get_Estimated_uA(), POWER_RUN_UA);
+
+    // The share changes only when a window closes
+    uint32_t sleeps = host_sleeps;
+    for (uint32_t i = 0; i < 99; i++) {
+        Cycle(1000, 9000);
+    }
+    CHECK_EQ(host_sleeps, sleeps + 99);
+    CHECK_EQ(Power_Get_Sleep_Permille(), 0);
+    Cycle(1000, 9000);
+    CHECK_EQ(Power_Get_Sleep_Permille(), 900);
+    CHECK_EQ(Power_Get_Estimated_uA(), POWER_RUN_UA / 10 + POWER_SLEEP_UA * 9 / 10);
+    CHECK_EQ(sleep_errors, 0);
+}
+
+static void Test_Duty(void)
+{
+    // Awake / asleep per pass in us, and the share of the time asleep
+    static const struct {
+        uint32_t awake_us;
+        uint32_t asleep_us;
+        uint16_t permille;
+    } profiles[] = {
+        { 12, 33321, 999 },         // TIM6 and TIM2 wakeups only, 30 per second
+        { 500, 500, 500 },
+        { 3, 7, 700 },
+        { 12, 65000, 999 },         // Windows up to 65 ms longer than nominal
+        { 900, 100, 100 },
+        { 1000, 0, 0 },             // Busy: never asleep
+        { 250, 65000, 996 },
+        { 650, 350, 350 },
+    };
+
+    for (uint8_t p = 0; p < sizeof(profiles) / sizeof(profiles[0]); p++) {
+        Run(profiles[p].awake_us, profiles[p].asleep_us);
+        CHECK_NEAR(Power_Get_Sleep_Permille(), profiles[p].permille, 1);
+        CHECK_EQ(Power_Get_Estimated_uA(), Expected_uA(Power_Get_Sleep_Permille()));
+    }
+    CHECK_EQ(sleep_errors, 0);
+
+    // The estimate at the ends and in the middle
+    Run(1000, 0);
+    CHECK_EQ(Power_Get_Estimated_uA(), POWER_RUN_UA);
+    Run(500, 500);
+    CHECK_EQ(Power_Get_Estimated_uA(), (POWER_RUN_UA + POWER_SLEEP_UA) / 2);
+}
+
+static void Test_Long_Window(void)
+{
+    // A window closes at the first sleep after POWER_WINDOW_MS: a pass of
+    // 1.6 s awake and 0.4 s asleep in 50 ms sleeps is 20 % asleep, not 40 %
+    Run(500, 500);
+    for (uint32_t i = 0; i < 2; i++) {
+        Advance(1600000);
+        for (uint32_t s = 0; s < 8; s++) {
+            Cycle(0, 50000);
+        }
+    }
+    CHECK_NEAR(Power_Get_Sleep_Permille(), 200, 1);
+    CHECK_EQ(sleep_errors, 0);
+}
+
+int main(void)
+{
+    host_sleep = Sleep;
+    Timebase_Init(&htim);
+    Test_First_Window();
+    Test_Duty();
+    Test_Long_Window();
+    return CHECK_DONE();
+}
@@ -0,0 +1,291 @@
+/**
+  ******************************************************************************
+  * @file           : test_protection.c
+  * @brief          : Watchdog trip latency, hysteresis release and the latched event
+  ******************************************************************************
+  * @attention
+  *
+  * The ADC is the register model in stub/: every conversion is checked
+  * against the loaded window and an enabled watchdog interrupt runs
+  * Protection_IRQHandler() before the conversion call returns, as the
+  * priority 1 interrupt preempts the tick on the target. Tick() converts
+  * like Timer_Interrupt_Handler(), streams convert one sample per step.
+  ******************************************************************************
+  */
+
+#include "check.h"
+#include "protection.h"
+#include "compensation.h"
+#include "timebase.h"
+#include "board_io.h"
+
+static const Cal_Line_t defaults[CAL_CHANNELS] = {
+    { 525770, -962 },       // 8.0226 mV/code
+    { 262984, -8776 },      // 4.0128 mA/code, 0 mA at code 2187
+};
+static const Compensation_Config_t compensation = { 1500, 670, 870, { 0, 0 } };
+static Protection_Config_t config = { 200, 150, 5 };   // 20 V, 1.5 A, 5 %
+
+static TIM_TypeDef tim;
+static TIM_HandleTypeDef htim = { &tim };
+static uint16_t codes[19];              // Input of each ADC channel
+static uint32_t interrupts;
+static int32_t voltage_mv, current_ma;  // Readings of the last tick
+
+static uint16_t Source(uint8_t channel)
+{
+    return codes[channel];
+}
+
+static void Irq(void)
+{
+    interrupts++;
+    Protection_IRQHandler();
+}
+
+static int32_t Reading(Cal_Channel_t channel, uint16_t code)
+{
+    return Calibration_Apply(channel, Compensation_Apply(channel, code));
+}
+
+// Smallest code that reads above the limit
+static uint16_t First_Above(Cal_Channel_t channel, int32_t limit)
+{
+    uint16_t code = 0;
+
+    while (code < 4095 && Reading(channel, code) <= limit) {
+        code++;
+    }
+    return code;
+}
+
+// Let the timebase run on to the given millisecond
+static void Set_Time_ms(uint32_t ms)
+{
+    while (Timebase_Now_ms() < ms) {
+        uint32_t count = tim.CNT + 1000;
+        tim.CNT = count & 0xFFFF;
+        if (count > 0xFFFF) {
+            tim.SR |= TIM_SR_UIF;
+            Timebase_IRQHandler();
+        }
+    }
+}
+
+static void Start(void)
+{
+    Host_Registers_Reset();
+    host_adc_source = Source;
+    host_adc_irq = Irq;
+    interrupts = 0;
+    tim = (TIM_TypeDef){ 0 };
+    Timebase_Init(&htim);
+    Calibration_Init(defaults);
+    Compensation_Init(&compensation);
+    Board_Adc_Enable();
+    Protection_Init(&config);
+    codes[4] = 1000;
+    codes[3] = 2187;
+    voltage_mv = Reading(CAL_VOLTAGE, codes[4]);
+    current_ma = Reading(CAL_CURRENT, codes[3]);
+}
+
+// One measurement tick: thresholds from the last readings, then convert
+static void Tick(void)
+{
+    Protection_Update(voltage_mv, current_ma);
+    Protection_Arm(CAL_VOLTAGE);
+    voltage_mv = Reading(CAL_VOLTAGE, Board_Adc_Read(ADC_CHANNEL_4));
+    Protection_Arm(CAL_CURRENT);
+    current_ma = Reading(CAL_CURRENT, Board_Adc_Read(ADC_CHANNEL_3));
+    Protection_Arm(CAL_CHANNELS);
+    Board_Adc_Read(ADC_CHANNEL_VREFINT);
+}
+
+static uint8_t Led(void)
+{
+    Host_Sync();
+    return (LED_RED_GPIO_Port->ODR & LED_RED_Pin) ? 1 : 0;
+}
+
+static void Test_Threshold(void)
+{
+    Start();
+    uint16_t voltage_trip = First_Above(CAL_VOLTAGE, 20000);
+    uint16_t current_trip = First_Above(CAL_CURRENT, 1500);
+    uint16_t reverse_trip = First_Above(CAL_CURRENT, -1500) - 1;
+
+    // The last code within the limit never trips
+    Tick();
+    codes[4] = voltage_trip - 1;
+    codes[3] = current_trip - 1;
+    for (uint8_t i = 0; i < 10; i++) {
+        Tick();
+    }
+    CHECK_EQ(Protection_Get_Event(), 0);
+    CHECK_EQ(interrupts, 0);
+
+    // One code more trips at the end of that very conversion, before the
+    // tick reads the result
+    codes[4] = voltage_trip;
+    Protection_Arm(CAL_VOLTAGE);
+    Board_Adc_Read(ADC_CHANNEL_4);
+    CHECK_EQ(interrupts, 1);
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_VOLTAGE);
+    CHECK_EQ(Protection_Get_Active(), PROTECTION_OVER_VOLTAGE);
+    CHECK_EQ(Led(), 1);
+
+    // Current trips in both directions
+    Start();
+    Tick();
+    codes[3] = current_trip;
+    Tick();
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_CURRENT);
+    Start();
+    Tick();
+    codes[3] = reverse_trip + 1;
+    Tick();
+    CHECK_EQ(Protection_Get_Event(), 0);
+    codes[3] = reverse_trip;
+    Tick();
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_CURRENT);
+
+    // Internal channels are not watched, whatever they read
+    Start();
+    Tick();
+    codes[17] = 4095;
+    Tick();
+    CHECK_EQ(interrupts, 0);
+}
+
+static void Test_Release(void)
+{
+    Start();
+    uint16_t trip = First_Above(CAL_VOLTAGE, 20000);
+    uint16_t release = First_Above(CAL_VOLTAGE, 19000) - 1;    // Below 95 %
+
+    // Tripped: disarmed and lit until the reading is below the hysteresis
+    Tick();
+    codes[4] = 4000;
+    Tick();
+    CHECK_EQ(interrupts, 1);
+    for (uint8_t i = 0; i < 5; i++) {
+        Tick();
+    }
+    CHECK_EQ(interrupts, 1);
+
+    codes[4] = release + 1;
+    Tick();
+    Tick();
+    CHECK_EQ(Protection_Get_Active(), PROTECTION_OVER_VOLTAGE);
+    CHECK_EQ(Led(), 1);
+
+    codes[4] = release;
+    Tick();
+    Tick();
+    CHECK_EQ(Protection_Get_Active(), 0);
+    CHECK_EQ(Led(), 0);
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_VOLTAGE);
+
+    // Armed again: the next breach trips again
+    codes[4] = trip;
+    Tick();
+    CHECK_EQ(interrupts, 2);
+    CHECK_EQ(Protection_Get_Active(), PROTECTION_OVER_VOLTAGE);
+
+    // Disabling the limit releases at once and stops watching
+    config.voltage_limit_dv = 0;
+    Tick();
+    CHECK_EQ(Protection_Get_Active(), 0);
+    codes[4] = 4095;
+    Tick();
+    CHECK_EQ(interrupts, 2);
+    config.voltage_limit_dv = 200;
+}
+
+static void Test_Latch(void)
+{
+    // The event keeps the time of the first breach until acknowledged
+    Start();
+    Tick();
+    Set_Time_ms(1234);
+    codes[4] = 4000;
+    Tick();
+    CHECK_EQ(Protection_Get_Event_Time_ms(), 1234);
+
+    Set_Time_ms(2000);
+    codes[3] = 4000;
+    Tick();
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_VOLTAGE | PROTECTION_OVER_CURRENT);
+    CHECK_EQ(Protection_Get_Event_Time_ms(), 1234);
+
+    // Acknowledged: tripped channels stay tripped, a new breach relatches
+    Protection_Acknowledge();
+    CHECK_EQ(Protection_Get_Event(), 0);
+    CHECK_EQ(Protection_Get_Active(), PROTECTION_OVER_VOLTAGE | PROTECTION_OVER_CURRENT);
+    codes[3] = 2187;
+    for (uint8_t i = 0; i < 3; i++) {
+        Tick();
+    }
+    Set_Time_ms(5000);
+    codes[3] = 4000;
+    Tick();
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_CURRENT);
+    CHECK_EQ(Protection_Get_Event_Time_ms(), 5000);
+}
+
+static void Test_Stream(void)
+{
+    static volatile uint16_t buffer[64];
+
+    // A stream over the limit interrupts once, not on every sample, and
+    // nothing is written to the window while it converts
+    Start();
+    Tick();
+    Protection_Arm(CAL_VOLTAGE);
+    Board_Adc_Stream_Start(ADC_CHANNEL_4, 0, 0, buffer, 64, 1);
+    codes[4] = 4000;
+    for (uint16_t i = 0; i < 1000; i++) {
+        Host_Adc_Convert();
+    }
+    Board_Adc_Stream_Restore();
+    CHECK_EQ(interrupts, 1);
+    CHECK_EQ(host_adc_ignored_writes, 0);
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_VOLTAGE);
+
+    // The flag the stream left set does not blame the next channel
+    codes[4] = 1000;
+    Tick();
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_VOLTAGE);
+    CHECK_EQ(interrupts, 1);
+
+    // Two channels: the current stays watched, the voltage is not
+    Start();
+    Tick();
+    Protection_Arm_Single(CAL_CURRENT, ADC_CHANNEL_3);
+    Board_Adc_Stream_Start(ADC_CHANNEL_3 | ADC_CHANNEL_4, 0, 0, buffer, 64, 1);
+    codes[4] = 4000;
+    for (uint16_t i = 0; i < 100; i++) {
+        Host_Adc_Convert();
+    }
+    CHECK_EQ(interrupts, 0);
+    codes[3] = 4000;
+    Host_Adc_Convert();
+    Host_Adc_Convert();
+    CHECK_EQ(interrupts, 1);
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_CURRENT);
+    Board_Adc_Stream_Restore();
+
+    // Back on single conversions every channel is watched again
+    Tick();
+    CHECK_EQ(Protection_Get_Event(), PROTECTION_OVER_CURRENT | PROTECTION_OVER_VOLTAGE);
+}
+
+int main(void)
+{
+    Test_Threshold();
+    Test_Release();
+    Test_Latch();
+    Test_Stream();
+    return CHECK_DONE();
+}
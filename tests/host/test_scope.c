@@ -0,0 +1,297 @@
+/**
+  ******************************************************************************
+  * @file           : test_scope.c
+  * @brief          : Triggers, pre-trigger, auto mode and record integrity in the circular buffer
+  ******************************************************************************
+  * @attention
+  *
+  * Run() plays the DMA: it writes the stream half by half, calls
+  * Scope_Feed() at each half and full transfer, and after completion writes
+  * SCOPE_MARGIN more samples as a DMA that stops late would. A shadow of
+  * the buffer keeps the absolute index of every slot, so a record that
+  * reads a slot the DMA has written again is caught.
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include "check.h"
+#include "scope.h"
+
+static volatile uint16_t buffer[SCOPE_BUFFER];
+static uint32_t shadow[SCOPE_BUFFER];   // Absolute sample index of each slot
+static uint32_t written;                // Samples written so far
+static Scope_t scope;
+
+// Trigger lane waveform by step, the other lane carries the step number
+static uint16_t (*wave)(uint32_t step);
+static uint8_t stride, lane;
+
+static uint16_t Sample(uint32_t n)
+{
+    return (n % stride == lane) ? wave(n / stride) : (uint16_t)((n / stride) & 0x0FFF);
+}
+
+static void Write(uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++, written++) {
+        buffer[written % SCOPE_BUFFER] = Sample(written);
+        shadow[written % SCOPE_BUFFER] = written;
+    }
+}
+
+static void Arm(uint16_t level, Scope_Edge_t edge, uint16_t pct, uint8_t channels, uint8_t trigger_lane,
+                uint16_t auto_halves)
+{
+    Scope_Config_t config = { level, edge, pct };
+
+    stride = channels;
+    lane = trigger_lane;
+    written = 0;
+    Scope_Arm(&scope, buffer, &config, channels, trigger_lane, auto_halves);
+}
+
+// Stream until the record completes, at most the given halves
+static uint8_t Run(uint32_t halves)
+{
+    for (uint32_t h = 0; h < halves; h++) {
+        Write(SCOPE_HALF);
+        if (Scope_Feed(&scope)) {
+            Write(SCOPE_MARGIN);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Steps of the record that are not the samples the stream wrote there
+static uint32_t Record_Errors(void)
+{
+    uint32_t errors = 0;
+    uint32_t first = scope.trigger_step - scope.pre_steps;
+
+    for (uint16_t step = 0; step < Scope_Steps(&scope); step++) {
+        for (uint8_t l = 0; l < stride; l++) {
+            uint32_t n = (first + step) * stride + l;
+
+            errors += n >= written || shadow[n % SCOPE_BUFFER] != n || Scope_Get(&scope, step, l) != Sample(n);
+        }
+    }
+    return errors;
+}
+
+// Triangle 0..4000 over 100 steps, starting at the bottom
+static uint16_t Triangle(uint32_t step)
+{
+    uint32_t phase = step % 100;
+
+    return (uint16_t)((phase < 50) ? phase * 80 : (100 - phase) * 80);
+}
+
+static uint16_t Flat(uint32_t step)
+{
+    (void)step;
+    return 2000;
+}
+
+// Low, then high from step_at on
+static uint32_t step_at;
+
+static uint16_t Step_Up(uint32_t step)
+{
+    return (step < step_at) ? 100 : 3900;
+}
+
+// Wanders around the level inside the hysteresis, then dips through it
+static uint16_t Noisy(uint32_t step)
+{
+    if (step < 300) {
+        return (step % 2) ? 2010 : 1990;
+    }
+    if (step < 310) {
+        return 1980;
+    }
+    return 2010;
+}
+
+static uint16_t Noisy_Inverted(uint32_t step)
+{
+    return (uint16_t)(4000 - Noisy(step));
+}
+
+static void Test_Edges(void)
+{
+    // Rising: the trigger is the first sample at or above the level, after
+    // the pre-trigger part
+    wave = Triangle;
+    Arm(2000, SCOPE_RISING, 50, 1, 0, 0);
+    CHECK_EQ(scope.pre_steps, 64);
+    CHECK(Run(20));
+    CHECK_EQ(scope.state, SCOPE_DONE);
+    CHECK_EQ(scope.forced, 0);
+    CHECK_EQ(scope.trigger_step, 125);      // 125 % 100 = 25, 25 * 80 = 2000
+    CHECK(Scope_Get(&scope, 64, 0) >= 2000);
+    CHECK(Scope_Get(&scope, 63, 0) < 2000);
+    CHECK_EQ(Record_Errors(), 0);
+
+    // Falling, on the way down
+    Arm(2000, SCOPE_FALLING, 50, 1, 0, 0);
+    CHECK(Run(20));
+    CHECK_EQ(scope.trigger_step, 75);
+    CHECK(Scope_Get(&scope, 64, 0) <= 2000);
+    CHECK(Scope_Get(&scope, 63, 0) > 2000);
+    CHECK_EQ(Record_Errors(), 0);
+
+    // Noise around the level does not fire until it went past the
+    // hysteresis, for either edge
+    wave = Noisy;
+    Arm(2000, SCOPE_RISING, 0, 1, 0, 0);
+    CHECK(Run(20));
+    CHECK_EQ(scope.trigger_step, 310);
+    CHECK_EQ(Record_Errors(), 0);
+    wave = Noisy_Inverted;
+    Arm(2000, SCOPE_FALLING, 0, 1, 0, 0);
+    CHECK(Run(20));
+    CHECK_EQ(scope.trigger_step, 310);
+
+    // Exactly the hysteresis away re-arms
+    wave = Noisy;
+    Arm(1980 + SCOPE_HYSTERESIS, SCOPE_RISING, 0, 1, 0, 0);
+    CHECK(Run(20));
+    CHECK_EQ(scope.trigger_step, 310);
+    Arm(1980 + SCOPE_HYSTERESIS - 1, SCOPE_RISING, 0, 1, 0, 0);
+    CHECK(!Run(20));
+}
+
+static void Test_Pretrigger(void)
+{
+    // 0 %: the record starts at the trigger
+    wave = Triangle;
+    Arm(2000, SCOPE_RISING, 0, 1, 0, 0);
+    CHECK_EQ(scope.pre_steps, 0);
+    CHECK(Run(20));
+    CHECK_EQ(scope.trigger_step, 25);
+    CHECK(Scope_Get(&scope, 0, 0) >= 2000);
+    CHECK_EQ(Record_Errors(), 0);
+
+    // 100 %: the record ends right before the trigger, which completes it
+    Arm(2000, SCOPE_RISING, 100, 1, 0, 0);
+    CHECK_EQ(scope.pre_steps, SCOPE_RECORD);
+    CHECK(Run(20));
+    CHECK_EQ(scope.trigger_step, 225);
+    CHECK(Scope_Get(&scope, SCOPE_RECORD - 1, 0) < 2000);
+    CHECK_EQ(Record_Errors(), 0);
+
+    // Only what follows the pre-trigger part primes the trigger: a signal
+    // that goes up right there is not a crossing
+    wave = Step_Up;
+    step_at = 64;
+    Arm(2000, SCOPE_RISING, 50, 1, 0, 0);
+    CHECK(!Run(20));
+    CHECK_EQ(scope.state, SCOPE_ARMED);
+
+    // More than 100 is taken as 100
+    Arm(2000, SCOPE_RISING, 250, 1, 0, 0);
+    CHECK_EQ(scope.pre_steps, SCOPE_RECORD);
+}
+
+static void Test_Auto(void)
+{
+    // No trigger: after the given halves the newest record is taken
+    wave = Flat;
+    Arm(3000, SCOPE_RISING, 25, 1, 0, 3);
+    CHECK(!Run(2));
+    CHECK(Run(1));
+    CHECK_EQ(scope.forced, 1);
+    CHECK_EQ(scope.trigger_step - scope.pre_steps + Scope_Steps(&scope), 3 * SCOPE_HALF);
+    CHECK_EQ(Record_Errors(), 0);
+
+    // One half is already a full record
+    Arm(3000, SCOPE_RISING, 0, 2, 0, 1);
+    CHECK(Run(1));
+    CHECK_EQ(scope.forced, 1);
+    CHECK_EQ(Record_Errors(), 0);
+
+    // Without auto mode it waits
+    Arm(3000, SCOPE_RISING, 50, 1, 0, 0);
+    CHECK(!Run(50));
+    CHECK_EQ(scope.state, SCOPE_ARMED);
+
+    // A trigger in the half that would have forced it wins
+    wave = Triangle;
+    Arm(2000, SCOPE_RISING, 0, 1, 0, 1);
+    CHECK(!Run(1));
+    CHECK_EQ(scope.state, SCOPE_TRIGGERED);
+    CHECK(Run(1));
+    CHECK_EQ(scope.forced, 0);
+    CHECK_EQ(scope.trigger_step, 25);
+}
+
+static void Test_Stride(void)
+{
+    // Two channels: a step holds one sample of each, the trigger looks at
+    // its lane only
+    wave = Triangle;
+    Arm(2000, SCOPE_RISING, 50, 2, 1, 0);
+    CHECK_EQ(Scope_Steps(&scope), SCOPE_RECORD / 2);
+    CHECK_EQ(scope.pre_steps, 32);
+    CHECK(Run(20));
+    CHECK_EQ(scope.trigger_step, 125);
+    CHECK(Scope_Get(&scope, 32, 1) >= 2000);
+    CHECK_EQ(Scope_Get(&scope, 32, 0), 125);
+    CHECK_EQ(Record_Errors(), 0);
+
+    Arm(2000, SCOPE_FALLING, 50, 2, 0, 0);
+    CHECK(Run(20));
+    CHECK_EQ(scope.trigger_step, 75);
+    CHECK_EQ(Scope_Get(&scope, 32, 1), 75);
+    CHECK_EQ(Record_Errors(), 0);
+}
+
+static void Test_Boundaries(void)
+{
+    // Triggers on and around the half, full and wrap boundaries, at every
+    // pre-trigger share the menu offers
+    static const uint32_t around[] = { SCOPE_HALF, 2 * SCOPE_HALF, 3 * SCOPE_HALF, 4 * SCOPE_HALF };
+    uint32_t errors = 0, wrong = 0;
+
+    wave = Step_Up;
+    for (uint8_t a = 0; a < 4; a++) {
+        for (int8_t d = -2; d <= 2; d++) {
+            for (uint16_t pct = 0; pct <= 100; pct += 25) {
+                for (uint8_t channels = 1; channels <= 2; channels++) {
+                    step_at = (around[a] + d) / channels;
+                    Arm(2000, SCOPE_RISING, pct, channels, channels - 1, 0);
+                    wrong += !Run(20) || scope.trigger_step != step_at;
+                    errors += Record_Errors();
+                }
+            }
+        }
+    }
+    CHECK_EQ(wrong, 0);
+    CHECK_EQ(errors, 0);
+
+    // Random steps, shares and lanes
+    srand(7);
+    for (uint32_t i = 0; i < 20000; i++) {
+        uint16_t pct = (uint16_t)(rand() % 101);
+        uint8_t channels = (uint8_t)(1 + rand() % 2);
+
+        step_at = SCOPE_RECORD / channels + (uint32_t)(rand() % (6 * SCOPE_HALF));
+        Arm(2000, SCOPE_RISING, pct, channels, (uint8_t)(rand() % channels), (uint16_t)(rand() % 4));
+        Run(50);
+        wrong += scope.state != SCOPE_DONE || (!scope.forced && scope.trigger_step != step_at);
+        errors += Record_Errors();
+    }
+    CHECK_EQ(wrong, 0);
+    CHECK_EQ(errors, 0);
+}
+
+int main(void)
+{
+    Test_Edges();
+    Test_Pretrigger();
+    Test_Auto();
+    Test_Stride();
+    Test_Boundaries();
+    return CHECK_DONE();
+}
@@ -0,0 +1,245 @@
+/**
+  ******************************************************************************
+  * @file           : test_ssd1306.c
+  * @brief          : Glyph cache and partial flushes against the full-screen paths
+  ******************************************************************************
+  * @attention
+  *
+  * HAL_I2C_Mem_Write() feeds a model of the controller: commands are parsed
+  * with their argument bytes, data goes to GDDRAM at the RAM pointer, which
+  * moves as in horizontal addressing mode within the 0x21/0x22 window. Two
+  * panels receive the same frames, one through full ssd1306_UpdateScreen()
+  * calls and one through ssd1306_UpdateArea() calls of the changed regions
+  * only; their GDDRAM must stay identical.
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "ssd1306/ssd1306.h"
+
+#define PANEL_PAGES             8       // GDDRAM of the controller, 128 x 64
+
+typedef struct {
+    uint8_t ram[PANEL_PAGES][SSD1306_WIDTH];
+    uint8_t column, page;
+    uint8_t column_start, column_end, page_start, page_end;
+    uint8_t command[3];
+    uint8_t command_length;
+} Panel_t;
+
+I2C_HandleTypeDef hi2c1;
+
+static Panel_t full_panel, dirty_panel;
+static Panel_t* panel = &full_panel;    // Receives the bus traffic
+
+static void Panel_Reset(Panel_t* target)
+{
+    memset(target, 0, sizeof(*target));
+    target->column_end = SSD1306_WIDTH - 1;
+    target->page_end = PANEL_PAGES - 1;
+}
+
+// Bytes of a command including its arguments
+static uint8_t Panel_Command_Length(uint8_t opcode)
+{
+    switch (opcode) {
+        case 0x21: case 0x22:
+            return 3;
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+        case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+static void Panel_Command(uint8_t byte)
+{
+    uint8_t* command = panel->command;
+
+    command[panel->command_length++] = byte;
+    if (panel->command_length < Panel_Command_Length(command[0])) {
+        return;
+    }
+    panel->command_length = 0;
+
+    if (command[0] == 0x21) {
+        panel->column_start = panel->column = command[1];
+        panel->column_end = command[2];
+    } else if (command[0] == 0x22) {
+        panel->page_start = panel->page = command[1];
+        panel->page_end = command[2];
+    } else if (command[0] >= 0xB0 && command[0] <= 0xB7) {
+        panel->page = command[0] & 0x07;
+    } else if (command[0] <= 0x0F) {
+        panel->column = (panel->column & 0xF0) | command[0];
+    } else if (command[0] <= 0x1F) {
+        panel->column = (panel->column & 0x0F) | (uint8_t)((command[0] & 0x0F) << 4);
+    }
+}
+
+static void Panel_Data(uint8_t byte)
+{
+    panel->ram[panel->page][panel->column] = byte;
+    if (panel->column < panel->column_end) {
+        panel->column++;
+        return;
+    }
+    panel->column = panel->column_start;
+    panel->page = (panel->page < panel->page_end) ? panel->page + 1 : panel->page_start;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef* hi2c, uint16_t address, uint16_t mem_address,
+                                    uint16_t mem_size, uint8_t* data, uint16_t size, uint32_t timeout)
+{
+    (void)hi2c;
+    (void)address;
+    (void)mem_size;
+    (void)timeout;
+    for (uint16_t i = 0; i < size; i++) {
+        if (mem_address == 0x40) {
+            Panel_Data(data[i]);
+        } else {
+            Panel_Command(data[i]);
+        }
+    }
+    return HAL_OK;
+}
+
+// Screen buffer as seen on a panel after a full update
+static void Snapshot(uint8_t* dst)
+{
+    Panel_t* previous = panel;
+    Panel_t scratch;
+
+    Panel_Reset(&scratch);
+    panel = &scratch;
+    ssd1306_UpdateScreen();
+    panel = previous;
+    memcpy(dst, scratch.ram, SSD1306_BUFFER_SIZE);
+}
+
+static void Test_Glyph_Cache(void)
+{
+    static const FontDef* fonts[] = { &Font_6x8, &Font_7x10 };
+    static const char charset[] = " .:-0123456789VAIPWEmhk";
+    static uint16_t columns[(sizeof(charset) - 1) * 7];
+    uint8_t direct[SSD1306_BUFFER_SIZE], cached[SSD1306_BUFFER_SIZE];
+    uint32_t mismatches = 0;
+
+    // Every y offset within the page, both colors, over a busy background;
+    // 'x' is not cached and takes the fallback path
+    for (uint8_t f = 0; f < 2; f++) {
+        SSD1306_GlyphCache cache;
+        ssd1306_GlyphCacheInit(&cache, fonts[f], charset, columns);
+        for (uint8_t y = 0; y + fonts[f]->FontHeight <= SSD1306_HEIGHT; y++) {
+            for (uint8_t color = Black; color <= White; color++) {
+                ssd1306_Fill(Black);
+                ssd1306_Line(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, White);
+                ssd1306_FillRectangle(40, 3, 70, 28, White);
+                ssd1306_SetCursor(3, y);
+                ssd1306_WriteString("-12.34V 5.6Ax9:0", *fonts[f], (SSD1306_COLOR)color);
+                Snapshot(direct);
+
+                ssd1306_Fill(Black);
+                ssd1306_Line(0, 0, SSD1306_WIDTH - 1, SSD1306_HEIGHT - 1, White);
+                ssd1306_FillRectangle(40, 3, 70, 28, White);
+                ssd1306_SetCursor(3, y);
+                ssd1306_WriteStringCached(&cache, "-12.34V 5.6Ax9:0", (SSD1306_COLOR)color);
+                Snapshot(cached);
+
+                mismatches += memcmp(direct, cached, sizeof(direct)) != 0;
+            }
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+
+    // Both stop at the right edge on the same character
+    SSD1306_GlyphCache cache;
+    ssd1306_GlyphCacheInit(&cache, &Font_7x10, charset, columns);
+    ssd1306_SetCursor(SSD1306_WIDTH - 10, 0);
+    CHECK_EQ(ssd1306_WriteString("12", Font_7x10, White), '2');
+    ssd1306_SetCursor(SSD1306_WIDTH - 10, 0);
+    CHECK_EQ(ssd1306_WriteStringCached(&cache, "12", White), '2');
+}
+
+// Draw inside a random rectangle and return its bounds
+static void Random_Region(uint8_t* x, uint8_t* w, uint8_t* y, uint8_t* h)
+{
+    *x = (uint8_t)(rand() % SSD1306_WIDTH);
+    *w = (uint8_t)(1 + rand() % (SSD1306_WIDTH - *x));
+    *y = (uint8_t)(rand() % SSD1306_HEIGHT);
+    *h = (uint8_t)(1 + rand() % (SSD1306_HEIGHT - *y));
+
+    for (uint8_t i = 0; i < 8; i++) {
+        ssd1306_DrawPixel((uint8_t)(*x + rand() % *w), (uint8_t)(*y + rand() % *h),
+                          (rand() & 1) ? White : Black);
+    }
+    ssd1306_FillRectangle(*x, *y, (uint8_t)(*x + rand() % *w), (uint8_t)(*y + rand() % *h),
+                          (rand() & 1) ? White : Black);
+}
+
+static void Test_Partial_Flush(void)
+{
+    uint32_t mismatches = 0;
+
+    Panel_Reset(&full_panel);
+    Panel_Reset(&dirty_panel);
+    srand(3);
+
+    // Both panels start from the same initialized, fully written screen
+    panel = &full_panel;
+    ssd1306_Init();
+    panel = &dirty_panel;
+    ssd1306_Init();
+    CHECK(memcmp(full_panel.ram, dirty_panel.ram, sizeof(full_panel.ram)) == 0);
+
+    for (uint32_t frame = 0; frame < 2000; frame++) {
+        uint8_t regions = (uint8_t)(1 + rand() % 4);
+
+        panel = &dirty_panel;
+        for (uint8_t r = 0; r < regions; r++) {
+            uint8_t x, w, y, h;
+            Random_Region(&x, &w, &y, &h);
+            // The pages a widget covers, as UI_Flush_Widget() computes them
+            ssd1306_UpdateArea(x, w, y / 8, (uint8_t)((y + h - 1) / 8));
+        }
+        // Now and then a full repaint follows partial ones
+        if (frame % 50 == 49) {
+            ssd1306_Fill((frame & 64) ? White : Black);
+            ssd1306_UpdateScreen();
+        }
+
+        panel = &full_panel;
+        ssd1306_UpdateScreen();
+        mismatches += memcmp(full_panel.ram, dirty_panel.ram, sizeof(full_panel.ram)) != 0;
+    }
+    CHECK_EQ(mismatches, 0);
+
+    // Rows below the 32-row screen are never written
+    uint8_t blank[PANEL_PAGES / 2][SSD1306_WIDTH] = { { 0 } };
+    CHECK(memcmp(&dirty_panel.ram[SSD1306_HEIGHT / 8], blank, sizeof(blank)) == 0);
+
+    // Out of range areas send nothing, over-wide ones are clipped
+    Panel_t before = dirty_panel;
+    panel = &dirty_panel;
+    ssd1306_UpdateArea(SSD1306_WIDTH, 4, 0, 0);
+    ssd1306_UpdateArea(0, 0, 0, 0);
+    ssd1306_UpdateArea(0, 4, 2, 1);
+    ssd1306_UpdateArea(0, 4, 0, SSD1306_HEIGHT / 8);
+    CHECK(memcmp(&before, &dirty_panel, sizeof(before)) == 0);
+    ssd1306_Fill(White);
+    ssd1306_UpdateArea(SSD1306_WIDTH - 2, 200, 1, 1);
+    CHECK_EQ(dirty_panel.ram[1][SSD1306_WIDTH - 1], 0xFF);
+    CHECK_EQ(dirty_panel.ram[2][SSD1306_WIDTH - 2], before.ram[2][SSD1306_WIDTH - 2]);
+    CHECK_EQ(dirty_panel.ram[1][0], before.ram[1][0]);
+}
+
+int main(void)
+{
+    Test_Glyph_Cache();
+    Test_Partial_Flush();
+    return CHECK_DONE();
+}
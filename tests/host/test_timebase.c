@@ -0,0 +1,136 @@
+/**
+  ******************************************************************************
+  * @file           : test_timebase.c
+  * @brief          : Overflow extension with a pending update and the ms clock
+  ******************************************************************************
+  * @attention
+  *
+  * The TIM2 registers are driven by hand: Advance() counts like the timer
+  * and raises UIF on a wrap, the interrupt runs only when the test says so,
+  * as when the reader has interrupts masked or outranks the timer.
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include "check.h"
+#include "timebase.h"
+
+static TIM_TypeDef tim;
+static TIM_HandleTypeDef htim = { &tim };
+static uint64_t truth_us;
+
+static void Advance(uint32_t us)
+{
+    while (us--) {
+        truth_us++;
+        tim.CNT = (tim.CNT + 1) & 0xFFFFU;
+        if (tim.CNT == 0) {
+            tim.SR |= TIM_SR_UIF;
+        }
+    }
+}
+
+static void Start(void)
+{
+    tim = (TIM_TypeDef){ 0 };
+    truth_us = 0;
+    Timebase_Init(&htim);
+}
+
+static void Test_Pending_Update(void)
+{
+    Start();
+    Advance(0xFFF0);
+    CHECK_EQ(Timebase_Now_us64(), 0xFFF0);
+
+    // Wrapped, interrupt not run yet: the pending flag carries the overflow
+    Advance(0x20);
+    CHECK(tim.SR & TIM_SR_UIF);
+    CHECK_EQ(Timebase_Now_us64(), 0x10010);
+    CHECK_EQ(Timebase_Now_ms(), 0x10010 / 1000);
+
+    // Reading leaves the flag to the interrupt, which counts it once
+    CHECK(tim.SR & TIM_SR_UIF);
+    Timebase_IRQHandler();
+    CHECK(!(tim.SR & TIM_SR_UIF));
+    CHECK_EQ(Timebase_Now_us64(), 0x10010);
+    Timebase_IRQHandler();
+    CHECK_EQ(Timebase_Now_us64(), 0x10010);
+
+    // Interrupts masked by the caller stay masked, unmasked stay unmasked
+    host_primask = 1;
+    Timebase_Now_us64();
+    Timebase_Now_ms();
+    CHECK_EQ(host_primask, 1);
+    host_primask = 0;
+    Timebase_Now_us64();
+    CHECK_EQ(host_primask, 0);
+}
+
+static void Test_Delayed_Interrupt(void)
+{
+    uint64_t last_us = 0;
+    uint32_t errors = 0;
+
+    Start();
+    srand(1);
+
+    // Random steps, the interrupt runs late or not before the next read;
+    // never more than one overflow outstanding, as on the target
+    for (uint32_t i = 0; i < 500000; i++) {
+        Advance((uint32_t)rand() % 400);
+        if (rand() % 3) {
+            Timebase_IRQHandler();
+        }
+        uint64_t now_us = Timebase_Now_us64();
+        errors += now_us != truth_us || now_us < last_us;
+        errors += Timebase_Now_ms() != (uint32_t)(truth_us / 1000);
+        errors += Timebase_Now_us() != (uint32_t)truth_us;
+        last_us = now_us;
+        if (tim.SR & TIM_SR_UIF && tim.CNT > 0x8000) {
+            Timebase_IRQHandler();
+        }
+    }
+    CHECK_EQ(errors, 0);
+    CHECK(truth_us > 6 * 65536);
+}
+
+static void Test_Long_Run(void)
+{
+    uint32_t errors = 0;
+
+    Start();
+
+    // Wrap by wrap past the 32-bit us (71 min) and ms (49 days) rollovers
+    for (uint64_t wraps = 1; wraps <= (1ULL << 32) / 65 + 1000; wraps++) {
+        truth_us += 0x10000;
+        tim.SR = TIM_SR_UIF;
+        if (wraps % 4096 == 0 || (wraps > 65535000 && wraps < 65537000)) {
+            // Pending and counted must agree, also across the rollovers
+            tim.CNT = (uint32_t)(wraps % 0x10000);
+            uint64_t expected_us = truth_us + tim.CNT;
+            errors += Timebase_Now_us64() != expected_us;
+            errors += Timebase_Now_ms() != (uint32_t)(expected_us / 1000);
+            Timebase_IRQHandler();
+            errors += Timebase_Now_ms() != (uint32_t)(expected_us / 1000);
+            tim.CNT = 0;
+        } else {
+            Timebase_IRQHandler();
+        }
+    }
+    CHECK_EQ(errors, 0);
+    CHECK(truth_us / 1000 > UINT32_MAX);
+    CHECK_EQ(Timebase_Now_ms(), (uint32_t)(truth_us / 1000));
+}
+
+int main(void)
+{
+    // Before Timebase_Init() the clocks read 0, edge interrupts may come first
+    CHECK_EQ(Timebase_Now_us64(), 0);
+    CHECK_EQ(Timebase_Now_ms(), 0);
+
+    Test_Pending_Update();
+    Test_Delayed_Interrupt();
+    Test_Long_Run();
+    return CHECK_DONE();
+}